@@ -5,18 +5,469 @@
 #include "base/base64.h"
 
 #include <stddef.h>
+#include <string.h>
 
+#include <algorithm>
+
+#include "build/build_config.h"
 #include "third_party/modp_b64/modp_b64.h"
 
+#if defined(ARCH_CPU_X86_FAMILY) && \
+    (defined(COMPILER_GCC) || defined(__clang__))
+#define BASE64_X86_KERNELS
+#include <immintrin.h>
+
+#include "base/cpu.h"
+#elif defined(ARCH_CPU_ARM64)
+#include <arm_neon.h>
+#endif
+
 namespace base {
 
+namespace {
+
+// The vector kernels below only encode and decode whole blocks of groups, and
+// leave the rest of the input, and any block with an invalid character, to
+// modp_b64. Since base64 encodes each group of three bytes independently of
+// the others, the output is exactly that of modp_b64 alone, and so is whether
+// decoding fails.
+
+#if defined(BASE64_X86_KERNELS)
+
+// Converts the 6-bit values in |indices| to base64 characters.
+__attribute__((target("ssse3"))) inline __m128i IndicesToAsciiSsse3(
+    __m128i indices) {
+  // Map 0..25 to 13, 26..51 to 0, and 52..63 to 1..12, then add the offset
+  // from the value to its character for each of these ranges.
+  const __m128i kOffsets =
+      _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                    '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                    '/' - 63, 'A', 0, 0);
+  __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  const __m128i is_upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+  range = _mm_or_si128(range, _mm_and_si128(is_upper, _mm_set1_epi8(13)));
+  return _mm_add_epi8(_mm_shuffle_epi8(kOffsets, range), indices);
+}
+
+// Spreads the 12 bytes at the start of |input| into 16 6-bit values.
+__attribute__((target("ssse3"))) inline __m128i BytesToIndicesSsse3(
+    __m128i input) {
+  input = _mm_shuffle_epi8(
+      input, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+  // Move the first and third value of each group into place with a high
+  // multiplication, and the second and fourth with a low one.
+  const __m128i first_third = _mm_mulhi_epu16(
+      _mm_and_si128(input, _mm_set1_epi32(0x0fc0fc00)),
+      _mm_set1_epi32(0x04000040));
+  const __m128i second_fourth = _mm_mullo_epi16(
+      _mm_and_si128(input, _mm_set1_epi32(0x003f03f0)),
+      _mm_set1_epi32(0x01000010));
+  return _mm_or_si128(first_third, second_fourth);
+}
+
+// Converts the base64 characters in |input| to their 6-bit values. Returns
+// false if any of them isn't a base64 character.
+__attribute__((target("ssse3"))) inline bool AsciiToIndicesSsse3(
+    __m128i input,
+    __m128i* indices) {
+  // The characters with the same high nibble map to their values with the
+  // same offset, except for '/', which shares it with '+'.
+  const __m128i kOffsets = _mm_setr_epi8(0, 0, 19, 4, -65, -65, -71, -71, 0, 0,
+                                         0, 0, 0, 0, 0, 0);
+  // Bit n of entry l is set if character 16 * n + l is a base64 character.
+  const __m128i kValidHighNibbles = _mm_setr_epi8(
+      static_cast<char>(0xa8), static_cast<char>(0xf8), static_cast<char>(0xf8),
+      static_cast<char>(0xf8), static_cast<char>(0xf8), static_cast<char>(0xf8),
+      static_cast<char>(0xf8), static_cast<char>(0xf8), static_cast<char>(0xf8),
+      static_cast<char>(0xf8), static_cast<char>(0xf0), 0x54, 0x50, 0x50, 0x50,
+      0x54);
+  const __m128i kHighNibbleBits =
+      _mm_setr_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40,
+                    static_cast<char>(0x80), 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+  const __m128i high = _mm_and_si128(_mm_srli_epi32(input, 4), nibble_mask);
+  const __m128i low = _mm_and_si128(input, nibble_mask);
+  const __m128i valid =
+      _mm_and_si128(_mm_shuffle_epi8(kValidHighNibbles, low),
+                    _mm_shuffle_epi8(kHighNibbleBits, high));
+  if (_mm_movemask_epi8(_mm_cmpeq_epi8(valid, _mm_setzero_si128())))
+    return false;
+  const __m128i is_slash = _mm_cmpeq_epi8(input, _mm_set1_epi8('/'));
+  const __m128i offsets =
+      _mm_add_epi8(_mm_shuffle_epi8(kOffsets, high),
+                   _mm_and_si128(is_slash, _mm_set1_epi8(-3)));
+  *indices = _mm_add_epi8(input, offsets);
+  return true;
+}
+
+// Packs the 16 6-bit values in |indices| into 12 bytes at the start of the
+// result.
+__attribute__((target("ssse3"))) inline __m128i IndicesToBytesSsse3(
+    __m128i indices) {
+  const __m128i pairs =
+      _mm_maddubs_epi16(indices, _mm_set1_epi32(0x01400140));
+  const __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+  return _mm_shuffle_epi8(groups, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14,
+                                                13, 12, -1, -1, -1, -1));
+}
+
+// Each block encodes 12 bytes into 16 characters, but reads 16 bytes.
+__attribute__((target("ssse3"))) size_t EncodeBlocksSsse3(const uint8_t* input,
+                                                          size_t input_size,
+                                                          char* output) {
+  size_t pos = 0;
+  for (; input_size - pos >= 16; pos += 12, output += 16) {
+    const __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + pos));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output),
+                     IndicesToAsciiSsse3(BytesToIndicesSsse3(bytes)));
+  }
+  return pos;
+}
+
+// Each block decodes 16 characters into 12 bytes, but writes 16 bytes.
+__attribute__((target("ssse3"))) size_t DecodeBlocksSsse3(
+    const char* input,
+    size_t input_size,
+    uint8_t* output,
+    size_t output_size) {
+  size_t pos = 0;
+  for (; input_size - pos >= 16 && output_size >= 16;
+       pos += 16, output += 12, output_size -= 12) {
+    __m128i indices;
+    if (!AsciiToIndicesSsse3(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + pos)),
+            &indices)) {
+      break;
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output),
+                     IndicesToBytesSsse3(indices));
+  }
+  return pos;
+}
+
+// The AVX2 kernels work like the SSSE3 ones on each 128-bit lane.
+
+__attribute__((target("avx2"))) inline __m256i IndicesToAsciiAvx2(
+    __m256i indices) {
+  const __m256i kOffsets = _mm256_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+  const __m256i is_upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+  range =
+      _mm256_or_si256(range, _mm256_and_si256(is_upper, _mm256_set1_epi8(13)));
+  return _mm256_add_epi8(_mm256_shuffle_epi8(kOffsets, range), indices);
+}
+
+__attribute__((target("avx2"))) inline __m256i BytesToIndicesAvx2(
+    __m256i input) {
+  input = _mm256_shuffle_epi8(
+      input, _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                              1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11,
+                              10));
+  const __m256i first_third = _mm256_mulhi_epu16(
+      _mm256_and_si256(input, _mm256_set1_epi32(0x0fc0fc00)),
+      _mm256_set1_epi32(0x04000040));
+  const __m256i second_fourth = _mm256_mullo_epi16(
+      _mm256_and_si256(input, _mm256_set1_epi32(0x003f03f0)),
+      _mm256_set1_epi32(0x01000010));
+  return _mm256_or_si256(first_third, second_fourth);
+}
+
+__attribute__((target("avx2"))) inline bool AsciiToIndicesAvx2(
+    __m256i input,
+    __m256i* indices) {
+  const __m256i kOffsets =
+      _mm256_setr_epi8(0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                       0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i kValidHighNibbles = _mm256_setr_epi8(
+      static_cast<char>(0xa8), static_cast<char>(0xf8), static_cast<char>(0xf8),
+      static_cast<char>(0xf8), static_cast<char>(0xf8), static_cast<char>(0xf8),
+      static_cast<char>(0xf8), static_cast<char>(0xf8), static_cast<char>(0xf8),
+      static_cast<char>(0xf8), static_cast<char>(0xf0), 0x54, 0x50, 0x50, 0x50,
+      0x54, static_cast<char>(0xa8), static_cast<char>(0xf8),
+      static_cast<char>(0xf8), static_cast<char>(0xf8), static_cast<char>(0xf8),
+      static_cast<char>(0xf8), static_cast<char>(0xf8), static_cast<char>(0xf8),
+      static_cast<char>(0xf8), static_cast<char>(0xf8), static_cast<char>(0xf0),
+      0x54, 0x50, 0x50, 0x50, 0x54);
+  const __m256i kHighNibbleBits = _mm256_setr_epi8(
+      0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, static_cast<char>(0x80), 0, 0,
+      0, 0, 0, 0, 0, 0, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40,
+      static_cast<char>(0x80), 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+  const __m256i high =
+      _mm256_and_si256(_mm256_srli_epi32(input, 4), nibble_mask);
+  const __m256i low = _mm256_and_si256(input, nibble_mask);
+  const __m256i valid =
+      _mm256_and_si256(_mm256_shuffle_epi8(kValidHighNibbles, low),
+                       _mm256_shuffle_epi8(kHighNibbleBits, high));
+  if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(valid, _mm256_setzero_si256())))
+    return false;
+  const __m256i is_slash = _mm256_cmpeq_epi8(input, _mm256_set1_epi8('/'));
+  const __m256i offsets =
+      _mm256_add_epi8(_mm256_shuffle_epi8(kOffsets, high),
+                      _mm256_and_si256(is_slash, _mm256_set1_epi8(-3)));
+  *indices = _mm256_add_epi8(input, offsets);
+  return true;
+}
+
+// Packs the 32 6-bit values in |indices| into 24 bytes at the start of the
+// result.
+__attribute__((target("avx2"))) inline __m256i IndicesToBytesAvx2(
+    __m256i indices) {
+  const __m256i pairs =
+      _mm256_maddubs_epi16(indices, _mm256_set1_epi32(0x01400140));
+  const __m256i groups =
+      _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+  const __m256i lanes = _mm256_shuffle_epi8(
+      groups,
+      _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                       2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+  return _mm256_permutevar8x32_epi32(lanes,
+                                     _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+}
+
+// Each block encodes 24 bytes into 32 characters, but reads 28 bytes.
+__attribute__((target("avx2"))) size_t EncodeBlocksAvx2(const uint8_t* input,
+                                                        size_t input_size,
+                                                        char* output) {
+  size_t pos = 0;
+  for (; input_size - pos >= 28; pos += 24, output += 32) {
+    const __m256i bytes = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + pos))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + pos + 12)),
+        1);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output),
+                        IndicesToAsciiAvx2(BytesToIndicesAvx2(bytes)));
+  }
+  return pos;
+}
+
+// Each block decodes 32 characters into 24 bytes, but writes 32 bytes.
+__attribute__((target("avx2"))) size_t DecodeBlocksAvx2(const char* input,
+                                                        size_t input_size,
+                                                        uint8_t* output,
+                                                        size_t output_size) {
+  size_t pos = 0;
+  for (; input_size - pos >= 32 && output_size >= 32;
+       pos += 32, output += 24, output_size -= 24) {
+    __m256i indices;
+    if (!AsciiToIndicesAvx2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + pos)),
+            &indices)) {
+      break;
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output),
+                        IndicesToBytesAvx2(indices));
+  }
+  return pos;
+}
+
+enum class Kernels { kNone, kSsse3, kAvx2 };
+
+Kernels GetKernels() {
+  static const Kernels kernels = [] {
+    const CPU& cpu = CPU::GetInstanceNoAllocation();
+    if (cpu.has_avx2())
+      return Kernels::kAvx2;
+    if (cpu.has_ssse3())
+      return Kernels::kSsse3;
+    return Kernels::kNone;
+  }();
+  return kernels;
+}
+
+#elif defined(ARCH_CPU_ARM64)
+
+constexpr char kAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// The values of the characters below 128, with 0xff for characters that aren't
+// base64 characters.
+constexpr uint8_t kDecodeTable[128] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 62,   0xff, 0xff, 0xff, 63,
+    52,   53,   54,   55,   56,   57,   58,   59,   60,   61,   0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0,    1,    2,    3,    4,    5,    6,
+    7,    8,    9,    10,   11,   12,   13,   14,   15,   16,   17,   18,
+    19,   20,   21,   22,   23,   24,   25,   0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 26,   27,   28,   29,   30,   31,   32,   33,   34,   35,   36,
+    37,   38,   39,   40,   41,   42,   43,   44,   45,   46,   47,   48,
+    49,   50,   51,   0xff, 0xff, 0xff, 0xff, 0xff};
+
+inline uint8x16x4_t LoadTable(const uint8_t* table) {
+  return {vld1q_u8(table), vld1q_u8(table + 16), vld1q_u8(table + 32),
+          vld1q_u8(table + 48)};
+}
+
+// Each block encodes 48 bytes into 64 characters.
+size_t EncodeBlocksNeon(const uint8_t* input, size_t input_size, char* output) {
+  const uint8x16x4_t alphabet =
+      LoadTable(reinterpret_cast<const uint8_t*>(kAlphabet));
+  const uint8x16_t mask = vdupq_n_u8(0x3f);
+  size_t pos = 0;
+  for (; input_size - pos >= 48; pos += 48, output += 64) {
+    const uint8x16x3_t bytes = vld3q_u8(input + pos);
+    uint8x16x4_t indices;
+    indices.val[0] = vshrq_n_u8(bytes.val[0], 2);
+    indices.val[1] = vandq_u8(
+        vsliq_n_u8(vshrq_n_u8(bytes.val[1], 4), bytes.val[0], 4), mask);
+    indices.val[2] = vandq_u8(
+        vsliq_n_u8(vshrq_n_u8(bytes.val[2], 6), bytes.val[1], 2), mask);
+    indices.val[3] = vandq_u8(bytes.val[2], mask);
+    uint8x16x4_t chars;
+    for (int i = 0; i < 4; ++i)
+      chars.val[i] = vqtbl4q_u8(alphabet, indices.val[i]);
+    vst4q_u8(reinterpret_cast<uint8_t*>(output), chars);
+  }
+  return pos;
+}
+
+// Each block decodes 64 characters into 48 bytes.
+size_t DecodeBlocksNeon(const char* input,
+                        size_t input_size,
+                        uint8_t* output,
+                        size_t output_size) {
+  const uint8x16x4_t low_table = LoadTable(kDecodeTable);
+  const uint8x16x4_t high_table = LoadTable(kDecodeTable + 64);
+  const uint8x16_t offset = vdupq_n_u8(64);
+  const uint8x16_t max_value = vdupq_n_u8(63);
+  size_t pos = 0;
+  for (; input_size - pos >= 64 && output_size >= 48;
+       pos += 64, output += 48, output_size -= 48) {
+    const uint8x16x4_t chars =
+        vld4q_u8(reinterpret_cast<const uint8_t*>(input + pos));
+    uint8x16x4_t indices;
+    uint8x16_t invalid = vdupq_n_u8(0);
+    for (int i = 0; i < 4; ++i) {
+      // Out of range table indices give 0, so characters from 128 up look up
+      // 0 in both tables and are caught by the second check.
+      indices.val[i] =
+          vorrq_u8(vqtbl4q_u8(low_table, chars.val[i]),
+                   vqtbl4q_u8(high_table, vsubq_u8(chars.val[i], offset)));
+      invalid = vorrq_u8(invalid, vcgtq_u8(indices.val[i], max_value));
+      invalid = vorrq_u8(invalid, vcgtq_u8(chars.val[i], vdupq_n_u8(127)));
+    }
+    if (vmaxvq_u8(invalid))
+      break;
+    uint8x16x3_t bytes;
+    bytes.val[0] = vorrq_u8(vshlq_n_u8(indices.val[0], 2),
+                            vshrq_n_u8(indices.val[1], 4));
+    bytes.val[1] = vorrq_u8(vshlq_n_u8(indices.val[1], 4),
+                            vshrq_n_u8(indices.val[2], 2));
+    bytes.val[2] = vorrq_u8(vshlq_n_u8(indices.val[2], 6), indices.val[3]);
+    vst3q_u8(output, bytes);
+  }
+  return pos;
+}
+
+#endif
+
+// Encodes as many whole blocks of |input| as the kernels for this CPU can, and
+// returns the number of bytes encoded, which is a multiple of 3.
+size_t EncodeBlocks(const uint8_t* input, size_t input_size, char* output) {
+  size_t encoded = 0;
+#if defined(BASE64_X86_KERNELS)
+  switch (GetKernels()) {
+    case Kernels::kAvx2:
+      encoded = EncodeBlocksAvx2(input, input_size, output);
+      [[fallthrough]];
+    case Kernels::kSsse3:
+      encoded += EncodeBlocksSsse3(input + encoded, input_size - encoded,
+                                   output + encoded / 3 * 4);
+      break;
+    case Kernels::kNone:
+      break;
+  }
+#elif defined(ARCH_CPU_ARM64)
+  encoded = EncodeBlocksNeon(input, input_size, output);
+#endif
+  return encoded;
+}
+
+// Decodes as many whole blocks of |input| as the kernels for this CPU can into
+// |output|, which has room for |output_size| bytes, and returns the number of
+// characters decoded, which is a multiple of 4. Stops at the first block that
+// has a character that isn't a base64 character, including padding.
+size_t DecodeBlocks(const char* input,
+                    size_t input_size,
+                    uint8_t* output,
+                    size_t output_size) {
+  size_t decoded = 0;
+#if defined(BASE64_X86_KERNELS)
+  switch (GetKernels()) {
+    case Kernels::kAvx2:
+      decoded = DecodeBlocksAvx2(input, input_size, output, output_size);
+      [[fallthrough]];
+    case Kernels::kSsse3:
+      decoded += DecodeBlocksSsse3(input + decoded, input_size - decoded,
+                                   output + decoded / 4 * 3,
+                                   output_size - decoded / 4 * 3);
+      break;
+    case Kernels::kNone:
+      break;
+  }
+#elif defined(ARCH_CPU_ARM64)
+  decoded = DecodeBlocksNeon(input, input_size, output, output_size);
+#endif
+  return decoded;
+}
+
+// Like modp_b64_encode(), which this leaves the tail of |input| to.
+size_t Encode(char* output, const uint8_t* input, size_t input_size) {
+  const size_t encoded = EncodeBlocks(input, input_size, output);
+  return encoded / 3 * 4 +
+         modp_b64_encode(output + encoded / 3 * 4,
+                         reinterpret_cast<const char*>(input + encoded),
+                         input_size - encoded);
+}
+
+// Like modp_b64_decode(), with room for |output_size| bytes in |output|.
+size_t Decode(uint8_t* output, size_t output_size, StringPiece input) {
+  size_t decoded = 0;
+  // Leave the last group, which may be padded, and malformed input to
+  // modp_b64.
+  if (input.size() % 4 == 0 && input.size() > 4) {
+    decoded =
+        DecodeBlocks(input.data(), input.size() - 4, output, output_size);
+  }
+  const size_t size =
+      modp_b64_decode(reinterpret_cast<char*>(output + decoded / 4 * 3),
+                      input.data() + decoded, input.size() - decoded);
+  if (size == MODP_B64_ERROR)
+    return MODP_B64_ERROR;
+  return decoded / 4 * 3 + size;
+}
+
+// Decodes |input|, which must consist of whole groups without padding, and
+// appends the result to |output|.
+bool DecodeUnpaddedGroups(StringPiece input, std::string* output) {
+  const size_t offset = output->size();
+  output->resize(offset + input.size() / 4 * 3);
+  uint8_t* bytes = reinterpret_cast<uint8_t*>(&(*output)[0]) + offset;
+  const size_t decoded =
+      DecodeBlocks(input.data(), input.size(), bytes, input.size() / 4 * 3);
+  input.remove_prefix(decoded);
+  // The vector kernels stop at padding, which modp_b64 would strip.
+  return input.find('=') == StringPiece::npos &&
+         modp_b64_decode(reinterpret_cast<char*>(bytes + decoded / 4 * 3),
+                         input.data(), input.size()) != MODP_B64_ERROR;
+}
+
+}  // namespace
+
 std::string Base64Encode(span<const uint8_t> input) {
   std::string output;
   output.resize(modp_b64_encode_len(input.size()));  // makes room for null byte
 
   // modp_b64_encode_len() returns at least 1, so output[0] is safe to use.
-  const size_t output_size = modp_b64_encode(
-      &(output[0]), reinterpret_cast<const char*>(input.data()), input.size());
+  const size_t output_size = Encode(&(output[0]), input.data(), input.size());
 
   output.resize(output_size);
   return output;
@@ -31,8 +482,8 @@ bool Base64Decode(StringPiece input, std::string* output) {
   temp.resize(modp_b64_decode_len(input.size()));
 
   // does not null terminate result since result is binary data!
-  size_t input_size = input.size();
-  size_t output_size = modp_b64_decode(&(temp[0]), input.data(), input_size);
+  size_t output_size =
+      Decode(reinterpret_cast<uint8_t*>(&(temp[0])), temp.size(), input);
   if (output_size == MODP_B64_ERROR)
     return false;
 
@@ -44,9 +495,7 @@ bool Base64Decode(StringPiece input, std::string* output) {
 absl::optional<std::vector<uint8_t>> Base64Decode(StringPiece input) {
   std::vector<uint8_t> ret(modp_b64_decode_len(input.size()));
 
-  size_t input_size = input.size();
-  size_t output_size = modp_b64_decode(reinterpret_cast<char*>(ret.data()),
-                                       input.data(), input_size);
+  size_t output_size = Decode(ret.data(), ret.size(), input);
   if (output_size == MODP_B64_ERROR)
     return absl::nullopt;
 
@@ -54,4 +503,58 @@ absl::optional<std::vector<uint8_t>> Base64Decode(StringPiece input) {
   return ret;
 }
 
+Base64StreamDecoder::Base64StreamDecoder() = default;
+
+Base64StreamDecoder::~Base64StreamDecoder() = default;
+
+bool Base64StreamDecoder::Append(StringPiece chunk, std::string* output) {
+  if (failed_)
+    return false;
+
+  // Complete the held back group first.
+  if (pending_size_ < sizeof(pending_)) {
+    const size_t size =
+        std::min(sizeof(pending_) - pending_size_, chunk.size());
+    memcpy(pending_ + pending_size_, chunk.data(), size);
+    pending_size_ += size;
+    chunk.remove_prefix(size);
+  }
+  if (chunk.empty())
+    return true;
+
+  // More input follows, so neither the held back group nor any but the last
+  // group of |chunk| may be padded.
+  const size_t original_size = output->size();
+  const size_t held_back = chunk.size() % 4 ? chunk.size() % 4 : 4;
+  const StringPiece groups = chunk.substr(0, chunk.size() - held_back);
+  if (!DecodeUnpaddedGroups(StringPiece(pending_, pending_size_), output) ||
+      !DecodeUnpaddedGroups(groups, output)) {
+    output->resize(original_size);
+    failed_ = true;
+    return false;
+  }
+  memcpy(pending_, chunk.data() + chunk.size() - held_back, held_back);
+  pending_size_ = held_back;
+  return true;
+}
+
+bool Base64StreamDecoder::Finish(std::string* output) {
+  const bool failed = failed_;
+  const StringPiece last_group(pending_, pending_size_);
+  failed_ = false;
+  pending_size_ = 0;
+  if (failed)
+    return false;
+  // An empty input decodes to nothing.
+  if (last_group.empty())
+    return true;
+
+  uint8_t bytes[modp_b64_decode_len(sizeof(pending_))];
+  const size_t size = Decode(bytes, sizeof(bytes), last_group);
+  if (size == MODP_B64_ERROR)
+    return false;
+  output->append(reinterpret_cast<const char*>(bytes), size);
+  return true;
+}
+
 }  // namespace base
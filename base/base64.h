@@ -5,6 +5,7 @@
 #ifndef BASE_BASE64_H_
 #define BASE_BASE64_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include <string>
@@ -32,6 +33,36 @@ BASE_EXPORT bool Base64Decode(StringPiece input, std::string* output);
 BASE_EXPORT absl::optional<std::vector<uint8_t>> Base64Decode(
     StringPiece input);
 
+// Decodes base64 input that arrives in several chunks, such as the runs of a
+// data: URL between the whitespace that it may contain, without concatenating
+// them first. Decoding succeeds exactly when Base64Decode() of the whole input
+// does, and produces the same output.
+class BASE_EXPORT Base64StreamDecoder {
+ public:
+  Base64StreamDecoder();
+  Base64StreamDecoder(const Base64StreamDecoder&) = delete;
+  Base64StreamDecoder& operator=(const Base64StreamDecoder&) = delete;
+  ~Base64StreamDecoder();
+
+  // Decodes the next chunk of the input and appends the result to |output|.
+  // The last group of characters seen is held back until the next call, since
+  // it may be padded. Returns false, and leaves |output| unchanged, if the
+  // input can't be valid base64, in which case Finish() also returns false.
+  bool Append(StringPiece chunk, std::string* output);
+
+  // Decodes the held back characters and appends the result to |output|.
+  // Returns false if the input as a whole isn't valid base64. The decoder can
+  // then decode another input.
+  bool Finish(std::string* output);
+
+ private:
+  // The last group of the input so far.
+  char pending_[4];
+  size_t pending_size_ = 0;
+
+  bool failed_ = false;
+};
+
 }  // namespace base
 
 #endif  // BASE_BASE64_H_
@@ -5,11 +5,26 @@
 #include <string>
 
 #include "base/base64.h"
+#include "base/check_op.h"
 #include "base/strings/string_piece.h"
 
 extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
   std::string decode_output;
   base::StringPiece data_piece(reinterpret_cast<const char*>(data), size);
-  base::Base64Decode(data_piece, &decode_output);
+  const bool decoded = base::Base64Decode(data_piece, &decode_output);
+
+  // Decoding the input in chunks gives the same result.
+  const size_t chunk_size = size ? data[0] % 64 + 1 : 1;
+  base::Base64StreamDecoder decoder;
+  std::string stream_output;
+  bool stream_decoded = true;
+  for (size_t pos = 0; stream_decoded && pos < size; pos += chunk_size) {
+    stream_decoded =
+        decoder.Append(data_piece.substr(pos, chunk_size), &stream_output);
+  }
+  stream_decoded = decoder.Finish(&stream_output) && stream_decoded;
+  CHECK_EQ(decoded, stream_decoded);
+  if (decoded)
+    CHECK_EQ(decode_output, stream_output);
   return 0;
 }
@@ -0,0 +1,87 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/base64.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/strings/string_piece.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace base {
+
+namespace {
+
+constexpr char kMetricPrefix[] = "Base64.";
+constexpr char kMetricThroughput[] = "throughput";
+
+// About the size of a large image in a data: URL.
+constexpr size_t kDataSize = 4 * 1024 * 1024;
+constexpr int kNumIterations = 20;
+
+// The length of the lines that MIME wraps base64 into.
+constexpr size_t kLineLength = 76;
+
+std::vector<uint8_t> CreateData() {
+  std::vector<uint8_t> data(kDataSize);
+  uint32_t state = 1;
+  for (uint8_t& byte : data) {
+    state = state * 1103515245 + 12345;
+    byte = static_cast<uint8_t>(state >> 16);
+  }
+  return data;
+}
+
+void Report(const std::string& story, size_t size, TimeDelta time) {
+  perf_test::PerfResultReporter reporter(kMetricPrefix, story);
+  reporter.RegisterImportantMetric(kMetricThroughput, "MB/s");
+  reporter.AddResult(kMetricThroughput, size * kNumIterations /
+                                            time.InSecondsF() / (1024 * 1024));
+}
+
+}  // namespace
+
+TEST(Base64PerfTest, Encode) {
+  const std::vector<uint8_t> data = CreateData();
+  ElapsedTimer timer;
+  for (int i = 0; i < kNumIterations; ++i)
+    ASSERT_FALSE(Base64Encode(data).empty());
+  Report("Encode", data.size(), timer.Elapsed());
+}
+
+TEST(Base64PerfTest, Decode) {
+  const std::string encoded = Base64Encode(CreateData());
+  std::string decoded;
+  ElapsedTimer timer;
+  for (int i = 0; i < kNumIterations; ++i)
+    ASSERT_TRUE(Base64Decode(encoded, &decoded));
+  Report("Decode", encoded.size(), timer.Elapsed());
+}
+
+// Decodes the input line by line, like DataURL::Parse() does for data: URLs
+// with whitespace in them.
+TEST(Base64PerfTest, StreamDecodeLines) {
+  const std::string encoded = Base64Encode(CreateData());
+  std::string decoded;
+  ElapsedTimer timer;
+  for (int i = 0; i < kNumIterations; ++i) {
+    Base64StreamDecoder decoder;
+    decoded.clear();
+    for (size_t pos = 0; pos < encoded.size(); pos += kLineLength) {
+      ASSERT_TRUE(decoder.Append(StringPiece(encoded).substr(pos, kLineLength),
+                                 &decoded));
+    }
+    ASSERT_TRUE(decoder.Finish(&decoded));
+  }
+  Report("StreamDecodeLines", encoded.size(), timer.Elapsed());
+}
+
+}  // namespace base
@@ -4,6 +4,13 @@
 
 #include "base/base64.h"
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include "testing/gmock/include/gmock/gmock.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -56,4 +63,103 @@ TEST(Base64Test, InPlace) {
   EXPECT_EQ(text, kText);
 }
 
+// The vectorized encoder and decoder handle blocks of up to 48 bytes, so check
+// inputs of all sizes around them, with each kind of character at every
+// position, against the groups encoded one by one.
+TEST(Base64Test, LongInputs) {
+  for (size_t size = 0; size < 200; ++size) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i)
+      data[i] = static_cast<uint8_t>(i * 37 + size);
+
+    std::string expected_encoded;
+    for (size_t i = 0; i < size; i += 3) {
+      expected_encoded += Base64Encode(
+          make_span(data).subspan(i, std::min<size_t>(3, size - i)));
+    }
+    const std::string encoded = Base64Encode(data);
+    EXPECT_EQ(expected_encoded, encoded);
+    EXPECT_THAT(Base64Decode(encoded),
+                testing::Optional(testing::ElementsAreArray(data)));
+  }
+
+  std::vector<uint8_t> data(255);
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = static_cast<uint8_t>(i);
+  const std::string encoded = Base64Encode(data);
+  for (size_t pos = 0; pos < encoded.size() - 4; ++pos) {
+    for (int c = 0; c < 256; ++c) {
+      std::string corrupted = encoded;
+      corrupted[pos] = static_cast<char>(c);
+      const bool valid = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+                         (c >= '0' && c <= '9') || c == '+' || c == '/';
+      EXPECT_EQ(valid, Base64Decode(corrupted).has_value());
+    }
+  }
+}
+
+TEST(Base64Test, Padding) {
+  std::string decoded;
+  EXPECT_TRUE(Base64Decode("", &decoded));
+  EXPECT_EQ("", decoded);
+  EXPECT_TRUE(Base64Decode("YQ==", &decoded));
+  EXPECT_EQ("a", decoded);
+  EXPECT_TRUE(Base64Decode("YWI=", &decoded));
+  EXPECT_EQ("ab", decoded);
+
+  EXPECT_FALSE(Base64Decode("YQ", &decoded));
+  EXPECT_FALSE(Base64Decode("Y===", &decoded));
+  EXPECT_FALSE(Base64Decode("YQ==YWJj", &decoded));
+  const std::string padded_in_middle =
+      std::string(64, 'A') + "YQ==" + std::string(64, 'A');
+  EXPECT_FALSE(Base64Decode(padded_in_middle, &decoded));
+  EXPECT_EQ("ab", decoded);
+}
+
+TEST(Base64Test, StreamDecoder) {
+  std::string data;
+  for (int i = 0; i < 300; ++i)
+    data.push_back(static_cast<char>(i * 7));
+
+  for (size_t size : {0, 1, 2, 3, 100, 299, 300}) {
+    std::string encoded;
+    Base64Encode(data.substr(0, size), &encoded);
+    for (size_t chunk_size = 1; chunk_size <= 70; ++chunk_size) {
+      Base64StreamDecoder decoder;
+      std::string decoded = "prefix";
+      for (size_t i = 0; i < encoded.size(); i += chunk_size)
+        EXPECT_TRUE(decoder.Append(encoded.substr(i, chunk_size), &decoded));
+      EXPECT_TRUE(decoder.Finish(&decoded));
+      EXPECT_EQ("prefix" + data.substr(0, size), decoded);
+    }
+  }
+}
+
+TEST(Base64Test, StreamDecoderInvalid) {
+  const char* const kInvalidInputs[] = {"YQ",       "Y===",     "YQ==YWJj",
+                                        "YWJj*WJj", "YWJjYWJjYWJjYWJjYWJj!",
+                                        "YWJjYQ=="
+                                        "YWJjYWJjYWJjYWJjYWJj"};
+  for (const char* input : kInvalidInputs) {
+    SCOPED_TRACE(input);
+    const StringPiece encoded(input);
+    for (size_t chunk_size = 1; chunk_size <= encoded.size(); ++chunk_size) {
+      Base64StreamDecoder decoder;
+      std::string decoded;
+      bool ok = true;
+      for (size_t i = 0; ok && i < encoded.size(); i += chunk_size) {
+        const std::string before = decoded;
+        ok = decoder.Append(encoded.substr(i, chunk_size), &decoded);
+        if (!ok)
+          EXPECT_EQ(before, decoded);
+      }
+      EXPECT_FALSE(decoder.Finish(&decoded));
+
+      // The decoder can be reused.
+      EXPECT_TRUE(decoder.Append("YWJj", &decoded));
+      EXPECT_TRUE(decoder.Finish(&decoded));
+    }
+  }
+}
+
 }  // namespace base
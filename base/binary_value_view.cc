@@ -0,0 +1,561 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/binary_value_view.h"
+
+#include <string.h>
+
+#include <iterator>
+#include <limits>
+
+#include "base/check_op.h"
+#include "base/notreached.h"
+#include "third_party/abseil-cpp/absl/types/variant.h"
+
+namespace base {
+
+namespace {
+
+// Encodings start with this, which also identifies the version of the format.
+constexpr uint8_t kMagic[] = {'B', 'V', 'V', '1'};
+
+// The type byte of an encoded value.
+enum class Tag : uint8_t {
+  kNone = 0,
+  kBool = 1,
+  kInt = 2,
+  kDouble = 3,
+  kString = 4,
+  kBlob = 5,
+  kDict = 6,
+  kList = 7,
+  kMaxValue = kList,
+};
+
+constexpr size_t kTagSize = 1;
+constexpr size_t kUint32Size = sizeof(uint32_t);
+
+// The size of the type byte and the number of entries of a dictionary or
+// list, which are followed by the offsets of the entries.
+constexpr size_t kContainerHeaderSize = kTagSize + kUint32Size;
+
+// Nesting deeper than this is rejected when copying into Values, which are
+// destroyed recursively. Matches the limit of the JSON parser.
+constexpr size_t kMaxDepth = 200;
+
+Value::Type TagToType(Tag tag) {
+  switch (tag) {
+    case Tag::kNone:
+      return Value::Type::NONE;
+    case Tag::kBool:
+      return Value::Type::BOOLEAN;
+    case Tag::kInt:
+      return Value::Type::INTEGER;
+    case Tag::kDouble:
+      return Value::Type::DOUBLE;
+    case Tag::kString:
+      return Value::Type::STRING;
+    case Tag::kBlob:
+      return Value::Type::BINARY;
+    case Tag::kDict:
+      return Value::Type::DICTIONARY;
+    case Tag::kList:
+      return Value::Type::LIST;
+  }
+  NOTREACHED();
+  return Value::Type::NONE;
+}
+
+// Reads a uint32_t at |offset| of |data|, which must be in range.
+uint32_t ReadUint32(span<const uint8_t> data, size_t offset) {
+  uint32_t value;
+  memcpy(&value, data.subspan(offset, kUint32Size).data(), kUint32Size);
+  return value;
+}
+
+// Returns the bytes at |offset| of |data| that are preceded by their size, or
+// nullopt if they don't fit in |data|.
+absl::optional<span<const uint8_t>> ReadSizedBytes(span<const uint8_t> data,
+                                                   size_t offset) {
+  if (offset > data.size() || data.size() - offset < kUint32Size)
+    return absl::nullopt;
+  size_t size = ReadUint32(data, offset);
+  offset += kUint32Size;
+  if (size > data.size() - offset)
+    return absl::nullopt;
+  return data.subspan(offset, size);
+}
+
+StringPiece AsStringPiece(span<const uint8_t> bytes) {
+  return StringPiece(reinterpret_cast<const char*>(bytes.data()),
+                     bytes.size());
+}
+
+class Encoder {
+ public:
+  explicit Encoder(std::vector<uint8_t>* output) : output_(*output) {}
+  Encoder(const Encoder&) = delete;
+  Encoder& operator=(const Encoder&) = delete;
+  ~Encoder() = default;
+
+  void Encode(absl::monostate) { WriteTag(Tag::kNone); }
+
+  void Encode(bool value) {
+    WriteTag(Tag::kBool);
+    output_.push_back(value ? 1 : 0);
+  }
+
+  void Encode(int value) {
+    WriteTag(Tag::kInt);
+    WriteBytes(&value, sizeof(value));
+  }
+
+  void Encode(double value) {
+    WriteTag(Tag::kDouble);
+    WriteBytes(&value, sizeof(value));
+  }
+
+  void Encode(StringPiece value) {
+    WriteTag(Tag::kString);
+    WriteSizedBytes(value.data(), value.size());
+  }
+
+  void Encode(const Value::BlobStorage& value) {
+    WriteTag(Tag::kBlob);
+    WriteSizedBytes(value.data(), value.size());
+  }
+
+  void Encode(const Value::Dict& dict) {
+    const size_t start = output_.size();
+    size_t table = WriteContainerHeader(Tag::kDict, dict.size());
+    for (const auto [key, value] : dict) {
+      WriteEntryOffset(start, &table);
+      WriteSizedBytes(key.data(), key.size());
+      Encode(value);
+    }
+  }
+
+  void Encode(const Value::List& list) {
+    const size_t start = output_.size();
+    size_t table = WriteContainerHeader(Tag::kList, list.size());
+    for (const Value& value : list) {
+      WriteEntryOffset(start, &table);
+      Encode(value);
+    }
+  }
+
+  void Encode(const Value& value) {
+    switch (value.type()) {
+      case Value::Type::NONE:
+        Encode(absl::monostate());
+        return;
+      case Value::Type::BOOLEAN:
+        Encode(value.GetBool());
+        return;
+      case Value::Type::INTEGER:
+        Encode(value.GetInt());
+        return;
+      case Value::Type::DOUBLE:
+        Encode(value.GetDouble());
+        return;
+      case Value::Type::STRING:
+        Encode(StringPiece(value.GetString()));
+        return;
+      case Value::Type::BINARY:
+        Encode(value.GetBlob());
+        return;
+      case Value::Type::DICTIONARY:
+        Encode(value.GetDict());
+        return;
+      case Value::Type::LIST:
+        Encode(value.GetList());
+        return;
+    }
+    NOTREACHED();
+  }
+
+ private:
+  void WriteTag(Tag tag) { output_.push_back(static_cast<uint8_t>(tag)); }
+
+  void WriteBytes(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    output_.insert(output_.end(), bytes, bytes + size);
+  }
+
+  void WriteUint32(uint32_t value) { WriteBytes(&value, sizeof(value)); }
+
+  void WriteSizedBytes(const void* data, size_t size) {
+    WriteUint32(static_cast<uint32_t>(size));
+    WriteBytes(data, size);
+  }
+
+  // Writes the header of a dictionary or list with |size| entries, and makes
+  // room for the offsets of its entries. Returns the position of the offsets.
+  size_t WriteContainerHeader(Tag tag, size_t size) {
+    WriteTag(tag);
+    WriteUint32(static_cast<uint32_t>(size));
+    const size_t table = output_.size();
+    output_.resize(table + size * kUint32Size);
+    return table;
+  }
+
+  // Writes the offset of the entry that starts at the end of the output,
+  // relative to the container that starts at |start|, at |*table|, and
+  // advances |*table| to the offset of the next entry. Offsets are truncated
+  // if the output is too large, which Serialize() reports.
+  void WriteEntryOffset(size_t start, size_t* table) {
+    uint32_t offset = static_cast<uint32_t>(output_.size() - start);
+    memcpy(output_.data() + *table, &offset, sizeof(offset));
+    *table += sizeof(offset);
+  }
+
+  std::vector<uint8_t>& output_;
+};
+
+}  // namespace
+
+BinaryValueSerializer::BinaryValueSerializer(std::vector<uint8_t>* output)
+    : output_(output) {}
+
+BinaryValueSerializer::~BinaryValueSerializer() = default;
+
+bool BinaryValueSerializer::Serialize(ValueView root) {
+  output_->assign(std::begin(kMagic), std::end(kMagic));
+  Encoder encoder(output_);
+  root.Visit([&encoder](const auto& member) { encoder.Encode(member); });
+  if (output_->size() > std::numeric_limits<uint32_t>::max()) {
+    output_->clear();
+    return false;
+  }
+  return true;
+}
+
+BinaryValueView::BinaryValueView(Value::Type type,
+                                 span<const uint8_t> data,
+                                 size_t depth)
+    : type_(type), data_(data), depth_(depth) {}
+
+BinaryValueView::BinaryValueView(const BinaryValueView&) = default;
+
+BinaryValueView& BinaryValueView::operator=(const BinaryValueView&) = default;
+
+BinaryValueView::~BinaryValueView() = default;
+
+// static
+absl::optional<BinaryValueView> BinaryValueView::Create(
+    span<const uint8_t> data) {
+  if (data.size() < sizeof(kMagic) ||
+      memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+    return absl::nullopt;
+  }
+  return FromSpan(data.subspan(sizeof(kMagic)), 0);
+}
+
+// static
+absl::optional<BinaryValueView> BinaryValueView::FromSpan(
+    span<const uint8_t> data,
+    size_t depth) {
+  if (data.empty() || data[0] > static_cast<uint8_t>(Tag::kMaxValue))
+    return absl::nullopt;
+  const Tag tag = static_cast<Tag>(data[0]);
+
+  // Check that the fixed-size part of the value fits, so that getters don't
+  // have to.
+  size_t min_size = kTagSize;
+  switch (tag) {
+    case Tag::kNone:
+      break;
+    case Tag::kBool:
+      if (data.size() < kTagSize + 1 || data[kTagSize] > 1)
+        return absl::nullopt;
+      break;
+    case Tag::kInt:
+      min_size += sizeof(int);
+      break;
+    case Tag::kDouble:
+      min_size += sizeof(double);
+      break;
+    case Tag::kString:
+    case Tag::kBlob:
+      if (!ReadSizedBytes(data, kTagSize))
+        return absl::nullopt;
+      break;
+    case Tag::kDict:
+    case Tag::kList:
+      if (data.size() < kContainerHeaderSize ||
+          ReadUint32(data, kTagSize) >
+              (data.size() - kContainerHeaderSize) / kUint32Size) {
+        return absl::nullopt;
+      }
+      break;
+  }
+  if (data.size() < min_size)
+    return absl::nullopt;
+  return BinaryValueView(TagToType(tag), data, depth);
+}
+
+// static
+absl::optional<span<const uint8_t>> BinaryValueView::GetEntryData(
+    span<const uint8_t> data,
+    size_t size,
+    size_t index) {
+  DCHECK_LT(index, size);
+  // Each entry ends where the next one starts, so that entries never overlap
+  // and copying a value takes time linear in the size of its encoding.
+  const size_t table_end = kContainerHeaderSize + size * kUint32Size;
+  const size_t start =
+      ReadUint32(data, kContainerHeaderSize + index * kUint32Size);
+  const size_t end =
+      index + 1 < size
+          ? ReadUint32(data, kContainerHeaderSize + (index + 1) * kUint32Size)
+          : data.size();
+  if (start < table_end || start > end || end > data.size())
+    return absl::nullopt;
+  return data.subspan(start, end - start);
+}
+
+absl::optional<bool> BinaryValueView::GetIfBool() const {
+  if (type_ != Value::Type::BOOLEAN)
+    return absl::nullopt;
+  return data_[kTagSize] != 0;
+}
+
+absl::optional<int> BinaryValueView::GetIfInt() const {
+  if (type_ != Value::Type::INTEGER)
+    return absl::nullopt;
+  int value;
+  memcpy(&value, data_.subspan(kTagSize, sizeof(value)).data(),
+         sizeof(value));
+  return value;
+}
+
+absl::optional<double> BinaryValueView::GetIfDouble() const {
+  if (type_ == Value::Type::INTEGER)
+    return *GetIfInt();
+  if (type_ != Value::Type::DOUBLE)
+    return absl::nullopt;
+  double value;
+  memcpy(&value, data_.subspan(kTagSize, sizeof(value)).data(),
+         sizeof(value));
+  return value;
+}
+
+absl::optional<StringPiece> BinaryValueView::GetIfString() const {
+  if (type_ != Value::Type::STRING)
+    return absl::nullopt;
+  return AsStringPiece(*ReadSizedBytes(data_, kTagSize));
+}
+
+absl::optional<span<const uint8_t>> BinaryValueView::GetIfBlob() const {
+  if (type_ != Value::Type::BINARY)
+    return absl::nullopt;
+  return *ReadSizedBytes(data_, kTagSize);
+}
+
+absl::optional<BinaryValueView::DictView> BinaryValueView::GetIfDict() const {
+  if (type_ != Value::Type::DICTIONARY)
+    return absl::nullopt;
+  return DictView(data_, ReadUint32(data_, kTagSize), depth_);
+}
+
+absl::optional<BinaryValueView::ListView> BinaryValueView::GetIfList() const {
+  if (type_ != Value::Type::LIST)
+    return absl::nullopt;
+  return ListView(data_, ReadUint32(data_, kTagSize), depth_);
+}
+
+absl::optional<Value> BinaryValueView::ToValue() const {
+  switch (type_) {
+    case Value::Type::NONE:
+      return Value();
+    case Value::Type::BOOLEAN:
+      return Value(*GetIfBool());
+    case Value::Type::INTEGER:
+      return Value(*GetIfInt());
+    case Value::Type::DOUBLE:
+      return Value(*GetIfDouble());
+    case Value::Type::STRING:
+      return Value(*GetIfString());
+    case Value::Type::BINARY:
+      return Value(*GetIfBlob());
+    case Value::Type::DICTIONARY: {
+      absl::optional<Value::Dict> dict = GetIfDict()->ToDict();
+      if (!dict)
+        return absl::nullopt;
+      return Value(std::move(*dict));
+    }
+    case Value::Type::LIST: {
+      absl::optional<Value::List> list = GetIfList()->ToList();
+      if (!list)
+        return absl::nullopt;
+      return Value(std::move(*list));
+    }
+  }
+  NOTREACHED();
+  return absl::nullopt;
+}
+
+BinaryValueView::DictView::DictView(span<const uint8_t> data,
+                                    size_t size,
+                                    size_t depth)
+    : data_(data), size_(size), depth_(depth) {}
+
+BinaryValueView::DictView::DictView(const DictView&) = default;
+
+BinaryValueView::DictView& BinaryValueView::DictView::operator=(
+    const DictView&) = default;
+
+BinaryValueView::DictView::~DictView() = default;
+
+absl::optional<std::pair<StringPiece, BinaryValueView>>
+BinaryValueView::DictView::GetEntry(size_t index) const {
+  if (index >= size_)
+    return absl::nullopt;
+  absl::optional<span<const uint8_t>> entry =
+      GetEntryData(data_, size_, index);
+  if (!entry)
+    return absl::nullopt;
+  absl::optional<span<const uint8_t>> key = ReadSizedBytes(*entry, 0);
+  if (!key)
+    return absl::nullopt;
+  absl::optional<BinaryValueView> value =
+      FromSpan(entry->subspan(kUint32Size + key->size()), depth_ + 1);
+  if (!value)
+    return absl::nullopt;
+  return std::make_pair(AsStringPiece(*key), *value);
+}
+
+absl::optional<BinaryValueView> BinaryValueView::DictView::Find(
+    StringPiece key) const {
+  // Keys are sorted like in Value::Dict, by comparing their bytes.
+  size_t begin = 0;
+  size_t end = size_;
+  while (begin < end) {
+    const size_t middle = begin + (end - begin) / 2;
+    absl::optional<std::pair<StringPiece, BinaryValueView>> entry =
+        GetEntry(middle);
+    if (!entry)
+      return absl::nullopt;
+    const int comparison = entry->first.compare(key);
+    if (comparison == 0)
+      return entry->second;
+    if (comparison < 0)
+      begin = middle + 1;
+    else
+      end = middle;
+  }
+  return absl::nullopt;
+}
+
+absl::optional<bool> BinaryValueView::DictView::FindBool(
+    StringPiece key) const {
+  absl::optional<BinaryValueView> value = Find(key);
+  return value ? value->GetIfBool() : absl::nullopt;
+}
+
+absl::optional<int> BinaryValueView::DictView::FindInt(StringPiece key) const {
+  absl::optional<BinaryValueView> value = Find(key);
+  return value ? value->GetIfInt() : absl::nullopt;
+}
+
+absl::optional<double> BinaryValueView::DictView::FindDouble(
+    StringPiece key) const {
+  absl::optional<BinaryValueView> value = Find(key);
+  return value ? value->GetIfDouble() : absl::nullopt;
+}
+
+absl::optional<StringPiece> BinaryValueView::DictView::FindString(
+    StringPiece key) const {
+  absl::optional<BinaryValueView> value = Find(key);
+  return value ? value->GetIfString() : absl::nullopt;
+}
+
+absl::optional<BinaryValueView::DictView>
+BinaryValueView::DictView::FindDict(StringPiece key) const {
+  absl::optional<BinaryValueView> value = Find(key);
+  return value ? value->GetIfDict() : absl::nullopt;
+}
+
+absl::optional<BinaryValueView::ListView>
+BinaryValueView::DictView::FindList(StringPiece key) const {
+  absl::optional<BinaryValueView> value = Find(key);
+  return value ? value->GetIfList() : absl::nullopt;
+}
+
+absl::optional<BinaryValueView> BinaryValueView::DictView::FindByDottedPath(
+    StringPiece path) const {
+  DCHECK(!path.empty());
+  DictView current_dict = *this;
+  size_t current_path_start = 0;
+  size_t dot_position;
+  while ((dot_position = path.find('.', current_path_start)) !=
+         StringPiece::npos) {
+    absl::optional<DictView> next_dict = current_dict.FindDict(
+        path.substr(current_path_start, dot_position - current_path_start));
+    if (!next_dict)
+      return absl::nullopt;
+    current_dict = *next_dict;
+    current_path_start = dot_position + 1;
+  }
+  return current_dict.Find(path.substr(current_path_start));
+}
+
+absl::optional<Value::Dict> BinaryValueView::DictView::ToDict() const {
+  if (depth_ >= kMaxDepth)
+    return absl::nullopt;
+  Value::Dict dict;
+  for (size_t i = 0; i < size_; ++i) {
+    absl::optional<std::pair<StringPiece, BinaryValueView>> entry =
+        GetEntry(i);
+    if (!entry)
+      return absl::nullopt;
+    absl::optional<Value> value = entry->second.ToValue();
+    if (!value)
+      return absl::nullopt;
+    dict.Set(entry->first, std::move(*value));
+  }
+  return dict;
+}
+
+BinaryValueView::ListView::ListView(span<const uint8_t> data,
+                                    size_t size,
+                                    size_t depth)
+    : data_(data), size_(size), depth_(depth) {}
+
+BinaryValueView::ListView::ListView(const ListView&) = default;
+
+BinaryValueView::ListView& BinaryValueView::ListView::operator=(
+    const ListView&) = default;
+
+BinaryValueView::ListView::~ListView() = default;
+
+absl::optional<BinaryValueView> BinaryValueView::ListView::Get(
+    size_t index) const {
+  if (index >= size_)
+    return absl::nullopt;
+  absl::optional<span<const uint8_t>> entry =
+      GetEntryData(data_, size_, index);
+  if (!entry)
+    return absl::nullopt;
+  return FromSpan(*entry, depth_ + 1);
+}
+
+absl::optional<Value::List> BinaryValueView::ListView::ToList() const {
+  if (depth_ >= kMaxDepth)
+    return absl::nullopt;
+  Value::List list;
+  list.reserve(size_);
+  for (size_t i = 0; i < size_; ++i) {
+    absl::optional<BinaryValueView> view = Get(i);
+    if (!view)
+      return absl::nullopt;
+    absl::optional<Value> value = view->ToValue();
+    if (!value)
+      return absl::nullopt;
+    list.Append(std::move(*value));
+  }
+  return list;
+}
+
+}  // namespace base
@@ -0,0 +1,187 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_BINARY_VALUE_VIEW_H_
+#define BASE_BINARY_VALUE_VIEW_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/containers/span.h"
+#include "base/memory/raw_ptr.h"
+#include "base/strings/string_piece.h"
+#include "base/values.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
+
+namespace base {
+
+// Encodes Values into a compact binary format that BinaryValueView reads in
+// place, for readers that only look up a few keys of a large tree they receive
+// through IPC or load from disk, and that shouldn't have to deserialize all of
+// it into Values first.
+//
+// Each value is encoded as a type byte followed by its contents. Integers,
+// doubles and sizes are in host byte order, like in Pickle. Dictionaries and
+// lists start with the number of their entries and a table of the offsets of
+// the entries, relative to the start of the dictionary or list, so any encoded
+// value is position-independent, and the entries of dictionaries are sorted by
+// key, like in Value::Dict.
+class BASE_EXPORT BinaryValueSerializer : public ValueSerializer {
+ public:
+  // |output| must outlive the serializer.
+  explicit BinaryValueSerializer(std::vector<uint8_t>* output);
+  BinaryValueSerializer(const BinaryValueSerializer&) = delete;
+  BinaryValueSerializer& operator=(const BinaryValueSerializer&) = delete;
+  ~BinaryValueSerializer() override;
+
+  // Replaces the contents of |output| with the encoding of |root|. Returns
+  // false if the encoding is too large for its 32-bit offsets.
+  bool Serialize(ValueView root) override;
+
+ private:
+  const raw_ptr<std::vector<uint8_t>> output_;
+};
+
+// A read-only view of a value encoded by BinaryValueSerializer, which doesn't
+// copy or allocate. Like span, it doesn't own the encoded data, which must
+// outlive the view and all the views that it returns.
+//
+// The encoded data isn't trusted: only the parts of it that are read are
+// checked, when they are read, so that looking up a key takes logarithmic time
+// in the size of each dictionary along its path. Malformed values are reported
+// as missing.
+class BASE_EXPORT BinaryValueView {
+ public:
+  class DictView;
+  class ListView;
+
+  // Returns a view of the value encoded in |data|, or nullopt if |data| doesn't
+  // start with an encoded value.
+  static absl::optional<BinaryValueView> Create(span<const uint8_t> data);
+
+  BinaryValueView(const BinaryValueView&);
+  BinaryValueView& operator=(const BinaryValueView&);
+  ~BinaryValueView();
+
+  Value::Type type() const { return type_; }
+
+  // These return nullopt if the value is of another type. Like
+  // Value::GetIfDouble(), GetIfDouble() also converts integers.
+  absl::optional<bool> GetIfBool() const;
+  absl::optional<int> GetIfInt() const;
+  absl::optional<double> GetIfDouble() const;
+  absl::optional<StringPiece> GetIfString() const;
+  absl::optional<span<const uint8_t>> GetIfBlob() const;
+  absl::optional<DictView> GetIfDict() const;
+  absl::optional<ListView> GetIfList() const;
+
+  // Returns an owning copy of the value and everything under it, or nullopt if
+  // any part of it is malformed.
+  absl::optional<Value> ToValue() const;
+
+  // A view of an encoded dictionary.
+  class BASE_EXPORT DictView {
+   public:
+    DictView(const DictView&);
+    DictView& operator=(const DictView&);
+    ~DictView();
+
+    // Returns the number of entries in the dictionary.
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Returns the entry at |index|, in key order. Returns nullopt if the entry
+    // is malformed.
+    absl::optional<std::pair<StringPiece, BinaryValueView>> GetEntry(
+        size_t index) const;
+
+    // Looks up |key| with a binary search. The typed variants return nullopt
+    // if the value for |key| is of another type.
+    absl::optional<BinaryValueView> Find(StringPiece key) const;
+    absl::optional<bool> FindBool(StringPiece key) const;
+    absl::optional<int> FindInt(StringPiece key) const;
+    absl::optional<double> FindDouble(StringPiece key) const;
+    absl::optional<StringPiece> FindString(StringPiece key) const;
+    absl::optional<DictView> FindDict(StringPiece key) const;
+    absl::optional<ListView> FindList(StringPiece key) const;
+
+    // Like Value::Dict::FindByDottedPath(), looks up the value at |path|
+    // through nested dictionaries.
+    absl::optional<BinaryValueView> FindByDottedPath(StringPiece path) const;
+
+    // Returns an owning copy of the dictionary, or nullopt if any part of it
+    // is malformed.
+    absl::optional<Value::Dict> ToDict() const;
+
+   private:
+    friend class BinaryValueView;
+
+    DictView(span<const uint8_t> data, size_t size, size_t depth);
+
+    span<const uint8_t> data_;
+    size_t size_;
+    size_t depth_;
+  };
+
+  // A view of an encoded list.
+  class BASE_EXPORT ListView {
+   public:
+    ListView(const ListView&);
+    ListView& operator=(const ListView&);
+    ~ListView();
+
+    // Returns the number of values in the list.
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Returns the value at |index|, or nullopt if |index| is out of range or
+    // the value is malformed.
+    absl::optional<BinaryValueView> Get(size_t index) const;
+
+    // Returns an owning copy of the list, or nullopt if any part of it is
+    // malformed.
+    absl::optional<Value::List> ToList() const;
+
+   private:
+    friend class BinaryValueView;
+
+    ListView(span<const uint8_t> data, size_t size, size_t depth);
+
+    span<const uint8_t> data_;
+    size_t size_;
+    size_t depth_;
+  };
+
+ private:
+  BinaryValueView(Value::Type type, span<const uint8_t> data, size_t depth);
+
+  // Returns a view of the value that starts at the beginning of |data|, which
+  // is |depth| levels deep in the encoded tree, or nullopt if it's malformed.
+  static absl::optional<BinaryValueView> FromSpan(span<const uint8_t> data,
+                                                  size_t depth);
+
+  // Returns the region of the entry at |index| of the dictionary or list
+  // |data| with |size| entries, or nullopt if its offsets are malformed.
+  static absl::optional<span<const uint8_t>> GetEntryData(
+      span<const uint8_t> data,
+      size_t size,
+      size_t index);
+
+  Value::Type type_;
+
+  // The encoded value, from its type byte to the end of the region it may
+  // use, which includes trailing data for scalars.
+  span<const uint8_t> data_;
+
+  // How deep the value is in the encoded tree, to bound nesting.
+  size_t depth_;
+};
+
+}  // namespace base
+
+#endif  // BASE_BINARY_VALUE_VIEW_H_
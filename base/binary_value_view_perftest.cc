@@ -0,0 +1,111 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/binary_value_view.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace base {
+
+namespace {
+
+constexpr char kMetricPrefix[] = "BinaryValueView.";
+constexpr char kMetricTime[] = "time";
+constexpr char kMetricSize[] = "size";
+
+constexpr int kNumExtensions = 500;
+constexpr int kNumIterations = 20;
+
+// The paths that a reader of the preferences looks up.
+const char* const kLookupPaths[] = {
+    "extensions.settings.00000000000000000000000000000007.state",
+    "extensions.settings.00000000000000000000000000000250.manifest.version",
+    "extensions.settings.00000000000000000000000000000499.path",
+};
+
+// Returns a tree like the preferences that ExtensionPrefs writes.
+Value::Dict CreatePrefs() {
+  Value::Dict settings;
+  for (int i = 0; i < kNumExtensions; ++i) {
+    const std::string id = StringPrintf("%032d", i);
+    Value::Dict extension;
+    Value::List api;
+    for (const char* permission : {"alarms", "storage", "tabs", "webRequest"})
+      api.Append(permission);
+    extension.SetByDottedPath("active_permissions.api", api.Clone());
+    extension.SetByDottedPath("granted_permissions.api", std::move(api));
+    extension.Set("creation_flags", 9);
+    extension.Set("from_webstore", true);
+    extension.Set("install_time", "13301234567890123");
+    extension.Set("location", 1);
+    extension.SetByDottedPath("manifest.description", std::string(120, 'd'));
+    extension.SetByDottedPath("manifest.key", std::string(392, 'k'));
+    extension.SetByDottedPath("manifest.manifest_version", 3);
+    extension.SetByDottedPath("manifest.name",
+                              "Extension " + NumberToString(i));
+    extension.SetByDottedPath("manifest.version", "1.2." + NumberToString(i));
+    extension.Set("path", id + "/1.2.3_0");
+    extension.Set("state", 1);
+    settings.Set(id, std::move(extension));
+  }
+  Value::Dict prefs;
+  prefs.SetByDottedPath("extensions.settings", std::move(settings));
+  return prefs;
+}
+
+void Report(const std::string& story, TimeDelta time) {
+  perf_test::PerfResultReporter reporter(kMetricPrefix, story);
+  reporter.RegisterImportantMetric(kMetricTime, "us");
+  reporter.AddResult(kMetricTime, time.InMicrosecondsF() / kNumIterations);
+}
+
+}  // namespace
+
+// Compares looking up a few preferences from their binary encoding by copying
+// it into Values first, and by reading it in place.
+TEST(BinaryValueViewPerfTest, LookupPrefs) {
+  const Value::Dict prefs = CreatePrefs();
+
+  std::vector<uint8_t> encoded;
+  ElapsedTimer serialize_timer;
+  for (int i = 0; i < kNumIterations; ++i) {
+    BinaryValueSerializer serializer(&encoded);
+    ASSERT_TRUE(serializer.Serialize(prefs));
+  }
+  Report("Serialize", serialize_timer.Elapsed());
+  perf_test::PerfResultReporter reporter(kMetricPrefix, "Serialize");
+  reporter.RegisterImportantMetric(kMetricSize, "bytes");
+  reporter.AddResult(kMetricSize, encoded.size());
+
+  ElapsedTimer copy_timer;
+  for (int i = 0; i < kNumIterations; ++i) {
+    absl::optional<Value> value = BinaryValueView::Create(encoded)->ToValue();
+    ASSERT_TRUE(value);
+    for (const char* path : kLookupPaths)
+      ASSERT_TRUE(value->GetDict().FindByDottedPath(path));
+  }
+  Report("CopyAndLookup", copy_timer.Elapsed());
+
+  ElapsedTimer view_timer;
+  for (int i = 0; i < kNumIterations; ++i) {
+    absl::optional<BinaryValueView> view = BinaryValueView::Create(encoded);
+    ASSERT_TRUE(view);
+    for (const char* path : kLookupPaths)
+      ASSERT_TRUE(view->GetIfDict()->FindByDottedPath(path));
+  }
+  Report("ViewLookup", view_timer.Elapsed());
+}
+
+}  // namespace base
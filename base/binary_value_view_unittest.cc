@@ -0,0 +1,233 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/binary_value_view.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/strings/string_number_conversions.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+std::vector<uint8_t> Serialize(ValueView value) {
+  std::vector<uint8_t> encoded;
+  BinaryValueSerializer serializer(&encoded);
+  EXPECT_TRUE(serializer.Serialize(value));
+  return encoded;
+}
+
+Value::Dict CreatePrefs() {
+  Value::Dict dict;
+  dict.SetByDottedPath("extensions.settings.id1.state", 1);
+  dict.SetByDottedPath("extensions.settings.id1.manifest.name", "Name");
+  dict.SetByDottedPath("extensions.settings.id1.manifest.version", "1.0");
+  dict.SetByDottedPath("extensions.settings.id2.state", 0);
+  dict.SetByDottedPath("extensions.settings.id2.from_webstore", true);
+  dict.SetByDottedPath("extensions.settings.id2.install_time", 1.5);
+  Value::List api;
+  api.Append("storage");
+  api.Append("tabs");
+  dict.SetByDottedPath("extensions.settings.id2.api", std::move(api));
+  dict.Set("blob", Value::BlobStorage({1, 2, 3}));
+  dict.Set("none", Value());
+  dict.Set("", "empty key");
+  dict.Set("empty_dict", Value::Dict());
+  dict.Set("empty_list", Value::List());
+  return dict;
+}
+
+}  // namespace
+
+TEST(BinaryValueViewTest, Scalars) {
+  std::vector<uint8_t> encoded = Serialize(Value());
+  absl::optional<BinaryValueView> view = BinaryValueView::Create(encoded);
+  ASSERT_TRUE(view);
+  EXPECT_EQ(Value::Type::NONE, view->type());
+  EXPECT_EQ(absl::nullopt, view->GetIfBool());
+  EXPECT_EQ(Value(), view->ToValue());
+
+  encoded = Serialize(true);
+  view = BinaryValueView::Create(encoded);
+  ASSERT_TRUE(view);
+  EXPECT_EQ(Value::Type::BOOLEAN, view->type());
+  EXPECT_EQ(true, view->GetIfBool());
+  EXPECT_EQ(absl::nullopt, view->GetIfInt());
+
+  encoded = Serialize(-42);
+  view = BinaryValueView::Create(encoded);
+  ASSERT_TRUE(view);
+  EXPECT_EQ(-42, view->GetIfInt());
+  // Like Value, integers are also doubles.
+  EXPECT_EQ(-42.0, view->GetIfDouble());
+
+  encoded = Serialize(0.25);
+  view = BinaryValueView::Create(encoded);
+  ASSERT_TRUE(view);
+  EXPECT_EQ(0.25, view->GetIfDouble());
+  EXPECT_EQ(absl::nullopt, view->GetIfInt());
+
+  encoded = Serialize("string");
+  view = BinaryValueView::Create(encoded);
+  ASSERT_TRUE(view);
+  EXPECT_EQ("string", view->GetIfString());
+  EXPECT_EQ(absl::nullopt, view->GetIfBlob());
+
+  const Value blob(Value::BlobStorage({0, 255}));
+  encoded = Serialize(blob);
+  view = BinaryValueView::Create(encoded);
+  ASSERT_TRUE(view);
+  ASSERT_TRUE(view->GetIfBlob());
+  EXPECT_EQ(blob.GetBlob(), Value::BlobStorage(view->GetIfBlob()->begin(),
+                                                view->GetIfBlob()->end()));
+  EXPECT_EQ(blob, view->ToValue());
+}
+
+TEST(BinaryValueViewTest, Dict) {
+  const Value::Dict prefs = CreatePrefs();
+  std::vector<uint8_t> encoded = Serialize(prefs);
+  absl::optional<BinaryValueView> view = BinaryValueView::Create(encoded);
+  ASSERT_TRUE(view);
+  EXPECT_EQ(Value::Type::DICTIONARY, view->type());
+  absl::optional<BinaryValueView::DictView> dict = view->GetIfDict();
+  ASSERT_TRUE(dict);
+  EXPECT_EQ(prefs.size(), dict->size());
+
+  EXPECT_EQ("empty key", dict->FindString(""));
+  EXPECT_EQ(Value::Type::NONE, dict->Find("none")->type());
+  EXPECT_TRUE(dict->FindDict("empty_dict")->empty());
+  EXPECT_TRUE(dict->FindList("empty_list")->empty());
+  EXPECT_EQ(absl::nullopt, dict->Find("missing"));
+  EXPECT_EQ(absl::nullopt, dict->FindInt("blob"));
+
+  EXPECT_EQ(1, dict->FindByDottedPath("extensions.settings.id1.state")
+                   ->GetIfInt());
+  EXPECT_EQ("1.0",
+            dict->FindByDottedPath("extensions.settings.id1.manifest.version")
+                ->GetIfString());
+  EXPECT_EQ(absl::nullopt,
+            dict->FindByDottedPath("extensions.settings.id3.state"));
+  EXPECT_EQ(absl::nullopt,
+            dict->FindByDottedPath("extensions.settings.id1.state.value"));
+
+  absl::optional<BinaryValueView::DictView> id2 =
+      dict->FindByDottedPath("extensions.settings.id2")->GetIfDict();
+  ASSERT_TRUE(id2);
+  EXPECT_EQ(0, id2->FindInt("state"));
+  EXPECT_EQ(true, id2->FindBool("from_webstore"));
+  EXPECT_EQ(1.5, id2->FindDouble("install_time"));
+  absl::optional<BinaryValueView::ListView> api = id2->FindList("api");
+  ASSERT_TRUE(api);
+  ASSERT_EQ(2u, api->size());
+  EXPECT_EQ("storage", api->Get(0)->GetIfString());
+  EXPECT_EQ("tabs", api->Get(1)->GetIfString());
+  EXPECT_EQ(absl::nullopt, api->Get(2));
+
+  // Entries are in key order.
+  size_t index = 0;
+  for (const auto [key, value] : prefs) {
+    absl::optional<std::pair<StringPiece, BinaryValueView>> entry =
+        dict->GetEntry(index++);
+    ASSERT_TRUE(entry);
+    EXPECT_EQ(key, entry->first);
+    EXPECT_EQ(value, entry->second.ToValue());
+  }
+
+  EXPECT_EQ(prefs, dict->ToDict());
+}
+
+TEST(BinaryValueViewTest, ManyKeys) {
+  Value::Dict dict;
+  for (int i = 0; i < 1000; ++i)
+    dict.Set("key" + NumberToString(i * 2), i);
+  std::vector<uint8_t> encoded = Serialize(dict);
+  absl::optional<BinaryValueView> view = BinaryValueView::Create(encoded);
+  ASSERT_TRUE(view);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(i, view->GetIfDict()->FindInt("key" + NumberToString(i * 2)));
+    EXPECT_EQ(absl::nullopt,
+              view->GetIfDict()->Find("key" + NumberToString(i * 2 + 1)));
+  }
+}
+
+TEST(BinaryValueViewTest, PositionIndependent) {
+  const Value::Dict prefs = CreatePrefs();
+  std::vector<uint8_t> encoded = Serialize(prefs);
+
+  // Copies of the encoding at any alignment read the same.
+  for (size_t padding = 1; padding < 8; ++padding) {
+    std::vector<uint8_t> moved(padding, 0);
+    moved.insert(moved.end(), encoded.begin(), encoded.end());
+    absl::optional<BinaryValueView> view =
+        BinaryValueView::Create(make_span(moved).subspan(padding));
+    ASSERT_TRUE(view);
+    EXPECT_EQ(Value(prefs.Clone()), view->ToValue());
+  }
+}
+
+TEST(BinaryValueViewTest, Malformed) {
+  EXPECT_EQ(absl::nullopt, BinaryValueView::Create({}));
+  const uint8_t kNotMagic[] = {'N', 'O', 'P', 'E', 0};
+  EXPECT_EQ(absl::nullopt, BinaryValueView::Create(kNotMagic));
+
+  const Value::Dict prefs = CreatePrefs();
+  const std::vector<uint8_t> encoded = Serialize(prefs);
+
+  // Truncated encodings don't read out of bounds, and can't be copied.
+  for (size_t size = 0; size < encoded.size(); ++size) {
+    absl::optional<BinaryValueView> view =
+        BinaryValueView::Create(make_span(encoded).first(size));
+    if (!view)
+      continue;
+    EXPECT_EQ(absl::nullopt, view->ToValue());
+    if (absl::optional<BinaryValueView::DictView> dict = view->GetIfDict()) {
+      dict->FindByDottedPath("extensions.settings.id2.api");
+      dict->Find("none");
+    }
+  }
+
+  // Neither do encodings with any byte changed.
+  for (size_t i = 0; i < encoded.size(); ++i) {
+    for (uint8_t byte : {0x00, 0x01, 0x07, 0x80, 0xff}) {
+      std::vector<uint8_t> corrupted = encoded;
+      corrupted[i] = byte;
+      absl::optional<BinaryValueView> view =
+          BinaryValueView::Create(corrupted);
+      if (!view)
+        continue;
+      view->ToValue();
+      if (absl::optional<BinaryValueView::DictView> dict = view->GetIfDict())
+        dict->FindByDottedPath("extensions.settings.id2.api");
+    }
+  }
+}
+
+TEST(BinaryValueViewTest, DeepNesting) {
+  // Views can read any depth, but copies are limited to the depth of JSON.
+  Value::List list;
+  for (int i = 0; i < 300; ++i) {
+    Value::List outer;
+    outer.Append(std::move(list));
+    list = std::move(outer);
+  }
+  std::vector<uint8_t> encoded = Serialize(list);
+  absl::optional<BinaryValueView> view = BinaryValueView::Create(encoded);
+  ASSERT_TRUE(view);
+  EXPECT_EQ(absl::nullopt, view->ToValue());
+  for (int i = 0; i < 300; ++i) {
+    ASSERT_TRUE(view->GetIfList());
+    view = view->GetIfList()->Get(0);
+    ASSERT_TRUE(view);
+  }
+  EXPECT_TRUE(view->GetIfList()->empty());
+}
+
+}  // namespace base
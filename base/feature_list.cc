@@ -11,6 +11,8 @@
 #pragma clang max_tokens_here 600000
 #endif
 
+#include <atomic>
+#include <limits>
 #include <string>
 #include <tuple>
 
@@ -64,6 +66,24 @@ void DCheckOverridesAllowed() {
 void DCheckOverridesAllowed() {}
 #endif
 
+// The bits of Feature::cached_value_ that hold the cached OverrideState. The
+// remaining bits hold the caching context of the FeatureList that cached it.
+constexpr uint32_t kCachedOverrideStateBits = 8;
+constexpr uint32_t kCachedOverrideStateMask =
+    (1u << kCachedOverrideStateBits) - 1;
+constexpr uint32_t kMaxCachingContext =
+    std::numeric_limits<uint32_t>::max() >> kCachedOverrideStateBits;
+
+// Returns a caching context for a new FeatureList. Contexts start at 1, so
+// that a cached value is never 0, and are only reused after wrapping around.
+uint32_t NextCachingContext() {
+  static std::atomic<uint32_t> g_last_caching_context{0};
+  uint32_t context =
+      g_last_caching_context.fetch_add(1, std::memory_order_relaxed) %
+      kMaxCachingContext;
+  return context + 1;
+}
+
 // An allocator entry for a feature in shared memory. The FeatureEntry is
 // followed by a base::Pickle object that contains the feature and trial name.
 struct FeatureEntry {
@@ -196,7 +216,7 @@ const Feature kDCheckIsFatalFeature{"DcheckIsFatal",
                                     FEATURE_DISABLED_BY_DEFAULT};
 #endif  // defined(DCHECK_IS_CONFIGURABLE)
 
-FeatureList::FeatureList() = default;
+FeatureList::FeatureList() : caching_context_(NextCachingContext()) {}
 
 FeatureList::~FeatureList() = default;
 
@@ -555,7 +575,21 @@ FeatureList::OverrideState FeatureList::GetOverrideState(
   DCHECK(IsValidFeatureOrFieldTrialName(feature.name)) << feature.name;
   DCHECK(CheckFeatureIdentity(feature)) << feature.name;
 
-  return GetOverrideStateByFeatureName(feature.name);
+  // Overrides can't change after initialization, so the state looked up for a
+  // feature by this object can be cached in the feature. A racing lookup on
+  // another thread at worst caches the same value again.
+  uint32_t cached_value =
+      feature.cached_value_.load(std::memory_order_relaxed);
+  if ((cached_value >> kCachedOverrideStateBits) == caching_context_) {
+    return static_cast<OverrideState>(cached_value &
+                                      kCachedOverrideStateMask);
+  }
+
+  OverrideState state = GetOverrideStateByFeatureName(feature.name);
+  feature.cached_value_.store(
+      (caching_context_ << kCachedOverrideStateBits) | state,
+      std::memory_order_relaxed);
+  return state;
 }
 
 FeatureList::OverrideState FeatureList::GetOverrideStateByFeatureName(
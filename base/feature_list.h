@@ -5,6 +5,9 @@
 #ifndef BASE_FEATURE_LIST_H_
 #define BASE_FEATURE_LIST_H_
 
+#include <stdint.h>
+
+#include <atomic>
 #include <functional>
 #include <map>
 #include <memory>
@@ -53,6 +56,13 @@ struct BASE_EXPORT Feature {
     }
 #endif  // BUILDFLAG(ENABLE_BANNED_BASE_FEATURE_PREFIX)
   }
+
+  // Copies don't share the cached state of |other|, since their address is not
+  // the one that is checked for identity.
+  constexpr Feature(const Feature& other)
+      : name(other.name), default_state(other.default_state) {}
+  Feature& operator=(const Feature&) = delete;
+
   // The name of the feature. This should be unique to each feature and is used
   // for enabling/disabling features via command line flags and experiments.
   // It is strongly recommended to use CamelCase style for feature names, e.g.
@@ -63,6 +73,15 @@ struct BASE_EXPORT Feature {
   // NOTE: The actual runtime state may be different, due to a field trial or a
   // command line switch.
   const FeatureState default_state;
+
+ private:
+  friend class FeatureList;
+
+  // The OverrideState of this feature in the low 8 bits, packed with the
+  // caching context of the FeatureList that looked it up in the other bits.
+  // 0 means that the state hasn't been cached. Lets FeatureList::IsEnabled()
+  // skip the lookup of the feature name in the overrides after the first call.
+  mutable std::atomic<uint32_t> cached_value_{0};
 };
 
 #if defined(DCHECK_IS_CONFIGURABLE)
@@ -475,6 +494,11 @@ class BASE_EXPORT FeatureList {
 
   // Whether this object has been initialized from command line.
   bool initialized_from_command_line_ = false;
+
+  // Identifies the override states cached in Feature structs by this object, so
+  // that states cached by a previous instance, e.g. one replaced by a
+  // ScopedFeatureList, are ignored. Unique to each instance and never 0.
+  const uint32_t caching_context_;
 };
 
 }  // namespace base
@@ -0,0 +1,81 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/feature_list.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_util.h"
+#include "base/test/scoped_feature_list.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace base {
+
+namespace {
+
+constexpr char kMetricPrefix[] = "FeatureList.";
+constexpr char kMetricLookupTime[] = "lookup_time";
+
+// Roughly the number of features overridden by a field trial config.
+constexpr size_t kNumFeatures = 5000;
+constexpr int kNumCachedIterations = 100;
+
+void ReportLookupTime(const std::string& story,
+                      TimeDelta elapsed,
+                      size_t num_lookups) {
+  perf_test::PerfResultReporter reporter(kMetricPrefix, story);
+  reporter.RegisterImportantMetric(kMetricLookupTime, "ns");
+  reporter.AddResult(kMetricLookupTime,
+                     elapsed.InNanosecondsF() / num_lookups);
+}
+
+}  // namespace
+
+// Measures IsEnabled() on features that are all overridden, the first time
+// each feature is queried, which looks up its name in the overrides, and after
+// that, when its state is cached.
+TEST(FeatureListPerfTest, IsEnabled) {
+  std::vector<std::string> names;
+  names.reserve(kNumFeatures);
+  for (size_t i = 0; i < kNumFeatures; ++i)
+    names.push_back("PerfTestFeature" + NumberToString(i));
+
+  // The features must not move once queried, since their identity is their
+  // address.
+  std::vector<Feature> features;
+  features.reserve(kNumFeatures);
+  for (const std::string& name : names)
+    features.emplace_back(name.c_str(), FEATURE_DISABLED_BY_DEFAULT);
+
+  auto feature_list = std::make_unique<FeatureList>();
+  feature_list->InitializeFromCommandLine(JoinString(names, ","), "");
+  test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitWithFeatureList(std::move(feature_list));
+
+  size_t num_enabled = 0;
+  ElapsedTimer uncached_timer;
+  for (const Feature& feature : features)
+    num_enabled += FeatureList::IsEnabled(feature);
+  TimeDelta uncached_time = uncached_timer.Elapsed();
+
+  ElapsedTimer cached_timer;
+  for (int i = 0; i < kNumCachedIterations; ++i) {
+    for (const Feature& feature : features)
+      num_enabled += FeatureList::IsEnabled(feature);
+  }
+  TimeDelta cached_time = cached_timer.Elapsed();
+  EXPECT_EQ(kNumFeatures * (kNumCachedIterations + 1), num_enabled);
+
+  ReportLookupTime("Uncached", uncached_time, kNumFeatures);
+  ReportLookupTime("Cached", cached_time, kNumFeatures * kNumCachedIterations);
+}
+
+}  // namespace base
@@ -600,6 +600,49 @@ TEST_F(FeatureListTest, InitializeInstance) {
   EXPECT_FALSE(FeatureList::IsEnabled(kFeatureOffByDefault));
 }
 
+TEST_F(FeatureListTest, CachedStateIsPerInstance) {
+  // The state is cached in the feature by the first call.
+  EXPECT_FALSE(FeatureList::IsEnabled(kFeatureOffByDefault));
+  EXPECT_FALSE(FeatureList::IsEnabled(kFeatureOffByDefault));
+
+  {
+    auto feature_list = std::make_unique<FeatureList>();
+    feature_list->InitializeFromCommandLine(kFeatureOffByDefaultName,
+                                            kFeatureOnByDefaultName);
+    test::ScopedFeatureList scoped_feature_list;
+    scoped_feature_list.InitWithFeatureList(std::move(feature_list));
+
+    // States cached by the previous instance are ignored.
+    EXPECT_TRUE(FeatureList::IsEnabled(kFeatureOffByDefault));
+    EXPECT_TRUE(FeatureList::IsEnabled(kFeatureOffByDefault));
+    EXPECT_FALSE(FeatureList::IsEnabled(kFeatureOnByDefault));
+    EXPECT_EQ(false, FeatureList::GetStateIfOverridden(kFeatureOnByDefault));
+  }
+
+  // So are the states cached by the instance that was replaced.
+  EXPECT_FALSE(FeatureList::IsEnabled(kFeatureOffByDefault));
+  EXPECT_TRUE(FeatureList::IsEnabled(kFeatureOnByDefault));
+  EXPECT_EQ(absl::nullopt,
+            FeatureList::GetStateIfOverridden(kFeatureOnByDefault));
+}
+
+TEST_F(FeatureListTest, CachedStateActivatesFieldTrialOnce) {
+  test::ScopedFieldTrialListResetter resetter;
+  FieldTrialList field_trial_list(nullptr);
+  auto feature_list = std::make_unique<FeatureList>();
+  FieldTrial* trial = FieldTrialList::CreateFieldTrial("TrialExample", "A");
+  feature_list->RegisterFieldTrialOverride(
+      kFeatureOffByDefaultName, FeatureList::OVERRIDE_ENABLE_FEATURE, trial);
+  test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitWithFeatureList(std::move(feature_list));
+
+  EXPECT_FALSE(FieldTrialList::IsTrialActive(trial->trial_name()));
+  EXPECT_TRUE(FeatureList::IsEnabled(kFeatureOffByDefault));
+  EXPECT_TRUE(FieldTrialList::IsTrialActive(trial->trial_name()));
+  EXPECT_TRUE(FeatureList::IsEnabled(kFeatureOffByDefault));
+  EXPECT_TRUE(FieldTrialList::IsTrialActive(trial->trial_name()));
+}
+
 TEST_F(FeatureListTest, UninitializedInstance_IsEnabledReturnsFalse) {
   std::unique_ptr<FeatureList> original_feature_list =
       FeatureList::ClearInstanceForTesting();
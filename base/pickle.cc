@@ -4,13 +4,16 @@
 
 #include "base/pickle.h"
 
-#include <algorithm>  // for max()
+#include <algorithm>
 #include <cstdlib>
 #include <limits>
+#include <memory>
 
 #include "base/bits.h"
+#include "base/no_destructor.h"
 #include "base/numerics/safe_conversions.h"
 #include "base/numerics/safe_math.h"
+#include "base/threading/thread_local.h"
 #include "build/build_config.h"
 
 namespace base {
@@ -20,6 +23,95 @@ const size_t Pickle::kPayloadUnit = 64;
 
 static const size_t kCapacityReadOnly = static_cast<size_t>(-1);
 
+namespace {
+
+// Keeps the buffers of destroyed Pickles for the next Pickles on the same
+// thread, since most Pickles are short-lived, and are written in loops that
+// create Pickles of similar sizes, such as when sending IPC messages or writing
+// disk cache entries.
+class PickleBufferPool {
+ public:
+  PickleBufferPool() = default;
+  PickleBufferPool(const PickleBufferPool&) = delete;
+  PickleBufferPool& operator=(const PickleBufferPool&) = delete;
+  ~PickleBufferPool() {
+    for (size_t i = 0; i < buffer_count_; ++i)
+      free(buffers_[i].data);
+  }
+
+  // Returns the pool of the current thread. Only creates it if |create|, so
+  // that Pickles destroyed after it at thread exit don't create another.
+  static PickleBufferPool* Get(bool create) {
+    static NoDestructor<ThreadLocalOwnedPointer<PickleBufferPool>> pools;
+    PickleBufferPool* pool = pools->Get();
+    if (!pool && create) {
+      pools->Set(std::make_unique<PickleBufferPool>());
+      pool = pools->Get();
+    }
+    return pool;
+  }
+
+  // Returns the smallest pooled buffer of at least |min_size| bytes and sets
+  // |*size| to its size, or returns null if there is none. Doesn't return much
+  // larger buffers, which small Pickles would then hold on to.
+  void* Take(size_t min_size, size_t* size) {
+    const size_t max_size = std::max(2 * min_size, kSmallBufferSize);
+    size_t best = buffer_count_;
+    for (size_t i = 0; i < buffer_count_; ++i) {
+      if (buffers_[i].size >= min_size && buffers_[i].size <= max_size &&
+          (best == buffer_count_ || buffers_[i].size < buffers_[best].size)) {
+        best = i;
+      }
+    }
+    if (best == buffer_count_)
+      return nullptr;
+    void* data = buffers_[best].data;
+    *size = buffers_[best].size;
+    std::copy(buffers_ + best + 1, buffers_ + buffer_count_, buffers_ + best);
+    --buffer_count_;
+    return data;
+  }
+
+  // Keeps |data|, of |size| bytes, for reuse, or frees it if it's too large.
+  // Frees the least recently released buffer if the pool is full.
+  void Release(void* data, size_t size) {
+    if (size > kMaxBufferSize) {
+      free(data);
+      return;
+    }
+    if (buffer_count_ == kMaxBuffers) {
+      free(buffers_[0].data);
+      std::copy(buffers_ + 1, buffers_ + buffer_count_, buffers_);
+      --buffer_count_;
+    }
+    buffers_[buffer_count_++] = {data, size};
+  }
+
+  void RecordAllocation() { ++allocation_count_; }
+  size_t allocation_count() const { return allocation_count_; }
+
+ private:
+  // Bounds the memory that each thread keeps to 128 KB.
+  static constexpr size_t kMaxBuffers = 4;
+  static constexpr size_t kMaxBufferSize = 32 * 1024;
+
+  // Buffers up to this size are returned for any smaller Pickle.
+  static constexpr size_t kSmallBufferSize = 4 * 1024;
+
+  struct Buffer {
+    void* data;
+    size_t size;
+  };
+
+  // In the order they were released.
+  Buffer buffers_[kMaxBuffers];
+  size_t buffer_count_ = 0;
+
+  size_t allocation_count_ = 0;
+};
+
+}  // namespace
+
 PickleIterator::PickleIterator(const Pickle& pickle)
     : payload_(pickle.payload()),
       read_index_(0),
@@ -224,7 +316,8 @@ Pickle::Pickle()
     : header_(nullptr),
       header_size_(sizeof(Header)),
       capacity_after_header_(0),
-      write_offset_(0) {
+      write_offset_(0),
+      allocated_size_(0) {
   static_assert(base::bits::IsPowerOfTwo(Pickle::kPayloadUnit),
                 "Pickle::kPayloadUnit must be a power of two");
   Resize(kPayloadUnit);
@@ -235,18 +328,32 @@ Pickle::Pickle(size_t header_size)
     : header_(nullptr),
       header_size_(bits::AlignUp(header_size, sizeof(uint32_t))),
       capacity_after_header_(0),
-      write_offset_(0) {
+      write_offset_(0),
+      allocated_size_(0) {
   DCHECK_GE(header_size, sizeof(Header));
   DCHECK_LE(header_size, kPayloadUnit);
   Resize(kPayloadUnit);
   header_->payload_size = 0;
 }
 
+Pickle::Pickle(size_t header_size, size_t payload_capacity)
+    : header_(nullptr),
+      header_size_(bits::AlignUp(header_size, sizeof(uint32_t))),
+      capacity_after_header_(0),
+      write_offset_(0),
+      allocated_size_(0) {
+  DCHECK_GE(header_size, sizeof(Header));
+  DCHECK_LE(header_size, kPayloadUnit);
+  Resize(std::max(payload_capacity, kPayloadUnit));
+  header_->payload_size = 0;
+}
+
 Pickle::Pickle(const char* data, size_t data_len)
     : header_(reinterpret_cast<Header*>(const_cast<char*>(data))),
       header_size_(0),
       capacity_after_header_(kCapacityReadOnly),
-      write_offset_(0) {
+      write_offset_(0),
+      allocated_size_(0) {
   if (data_len >= sizeof(Header))
     header_size_ = data_len - header_->payload_size;
 
@@ -265,7 +372,8 @@ Pickle::Pickle(const Pickle& other)
     : header_(nullptr),
       header_size_(other.header_size_),
       capacity_after_header_(0),
-      write_offset_(other.write_offset_) {
+      write_offset_(other.write_offset_),
+      allocated_size_(0) {
   if (other.header_) {
     Resize(other.header_->payload_size);
     memcpy(header_, other.header_, header_size_ + other.header_->payload_size);
@@ -274,7 +382,7 @@ Pickle::Pickle(const Pickle& other)
 
 Pickle::~Pickle() {
   if (capacity_after_header_ != kCapacityReadOnly)
-    free(header_);
+    ReleaseBuffer();
 }
 
 Pickle& Pickle::operator=(const Pickle& other) {
@@ -286,8 +394,10 @@ Pickle& Pickle::operator=(const Pickle& other) {
     capacity_after_header_ = 0;
   }
   if (header_size_ != other.header_size_) {
-    free(header_);
+    ReleaseBuffer();
     header_ = nullptr;
+    capacity_after_header_ = 0;
+    allocated_size_ = 0;
     header_size_ = other.header_size_;
   }
   if (other.header_) {
@@ -345,9 +455,38 @@ bool Pickle::HasAttachments() const {
 void Pickle::Resize(size_t new_capacity) {
   CHECK_NE(capacity_after_header_, kCapacityReadOnly);
   capacity_after_header_ = bits::AlignUp(new_capacity, kPayloadUnit);
-  void* p = realloc(header_, GetTotalAllocatedSize());
+  const size_t new_size = header_size_ + capacity_after_header_;
+  // A buffer reused from another Pickle may already be large enough.
+  if (header_ && new_size <= allocated_size_)
+    return;
+
+  PickleBufferPool* pool = PickleBufferPool::Get(/*create=*/true);
+  size_t pooled_size = 0;
+  if (void* p = pool ? pool->Take(new_size, &pooled_size) : nullptr) {
+    if (header_) {
+      memcpy(p, header_, std::min(allocated_size_, new_size));
+      pool->Release(header_, allocated_size_);
+    }
+    header_ = reinterpret_cast<Header*>(p);
+    allocated_size_ = pooled_size;
+    return;
+  }
+
+  void* p = realloc(header_, new_size);
   CHECK(p);
   header_ = reinterpret_cast<Header*>(p);
+  allocated_size_ = new_size;
+  if (pool)
+    pool->RecordAllocation();
+}
+
+void Pickle::ReleaseBuffer() {
+  if (!header_)
+    return;
+  if (PickleBufferPool* pool = PickleBufferPool::Get(/*create=*/false))
+    pool->Release(header_, allocated_size_);
+  else
+    free(header_);
 }
 
 void* Pickle::ClaimBytes(size_t num_bytes) {
@@ -360,7 +499,13 @@ void* Pickle::ClaimBytes(size_t num_bytes) {
 size_t Pickle::GetTotalAllocatedSize() const {
   if (capacity_after_header_ == kCapacityReadOnly)
     return 0;
-  return header_size_ + capacity_after_header_;
+  return allocated_size_;
+}
+
+// static
+size_t Pickle::GetAllocationCountForTesting() {
+  PickleBufferPool* pool = PickleBufferPool::Get(/*create=*/true);
+  return pool->allocation_count();
 }
 
 // static
@@ -400,6 +545,28 @@ bool Pickle::PeekNext(size_t header_size,
   return true;
 }
 
+PickleSizer::PickleSizer() = default;
+
+PickleSizer::~PickleSizer() = default;
+
+void PickleSizer::AddString(const StringPiece& value) {
+  AddData(value.size());
+}
+
+void PickleSizer::AddString16(const StringPiece16& value) {
+  AddInt();
+  AddBytes(value.size() * sizeof(char16_t));
+}
+
+void PickleSizer::AddData(size_t length) {
+  AddInt();
+  AddBytes(length);
+}
+
+void PickleSizer::AddBytes(size_t length) {
+  payload_size_ += bits::AlignUp(length, sizeof(uint32_t));
+}
+
 template <size_t length>
 void Pickle::WriteBytesStatic(const void* data) {
   WriteBytesCommon(data, length);
@@ -155,6 +155,12 @@ class BASE_EXPORT Pickle {
   // will be rounded up to ensure that the header size is 32bit-aligned.
   explicit Pickle(size_t header_size);
 
+  // Initialize a Pickle object with the specified header size, as above, and
+  // with room for |payload_capacity| bytes of payload, so that writing that
+  // much doesn't grow the buffer. Use a PickleSizer to compute the exact size
+  // of the payload up front.
+  Pickle(size_t header_size, size_t payload_capacity);
+
   // Initializes a Pickle from a const block of data.  The data is not copied;
   // instead the data is merely referenced by this Pickle.  Only const methods
   // should be used on the Pickle when initialized this way.  The header
@@ -188,6 +194,11 @@ class BASE_EXPORT Pickle {
   // purposes.
   size_t GetTotalAllocatedSize() const;
 
+  // Returns the number of times that Pickles on the current thread allocated or
+  // reallocated a buffer because none of the buffers that destroyed Pickles
+  // left behind was large enough. For tests and benchmarks.
+  static size_t GetAllocationCountForTesting();
+
   // Methods for adding to the payload of the Pickle.  These values are
   // appended to the end of the Pickle's payload.  When reading values from a
   // Pickle, it is important to read them in the order in which they were added
@@ -283,7 +294,8 @@ class BASE_EXPORT Pickle {
   }
 
   // Resize the capacity, note that the input value should not include the size
-  // of the header.
+  // of the header. The buffer may then be larger than the capacity, if it was
+  // reused from a destroyed Pickle.
   void Resize(size_t new_capacity);
 
   // Claims |num_bytes| bytes of payload. This is similar to Reserve() in that
@@ -327,6 +339,9 @@ class BASE_EXPORT Pickle {
   // The offset at which we will write the next field. Note: this doesn't count
   // the header.
   size_t write_offset_;
+  // The size of the buffer at |header_|, including the header, which is at
+  // least |header_size_ + capacity_after_header_|.
+  size_t allocated_size_;
 
   // Just like WriteBytes, but with a compile-time size, for performance.
   template<size_t length> void BASE_EXPORT WriteBytesStatic(const void* data);
@@ -340,6 +355,9 @@ class BASE_EXPORT Pickle {
   inline void* ClaimUninitializedBytesInternal(size_t num_bytes);
   inline void WriteBytesCommon(const void* data, size_t length);
 
+  // Frees the buffer, or keeps it for the next Pickles on this thread.
+  void ReleaseBuffer();
+
   FRIEND_TEST_ALL_PREFIXES(PickleTest, DeepCopyResize);
   FRIEND_TEST_ALL_PREFIXES(PickleTest, Resize);
   FRIEND_TEST_ALL_PREFIXES(PickleTest, PeekNext);
@@ -349,6 +367,43 @@ class BASE_EXPORT Pickle {
   FRIEND_TEST_ALL_PREFIXES(PickleTest, FindNextOverflow);
 };
 
+// Computes the payload size of a Pickle from the values that will be written to
+// it, following the same padding rules, so that the Pickle can be created with
+// exactly that capacity instead of growing while it is written. Each AddFoo()
+// call accounts for the corresponding Pickle::WriteFoo() call.
+class BASE_EXPORT PickleSizer {
+ public:
+  PickleSizer();
+  PickleSizer(const PickleSizer&) = delete;
+  PickleSizer& operator=(const PickleSizer&) = delete;
+  ~PickleSizer();
+
+  // Returns the size of the payload so far.
+  size_t payload_size() const { return payload_size_; }
+
+  void AddBool() { AddInt(); }
+  void AddInt() { AddPOD<int>(); }
+  void AddLong() { AddPOD<int64_t>(); }
+  void AddUInt16() { AddPOD<uint16_t>(); }
+  void AddUInt32() { AddPOD<uint32_t>(); }
+  void AddInt64() { AddPOD<int64_t>(); }
+  void AddUInt64() { AddPOD<uint64_t>(); }
+  void AddFloat() { AddPOD<float>(); }
+  void AddDouble() { AddPOD<double>(); }
+  void AddString(const StringPiece& value);
+  void AddString16(const StringPiece16& value);
+  void AddData(size_t length);
+  void AddBytes(size_t length);
+
+ private:
+  template <typename T>
+  void AddPOD() {
+    AddBytes(sizeof(T));
+  }
+
+  size_t payload_size_ = 0;
+};
+
 }  // namespace base
 
 #endif  // BASE_PICKLE_H_
@@ -0,0 +1,150 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/pickle.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/utf_string_conversions.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace base {
+
+namespace {
+
+constexpr char kMetricPrefix[] = "Pickle.";
+constexpr char kMetricTime[] = "time_per_tab";
+constexpr char kMetricAllocations[] = "allocations_per_tab";
+constexpr char kMetricSize[] = "size";
+
+constexpr int kNumNavigations = 25;
+constexpr int kNumIterations = 10000;
+
+// The fields of a navigation that session restore saves for each tab.
+struct Navigation {
+  int index;
+  std::string virtual_url;
+  std::u16string title;
+  std::string encoded_page_state;
+  int transition_type;
+  int type_mask;
+  std::string referrer_url;
+  int referrer_policy;
+  std::string original_request_url;
+  bool is_overriding_user_agent;
+  int64_t timestamp;
+  std::u16string search_terms;
+  int http_status_code;
+};
+
+std::vector<Navigation> CreateTab() {
+  std::vector<Navigation> tab;
+  for (int i = 0; i < kNumNavigations; ++i) {
+    const std::string url =
+        "https://www.example.com/articles/" + NumberToString(i) + "?ref=home";
+    tab.push_back({i, url, UTF8ToUTF16("Article " + NumberToString(i)),
+                   std::string(300 + 20 * i, 'p'), 0, 1,
+                   "https://www.example.com/", 2, url, false,
+                   13301234567890123 + i, std::u16string(), 200});
+  }
+  return tab;
+}
+
+// Writes |navigation| the way SerializedNavigationEntry::WriteToPickle() does.
+void WriteNavigation(const Navigation& navigation, Pickle* pickle) {
+  pickle->WriteInt(navigation.index);
+  pickle->WriteString(navigation.virtual_url);
+  pickle->WriteString16(navigation.title);
+  pickle->WriteString(navigation.encoded_page_state);
+  pickle->WriteInt(navigation.transition_type);
+  pickle->WriteInt(navigation.type_mask);
+  pickle->WriteString(navigation.referrer_url);
+  pickle->WriteInt(navigation.referrer_policy);
+  pickle->WriteString(navigation.original_request_url);
+  pickle->WriteBool(navigation.is_overriding_user_agent);
+  pickle->WriteInt64(navigation.timestamp);
+  pickle->WriteString16(navigation.search_terms);
+  pickle->WriteInt(navigation.http_status_code);
+}
+
+// Accounts for the writes of WriteNavigation().
+void AddNavigation(const Navigation& navigation, PickleSizer* sizer) {
+  sizer->AddInt();
+  sizer->AddString(navigation.virtual_url);
+  sizer->AddString16(navigation.title);
+  sizer->AddString(navigation.encoded_page_state);
+  sizer->AddInt();
+  sizer->AddInt();
+  sizer->AddString(navigation.referrer_url);
+  sizer->AddInt();
+  sizer->AddString(navigation.original_request_url);
+  sizer->AddBool();
+  sizer->AddInt64();
+  sizer->AddString16(navigation.search_terms);
+  sizer->AddInt();
+}
+
+void WriteTab(const std::vector<Navigation>& tab, Pickle* pickle) {
+  pickle->WriteInt(static_cast<int>(tab.size()));
+  for (const Navigation& navigation : tab)
+    WriteNavigation(navigation, pickle);
+}
+
+void Report(const std::string& story,
+            TimeDelta time,
+            size_t allocation_count,
+            size_t size) {
+  perf_test::PerfResultReporter reporter(kMetricPrefix, story);
+  reporter.RegisterImportantMetric(kMetricTime, "us");
+  reporter.RegisterImportantMetric(kMetricAllocations, "count");
+  reporter.RegisterImportantMetric(kMetricSize, "bytes");
+  reporter.AddResult(kMetricTime, time.InMicrosecondsF() / kNumIterations);
+  reporter.AddResult(kMetricAllocations,
+                     static_cast<double>(allocation_count) / kNumIterations);
+  reporter.AddResult(kMetricSize, size);
+}
+
+}  // namespace
+
+// Measures writing the session state of a tab with many navigations into a
+// Pickle that grows as it is written, and into one sized with a PickleSizer
+// first. Both reuse the buffers of the Pickles written before them.
+TEST(PicklePerfTest, WriteTabState) {
+  const std::vector<Navigation> tab = CreateTab();
+
+  size_t size = 0;
+  size_t allocation_count = Pickle::GetAllocationCountForTesting();
+  ElapsedTimer growing_timer;
+  for (int i = 0; i < kNumIterations; ++i) {
+    Pickle pickle;
+    WriteTab(tab, &pickle);
+    size = pickle.size();
+  }
+  Report("Growing", growing_timer.Elapsed(),
+         Pickle::GetAllocationCountForTesting() - allocation_count, size);
+
+  allocation_count = Pickle::GetAllocationCountForTesting();
+  ElapsedTimer sized_timer;
+  for (int i = 0; i < kNumIterations; ++i) {
+    PickleSizer sizer;
+    sizer.AddInt();
+    for (const Navigation& navigation : tab)
+      AddNavigation(navigation, &sizer);
+    Pickle pickle(sizeof(Pickle::Header), sizer.payload_size());
+    WriteTab(tab, &pickle);
+    ASSERT_EQ(sizer.payload_size(), pickle.payload_size());
+  }
+  Report("Sized", sized_timer.Elapsed(),
+         Pickle::GetAllocationCountForTesting() - allocation_count, size);
+}
+
+}  // namespace base
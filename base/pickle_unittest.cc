@@ -637,4 +637,111 @@ TEST(PickleTest, ReachedEnd) {
   EXPECT_TRUE(iter.ReachedEnd());
 }
 
+TEST(PickleTest, PickleSizer) {
+  const std::string kString(13, 'a');
+  const std::u16string kString16(7, u'b');
+  const char kData[] = {1, 2, 3, 4, 5};
+
+  Pickle pickle;
+  PickleSizer sizer;
+  pickle.WriteBool(true);
+  sizer.AddBool();
+  EXPECT_EQ(pickle.payload_size(), sizer.payload_size());
+  pickle.WriteUInt16(testuint16);
+  sizer.AddUInt16();
+  EXPECT_EQ(pickle.payload_size(), sizer.payload_size());
+  pickle.WriteLong(testlong);
+  sizer.AddLong();
+  pickle.WriteInt64(testint64);
+  sizer.AddInt64();
+  pickle.WriteFloat(testfloat);
+  sizer.AddFloat();
+  pickle.WriteDouble(testdouble);
+  sizer.AddDouble();
+  EXPECT_EQ(pickle.payload_size(), sizer.payload_size());
+  pickle.WriteString(kString);
+  sizer.AddString(kString);
+  pickle.WriteString(std::string());
+  sizer.AddString(std::string());
+  pickle.WriteString16(kString16);
+  sizer.AddString16(kString16);
+  EXPECT_EQ(pickle.payload_size(), sizer.payload_size());
+  pickle.WriteData(kData, sizeof(kData));
+  sizer.AddData(sizeof(kData));
+  pickle.WriteBytes(kData, 3);
+  sizer.AddBytes(3);
+  EXPECT_EQ(pickle.payload_size(), sizer.payload_size());
+}
+
+// Checks that a Pickle created with the size computed by a PickleSizer doesn't
+// grow while it is written.
+TEST(PickleTest, SizedPickle) {
+  const std::string kString(1000, 'a');
+  PickleSizer sizer;
+  for (int i = 0; i < 10; ++i) {
+    sizer.AddInt();
+    sizer.AddString(kString);
+  }
+
+  Pickle pickle(sizeof(Pickle::Header), sizer.payload_size());
+  const void* data = pickle.data();
+  const size_t allocated_size = pickle.GetTotalAllocatedSize();
+  EXPECT_GE(allocated_size, sizeof(Pickle::Header) + sizer.payload_size());
+  for (int i = 0; i < 10; ++i) {
+    pickle.WriteInt(i);
+    pickle.WriteString(kString);
+  }
+  EXPECT_EQ(sizer.payload_size(), pickle.payload_size());
+  EXPECT_EQ(data, pickle.data());
+  EXPECT_EQ(allocated_size, pickle.GetTotalAllocatedSize());
+
+  PickleIterator iter(pickle);
+  for (int i = 0; i < 10; ++i) {
+    int value;
+    std::string string;
+    EXPECT_TRUE(iter.ReadInt(&value));
+    EXPECT_EQ(i, value);
+    EXPECT_TRUE(iter.ReadString(&string));
+    EXPECT_EQ(kString, string);
+  }
+  EXPECT_TRUE(iter.ReachedEnd());
+}
+
+// Checks that Pickles written in a loop reuse the buffers of the previous ones.
+TEST(PickleTest, ReusesBuffers) {
+  const std::string kString(3000, 'a');
+  auto write_pickles = [&kString] {
+    Pickle pickle;
+    for (int i = 0; i < 3; ++i)
+      pickle.WriteString(kString);
+    Pickle copy(pickle);
+    Pickle custom_header(sizeof(CustomHeader));
+    custom_header.WriteInt(1);
+    copy = custom_header;
+
+    PickleIterator iter(pickle);
+    std::string string;
+    EXPECT_TRUE(iter.ReadString(&string));
+    EXPECT_EQ(kString, string);
+    int value;
+    EXPECT_TRUE(PickleIterator(copy).ReadInt(&value));
+    EXPECT_EQ(1, value);
+  };
+
+  write_pickles();
+  const size_t allocation_count = Pickle::GetAllocationCountForTesting();
+  for (int i = 0; i < 10; ++i)
+    write_pickles();
+  EXPECT_EQ(allocation_count, Pickle::GetAllocationCountForTesting());
+}
+
+// Checks that small Pickles don't hold on to the large buffers of destroyed
+// Pickles.
+TEST(PickleTest, SmallPickleDoesNotReuseLargeBuffer) {
+  { Pickle large(sizeof(Pickle::Header), 30 * 1024); }
+  Pickle small;
+  EXPECT_LT(small.GetTotalAllocatedSize(), 30u * 1024);
+  EXPECT_EQ(0u, small.payload_size());
+}
+
 }  // namespace base
@@ -0,0 +1,299 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/value_builder.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "base/check_op.h"
+#include "base/notreached.h"
+
+namespace base {
+
+namespace {
+
+// The size of the chunks of the string arena. Strings larger than a quarter
+// of it get a chunk of their own, so that little of a chunk is left unused.
+constexpr size_t kArenaChunkSize = 16 * 1024;
+constexpr size_t kMaxSharedChunkCopySize = kArenaChunkSize / 4;
+
+}  // namespace
+
+ValueBuilder::DictRef::DictRef(ValueBuilder* builder, uint32_t index)
+    : builder_(builder), index_(index) {}
+
+ValueBuilder::DictRef::DictRef(const DictRef&) = default;
+
+ValueBuilder::DictRef& ValueBuilder::DictRef::operator=(const DictRef&) =
+    default;
+
+ValueBuilder::DictRef::~DictRef() = default;
+
+void ValueBuilder::DictRef::Set(StringPiece key, bool value) {
+  uint32_t index = builder_->AddNode(index_, key, Value::Type::BOOLEAN);
+  builder_->nodes_[index].bool_value = value;
+}
+
+void ValueBuilder::DictRef::Set(StringPiece key, int value) {
+  uint32_t index = builder_->AddNode(index_, key, Value::Type::INTEGER);
+  builder_->nodes_[index].int_value = value;
+}
+
+void ValueBuilder::DictRef::Set(StringPiece key, double value) {
+  uint32_t index = builder_->AddNode(index_, key, Value::Type::DOUBLE);
+  builder_->nodes_[index].double_value = value;
+}
+
+void ValueBuilder::DictRef::Set(StringPiece key, StringPiece value) {
+  uint32_t index = builder_->AddNode(index_, key, Value::Type::STRING);
+  builder_->nodes_[index].bytes = builder_->CopyToArena(value);
+}
+
+void ValueBuilder::DictRef::Set(StringPiece key, const char* value) {
+  Set(key, StringPiece(value));
+}
+
+void ValueBuilder::DictRef::Set(StringPiece key, const Value& value) {
+  builder_->AddValue(index_, key, value);
+}
+
+ValueBuilder::DictRef ValueBuilder::DictRef::SetDict(StringPiece key) {
+  return DictRef(builder_,
+                 builder_->AddNode(index_, key, Value::Type::DICTIONARY));
+}
+
+ValueBuilder::ListRef ValueBuilder::DictRef::SetList(StringPiece key) {
+  return ListRef(builder_, builder_->AddNode(index_, key, Value::Type::LIST));
+}
+
+size_t ValueBuilder::DictRef::size() const {
+  return builder_->nodes_[index_].children.size;
+}
+
+Value::Dict ValueBuilder::DictRef::ToDict() const {
+  return builder_->ToDict(index_);
+}
+
+ValueBuilder::ListRef::ListRef(ValueBuilder* builder, uint32_t index)
+    : builder_(builder), index_(index) {}
+
+ValueBuilder::ListRef::ListRef(const ListRef&) = default;
+
+ValueBuilder::ListRef& ValueBuilder::ListRef::operator=(const ListRef&) =
+    default;
+
+ValueBuilder::ListRef::~ListRef() = default;
+
+void ValueBuilder::ListRef::Append(bool value) {
+  uint32_t index =
+      builder_->AddNode(index_, StringPiece(), Value::Type::BOOLEAN);
+  builder_->nodes_[index].bool_value = value;
+}
+
+void ValueBuilder::ListRef::Append(int value) {
+  uint32_t index =
+      builder_->AddNode(index_, StringPiece(), Value::Type::INTEGER);
+  builder_->nodes_[index].int_value = value;
+}
+
+void ValueBuilder::ListRef::Append(double value) {
+  uint32_t index =
+      builder_->AddNode(index_, StringPiece(), Value::Type::DOUBLE);
+  builder_->nodes_[index].double_value = value;
+}
+
+void ValueBuilder::ListRef::Append(StringPiece value) {
+  uint32_t index =
+      builder_->AddNode(index_, StringPiece(), Value::Type::STRING);
+  builder_->nodes_[index].bytes = builder_->CopyToArena(value);
+}
+
+void ValueBuilder::ListRef::Append(const char* value) {
+  Append(StringPiece(value));
+}
+
+void ValueBuilder::ListRef::Append(const Value& value) {
+  builder_->AddValue(index_, StringPiece(), value);
+}
+
+ValueBuilder::DictRef ValueBuilder::ListRef::AppendDict() {
+  return DictRef(builder_, builder_->AddNode(index_, StringPiece(),
+                                             Value::Type::DICTIONARY));
+}
+
+ValueBuilder::ListRef ValueBuilder::ListRef::AppendList() {
+  return ListRef(builder_,
+                 builder_->AddNode(index_, StringPiece(), Value::Type::LIST));
+}
+
+size_t ValueBuilder::ListRef::size() const {
+  return builder_->nodes_[index_].children.size;
+}
+
+Value::List ValueBuilder::ListRef::ToList() const {
+  return builder_->ToList(index_);
+}
+
+ValueBuilder::ValueBuilder() {
+  Node& root = nodes_.emplace_back();
+  root.type = Value::Type::DICTIONARY;
+  root.next_sibling = kNoNode;
+  root.key = Bytes{nullptr, 0};
+  root.children = Children{kNoNode, kNoNode, 0};
+}
+
+ValueBuilder::~ValueBuilder() = default;
+
+ValueBuilder::DictRef ValueBuilder::root() {
+  return DictRef(this, 0);
+}
+
+uint32_t ValueBuilder::AddNode(uint32_t parent,
+                               StringPiece key,
+                               Value::Type type) {
+  CHECK_LT(nodes_.size(), size_t{kNoNode});
+  const uint32_t index = static_cast<uint32_t>(nodes_.size());
+
+  Node node{};
+  node.type = type;
+  node.next_sibling = kNoNode;
+  node.key = nodes_[parent].type == Value::Type::DICTIONARY
+                 ? CopyToArena(key)
+                 : Bytes{nullptr, 0};
+  if (type == Value::Type::DICTIONARY || type == Value::Type::LIST)
+    node.children = Children{kNoNode, kNoNode, 0};
+  nodes_.push_back(node);
+
+  Children& siblings = nodes_[parent].children;
+  if (siblings.last == kNoNode)
+    siblings.first = index;
+  else
+    nodes_[siblings.last].next_sibling = index;
+  siblings.last = index;
+  ++siblings.size;
+  return index;
+}
+
+void ValueBuilder::AddValue(uint32_t parent,
+                            StringPiece key,
+                            const Value& value) {
+  const uint32_t index = AddNode(parent, key, value.type());
+  switch (value.type()) {
+    case Value::Type::NONE:
+      return;
+    case Value::Type::BOOLEAN:
+      nodes_[index].bool_value = value.GetBool();
+      return;
+    case Value::Type::INTEGER:
+      nodes_[index].int_value = value.GetInt();
+      return;
+    case Value::Type::DOUBLE:
+      nodes_[index].double_value = value.GetDouble();
+      return;
+    case Value::Type::STRING:
+      nodes_[index].bytes = CopyToArena(value.GetString());
+      return;
+    case Value::Type::BINARY: {
+      const Value::BlobStorage& blob = value.GetBlob();
+      nodes_[index].bytes = CopyToArena(
+          StringPiece(reinterpret_cast<const char*>(blob.data()), blob.size()));
+      return;
+    }
+    case Value::Type::DICTIONARY:
+      for (const auto [child_key, child] : value.GetDict())
+        AddValue(index, child_key, child);
+      return;
+    case Value::Type::LIST:
+      for (const Value& child : value.GetList())
+        AddValue(index, StringPiece(), child);
+      return;
+  }
+  NOTREACHED();
+}
+
+ValueBuilder::Bytes ValueBuilder::CopyToArena(StringPiece bytes) {
+  if (bytes.empty())
+    return Bytes{nullptr, 0};
+
+  char* copy;
+  if (bytes.size() <= arena_remaining_) {
+    copy = arena_next_;
+    arena_next_ += bytes.size();
+    arena_remaining_ -= bytes.size();
+  } else if (bytes.size() > kMaxSharedChunkCopySize) {
+    // Keep filling the current chunk after this one.
+    copy = arena_chunks_.emplace_back(new char[bytes.size()]).get();
+  } else {
+    copy = arena_chunks_.emplace_back(new char[kArenaChunkSize]).get();
+    arena_next_ = copy + bytes.size();
+    arena_remaining_ = kArenaChunkSize - bytes.size();
+  }
+  memcpy(copy, bytes.data(), bytes.size());
+  return Bytes{copy, bytes.size()};
+}
+
+Value ValueBuilder::ToValue(uint32_t index) const {
+  const Node& node = nodes_[index];
+  switch (node.type) {
+    case Value::Type::NONE:
+      return Value();
+    case Value::Type::BOOLEAN:
+      return Value(node.bool_value);
+    case Value::Type::INTEGER:
+      return Value(node.int_value);
+    case Value::Type::DOUBLE:
+      return Value(node.double_value);
+    case Value::Type::STRING:
+      return Value(StringPiece(node.bytes.data, node.bytes.size));
+    case Value::Type::BINARY: {
+      const uint8_t* data = reinterpret_cast<const uint8_t*>(node.bytes.data);
+      return Value(Value::BlobStorage(data, data + node.bytes.size));
+    }
+    case Value::Type::DICTIONARY:
+      return Value(ToDict(index));
+    case Value::Type::LIST:
+      return Value(ToList(index));
+  }
+  NOTREACHED();
+  return Value();
+}
+
+Value::Dict ValueBuilder::ToDict(uint32_t index) const {
+  DCHECK_EQ(Value::Type::DICTIONARY, nodes_[index].type);
+  const Children& children = nodes_[index].children;
+  std::vector<std::pair<std::string, std::unique_ptr<Value>>> entries;
+  entries.reserve(children.size);
+  for (uint32_t child = children.first; child != kNoNode;
+       child = nodes_[child].next_sibling) {
+    const Bytes& key = nodes_[child].key;
+    entries.emplace_back(std::string(key.data, key.size),
+                         std::make_unique<Value>(ToValue(child)));
+  }
+
+  // flat_map keeps the first of duplicate keys, so reverse the entries for the
+  // last value added for a key to win.
+  std::reverse(entries.begin(), entries.end());
+  Value::Dict dict;
+  dict.storage_ =
+      flat_map<std::string, std::unique_ptr<Value>>(std::move(entries));
+  return dict;
+}
+
+Value::List ValueBuilder::ToList(uint32_t index) const {
+  DCHECK_EQ(Value::Type::LIST, nodes_[index].type);
+  const Children& children = nodes_[index].children;
+  Value::List list;
+  list.reserve(children.size);
+  for (uint32_t child = children.first; child != kNoNode;
+       child = nodes_[child].next_sibling) {
+    list.Append(ToValue(child));
+  }
+  return list;
+}
+
+}  // namespace base
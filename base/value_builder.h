@@ -0,0 +1,190 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_VALUE_BUILDER_H_
+#define BASE_VALUE_BUILDER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/memory/raw_ptr.h"
+#include "base/strings/string_piece.h"
+#include "base/values.h"
+
+namespace base {
+
+// Builds a tree of dictionaries and lists that is stored flat: all the nodes
+// of the tree live in a single contiguous vector, with the children of each
+// dictionary and list linked in the order they were added, and dictionary
+// keys, strings and blobs are copied into a string arena owned by the builder.
+// Building a tree this way takes a handful of allocations in total, rather
+// than one per entry and per key as Value::Dict does, and destroying it frees
+// them at once.
+//
+// The tree can't be read or modified in place. Once built, the part of it that
+// escapes the builder is converted to an ordinary Value::Dict or Value::List:
+//
+//   ValueBuilder builder;
+//   ValueBuilder::DictRef settings = builder.root().SetDict("settings");
+//   settings.Set("state", 1);
+//   settings.SetList("api").Append("storage");
+//   Value::Dict prefs = builder.root().ToDict();
+//
+// DictRef and ListRef are cheap handles to a node of the builder, which must
+// outlive them.
+class BASE_EXPORT ValueBuilder {
+ public:
+  class ListRef;
+
+  // A handle to a dictionary of the builder.
+  class BASE_EXPORT DictRef {
+   public:
+    DictRef(const DictRef&);
+    DictRef& operator=(const DictRef&);
+    ~DictRef();
+
+    // Adds an entry for |key| to the dictionary. Adding a key that was already
+    // added doesn't remove the previous entry from the builder, but the last
+    // value added for the key is the one that ends up in ToDict().
+    void Set(StringPiece key, bool value);
+    template <typename T>
+    void Set(StringPiece, const T*) = delete;
+    void Set(StringPiece key, int value);
+    void Set(StringPiece key, double value);
+    void Set(StringPiece key, StringPiece value);
+    void Set(StringPiece key, const char* value);
+    // Copies |value|, which may be of any type, into the builder.
+    void Set(StringPiece key, const Value& value);
+
+    // Adds an empty dictionary or list for |key| and returns a handle to it.
+    DictRef SetDict(StringPiece key);
+    ListRef SetList(StringPiece key);
+
+    // Returns the number of entries added to the dictionary, including any
+    // that were added for the same key.
+    size_t size() const;
+
+    // Returns an owning copy of the dictionary and everything under it.
+    Value::Dict ToDict() const;
+
+   private:
+    friend class ValueBuilder;
+
+    DictRef(ValueBuilder* builder, uint32_t index);
+
+    raw_ptr<ValueBuilder> builder_;
+    uint32_t index_;
+  };
+
+  // A handle to a list of the builder.
+  class BASE_EXPORT ListRef {
+   public:
+    ListRef(const ListRef&);
+    ListRef& operator=(const ListRef&);
+    ~ListRef();
+
+    // Appends a value to the end of the list.
+    void Append(bool value);
+    template <typename T>
+    void Append(const T*) = delete;
+    void Append(int value);
+    void Append(double value);
+    void Append(StringPiece value);
+    void Append(const char* value);
+    // Copies |value|, which may be of any type, into the builder.
+    void Append(const Value& value);
+
+    // Appends an empty dictionary or list and returns a handle to it.
+    DictRef AppendDict();
+    ListRef AppendList();
+
+    // Returns the number of values in the list.
+    size_t size() const;
+
+    // Returns an owning copy of the list and everything under it.
+    Value::List ToList() const;
+
+   private:
+    friend class ValueBuilder;
+
+    ListRef(ValueBuilder* builder, uint32_t index);
+
+    raw_ptr<ValueBuilder> builder_;
+    uint32_t index_;
+  };
+
+  ValueBuilder();
+  ValueBuilder(const ValueBuilder&) = delete;
+  ValueBuilder& operator=(const ValueBuilder&) = delete;
+  ~ValueBuilder();
+
+  // Returns a handle to the dictionary at the root of the tree.
+  DictRef root();
+
+ private:
+  // Marks the end of a list of siblings.
+  static constexpr uint32_t kNoNode = UINT32_MAX;
+
+  struct Bytes {
+    const char* data;
+    size_t size;
+  };
+
+  struct Children {
+    uint32_t first;
+    uint32_t last;
+    uint32_t size;
+  };
+
+  struct Node {
+    Value::Type type;
+
+    // The next child of the same parent, or kNoNode.
+    uint32_t next_sibling;
+
+    // The key of the node in its parent, if that is a dictionary.
+    Bytes key;
+
+    union {
+      bool bool_value;
+      int int_value;
+      double double_value;
+      // For strings and blobs.
+      Bytes bytes;
+      // For dictionaries and lists.
+      Children children;
+    };
+  };
+
+  // Adds a node of |type| as the last child of |parent|, under |key| if
+  // |parent| is a dictionary, and returns its index.
+  uint32_t AddNode(uint32_t parent, StringPiece key, Value::Type type);
+
+  // Adds a copy of |value| as the last child of |parent|.
+  void AddValue(uint32_t parent, StringPiece key, const Value& value);
+
+  // Copies |bytes| into the arena and returns the copy, which keeps its
+  // address for the lifetime of the builder.
+  Bytes CopyToArena(StringPiece bytes);
+
+  Value ToValue(uint32_t index) const;
+  Value::Dict ToDict(uint32_t index) const;
+  Value::List ToList(uint32_t index) const;
+
+  std::vector<Node> nodes_;
+
+  // The chunks of the string arena. Bytes are copied to the end of the last
+  // chunk if they fit, and to a new chunk if they don't.
+  std::vector<std::unique_ptr<char[]>> arena_chunks_;
+  char* arena_next_ = nullptr;
+  size_t arena_remaining_ = 0;
+};
+
+}  // namespace base
+
+#endif  // BASE_VALUE_BUILDER_H_
@@ -0,0 +1,172 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/value_builder.h"
+
+#include <memory>
+#include <string>
+
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_piece.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace base {
+
+namespace {
+
+constexpr char kMetricPrefix[] = "ValueBuilder.";
+constexpr char kMetricBuildTime[] = "build_time";
+constexpr char kMetricDestroyTime[] = "destroy_time";
+
+// About 1 MB of preferences when serialized as JSON.
+constexpr int kNumExtensions = 500;
+constexpr int kNumIterations = 20;
+
+const char* const kApiPermissions[] = {
+    "alarms",  "bookmarks",     "contextMenus", "cookies", "downloads",
+    "history", "notifications", "storage",      "tabs",    "webRequest"};
+
+// Adapters that let AddExtensionPrefs() build a Value::Dict in place, the way
+// pref writers do, or a ValueBuilder.
+Value::Dict& SetDict(Value::Dict& dict, StringPiece key) {
+  return dict.Set(key, Value::Dict())->GetDict();
+}
+
+Value::List& SetList(Value::Dict& dict, StringPiece key) {
+  return dict.Set(key, Value::List())->GetList();
+}
+
+ValueBuilder::DictRef SetDict(ValueBuilder::DictRef dict, StringPiece key) {
+  return dict.SetDict(key);
+}
+
+ValueBuilder::ListRef SetList(ValueBuilder::DictRef dict, StringPiece key) {
+  return dict.SetList(key);
+}
+
+template <typename DictType>
+void AddPermissions(DictType&& permissions) {
+  auto&& api = SetList(permissions, "api");
+  for (const char* permission : kApiPermissions)
+    api.Append(permission);
+  auto&& explicit_host = SetList(permissions, "explicit_host");
+  explicit_host.Append("https://*.example.com/*");
+  explicit_host.Append("https://example.org/*");
+  explicit_host.Append("http://localhost/*");
+  SetList(permissions, "manifest_permissions");
+  auto&& scriptable_host = SetList(permissions, "scriptable_host");
+  scriptable_host.Append("https://*.example.com/*");
+  scriptable_host.Append("<all_urls>");
+}
+
+// Adds the preferences that ExtensionPrefs writes for an installed extension.
+template <typename DictType>
+void AddExtensionPrefs(DictType&& settings, int index) {
+  const std::string id = StringPrintf("%032d", index);
+  auto&& extension = SetDict(settings, id);
+  AddPermissions(SetDict(extension, "active_permissions"));
+  SetDict(extension, "commands");
+  SetList(extension, "content_settings");
+  extension.Set("creation_flags", 9);
+  auto&& events = SetList(extension, "events");
+  events.Append("runtime.onInstalled");
+  events.Append("tabs.onUpdated");
+  events.Append("alarms.onAlarm");
+  extension.Set("from_webstore", true);
+  AddPermissions(SetDict(extension, "granted_permissions"));
+  extension.Set("install_time", "13301234567890123");
+  extension.Set("location", 1);
+
+  auto&& manifest = SetDict(extension, "manifest");
+  SetDict(manifest, "background").Set("service_worker", "background.js");
+  manifest.Set("description", std::string(120, 'd'));
+  manifest.Set("key", std::string(392, 'k'));
+  manifest.Set("manifest_version", 3);
+  manifest.Set("name", "Extension " + NumberToString(index));
+  auto&& permissions = SetList(manifest, "permissions");
+  for (const char* permission : kApiPermissions)
+    permissions.Append(permission);
+  manifest.Set("update_url", "https://clients2.google.com/service/update2/crx");
+  manifest.Set("version", "1.2." + NumberToString(index));
+
+  extension.Set("path", id + "/1.2.3_0");
+  SetDict(extension, "preferences");
+  SetDict(extension, "regular_only_preferences");
+  extension.Set("state", 1);
+  extension.Set("was_installed_by_default", false);
+  extension.Set("was_installed_by_oem", false);
+  extension.Set("withholding_permissions", false);
+}
+
+template <typename DictType>
+void AddPrefs(DictType&& root) {
+  auto&& settings = SetDict(SetDict(root, "extensions"), "settings");
+  for (int i = 0; i < kNumExtensions; ++i)
+    AddExtensionPrefs(settings, i);
+}
+
+void ReportTimes(const std::string& story,
+                 TimeDelta build_time,
+                 TimeDelta destroy_time) {
+  perf_test::PerfResultReporter reporter(kMetricPrefix, story);
+  reporter.RegisterImportantMetric(kMetricBuildTime, "ms");
+  reporter.RegisterImportantMetric(kMetricDestroyTime, "ms");
+  reporter.AddResult(kMetricBuildTime, build_time / kNumIterations);
+  reporter.AddResult(kMetricDestroyTime, destroy_time / kNumIterations);
+}
+
+}  // namespace
+
+// Measures building and destroying an ExtensionPrefs-like preferences tree
+// as a Value::Dict, in a ValueBuilder, and in a ValueBuilder that is then
+// converted to a Value::Dict.
+TEST(ValueBuilderPerfTest, ExtensionPrefs) {
+  TimeDelta build_time;
+  TimeDelta destroy_time;
+  for (int i = 0; i < kNumIterations; ++i) {
+    ElapsedTimer build_timer;
+    auto dict = std::make_unique<Value::Dict>();
+    AddPrefs(*dict);
+    build_time += build_timer.Elapsed();
+    ElapsedTimer destroy_timer;
+    dict.reset();
+    destroy_time += destroy_timer.Elapsed();
+  }
+  ReportTimes("Dict", build_time, destroy_time);
+
+  build_time = TimeDelta();
+  destroy_time = TimeDelta();
+  for (int i = 0; i < kNumIterations; ++i) {
+    ElapsedTimer build_timer;
+    auto builder = std::make_unique<ValueBuilder>();
+    AddPrefs(builder->root());
+    build_time += build_timer.Elapsed();
+    ElapsedTimer destroy_timer;
+    builder.reset();
+    destroy_time += destroy_timer.Elapsed();
+  }
+  ReportTimes("Builder", build_time, destroy_time);
+
+  build_time = TimeDelta();
+  destroy_time = TimeDelta();
+  for (int i = 0; i < kNumIterations; ++i) {
+    ElapsedTimer build_timer;
+    auto builder = std::make_unique<ValueBuilder>();
+    AddPrefs(builder->root());
+    auto dict = std::make_unique<Value::Dict>(builder->root().ToDict());
+    build_time += build_timer.Elapsed();
+    ElapsedTimer destroy_timer;
+    builder.reset();
+    dict.reset();
+    destroy_time += destroy_timer.Elapsed();
+  }
+  ReportTimes("BuilderToDict", build_time, destroy_time);
+}
+
+}  // namespace base
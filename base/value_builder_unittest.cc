@@ -0,0 +1,148 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/value_builder.h"
+
+#include <string>
+#include <utility>
+
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+TEST(ValueBuilderTest, Empty) {
+  ValueBuilder builder;
+  EXPECT_EQ(0u, builder.root().size());
+  EXPECT_EQ(Value::Dict(), builder.root().ToDict());
+}
+
+TEST(ValueBuilderTest, Scalars) {
+  ValueBuilder builder;
+  ValueBuilder::DictRef root = builder.root();
+  root.Set("bool", true);
+  root.Set("int", 42);
+  root.Set("double", 3.5);
+  root.Set("string_piece", StringPiece("piece"));
+  root.Set("const_char", "chars");
+  root.Set("std_string", std::string("string"));
+  root.Set("empty_string", "");
+  root.Set("", "empty key");
+  root.Set("none", Value());
+  root.Set("blob", Value(Value::BlobStorage({0, 1, 2})));
+  EXPECT_EQ(10u, root.size());
+
+  Value::Dict expected;
+  expected.Set("bool", true);
+  expected.Set("int", 42);
+  expected.Set("double", 3.5);
+  expected.Set("string_piece", "piece");
+  expected.Set("const_char", "chars");
+  expected.Set("std_string", "string");
+  expected.Set("empty_string", "");
+  expected.Set("", "empty key");
+  expected.Set("none", Value());
+  expected.Set("blob", Value::BlobStorage({0, 1, 2}));
+  EXPECT_EQ(expected, root.ToDict());
+}
+
+TEST(ValueBuilderTest, Nested) {
+  ValueBuilder builder;
+  ValueBuilder::DictRef settings = builder.root().SetDict("settings");
+  ValueBuilder::DictRef extension = settings.SetDict("extension_id");
+  ValueBuilder::ListRef api = extension.SetList("api");
+  api.Append("storage");
+  api.Append("tabs");
+  extension.Set("state", 1);
+  ValueBuilder::ListRef lists = extension.SetList("lists");
+  lists.AppendList().Append(1);
+  lists.AppendList();
+  ValueBuilder::DictRef dict_in_list = lists.AppendDict();
+  dict_in_list.Set("key", false);
+  lists.Append(2.5);
+  // Adding to a dictionary after its siblings were added.
+  settings.Set("count", 1);
+  EXPECT_EQ(2u, settings.size());
+  EXPECT_EQ(4u, lists.size());
+
+  Value::List expected_lists;
+  Value::List inner;
+  inner.Append(1);
+  expected_lists.Append(std::move(inner));
+  expected_lists.Append(Value::List());
+  Value::Dict expected_dict_in_list;
+  expected_dict_in_list.Set("key", false);
+  expected_lists.Append(std::move(expected_dict_in_list));
+  expected_lists.Append(2.5);
+  EXPECT_EQ(expected_lists, lists.ToList());
+
+  Value::Dict expected;
+  expected.SetByDottedPath("settings.extension_id.state", 1);
+  Value::List expected_api;
+  expected_api.Append("storage");
+  expected_api.Append("tabs");
+  expected.SetByDottedPath("settings.extension_id.api",
+                           std::move(expected_api));
+  expected.SetByDottedPath("settings.extension_id.lists",
+                           std::move(expected_lists));
+  expected.SetByDottedPath("settings.count", 1);
+  EXPECT_EQ(expected, builder.root().ToDict());
+}
+
+TEST(ValueBuilderTest, LastValueForKeyWins) {
+  ValueBuilder builder;
+  ValueBuilder::DictRef root = builder.root();
+  root.Set("b", 1);
+  root.Set("a", "first");
+  root.Set("b", 2);
+  root.SetDict("a").Set("c", true);
+  EXPECT_EQ(4u, root.size());
+
+  Value::Dict expected;
+  expected.Set("b", 2);
+  expected.SetByDottedPath("a.c", true);
+  EXPECT_EQ(expected, root.ToDict());
+}
+
+TEST(ValueBuilderTest, CopiesValues) {
+  Value::Dict dict;
+  dict.SetByDottedPath("a.b", "string");
+  Value::List list;
+  list.Append(1);
+  list.Append(Value::Dict());
+  list.Append(Value::BlobStorage({3, 4}));
+  dict.Set("list", std::move(list));
+  Value value(std::move(dict));
+
+  ValueBuilder builder;
+  builder.root().Set("copy", value);
+  builder.root().SetList("list").Append(value);
+
+  Value::Dict built = builder.root().ToDict();
+  EXPECT_EQ(value, *built.Find("copy"));
+  ASSERT_EQ(1u, built.FindList("list")->size());
+  EXPECT_EQ(value, (*built.FindList("list"))[0]);
+}
+
+TEST(ValueBuilderTest, LongStrings) {
+  // Strings of all sizes, including ones that don't fit in the arena chunks.
+  ValueBuilder builder;
+  ValueBuilder::ListRef list = builder.root().SetList("list");
+  Value::List expected;
+  for (size_t size = 1; size < 100000; size *= 3) {
+    std::string string(size, static_cast<char>('a' + size % 26));
+    list.Append(string);
+    builder.root().Set(string, static_cast<int>(size));
+    expected.Append(std::move(string));
+  }
+
+  Value::Dict built = builder.root().ToDict();
+  EXPECT_EQ(expected, *built.FindList("list"));
+  for (const Value& string : expected) {
+    EXPECT_EQ(static_cast<int>(string.GetString().size()),
+              built.FindInt(string.GetString()));
+  }
+}
+
+}  // namespace base
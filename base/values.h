@@ -35,6 +35,7 @@ namespace base {
 
 class DictionaryValue;
 class ListValue;
+class ValueBuilder;
 
 // The `Value` class is a variant type can hold one of the following types:
 // - null
@@ -559,6 +560,8 @@ class BASE_EXPORT GSL_OWNER Value {
 
     // For legacy access to the internal storage type.
     friend Value;
+    // Builds the storage from all the entries at once.
+    friend class ValueBuilder;
 
     explicit Dict(const flat_map<std::string, std::unique_ptr<Value>>& storage);
 
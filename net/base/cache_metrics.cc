@@ -10,4 +10,20 @@ void MediaCacheStatusResponseHistogram(MediaResponseCacheType type) {
   UMA_HISTOGRAM_ENUMERATION("Net.MediaCache.Response.EnabledOrDisabled", type);
 }
 
+void RecordHotTierCacheEvent(HotTierCacheEvent event,
+                             HotTierCacheCounters* counters) {
+  UMA_HISTOGRAM_ENUMERATION("HttpCache.HotTier.Event", event);
+  switch (event) {
+    case HotTierCacheEvent::kHit:
+      ++counters->hits;
+      break;
+    case HotTierCacheEvent::kMiss:
+      ++counters->misses;
+      break;
+    case HotTierCacheEvent::kEviction:
+      ++counters->evictions;
+      break;
+  }
+}
+
 }  // namespace net
@@ -7,6 +7,8 @@
 #ifndef NET_BASE_CACHE_METRICS_H_
 #define NET_BASE_CACHE_METRICS_H_
 
+#include <stdint.h>
+
 #include "base/metrics/histogram_macros.h"
 #include "net/base/net_export.h"
 
@@ -22,6 +24,28 @@ enum class MediaResponseCacheType {
 
 NET_EXPORT void MediaCacheStatusResponseHistogram(MediaResponseCacheType type);
 
+// UMA histogram enumerations for lookups in the HttpCache in-memory hot tier.
+// These values are persisted to logs. Entries should not be renumbered and
+// numeric values should never be reused.
+enum class HotTierCacheEvent {
+  kHit = 0,
+  kMiss = 1,
+  kEviction = 2,
+  kMaxValue = kEviction
+};
+
+// Running totals of hot tier events, for callers that want the counts without
+// going through UMA.
+struct NET_EXPORT HotTierCacheCounters {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+};
+
+// Records |event| to UMA and adds it to |counters|.
+NET_EXPORT void RecordHotTierCacheEvent(HotTierCacheEvent event,
+                                        HotTierCacheCounters* counters);
+
 }  // namespace net
 
 #endif  // NET_BASE_CACHE_METRICS_H_
@@ -142,22 +142,42 @@ bool DataURL::Parse(const GURL& url,
       } else {
         std::string unescaped_body = base::UnescapeBinaryURLComponent(raw_body);
 
-        // Strip spaces, which aren't allowed in Base64 encoding.
-        base::EraseIf(unescaped_body, base::IsAsciiWhitespace<char>);
+        // Decode the runs of characters between spaces, which aren't allowed
+        // in Base64 encoding, without copying them together first.
+        base::Base64StreamDecoder decoder;
+        std::string decoded;
+        decoded.reserve(unescaped_body.length() / 4 * 3 + 2);
+        size_t length = 0;
+        char last = '\0';
+        base::StringPiece remaining(unescaped_body);
+        while (!remaining.empty()) {
+          const size_t run_length =
+              base::ranges::find_if(remaining, base::IsAsciiWhitespace<char>) -
+              remaining.begin();
+          if (run_length > 0) {
+            if (!decoder.Append(remaining.substr(0, run_length), &decoded))
+              return false;
+            length += run_length;
+            last = remaining[run_length - 1];
+          }
+          remaining.remove_prefix(std::min(run_length + 1, remaining.length()));
+        }
 
-        size_t length = unescaped_body.length();
         size_t padding_needed = 4 - (length % 4);
         // If the input wasn't padded, then we pad it as necessary until we have
         // a length that is a multiple of 4 as required by our decoder. We don't
         // correct if the input was incorrectly padded. If |padding_needed| ==
         // 3, then the input isn't well formed and decoding will fail with or
         // without padding.
-        if ((padding_needed == 1 || padding_needed == 2) &&
-            unescaped_body[length - 1] != '=') {
-          unescaped_body.resize(length + padding_needed, '=');
+        if ((padding_needed == 1 || padding_needed == 2) && last != '=') {
+          if (!decoder.Append(base::StringPiece("==", padding_needed),
+                              &decoded)) {
+            return false;
+          }
         }
-        if (!base::Base64Decode(unescaped_body, data))
+        if (!decoder.Finish(&decoded))
           return false;
+        data->swap(decoded);
       }
     } else {
       // Strip whitespace for non-text MIME types.
@@ -4,6 +4,8 @@
 
 #include "net/base/data_url.h"
 
+#include <string>
+
 #include "base/memory/ref_counted.h"
 #include "net/base/net_errors.h"
 #include "net/http/http_response_headers.h"
@@ -23,6 +25,9 @@ struct ParseTestData {
   const std::string data;
 };
 
+constexpr char kBase64Chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
 }  // namespace
 
 TEST(DataURLTest, Parse) {
@@ -313,4 +318,36 @@ TEST(DataURLTest, Image) {
   EXPECT_EQ(value, "image/png");
 }
 
+// Base64 data URLs that are wrapped into lines, with escaped or unescaped
+// whitespace, and that are missing their padding decode like unwrapped ones.
+TEST(DataURLTest, WrappedBase64) {
+  std::string encoded;
+  for (int i = 0; i < 1000; ++i)
+    encoded.push_back(kBase64Chars[(i * 7) % 64]);
+  // Drop the padding.
+  encoded.pop_back();
+  encoded.pop_back();
+
+  std::string mime_type;
+  std::string charset;
+  std::string expected_data;
+  ASSERT_TRUE(DataURL::Parse(GURL("data:image/png;base64," + encoded + "=="),
+                             &mime_type, &charset, &expected_data));
+  EXPECT_EQ(748u, expected_data.size());
+
+  for (const char* line_break : {"%0D%0A", "%20", " ", "%0A%0A%09"}) {
+    SCOPED_TRACE(line_break);
+    for (size_t line_length : {1, 3, 64, 76}) {
+      std::string url = "data:image/png;base64,";
+      for (size_t i = 0; i < encoded.size(); i += line_length)
+        url += encoded.substr(i, line_length) + line_break;
+      mime_type.clear();
+      charset.clear();
+      std::string data;
+      ASSERT_TRUE(DataURL::Parse(GURL(url), &mime_type, &charset, &data));
+      EXPECT_EQ(expected_data, data);
+    }
+  }
+}
+
 }  // namespace net
@@ -0,0 +1,239 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/delta_log_file.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "base/big_endian.h"
+#include "base/check.h"
+#include "base/check_op.h"
+#include "base/containers/span.h"
+#include "base/files/file_util.h"
+#include "base/files/important_file_writer.h"
+#include "base/hash/hash.h"
+#include "base/strings/string_piece.h"
+
+namespace net {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x444c4f47;  // "DLOG"
+constexpr uint32_t kVersion = 1;
+constexpr size_t kFileHeaderSize = 8;
+constexpr size_t kRecordHeaderSize = 8;
+
+enum RecordType : uint8_t {
+  kPut = 1,
+  kDelete = 2,
+};
+
+// The log is compacted once it is this many times the size it would have
+// after compaction, but not before it reaches kMinLogSizeToCompact.
+constexpr size_t kCompactionRatio = 3;
+constexpr size_t kMinLogSizeToCompact = 64 * 1024;
+
+size_t EncodedSize(base::StringPiece key, const std::string* value) {
+  return kRecordHeaderSize + 1 + 4 + key.size() +
+         (value ? 4 + value->size() : 0);
+}
+
+uint32_t Checksum(base::span<const uint8_t> payload) {
+  return base::PersistentHash(payload);
+}
+
+// Appends the record that puts |value| in |key|, or deletes |key| if |value|
+// is null, to |out|.
+void AppendRecord(base::StringPiece key,
+                  const std::string* value,
+                  std::string* out) {
+  CHECK_LE(key.size(), UINT32_MAX);
+  CHECK(!value || value->size() <= UINT32_MAX);
+
+  size_t offset = out->size();
+  size_t size = EncodedSize(key, value);
+  out->resize(offset + size);
+  char* record = &(*out)[offset];
+  char* payload = record + kRecordHeaderSize;
+  size_t payload_size = size - kRecordHeaderSize;
+
+  base::BigEndianWriter writer(payload, payload_size);
+  bool success = writer.WriteU8(value ? kPut : kDelete) &&
+                 writer.WriteU32(key.size()) &&
+                 writer.WriteBytes(key.data(), key.size());
+  if (value) {
+    success = success && writer.WriteU32(value->size()) &&
+              writer.WriteBytes(value->data(), value->size());
+  }
+  DCHECK(success);
+  DCHECK_EQ(0u, writer.remaining());
+
+  base::BigEndianWriter header(record, kRecordHeaderSize);
+  header.WriteU32(payload_size);
+  header.WriteU32(Checksum(base::as_bytes(base::make_span(
+      static_cast<const char*>(payload), payload_size))));
+}
+
+// Reads the record at the front of |reader|. Returns nullopt if there is no
+// complete, valid record there.
+absl::optional<DeltaLogFile::Record> ReadRecord(
+    base::BigEndianReader* reader) {
+  uint32_t payload_size;
+  uint32_t checksum;
+  base::span<const uint8_t> payload;
+  if (!reader->ReadU32(&payload_size) || !reader->ReadU32(&checksum) ||
+      !reader->ReadSpan(&payload, payload_size) ||
+      Checksum(payload) != checksum) {
+    return absl::nullopt;
+  }
+
+  base::BigEndianReader payload_reader(payload);
+  uint8_t type;
+  uint32_t key_size;
+  base::StringPiece key;
+  if (!payload_reader.ReadU8(&type) || !payload_reader.ReadU32(&key_size) ||
+      !payload_reader.ReadPiece(&key, key_size)) {
+    return absl::nullopt;
+  }
+
+  if (type == kDelete && payload_reader.remaining() == 0)
+    return DeltaLogFile::Record(std::string(key), absl::nullopt);
+
+  uint32_t value_size;
+  base::StringPiece value;
+  if (type != kPut || !payload_reader.ReadU32(&value_size) ||
+      !payload_reader.ReadPiece(&value, value_size) ||
+      payload_reader.remaining() != 0) {
+    return absl::nullopt;
+  }
+  return DeltaLogFile::Record(std::string(key), std::string(value));
+}
+
+}  // namespace
+
+DeltaLogFile::Record::Record(std::string key,
+                             absl::optional<std::string> value)
+    : key(std::move(key)), value(std::move(value)) {}
+
+DeltaLogFile::Record::Record(const Record& other) = default;
+
+DeltaLogFile::Record::Record(Record&& other) = default;
+
+DeltaLogFile::Record& DeltaLogFile::Record::operator=(const Record& other) =
+    default;
+
+DeltaLogFile::Record& DeltaLogFile::Record::operator=(Record&& other) =
+    default;
+
+DeltaLogFile::Record::~Record() = default;
+
+DeltaLogFile::DeltaLogFile(const base::FilePath& path)
+    : path_(path), compacted_size_(kFileHeaderSize) {}
+
+DeltaLogFile::~DeltaLogFile() = default;
+
+absl::optional<DeltaLogFile::Entries> DeltaLogFile::Load() {
+  DCHECK(!loaded_);
+  loaded_ = true;
+
+  // A |log_size_| of zero means that the file is not a valid log, so the next
+  // write must replace it.
+  std::string contents;
+  if (!base::ReadFileToString(path_, &contents))
+    return absl::nullopt;
+
+  base::BigEndianReader reader(
+      reinterpret_cast<const uint8_t*>(contents.data()), contents.size());
+  uint32_t magic;
+  uint32_t version;
+  if (!reader.ReadU32(&magic) || !reader.ReadU32(&version) ||
+      magic != kMagic || version != kVersion) {
+    return absl::nullopt;
+  }
+
+  size_t valid_size = kFileHeaderSize;
+  while (reader.remaining() > 0) {
+    absl::optional<Record> record = ReadRecord(&reader);
+    if (!record)
+      break;
+    valid_size = contents.size() - reader.remaining();
+    Apply(std::move(*record));
+  }
+
+  log_size_ = valid_size;
+  // Drop whatever follows the last valid record, so that new records are not
+  // appended after it. If that fails, the next Append() will try again.
+  if (valid_size != contents.size())
+    Compact();
+  return entries_;
+}
+
+bool DeltaLogFile::Append(const std::vector<Record>& records) {
+  DCHECK(loaded_);
+  if (records.empty())
+    return true;
+
+  std::string data;
+  for (const Record& record : records) {
+    AppendRecord(record.key, record.value ? &*record.value : nullptr, &data);
+    Apply(record);
+  }
+
+  if (log_size_ == 0 ||
+      log_size_ + data.size() >
+          std::max(kMinLogSizeToCompact, kCompactionRatio * compacted_size_)) {
+    return Compact();
+  }
+
+  if (!base::AppendToFile(path_, data)) {
+    // Part of the data may have been written, so rewrite the file next time.
+    log_size_ = 0;
+    return false;
+  }
+  log_size_ += data.size();
+  return true;
+}
+
+bool DeltaLogFile::Compact() {
+  DCHECK(loaded_);
+
+  std::string data(kFileHeaderSize, '\0');
+  data.reserve(compacted_size_);
+  base::BigEndianWriter header(&data[0], kFileHeaderSize);
+  header.WriteU32(kMagic);
+  header.WriteU32(kVersion);
+  for (const auto& [key, value] : entries_)
+    AppendRecord(key, &value, &data);
+  DCHECK_EQ(compacted_size_, data.size());
+
+  if (!base::ImportantFileWriter::WriteFileAtomically(path_, data)) {
+    log_size_ = 0;
+    return false;
+  }
+  log_size_ = data.size();
+  return true;
+}
+
+void DeltaLogFile::Apply(Record record) {
+  auto it = entries_.find(record.key);
+  if (it != entries_.end()) {
+    compacted_size_ -= EncodedSize(it->first, &it->second);
+    if (!record.value) {
+      entries_.erase(it);
+      return;
+    }
+    it->second = std::move(*record.value);
+  } else {
+    if (!record.value)
+      return;
+    it = entries_.emplace(std::move(record.key), std::move(*record.value))
+             .first;
+  }
+  compacted_size_ += EncodedSize(it->first, &it->second);
+}
+
+}  // namespace net
@@ -0,0 +1,95 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_BASE_DELTA_LOG_FILE_H_
+#define NET_BASE_DELTA_LOG_FILE_H_
+
+#include <stddef.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "net/base/net_export.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
+
+namespace net {
+
+// A string to string map stored on disk as an append-only log of changes, so
+// that the cost of a write is proportional to the number of entries that
+// changed rather than to the size of the map. Once the log has grown to
+// several times the size of the entries it holds, it is rewritten atomically
+// with just those entries ("compacted").
+//
+// The file starts with a uint32 magic number and a uint32 version, followed by
+// records of the form
+//
+//   uint32 payload_size, uint32 checksum, payload
+//   payload: uint8 type, uint32 key_size, key, [uint32 value_size, value]
+//
+// where |type| is either a put or a delete, and only puts have a value. All
+// integers are big endian. Records that are truncated or fail their checksum,
+// as a crash in the middle of an append may leave them, end the log.
+//
+// Does blocking file IO, so must only be used on a sequence that allows it.
+class NET_EXPORT_PRIVATE DeltaLogFile {
+ public:
+  using Entries = std::map<std::string, std::string>;
+
+  // A change to a single entry. A |value| of nullopt deletes the entry.
+  struct NET_EXPORT_PRIVATE Record {
+    Record(std::string key, absl::optional<std::string> value);
+    Record(const Record& other);
+    Record(Record&& other);
+    Record& operator=(const Record& other);
+    Record& operator=(Record&& other);
+    ~Record();
+
+    std::string key;
+    absl::optional<std::string> value;
+  };
+
+  explicit DeltaLogFile(const base::FilePath& path);
+
+  DeltaLogFile(const DeltaLogFile&) = delete;
+  DeltaLogFile& operator=(const DeltaLogFile&) = delete;
+
+  ~DeltaLogFile();
+
+  // Reads the log and returns the entries it holds. Returns nullopt, and
+  // starts out with no entries, if the file does not exist or is not a log. If
+  // the log ends with a damaged record, it is compacted to drop it. Must be
+  // called before any other method.
+  absl::optional<Entries> Load();
+
+  // Appends |records| to the log, in order, and compacts it if it has grown
+  // too large. Returns false on failure, in which case the log should be
+  // considered lost.
+  bool Append(const std::vector<Record>& records);
+
+  // Rewrites the log with just the entries it holds.
+  bool Compact();
+
+  const base::FilePath& path() const { return path_; }
+
+  // The size of the log, and the size it would have after compaction.
+  size_t log_size() const { return log_size_; }
+  size_t compacted_size() const { return compacted_size_; }
+
+ private:
+  // Applies |record| to |entries_|, keeping |compacted_size_| up to date.
+  void Apply(Record record);
+
+  const base::FilePath path_;
+  bool loaded_ = false;
+
+  Entries entries_;
+  size_t log_size_ = 0;
+  size_t compacted_size_;
+};
+
+}  // namespace net
+
+#endif  // NET_BASE_DELTA_LOG_FILE_H_
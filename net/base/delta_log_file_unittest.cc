@@ -0,0 +1,128 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/delta_log_file.h"
+
+#include <string>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/string_number_conversions.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+using Entries = DeltaLogFile::Entries;
+using Record = DeltaLogFile::Record;
+
+class DeltaLogFileTest : public testing::Test {
+ public:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    path_ = temp_dir_.GetPath().AppendASCII("log");
+  }
+
+  // Loads the log at |path_| with a new DeltaLogFile.
+  absl::optional<Entries> Load() { return DeltaLogFile(path_).Load(); }
+
+ protected:
+  base::ScopedTempDir temp_dir_;
+  base::FilePath path_;
+};
+
+TEST_F(DeltaLogFileTest, AppendAndLoad) {
+  DeltaLogFile log(path_);
+  EXPECT_FALSE(log.Load());
+  EXPECT_FALSE(base::PathExists(path_));
+
+  ASSERT_TRUE(log.Append({{"a", "1"}, {"b", "2"}, {"c", ""}}));
+  EXPECT_EQ(Entries({{"a", "1"}, {"b", "2"}, {"c", ""}}), Load());
+
+  ASSERT_TRUE(log.Append({{"a", "3"}, {"b", absl::nullopt}}));
+  EXPECT_EQ(Entries({{"a", "3"}, {"c", ""}}), Load());
+
+  // Deleting a key that does not exist is harmless.
+  ASSERT_TRUE(log.Append({{"d", absl::nullopt}}));
+  EXPECT_EQ(Entries({{"a", "3"}, {"c", ""}}), Load());
+}
+
+TEST_F(DeltaLogFileTest, OnlyAppendsChanges) {
+  DeltaLogFile log(path_);
+  log.Load();
+  std::vector<Record> records;
+  for (int i = 0; i < 100; ++i)
+    records.emplace_back(base::NumberToString(i), std::string(100, 'x'));
+  ASSERT_TRUE(log.Append(records));
+  int64_t initial_size;
+  ASSERT_TRUE(base::GetFileSize(path_, &initial_size));
+  EXPECT_EQ(log.log_size(), static_cast<size_t>(initial_size));
+
+  ASSERT_TRUE(log.Append({{"7", "y"}}));
+  int64_t size;
+  ASSERT_TRUE(base::GetFileSize(path_, &size));
+  EXPECT_EQ(log.log_size(), static_cast<size_t>(size));
+  EXPECT_LT(size - initial_size, 32);
+  EXPECT_EQ("y", Load()->at("7"));
+}
+
+TEST_F(DeltaLogFileTest, Compacts) {
+  DeltaLogFile log(path_);
+  log.Load();
+  const std::string value(1000, 'x');
+  for (int i = 0; i < 1000; ++i)
+    ASSERT_TRUE(log.Append({{"key", value + base::NumberToString(i)}}));
+
+  // The log was rewritten with a single entry whenever it grew too large.
+  EXPECT_LT(log.log_size(), 100u * 1024);
+  int64_t size;
+  ASSERT_TRUE(base::GetFileSize(path_, &size));
+  EXPECT_EQ(log.log_size(), static_cast<size_t>(size));
+  EXPECT_EQ(Entries({{"key", value + "999"}}), Load());
+
+  ASSERT_TRUE(log.Compact());
+  EXPECT_EQ(log.compacted_size(), log.log_size());
+  EXPECT_EQ(Entries({{"key", value + "999"}}), Load());
+}
+
+TEST_F(DeltaLogFileTest, DropsDamagedTail) {
+  {
+    DeltaLogFile log(path_);
+    log.Load();
+    ASSERT_TRUE(log.Append({{"a", "1"}}));
+    ASSERT_TRUE(log.Append({{"b", "2"}}));
+  }
+  std::string contents;
+  ASSERT_TRUE(base::ReadFileToString(path_, &contents));
+
+  // A torn write of the last record.
+  ASSERT_TRUE(base::WriteFile(path_, contents.substr(0, contents.size() - 1)));
+  DeltaLogFile log(path_);
+  EXPECT_EQ(Entries({{"a", "1"}}), log.Load());
+
+  // The damaged record is gone, so new records are not lost behind it.
+  ASSERT_TRUE(log.Append({{"c", "3"}}));
+  EXPECT_EQ(Entries({{"a", "1"}, {"c", "3"}}), Load());
+
+  // A corrupted record fails its checksum.
+  contents.back() ^= 1;
+  ASSERT_TRUE(base::WriteFile(path_, contents));
+  EXPECT_EQ(Entries({{"a", "1"}}), Load());
+}
+
+TEST_F(DeltaLogFileTest, ReplacesInvalidFile) {
+  ASSERT_TRUE(base::WriteFile(path_, "not a log"));
+  DeltaLogFile log(path_);
+  EXPECT_FALSE(log.Load());
+
+  ASSERT_TRUE(log.Append({{"a", "1"}}));
+  EXPECT_EQ(Entries({{"a", "1"}}), Load());
+}
+
+}  // namespace
+
+}  // namespace net
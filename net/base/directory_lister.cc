@@ -5,25 +5,42 @@
 #include "net/base/directory_lister.h"
 
 #include <algorithm>
+#include <string>
 #include <utility>
 
 #include "base/bind.h"
 #include "base/check.h"
+#include "base/check_op.h"
 #include "base/files/file_enumerator.h"
 #include "base/files/file_util.h"
 #include "base/i18n/file_util_icu.h"
 #include "base/location.h"
 #include "base/notreached.h"
+#include "base/strings/sys_string_conversions.h"
+#include "base/strings/utf_string_conversions.h"
 #include "base/task/task_runner.h"
 #include "base/task/thread_pool.h"
 #include "base/threading/sequenced_task_runner_handle.h"
 #include "base/threading/thread_restrictions.h"
+#include "build/build_config.h"
 #include "net/base/net_errors.h"
+#include "third_party/icu/source/common/unicode/unistr.h"
+#include "third_party/icu/source/i18n/unicode/coll.h"
+
+#if BUILDFLAG(IS_WIN)
+#include "base/strings/string_piece.h"
+#include "base/strings/string_util_win.h"
+#endif
 
 namespace net {
 
 namespace {
 
+// Maximum number of files posted to the origin sequence in a single task, so
+// that large directories neither wait for the whole listing before the first
+// file is delivered, nor block the origin sequence while it is delivered.
+const size_t kMaxFilesPerBatch = 256;
+
 bool IsDotDot(const base::FilePath& path) {
   return FILE_PATH_LITERAL("..") == path.BaseName().value();
 }
@@ -49,12 +66,80 @@ bool CompareAlphaDirsFirst(const DirectoryLister::DirectoryListerData& a,
                                                  b.info.GetName());
 }
 
+// Creates the collator that base::i18n::LocaleAwareCompareFilenames() uses.
+// Returns nullptr on failure.
+std::unique_ptr<icu::Collator> CreateFilenameCollator() {
+  UErrorCode error_code = U_ZERO_ERROR;
+  std::unique_ptr<icu::Collator> collator(
+      icu::Collator::createInstance(error_code));
+  if (U_FAILURE(error_code))
+    return nullptr;
+  // Make it case-sensitive.
+  collator->setStrength(icu::Collator::TERTIARY);
+  return collator;
+}
+
+// Returns a key of |data| such that comparing the keys of two files orders
+// them like CompareAlphaDirsFirst(). LocaleAwareCompareFilenames() creates a
+// collator for every comparison, which dominates sorting large directories,
+// while this needs one per directory and a collation pass per file.
+std::string GetSortKey(const icu::Collator& collator,
+                       const DirectoryLister::DirectoryListerData& data) {
+  base::FilePath name = data.info.GetName();
+  // Parent directory before all else, then directories before regular files.
+  char rank = IsDotDot(name) ? '0' : data.info.IsDirectory() ? '1' : '2';
+
+#if BUILDFLAG(IS_WIN)
+  base::StringPiece16 name16 = base::AsStringPiece16(name.value());
+#else
+  // On POSIX, the file system encoding is not defined. As in
+  // LocaleAwareCompareFilenames(), assume SysNativeMBToWide() takes care of
+  // it.
+  std::u16string name16 =
+      base::WideToUTF16(base::SysNativeMBToWide(name.value()));
+#endif
+  icu::UnicodeString unicode_name(false, name16.data(),
+                                  static_cast<int32_t>(name16.length()));
+
+  // The collation key of a file name is typically a little longer than the
+  // name, so this is usually large enough to avoid a second pass.
+  std::string key(name16.length() * 2 + 16, '\0');
+  key[0] = rank;
+  int32_t key_length = collator.getSortKey(
+      unicode_name, reinterpret_cast<uint8_t*>(&key[1]),
+      static_cast<int32_t>(key.size() - 1));
+  if (static_cast<size_t>(key_length) > key.size() - 1) {
+    key.resize(key_length + 1);
+    collator.getSortKey(unicode_name, reinterpret_cast<uint8_t*>(&key[1]),
+                        key_length);
+  }
+  key.resize(key_length + 1);
+  return key;
+}
+
 void SortData(std::vector<DirectoryLister::DirectoryListerData>* data,
+              const std::vector<std::string>& sort_keys,
               DirectoryLister::ListingType listing_type) {
-  // Sort the results. See the TODO below (this sort should be removed and we
-  // should do it from JS).
+  // Sort the results. TODO(brettw) bug 24107: This sort should be removed and
+  // we should do it from JS, so that unsorted listings can be used there.
   if (listing_type == DirectoryLister::ALPHA_DIRS_FIRST) {
-    std::sort(data->begin(), data->end(), CompareAlphaDirsFirst);
+    if (sort_keys.empty()) {
+      std::sort(data->begin(), data->end(), CompareAlphaDirsFirst);
+      return;
+    }
+    DCHECK_EQ(data->size(), sort_keys.size());
+    // Sort the indices by key, and move the files into place.
+    std::vector<size_t> order(data->size());
+    for (size_t i = 0; i < order.size(); ++i)
+      order[i] = i;
+    std::sort(order.begin(), order.end(), [&sort_keys](size_t a, size_t b) {
+      return sort_keys[a] < sort_keys[b];
+    });
+    std::vector<DirectoryLister::DirectoryListerData> sorted;
+    sorted.reserve(data->size());
+    for (size_t i : order)
+      sorted.push_back(std::move((*data)[i]));
+    data->swap(sorted);
   } else if (listing_type != DirectoryLister::NO_SORT &&
              listing_type != DirectoryLister::NO_SORT_RECURSIVE) {
     NOTREACHED();
@@ -134,10 +219,20 @@ void DirectoryLister::Core::Start() {
   }
   base::FileEnumerator file_enum(dir_, recursive, types);
 
+  // Files are sent to the origin sequence as they're read, unless they need
+  // to be sorted first. When sorting, the collation key of each file is
+  // computed as it's read.
+  const bool sort = type_ == ALPHA_DIRS_FIRST;
+  std::unique_ptr<icu::Collator> collator;
+  if (sort)
+    collator = CreateFilenameCollator();
+  std::vector<std::string> sort_keys;
+
   base::FilePath path;
   while (!(path = file_enum.Next()).empty()) {
     // Abort on cancellation. This is purely for performance reasons.
-    // Correctness guarantees are made by checks in DoneOnOriginSequence.
+    // Correctness guarantees are made by checks in SendFilesOnOriginSequence
+    // and DoneOnOriginSequence.
     if (IsCancelled())
       return;
 
@@ -145,25 +240,33 @@ void DirectoryLister::Core::Start() {
     data.info = file_enum.GetInfo();
     data.path = path;
     data.absolute_path = base::MakeAbsoluteFilePath(path);
-    directory_list->push_back(data);
-
-    /* TODO(brettw) bug 24107: It would be nice to send incremental updates.
-       We gather them all so they can be sorted, but eventually the sorting
-       should be done from JS to give more flexibility in the page. When we do
-       that, we can uncomment this to send incremental updates to the page.
-
-    const int kFilesPerEvent = 8;
-    if (file_data.size() < kFilesPerEvent)
-      continue;
-
-    origin_loop_->PostTask(
-        FROM_HERE,
-        base::BindOnce(&DirectoryLister::Core::SendData, file_data));
-    file_data.clear();
-    */
+    if (collator)
+      sort_keys.push_back(GetSortKey(*collator, data));
+    directory_list->push_back(std::move(data));
+
+    if (!sort && directory_list->size() == kMaxFilesPerBatch) {
+      origin_task_runner_->PostTask(
+          FROM_HERE, base::BindOnce(&Core::SendFilesOnOriginSequence, this,
+                                    std::move(directory_list)));
+      directory_list = std::make_unique<DirectoryList>();
+    }
   }
 
-  SortData(directory_list.get(), type_);
+  SortData(directory_list.get(), sort_keys, type_);
+
+  // Send sorted files in batches as well, so the origin sequence isn't busy
+  // with a single task for the whole directory.
+  auto remaining_list = std::move(directory_list);
+  directory_list = std::make_unique<DirectoryList>();
+  for (DirectoryListerData& data : *remaining_list) {
+    if (directory_list->size() == kMaxFilesPerBatch) {
+      origin_task_runner_->PostTask(
+          FROM_HERE, base::BindOnce(&Core::SendFilesOnOriginSequence, this,
+                                    std::move(directory_list)));
+      directory_list = std::make_unique<DirectoryList>();
+    }
+    directory_list->push_back(std::move(data));
+  }
 
   origin_task_runner_->PostTask(
       FROM_HERE, base::BindOnce(&Core::DoneOnOriginSequence, this,
@@ -174,21 +277,26 @@ bool DirectoryLister::Core::IsCancelled() const {
   return !!base::subtle::NoBarrier_Load(&cancelled_);
 }
 
-void DirectoryLister::Core::DoneOnOriginSequence(
-    std::unique_ptr<DirectoryList> directory_list,
-    int error) const {
+void DirectoryLister::Core::SendFilesOnOriginSequence(
+    std::unique_ptr<DirectoryList> directory_list) const {
   DCHECK(origin_task_runner_->RunsTasksInCurrentSequence());
 
-  // Need to check if the operation was before first callback.
-  if (IsCancelled())
-    return;
-
   for (const auto& lister_data : *directory_list) {
-    lister_->OnListFile(lister_data);
-    // Need to check if the operation was cancelled during the callback.
+    // Need to check if the operation was cancelled before the first callback,
+    // or during the previous one.
     if (IsCancelled())
       return;
+    lister_->OnListFile(lister_data);
   }
+}
+
+void DirectoryLister::Core::DoneOnOriginSequence(
+    std::unique_ptr<DirectoryList> directory_list,
+    int error) const {
+  SendFilesOnOriginSequence(std::move(directory_list));
+  // Need to check if the operation was cancelled during a callback.
+  if (IsCancelled())
+    return;
   lister_->OnListDone(error);
 }
 
@@ -23,9 +23,10 @@ namespace net {
 
 // This class provides an API for asynchronously listing the contents of a
 // directory on the filesystem.  It runs a task on a background thread, and
-// enumerates all files in the specified directory on that thread.  Destroying
-// the lister cancels the list operation.  The DirectoryLister must only be
-// used on a thread with a MessageLoop.
+// enumerates all files in the specified directory on that thread.  Files are
+// sent back in batches as they're found, or once the listing is sorted for
+// sorted listing types.  Destroying the lister cancels the list operation.
+// The DirectoryLister must only be used on a thread with a MessageLoop.
 class NET_EXPORT DirectoryLister  {
  public:
   // Represents one file found.
@@ -87,8 +88,8 @@ class NET_EXPORT DirectoryLister  {
   // refcounted, it's destroyed when the final reference is released, which may
   // happen on either thread.
   //
-  // It's kept alive during the calls to Start() and DoneOnOriginSequence() by
-  // the reference owned by the callback itself.
+  // It's kept alive during the calls to Start(), SendFilesOnOriginSequence()
+  // and DoneOnOriginSequence() by the reference owned by the callback itself.
   class Core : public base::RefCountedThreadSafe<Core> {
    public:
     Core(const base::FilePath& dir, ListingType type, DirectoryLister* lister);
@@ -111,6 +112,8 @@ class NET_EXPORT DirectoryLister  {
     bool IsCancelled() const;
 
     // Called on origin thread.
+    void SendFilesOnOriginSequence(
+        std::unique_ptr<DirectoryList> directory_list) const;
     void DoneOnOriginSequence(std::unique_ptr<DirectoryList> directory_list,
                               int error) const;
 
@@ -0,0 +1,147 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/directory_lister.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/i18n/file_util_icu.h"
+#include "base/run_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "net/base/net_errors.h"
+#include "net/test/test_with_task_environment.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace net {
+
+namespace {
+
+const int kNumFiles[] = {10000, 100000};
+const int kFilesPerDirectory = 1000;
+
+// Records when the first file and the end of the listing arrive.
+class TimingDelegate : public DirectoryLister::DirectoryListerDelegate {
+ public:
+  void OnListFile(const DirectoryLister::DirectoryListerData& data) override {
+    if (names_.empty())
+      time_to_first_file_ = timer_.Elapsed();
+    names_.push_back(data.info.GetName());
+  }
+
+  void OnListDone(int error) override {
+    EXPECT_EQ(OK, error);
+    time_to_done_ = timer_.Elapsed();
+    run_loop_.Quit();
+  }
+
+  void Run(DirectoryLister* lister) {
+    lister->Start();
+    run_loop_.Run();
+  }
+
+  const std::vector<base::FilePath>& names() const { return names_; }
+  base::TimeDelta time_to_first_file() const { return time_to_first_file_; }
+  base::TimeDelta time_to_done() const { return time_to_done_; }
+
+ private:
+  base::ElapsedTimer timer_;
+  base::RunLoop run_loop_;
+  std::vector<base::FilePath> names_;
+  base::TimeDelta time_to_first_file_;
+  base::TimeDelta time_to_done_;
+};
+
+class DirectoryListerPerfTest : public TestWithTaskEnvironment {
+ public:
+  void SetUp() override { ASSERT_TRUE(temp_dir_.CreateUniqueTempDir()); }
+
+  // Creates a directory with |num_files| empty files, and one with the same
+  // number of files spread over subdirectories of |kFilesPerDirectory| files,
+  // like a build output directory.
+  void CreateTrees(int num_files) {
+    flat_dir_ = temp_dir_.GetPath().AppendASCII(
+        "flat_" + base::NumberToString(num_files));
+    nested_dir_ = temp_dir_.GetPath().AppendASCII(
+        "nested_" + base::NumberToString(num_files));
+    ASSERT_TRUE(base::CreateDirectory(flat_dir_));
+    for (int i = 0; i < num_files; ++i) {
+      ASSERT_TRUE(base::WriteFile(
+          flat_dir_.AppendASCII(base::StringPrintf("File_%d.o", i)), ""));
+      base::FilePath subdir = nested_dir_.AppendASCII(
+          base::StringPrintf("obj_%d", i / kFilesPerDirectory));
+      if (i % kFilesPerDirectory == 0)
+        ASSERT_TRUE(base::CreateDirectory(subdir));
+      ASSERT_TRUE(base::WriteFile(
+          subdir.AppendASCII(base::StringPrintf("file_%d.o", i)), ""));
+    }
+  }
+
+  // Lists |dir| as |type|, and reports the time until the first file and
+  // until the end of the listing arrived on the origin sequence as |story|.
+  // Returns the names of the files that were listed.
+  std::vector<base::FilePath> MeasureListing(const std::string& story,
+                                             const base::FilePath& dir,
+                                             DirectoryLister::ListingType type,
+                                             size_t expected_files) {
+    TimingDelegate delegate;
+    DirectoryLister lister(dir, type, &delegate);
+    delegate.Run(&lister);
+    EXPECT_EQ(expected_files, delegate.names().size());
+
+    perf_test::PerfResultReporter reporter("DirectoryLister.", story);
+    reporter.RegisterImportantMetric("time_to_first_file", "ms");
+    reporter.RegisterImportantMetric("time_to_done", "ms");
+    reporter.AddResult("time_to_first_file", delegate.time_to_first_file());
+    reporter.AddResult("time_to_done", delegate.time_to_done());
+    return delegate.names();
+  }
+
+ protected:
+  base::ScopedTempDir temp_dir_;
+  base::FilePath flat_dir_;
+  base::FilePath nested_dir_;
+};
+
+TEST_F(DirectoryListerPerfTest, List) {
+  for (int num_files : kNumFiles) {
+    CreateTrees(num_files);
+    const std::string suffix = "_" + base::NumberToString(num_files);
+    // Non-recursive listings include "..".
+    MeasureListing("NoSort" + suffix, flat_dir_, DirectoryLister::NO_SORT,
+                   num_files + 1);
+    MeasureListing("NoSortRecursive" + suffix, nested_dir_,
+                   DirectoryLister::NO_SORT_RECURSIVE,
+                   num_files + num_files / kFilesPerDirectory);
+    std::vector<base::FilePath> names =
+        MeasureListing("AlphaDirsFirst" + suffix, flat_dir_,
+                       DirectoryLister::ALPHA_DIRS_FIRST, num_files + 1);
+
+    // For comparison, sort the same files by comparing their names directly,
+    // with a collator for each comparison.
+    std::reverse(names.begin(), names.end());
+    base::ElapsedTimer timer;
+    std::sort(names.begin(), names.end(),
+              base::i18n::LocaleAwareCompareFilenames);
+    base::TimeDelta sort_time = timer.Elapsed();
+
+    perf_test::PerfResultReporter reporter("DirectoryLister.",
+                                           "LocaleAwareCompareFilenames" +
+                                               suffix);
+    reporter.RegisterImportantMetric("sort_time", "ms");
+    reporter.AddResult("sort_time", sort_time);
+  }
+}
+
+}  // namespace
+
+}  // namespace net
@@ -273,6 +273,59 @@ TEST_F(DirectoryListerTest, CancelOnLastElementTest) {
   EXPECT_EQ(1, delegate.num_files());
 }
 
+// Lists a directory with more files than are sent to the delegate at once,
+// with names that sort differently by code point and by locale.
+TEST_F(DirectoryListerTest, ManyFilesTest) {
+  const int kNumFiles = 1000;
+  const char* const kNamePrefixes[] = {"a", "B", "_", "b-", "Z10", "z9"};
+  base::ScopedTempDir tempDir;
+  ASSERT_TRUE(tempDir.CreateUniqueTempDir());
+  for (int i = 0; i < kNumFiles; ++i) {
+    std::string name = base::StringPrintf(
+        "%s%d", kNamePrefixes[i % std::size(kNamePrefixes)], i);
+    base::FilePath path = tempDir.GetPath().AppendASCII(name);
+    if (i % 10 == 0)
+      ASSERT_TRUE(base::CreateDirectory(path));
+    else
+      ASSERT_TRUE(base::WriteFile(path, ""));
+  }
+
+  for (auto type : {DirectoryLister::ALPHA_DIRS_FIRST, DirectoryLister::NO_SORT,
+                    DirectoryLister::NO_SORT_RECURSIVE}) {
+    ListerDelegate delegate(type);
+    DirectoryLister lister(tempDir.GetPath(), type, &delegate);
+    delegate.Run(&lister);
+
+    EXPECT_TRUE(delegate.done());
+    EXPECT_THAT(delegate.error(), IsOk());
+    // Non-recursive listings include "..".
+    EXPECT_EQ(type == DirectoryLister::NO_SORT_RECURSIVE ? kNumFiles
+                                                          : kNumFiles + 1,
+              delegate.num_files());
+  }
+}
+
+TEST_F(DirectoryListerTest, CancelOnListFileManyFilesTest) {
+  const int kNumFiles = 1000;
+  base::ScopedTempDir tempDir;
+  ASSERT_TRUE(tempDir.CreateUniqueTempDir());
+  for (int i = 0; i < kNumFiles; ++i) {
+    ASSERT_TRUE(base::WriteFile(
+        tempDir.GetPath().AppendASCII(base::StringPrintf("file_%d", i)), ""));
+  }
+
+  ListerDelegate delegate(DirectoryLister::NO_SORT);
+  DirectoryLister lister(tempDir.GetPath(), DirectoryLister::NO_SORT,
+                         &delegate);
+  delegate.set_cancel_lister_on_list_file(true);
+  delegate.Run(&lister);
+  // Batches that were already sent must not be delivered either.
+  RunUntilIdle();
+
+  EXPECT_FALSE(delegate.done());
+  EXPECT_EQ(1, delegate.num_files());
+}
+
 TEST_F(DirectoryListerTest, NoSuchDirTest) {
   base::ScopedTempDir tempDir;
   EXPECT_TRUE(tempDir.CreateUniqueTempDir());
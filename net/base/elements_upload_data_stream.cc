@@ -43,6 +43,20 @@ int ElementsUploadDataStream::ReadInternal(
   return ReadElements(base::MakeRefCounted<DrainableIOBuffer>(buf, buf_len));
 }
 
+scoped_refptr<IOBuffer> ElementsUploadDataStream::ReadWithoutCopyingInternal(
+    int max_length,
+    int* length) {
+  // Skip finished elements, like ReadElements() does.
+  while (element_index_ < element_readers_.size() &&
+         element_readers_[element_index_]->BytesRemaining() == 0) {
+    ++element_index_;
+  }
+  if (read_error_ != OK || element_index_ == element_readers_.size())
+    return nullptr;
+  return element_readers_[element_index_]->ReadWithoutCopying(max_length,
+                                                              length);
+}
+
 bool ElementsUploadDataStream::IsInMemory() const {
   for (const std::unique_ptr<UploadElementReader>& it : element_readers_) {
     if (!it->IsInMemory())
@@ -48,6 +48,8 @@ class NET_EXPORT ElementsUploadDataStream : public UploadDataStream {
       const override;
   int InitInternal(const NetLogWithSource& net_log) override;
   int ReadInternal(IOBuffer* buf, int buf_len) override;
+  scoped_refptr<IOBuffer> ReadWithoutCopyingInternal(int max_length,
+                                                     int* length) override;
   void ResetInternal() override;
 
   // Runs Init() for all element readers.
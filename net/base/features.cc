@@ -331,4 +331,26 @@ constexpr int kStorageAccessAPIDefaultImplicitGrantLimit = 5;
 const base::FeatureParam<int> kStorageAccessAPIImplicitGrantLimit{
     &kStorageAccessAPI, "storage-access-api-implicit-grant-limit",
     kStorageAccessAPIDefaultImplicitGrantLimit};
+
+const base::Feature kTransportSecurityDeltaLog{
+    "TransportSecurityDeltaLog", base::FEATURE_DISABLED_BY_DEFAULT};
+
+const base::Feature kHttpServerPropertiesBinaryFormat{
+    "HttpServerPropertiesBinaryFormat", base::FEATURE_DISABLED_BY_DEFAULT};
+
+const base::Feature kUploadFileMemoryMapping{"UploadFileMemoryMapping",
+                                             base::FEATURE_DISABLED_BY_DEFAULT};
+
+const base::Feature kAdaptiveURLRequestThrottling{
+    "AdaptiveURLRequestThrottling", base::FEATURE_DISABLED_BY_DEFAULT};
+
+const base::FeatureParam<int> kAdaptiveURLRequestThrottlingMinInitialDelayMs{
+    &kAdaptiveURLRequestThrottling, "min_initial_delay_ms", 350};
+
+const base::FeatureParam<int> kAdaptiveURLRequestThrottlingMaxInitialDelayMs{
+    &kAdaptiveURLRequestThrottling, "max_initial_delay_ms", 2800};
+
+const base::FeatureParam<int> kAdaptiveURLRequestThrottlingMaxErrorsToIgnore{
+    &kAdaptiveURLRequestThrottling, "max_errors_to_ignore", 4};
+
 }  // namespace net::features
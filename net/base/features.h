@@ -463,6 +463,33 @@ NET_EXPORT extern const int kStorageAccessAPIDefaultImplicitGrantLimit;
 NET_EXPORT extern const base::FeatureParam<int>
     kStorageAccessAPIImplicitGrantLimit;
 
+// When enabled, TransportSecurityPersister stores the dynamic transport
+// security state as an append-only log of changed entries, rather than
+// rewriting all of it as JSON on every write.
+NET_EXPORT extern const base::Feature kTransportSecurityDeltaLog;
+
+// When enabled, HttpServerPropertiesManager persists servers and QUIC server
+// infos in a compact binary encoding instead of a dictionary per entry.
+NET_EXPORT extern const base::Feature kHttpServerPropertiesBinaryFormat;
+
+// When enabled, UploadFileElementReader memory maps the files it uploads, so
+// that HTTP/1 uploads write their pages to the socket without copying them
+// into a buffer first.
+NET_EXPORT extern const base::Feature kUploadFileMemoryMapping;
+
+// When enabled, URLRequestThrottlerEntry sizes its exponential back-off from
+// the rate of server errors it has seen, instead of using fixed parameters.
+// The initial delay grows from the min to the max delay with the error rate,
+// and the number of errors to ignore before backing off shrinks from the max
+// to 0.
+NET_EXPORT extern const base::Feature kAdaptiveURLRequestThrottling;
+NET_EXPORT extern const base::FeatureParam<int>
+    kAdaptiveURLRequestThrottlingMinInitialDelayMs;
+NET_EXPORT extern const base::FeatureParam<int>
+    kAdaptiveURLRequestThrottlingMaxInitialDelayMs;
+NET_EXPORT extern const base::FeatureParam<int>
+    kAdaptiveURLRequestThrottlingMaxErrorsToIgnore;
+
 }  // namespace net::features
 
 #endif  // NET_BASE_FEATURES_H_
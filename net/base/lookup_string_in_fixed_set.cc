@@ -4,7 +4,15 @@
 
 #include "net/base/lookup_string_in_fixed_set.h"
 
-#include "base/check.h"
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "base/bits.h"
+#include "base/check_op.h"
+#include "base/trace_event/memory_usage_estimator.h"
 
 namespace net {
 
@@ -67,6 +75,40 @@ bool GetReturnValue(const unsigned char* offset, int* return_value) {
   return false;
 }
 
+// Appends every string of the DAFSA that starts with |prefix| to |strings|,
+// along with its return value. |pos| points to the offsets of the children of
+// the node that |prefix| leads to.
+void EnumerateStrings(const unsigned char* pos,
+                      const unsigned char* end,
+                      std::string* prefix,
+                      std::vector<std::pair<std::string, int>>* strings) {
+  const unsigned char* offset = pos;
+  while (GetNextOffset(&pos, &offset)) {
+    const size_t prefix_length = prefix->length();
+    for (const unsigned char* label = offset;; ++label) {
+      DCHECK(label < end);
+      int return_value;
+      if (GetReturnValue(label, &return_value)) {
+        strings->emplace_back(*prefix, return_value);
+        break;
+      }
+      prefix->push_back(*label & 0x7F);
+      if (IsEOL(label)) {
+        EnumerateStrings(label + 1, end, prefix, strings);
+        break;
+      }
+    }
+    prefix->resize(prefix_length);
+  }
+}
+
+// FNV-1a, which can be computed one character at a time.
+const uint32_t kHashSeed = 2166136261u;
+
+inline uint32_t HashStep(uint32_t hash, char c) {
+  return (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+}
+
 }  // namespace
 
 FixedSetIncrementalLookup::FixedSetIncrementalLookup(const unsigned char* graph,
@@ -229,4 +271,88 @@ int LookupSuffixInReversedSet(const unsigned char* graph,
   return result;
 }
 
+FixedSetSuffixTable::FixedSetSuffixTable(const unsigned char* graph,
+                                         size_t length) {
+  std::vector<std::pair<std::string, int>> reversed_strings;
+  std::string prefix;
+  EnumerateStrings(graph, graph + length, &prefix, &reversed_strings);
+
+  // Keep the table at most two thirds full, for short probe sequences.
+  buckets_.resize(size_t{1} << base::bits::Log2Ceiling(static_cast<uint32_t>(
+                      reversed_strings.size() * 3 / 2 + 1)));
+  const size_t mask = buckets_.size() - 1;
+  for (const auto& [reversed_string, value] : reversed_strings) {
+    // The empty string is never looked up.
+    if (reversed_string.empty())
+      continue;
+    CHECK_LE(reversed_string.length(), std::numeric_limits<uint16_t>::max());
+    CHECK_LE(strings_.length(), std::numeric_limits<uint32_t>::max());
+
+    // Hash in the order the lookup visits the characters of the host.
+    uint32_t hash = kHashSeed;
+    for (char c : reversed_string)
+      hash = HashStep(hash, c);
+    size_t i = hash & mask;
+    while (buckets_[i].length != 0)
+      i = (i + 1) & mask;
+    buckets_[i] = {hash, static_cast<uint32_t>(strings_.length()),
+                   static_cast<uint16_t>(reversed_string.length()),
+                   static_cast<uint8_t>(value)};
+    strings_.append(reversed_string.rbegin(), reversed_string.rend());
+    max_length_ = std::max(max_length_, reversed_string.length());
+  }
+}
+
+FixedSetSuffixTable::~FixedSetSuffixTable() = default;
+
+size_t FixedSetSuffixTable::EstimateMemoryUsage() const {
+  return base::trace_event::EstimateMemoryUsage(strings_) +
+         base::trace_event::EstimateMemoryUsage(buckets_);
+}
+
+const FixedSetSuffixTable::Entry* FixedSetSuffixTable::Find(
+    uint32_t hash,
+    base::StringPiece key) const {
+  const size_t mask = buckets_.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    const Entry& entry = buckets_[i];
+    if (entry.length == 0)
+      return nullptr;
+    if (entry.hash == hash && entry.length == key.length() &&
+        memcmp(strings_.data() + entry.offset, key.data(), key.length()) ==
+            0) {
+      return &entry;
+    }
+  }
+}
+
+int LookupSuffixInReversedSet(const FixedSetSuffixTable& table,
+                              bool include_private,
+                              base::StringPiece host,
+                              size_t* suffix_length) {
+  *suffix_length = 0;
+  int result = kDafsaNotFound;
+  uint32_t hash = kHashSeed;
+  // Look up host from right to left, like the DAFSA lookup. Suffixes longer
+  // than any string in the set can't match.
+  const size_t max_length = std::min(host.length(), table.max_length_);
+  for (size_t length = 1; length <= max_length; ++length) {
+    const size_t pos = host.length() - length;
+    hash = HashStep(hash, host[pos]);
+    // Only host itself or a part that follows a dot can match.
+    if (pos != 0 && host[pos - 1] != '.')
+      continue;
+    const FixedSetSuffixTable::Entry* entry =
+        table.Find(hash, host.substr(pos));
+    if (!entry)
+      continue;
+    // Break if private and private rules should be excluded.
+    if ((entry->value & kDafsaPrivateRule) && !include_private)
+      break;
+    *suffix_length = length;
+    result = entry->value;
+  }
+  return result;
+}
+
 }  // namespace net
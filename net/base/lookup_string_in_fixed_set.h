@@ -6,6 +6,10 @@
 #define NET_BASE_LOOKUP_STRING_IN_FIXED_SET_H_
 
 #include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
 
 #include "base/strings/string_piece.h"
 #include "net/base/net_export.h"
@@ -44,11 +48,72 @@ NET_EXPORT int LookupStringInFixedSet(const unsigned char* graph,
 // If no match was found a value of 0 is written to |suffix_length| and the
 // value kDafsaNotFound is returned, otherwise the length of the longest match
 // is written to |suffix_length| and the type of the longest match is returned.
-int LookupSuffixInReversedSet(const unsigned char* graph,
-                              size_t length,
-                              bool include_private,
-                              base::StringPiece host,
-                              size_t* suffix_length);
+NET_EXPORT int LookupSuffixInReversedSet(const unsigned char* graph,
+                                         size_t length,
+                                         bool include_private,
+                                         base::StringPiece host,
+                                         size_t* suffix_length);
+
+class FixedSetSuffixTable;
+
+// Like the above, but looks up |host| in |table|, with the same result as for
+// the graph that |table| was built from.
+NET_EXPORT int LookupSuffixInReversedSet(const FixedSetSuffixTable& table,
+                                         bool include_private,
+                                         base::StringPiece host,
+                                         size_t* suffix_length);
+
+// FixedSetSuffixTable holds the strings of a reversed DAFSA in a hash table,
+// for hosts to be looked up with LookupSuffixInReversedSet() without decoding
+// the graph. The DAFSA lookup follows the offsets of a node for every character
+// of the host, while this one hashes the host once from right to left and
+// probes the table once for each suffix that starts a component. The table
+// takes memory in proportion to the number of strings in the set, several
+// times the size of the graph, so it is meant for sets looked up on hot paths.
+// It is built once, from the graph generated by make_dafsa.py.
+//
+// Nothing in net/ uses it yet: it exists so that the perftest can compare it
+// with the graph lookup before GetRegistryLengthInStrippedHost() is switched
+// over.
+class NET_EXPORT FixedSetSuffixTable {
+ public:
+  FixedSetSuffixTable(const unsigned char* graph, size_t length);
+
+  FixedSetSuffixTable(const FixedSetSuffixTable&) = delete;
+  FixedSetSuffixTable& operator=(const FixedSetSuffixTable&) = delete;
+
+  ~FixedSetSuffixTable();
+
+  size_t EstimateMemoryUsage() const;
+
+ private:
+  friend int LookupSuffixInReversedSet(const FixedSetSuffixTable& table,
+                                       bool include_private,
+                                       base::StringPiece host,
+                                       size_t* suffix_length);
+
+  struct Entry {
+    uint32_t hash;
+    // Position of the string in |strings_|.
+    uint32_t offset;
+    // Zero for empty buckets.
+    uint16_t length;
+    uint8_t value;
+  };
+
+  // Returns the entry for |key|, whose hash is |hash|, or nullptr.
+  const Entry* Find(uint32_t hash, base::StringPiece key) const;
+
+  // The strings of the set, in host order, one after another.
+  std::string strings_;
+
+  // Open addressing hash table of the strings, with linear probing. Its size is
+  // a power of two, and more than one and a half times the number of strings.
+  std::vector<Entry> buckets_;
+
+  // The length of the longest string.
+  size_t max_length_ = 0;
+};
 
 // FixedSetIncrementalLookup provides efficient membership and prefix queries
 // against a fixed set of strings. The set of strings must be known at compile
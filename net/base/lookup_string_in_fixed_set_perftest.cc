@@ -0,0 +1,113 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/lookup_string_in_fixed_set.h"
+
+#include <string>
+#include <vector>
+
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace net {
+
+namespace {
+
+#include "net/base/registry_controlled_domains/effective_tld_names-reversed-inc.cc"
+
+const int kNumIterations = 100;
+
+// Appends hosts under each rule that starts with |reversed_suffix|, which
+// |lookup| has been advanced by, to |hosts|.
+void AppendHosts(const FixedSetIncrementalLookup& lookup,
+                 std::string* reversed_suffix,
+                 std::vector<std::string>* hosts) {
+  if (lookup.GetResultForCurrentSequence() != kDafsaNotFound) {
+    std::string suffix(reversed_suffix->rbegin(), reversed_suffix->rend());
+    hosts->push_back(suffix);
+    hosts->push_back("www.example." + suffix);
+  }
+  // The set only contains printable ASCII characters.
+  for (char c = 0x20; c < 0x7F; ++c) {
+    FixedSetIncrementalLookup continued_lookup = lookup;
+    if (continued_lookup.Advance(c)) {
+      reversed_suffix->push_back(c);
+      AppendHosts(continued_lookup, reversed_suffix, hosts);
+      reversed_suffix->pop_back();
+    }
+  }
+}
+
+// Returns hosts for every rule of the public suffix list, followed by some
+// that aren't under any rule.
+std::vector<std::string> CreateHosts() {
+  std::vector<std::string> hosts;
+  std::string reversed_suffix;
+  AppendHosts(FixedSetIncrementalLookup(kDafsa, sizeof(kDafsa)),
+              &reversed_suffix, &hosts);
+  hosts.push_back("localhost");
+  hosts.push_back("192.168.0.1");
+  hosts.push_back("www.example.notatld");
+  return hosts;
+}
+
+template <typename LookupFunction>
+void MeasureLookups(const std::string& story,
+                    const std::vector<std::string>& hosts,
+                    size_t size,
+                    LookupFunction lookup) {
+  size_t total_suffix_length = 0;
+  base::ElapsedTimer timer;
+  for (int i = 0; i < kNumIterations; ++i) {
+    for (const std::string& host : hosts) {
+      size_t suffix_length;
+      lookup(host, &suffix_length);
+      total_suffix_length += suffix_length;
+    }
+  }
+  base::TimeDelta elapsed = timer.Elapsed();
+  EXPECT_LT(0u, total_suffix_length);
+
+  perf_test::PerfResultReporter reporter("LookupSuffixInReversedSet.", story);
+  reporter.RegisterImportantMetric("lookups_per_second", "count/s");
+  reporter.RegisterImportantMetric("size", "bytes");
+  reporter.AddResult("lookups_per_second",
+                     hosts.size() * kNumIterations / elapsed.InSecondsF());
+  reporter.AddResult("size", size);
+}
+
+// Compares looking up hosts under every rule of the public suffix list in its
+// DAFSA, which is compiled into the binary, and in a FixedSetSuffixTable built
+// from the DAFSA, which takes memory instead.
+TEST(LookupSuffixInReversedSetPerfTest, PublicSuffixList) {
+  const std::vector<std::string> hosts = CreateHosts();
+
+  MeasureLookups("Graph", hosts, sizeof(kDafsa),
+                 [](const std::string& host, size_t* suffix_length) {
+                   return LookupSuffixInReversedSet(
+                       kDafsa, sizeof(kDafsa), true /* include_private */,
+                       host, suffix_length);
+                 });
+
+  base::ElapsedTimer build_timer;
+  FixedSetSuffixTable table(kDafsa, sizeof(kDafsa));
+  base::TimeDelta build_time = build_timer.Elapsed();
+  MeasureLookups("Table", hosts, table.EstimateMemoryUsage(),
+                 [&table](const std::string& host, size_t* suffix_length) {
+                   return LookupSuffixInReversedSet(
+                       table, true /* include_private */, host,
+                       suffix_length);
+                 });
+
+  perf_test::PerfResultReporter reporter("LookupSuffixInReversedSet.",
+                                         "Table");
+  reporter.RegisterImportantMetric("build_time", "ms");
+  reporter.AddResult("build_time", build_time);
+}
+
+}  // namespace
+
+}  // namespace net
@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <limits>
 #include <ostream>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -247,5 +248,69 @@ TEST(LookupStringInFixedSetTest, Dafsa6EnumerateLanguage) {
   EXPECT_EQ(expected_language, language);
 }
 
+// Checks that looking up hosts made of the strings in |graph| in a
+// FixedSetSuffixTable built from it gives the same results as in |graph|.
+template <typename Graph>
+void ExpectSuffixTableMatchesGraph(const Graph& graph) {
+  FixedSetSuffixTable table(graph, sizeof(Graph));
+  std::vector<std::string> hosts = {"", ".", "a", "a.", ".a"};
+  for (const std::string& line : EnumerateDafsaLanguage(graph)) {
+    // Strings are looked up in reverse, so reverse them to make hosts.
+    std::string key = line.substr(0, line.rfind(", "));
+    std::string host(key.rbegin(), key.rend());
+    hosts.push_back(host);
+    hosts.push_back("www." + host);
+    hosts.push_back("www" + host);
+    hosts.push_back(host + ".");
+    hosts.push_back(host.substr(1));
+  }
+
+  for (const std::string& host : hosts) {
+    for (bool include_private : {false, true}) {
+      size_t graph_suffix_length;
+      size_t table_suffix_length;
+      EXPECT_EQ(LookupSuffixInReversedSet(graph, sizeof(Graph),
+                                          include_private, host,
+                                          &graph_suffix_length),
+                LookupSuffixInReversedSet(table, include_private, host,
+                                          &table_suffix_length))
+          << host;
+      EXPECT_EQ(graph_suffix_length, table_suffix_length) << host;
+    }
+  }
+}
+
+TEST(LookupStringInFixedSetTest, SuffixTableMatchesGraph) {
+  ExpectSuffixTableMatchesGraph(test1::kDafsa);
+  ExpectSuffixTableMatchesGraph(test3::kDafsa);
+  ExpectSuffixTableMatchesGraph(test4::kDafsa);
+  ExpectSuffixTableMatchesGraph(test5::kDafsa);
+  ExpectSuffixTableMatchesGraph(test6::kDafsa);
+}
+
+TEST(LookupStringInFixedSetTest, SuffixTableLookup) {
+  FixedSetSuffixTable table(test1::kDafsa, sizeof(test1::kDafsa));
+  size_t suffix_length;
+  // Matches "bar.jp".
+  EXPECT_EQ(kDafsaWildcardRule,
+            LookupSuffixInReversedSet(table, false /* include_private */,
+                                      "foo.pj.rab", &suffix_length));
+  EXPECT_EQ(6u, suffix_length);
+  // Matches the private rule "priv.no".
+  EXPECT_EQ(kDafsaPrivateRule,
+            LookupSuffixInReversedSet(table, true /* include_private */,
+                                      "on.virp", &suffix_length));
+  EXPECT_EQ(7u, suffix_length);
+  EXPECT_EQ(kDafsaNotFound,
+            LookupSuffixInReversedSet(table, false /* include_private */,
+                                      "on.virp", &suffix_length));
+  EXPECT_EQ(0u, suffix_length);
+  // "bar.jp" must start a component.
+  EXPECT_EQ(kDafsaNotFound,
+            LookupSuffixInReversedSet(table, false /* include_private */,
+                                      "foopj.rab", &suffix_length));
+  EXPECT_EQ(0u, suffix_length);
+}
+
 }  // namespace
 }  // namespace net
@@ -84,12 +84,15 @@
 // definition and roughly the same as Firefox's definition.
 
 #include <stdint.h>
+#include <string.h>
 #include <string>
 
 #include "net/base/mime_sniffer.h"
 
+#include "base/bits.h"
 #include "base/check_op.h"
 #include "base/containers/span.h"
+#include "base/dcheck_is_on.h"
 #include "base/notreached.h"
 #include "base/strings/string_util.h"
 #include "build/build_config.h"
@@ -132,7 +135,7 @@ VerifySizes<sizeof(magic), sizeof(mask)>::SIZES
 #define MAGIC_STRING(mime_type, magic) \
   { (mime_type), base::StringPiece((magic), sizeof(magic) - 1), true, nullptr }
 
-static const MagicNumber kMagicNumbers[] = {
+static constexpr MagicNumber kMagicNumbers[] = {
   // Source: HTML 5 specification
   MAGIC_NUMBER("application/pdf", "%PDF-"),
   MAGIC_NUMBER("application/postscript", "%!PS-Adobe-"),
@@ -214,7 +217,7 @@ static const OfficeExtensionType kOfficeExtensionTypes[] = {
   OFFICE_EXTENSION(DOC_TYPE_POWERPOINT, ".pptx"),
 };
 
-static const MagicNumber kExtraMagicNumbers[] = {
+static constexpr MagicNumber kExtraMagicNumbers[] = {
   MAGIC_NUMBER("image/x-xbitmap", "#define"),
   MAGIC_NUMBER("image/x-icon", "\x00\x00\x01\x00"),
   MAGIC_NUMBER("audio/wav", "RIFF....WAVEfmt "),
@@ -256,7 +259,7 @@ static const MagicNumber kExtraMagicNumbers[] = {
 #define MAGIC_HTML_TAG(tag) \
   MAGIC_STRING("text/html", "<" tag)
 
-static const MagicNumber kSniffableTags[] = {
+static constexpr MagicNumber kSniffableTags[] = {
   // XML processing directive.  Although this is not an HTML mime type, we sniff
   // for this in the HTML phase because text/xml is just as powerful as HTML and
   // we want to leverage our white space skipping technology.
@@ -349,6 +352,96 @@ static bool CheckForMagicNumbers(base::StringPiece content,
   return false;
 }
 
+// An index of a table of magic numbers by the content byte at |key_position|:
+// |candidates[byte]| has bit i set if entry i of the table can match content
+// with that byte there. Looking up the content byte narrows the table down to
+// the few entries that need a full comparison, in table order, so the first
+// match is the same as that of a linear scan.
+struct MagicNumberIndex {
+  size_t key_position;
+  uint32_t candidates[256];
+};
+
+static constexpr char ToLowerASCIIConstexpr(char c) {
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+// Returns whether |magic_entry| accepts |byte| at |position|, with the same
+// rules as MatchMagicNumber().
+static constexpr bool MagicByteMatches(const MagicNumber& magic_entry,
+                                       size_t position,
+                                       char byte) {
+  // Content bytes past the end of the magic number are not compared.
+  if (position >= magic_entry.magic.length())
+    return true;
+  const char magic_byte = magic_entry.magic[position];
+  if (magic_entry.is_string)
+    return ToLowerASCIIConstexpr(byte) == ToLowerASCIIConstexpr(magic_byte);
+  if (magic_byte == '.')
+    return true;
+  if (magic_entry.mask)
+    return (magic_entry.mask[position] & byte) == magic_byte;
+  return byte == magic_byte;
+}
+
+template <size_t N>
+static constexpr MagicNumberIndex BuildMagicNumberIndex(
+    const MagicNumber (&magic_numbers)[N],
+    size_t key_position) {
+  static_assert(N <= 32, "candidates must have a bit for each entry");
+  MagicNumberIndex index = {key_position, {}};
+  for (size_t byte = 0; byte < 256; ++byte) {
+    for (size_t i = 0; i < N; ++i) {
+      if (MagicByteMatches(magic_numbers[i], key_position,
+                           static_cast<char>(byte))) {
+        index.candidates[byte] |= 1u << i;
+      }
+    }
+  }
+  return index;
+}
+
+static constexpr MagicNumberIndex kMagicNumbersIndex =
+    BuildMagicNumberIndex(kMagicNumbers, 0);
+static constexpr MagicNumberIndex kExtraMagicNumbersIndex =
+    BuildMagicNumberIndex(kExtraMagicNumbers, 0);
+// All the tags start with '<', so they are told apart by the next byte.
+static constexpr MagicNumberIndex kSniffableTagsIndex =
+    BuildMagicNumberIndex(kSniffableTags, 1);
+
+// Like CheckForMagicNumbers(), but only compares the entries of
+// |magic_numbers| that |index| lists for |content|.
+static bool CheckForMagicNumbers(base::StringPiece content,
+                                 base::span<const MagicNumber> magic_numbers,
+                                 const MagicNumberIndex& index,
+                                 std::string* result) {
+  // Too short for the index. This is rare enough not to be worth indexing.
+  if (content.length() <= index.key_position)
+    return CheckForMagicNumbers(content, magic_numbers, result);
+
+  bool match = false;
+  uint32_t candidates =
+      index.candidates[static_cast<uint8_t>(content[index.key_position])];
+  while (candidates) {
+    size_t i = base::bits::CountTrailingZeroBits(candidates);
+    candidates &= candidates - 1;
+    if (MatchMagicNumber(content, magic_numbers[i], result)) {
+      match = true;
+      break;
+    }
+  }
+
+#if DCHECK_IS_ON()
+  // Keep the index honest.
+  std::string linear_result;
+  DCHECK_EQ(match, CheckForMagicNumbers(content, magic_numbers,
+                                        &linear_result));
+  DCHECK(!match || linear_result == *result);
+#endif  // DCHECK_IS_ON()
+
+  return match;
+}
+
 // Truncates |string_piece| to length |max_size| and returns true if
 // |string_piece| is now exactly |max_size|.
 static bool TruncateStringPiece(const size_t max_size,
@@ -375,7 +468,8 @@ static bool SniffForHTML(base::StringPiece content,
       base::TrimWhitespaceASCII(content, base::TRIM_LEADING);
 
   // |trimmed| now starts at first non-whitespace character (or is empty).
-  return CheckForMagicNumbers(trimmed, kSniffableTags, result);
+  return CheckForMagicNumbers(trimmed, kSniffableTags, kSniffableTagsIndex,
+                              result);
 }
 
 // Returns true and sets result if the content matches any of kMagicNumbers.
@@ -386,7 +480,8 @@ static bool SniffForMagicNumbers(base::StringPiece content,
   *have_enough_content &= TruncateStringPiece(kBytesRequiredForMagic, &content);
 
   // Check our big table of Magic Numbers
-  return CheckForMagicNumbers(content, kMagicNumbers, result);
+  return CheckForMagicNumbers(content, kMagicNumbers, kMagicNumbersIndex,
+                              result);
 }
 
 // Returns true and sets result if the content matches any of
@@ -806,10 +901,13 @@ bool SniffMimeType(const char* content,
 NET_EXPORT bool SniffMimeTypeFromLocalData(base::StringPiece content,
                                            std::string* result) {
   // First check the extra table.
-  if (CheckForMagicNumbers(content, kExtraMagicNumbers, result))
+  if (CheckForMagicNumbers(content, kExtraMagicNumbers,
+                           kExtraMagicNumbersIndex, result)) {
     return true;
+  }
   // Finally check the original table.
-  return CheckForMagicNumbers(content, kMagicNumbers, result);
+  return CheckForMagicNumbers(content, kMagicNumbers, kMagicNumbersIndex,
+                              result);
 }
 
 bool SniffMimeTypeFromLocalData(const char* content,
@@ -828,9 +926,28 @@ bool LooksLikeBinary(base::StringPiece content) {
   // represents byte 0x1F.
   const uint32_t kBinaryBits =
       ~(1u << '\t' | 1u << '\n' | 1u << '\r' | 1u << '\f' | 1u << '\x1b');
-  for (char c : content) {
+  auto is_binary_byte = [kBinaryBits](char c) {
     uint8_t byte = static_cast<uint8_t>(c);
-    if (byte < 0x20 && (kBinaryBits & (1u << byte)))
+    return byte < 0x20 && (kBinaryBits & (1u << byte));
+  };
+
+  // Text has few bytes < 0x20, so skip a word at a time past those that have
+  // none. The expression is non-zero iff a byte of |word| is < 0x20.
+  const uint64_t kOnes = 0x0101010101010101;
+  const uint64_t kHighBits = 0x8080808080808080;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= content.length(); i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, content.data() + i, sizeof(word));
+    if (((word - kOnes * 0x20) & ~word & kHighBits) == 0)
+      continue;
+    for (size_t j = i; j < i + sizeof(uint64_t); ++j) {
+      if (is_binary_byte(content[j]))
+        return true;
+    }
+  }
+  for (; i < content.length(); ++i) {
+    if (is_binary_byte(content[i]))
       return true;
   }
   return false;
@@ -4,13 +4,18 @@
 
 #include "net/base/mime_sniffer.h"
 
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "base/bits.h"
 #include "base/check_op.h"
+#include "base/strings/string_piece.h"
+#include "base/time/time.h"
 #include "base/timer/elapsed_timer.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "testing/perf/perf_result_reporter.h"
+#include "url/gurl.h"
 
 namespace net {
 namespace {
@@ -103,5 +108,86 @@ TEST(MimeSnifferTest, PlainTextPerfTest) {
                                        elapsed_timer.Elapsed().InSecondsF());
 }
 
+// The starts of responses that are commonly sniffed: those with no
+// Content-Type, or one that is unknown or text/plain.
+#define RESPONSE_PREFIX(type_hint, prefix) \
+  { (type_hint), base::StringPiece((prefix), sizeof(prefix) - 1) }
+
+const struct {
+  const char* type_hint;
+  base::StringPiece prefix;
+} kResponsePrefixes[] = {
+    RESPONSE_PREFIX("",
+                    "\n\n<!DOCTYPE html>\n<html lang=\"en\">\n<head>\n"
+                    "<meta charset=\"utf-8\">\n"),
+    RESPONSE_PREFIX("",
+                    "<html><head><title>301 Moved Permanently</title></head>"
+                    "\r\n"),
+    RESPONSE_PREFIX("",
+                    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                    "<rss version=\"2.0\">\n"),
+    RESPONSE_PREFIX("",
+                    "{\"status\":\"ok\",\"results\":[{\"id\":1,"
+                    "\"name\":\"example\"}]}"),
+    RESPONSE_PREFIX("",
+                    "/*! For license information please see "
+                    "main.js.LICENSE.txt */\n"),
+    RESPONSE_PREFIX("",
+                    "\x89PNG\r\n\x1A\n\0\0\0\rIHDR\0\0\x01\0\0\0\x01\0"
+                    "\x08\x06"),
+    RESPONSE_PREFIX("", "\xFF\xD8\xFF\xE0\0\x10JFIF\0\x01\x01\x01\0H\0H\0\0"),
+    RESPONSE_PREFIX("",
+                    "GIF89a\x01\0\x01\0\x80\0\0\xFF\xFF\xFF\0\0\0!\xF9"
+                    "\x04"),
+    RESPONSE_PREFIX("", "\x1F\x8B\x08\0\0\0\0\0\0\x03"),
+    RESPONSE_PREFIX("application/unknown",
+                    "%PDF-1.7\n%\xE2\xE3\xCF\xD3\n1 0 obj\n"),
+    RESPONSE_PREFIX("text/plain",
+                    "User-agent: *\nDisallow: /search\n"
+                    "Allow: /search/about\n"),
+    RESPONSE_PREFIX("text/plain",
+                    "\0\0\0 ftypisom\0\0\x02\0isomiso2avc1mp41"),
+};
+
+// Measures sniffing the first kMaxBytesToSniff bytes of each of
+// kResponsePrefixes, repeated to that size.
+TEST(MimeSnifferTest, ResponsePrefixesPerfTest) {
+  const size_t kWarmupIterations = 16;
+  const size_t kMeasuredIterations = 1 << 15;
+  const GURL url("https://www.example.com/");
+  std::vector<std::string> contents;
+  for (const auto& response : kResponsePrefixes) {
+    std::string content;
+    while (content.size() < static_cast<size_t>(kMaxBytesToSniff))
+      content.append(response.prefix.data(), response.prefix.size());
+    content.resize(kMaxBytesToSniff);
+    contents.push_back(std::move(content));
+  }
+
+  std::string mime_type;
+  auto sniff_all = [&](size_t iterations) {
+    for (size_t i = 0; i < iterations; ++i) {
+      for (size_t j = 0; j < contents.size(); ++j) {
+        SniffMimeType(contents[j], url, kResponsePrefixes[j].type_hint,
+                      ForceSniffFileUrlsForHtml::kDisabled, &mime_type);
+      }
+    }
+  };
+  sniff_all(kWarmupIterations);
+  base::ElapsedTimer elapsed_timer;
+  sniff_all(kMeasuredIterations);
+  base::TimeDelta elapsed = elapsed_timer.Elapsed();
+
+  const size_t num_sniffs = kMeasuredIterations * contents.size();
+  perf_test::PerfResultReporter reporter("MimeSniffer.", "ResponsePrefixes");
+  reporter.RegisterImportantMetric("time_per_sniff", "us");
+  reporter.RegisterImportantMetric("throughput",
+                                   "bytesPerSecond_biggerIsBetter");
+  reporter.AddResult("time_per_sniff", elapsed.InMicrosecondsF() / num_sniffs);
+  reporter.AddResult("throughput", static_cast<double>(num_sniffs) *
+                                       kMaxBytesToSniff /
+                                       elapsed.InSecondsF());
+}
+
 }  // namespace
 }  // namespace net
@@ -519,6 +519,101 @@ TEST(MimeSnifferTest, ImageTest) {
   mime_type.clear();
 }
 
+// The magic number tables are matched through an index of the candidate
+// entries for each content byte, which must pick the same entry as a linear
+// scan of the table. In builds with DCHECKs, every lookup verifies that against
+// the linear scan, so this sniffs variations of the magic numbers that stress
+// the index: case changes, changed and truncated bytes, and masked bytes.
+TEST(MimeSnifferTest, IndexedMagicNumbers) {
+  const struct {
+    const char* url;
+    const char* type_hint;
+    std::string content;
+    const char* expected_mime_type;
+  } kTestCases[] = {
+      {"http://www.example.com/", "", "<!DOCTYPE html>", "text/html"},
+      {"http://www.example.com/", "", "<!doctype HTML>", "text/html"},
+      {"http://www.example.com/", "", "<!DOCTYPE svg>", "text/plain"},
+      {"http://www.example.com/", "", " \n<bR>", "text/html"},
+      {"http://www.example.com/", "", "<BUTTON>", "text/html"},
+      {"http://www.example.com/", "", "<Body>", "text/html"},
+      {"http://www.example.com/", "", "<?XML", "text/plain"},
+      {"http://www.example.com/", "", "<?xml", "text/xml"},
+      {"http://www.example.com/", "", "<", "text/plain"},
+      {"http://www.example.com/", "", "<x", "text/plain"},
+      {"http://www.example.com/", "", "GIF87a", "image/gif"},
+      {"http://www.example.com/", "", "GIF88a", "text/plain"},
+      {"http://www.example.com/", "", "gif87a", "text/plain"},
+      {"http://www.example.com/", "", MakeConstantString("MM\x00*"),
+       "image/tiff"},
+      {"http://www.example.com/", "", "MM\x01*", "application/octet-stream"},
+      {"http://www.example.com/", "", "MZ", "application/octet-stream"},
+      {"http://www.example.com/", "", "RIFF\x01\x02\x03\x04WEBPVP8",
+       "image/webp"},
+      {"http://www.example.com/", "", "RIFF\x01\x02\x03\x04WAVEfmt ",
+       "application/octet-stream"},
+      {"http://www.example.com/", "text/plain", "%!PS-Adobe-3.0",
+       "text/plain"},
+      {"http://www.example.com/", "", "%!PS-Adobe-3.0",
+       "application/postscript"},
+      {"http://www.example.com/", "", "%!PS", "text/plain"},
+  };
+  for (const auto& test_case : kTestCases) {
+    EXPECT_EQ(test_case.expected_mime_type,
+              SniffMimeType(test_case.content, test_case.url,
+                            test_case.type_hint))
+        << test_case.content;
+  }
+
+  const struct {
+    std::string content;
+    const char* expected_mime_type;
+  } kLocalDataTestCases[] = {
+      // Only the upper bits are compared after the first byte.
+      {"\xFF\xE0", "audio/mpeg"},
+      {"\xFF\xFB", "audio/mpeg"},
+      {"\xFF\xD8\xFF", "image/jpeg"},
+      {MakeConstantString("\x00\x00\x01\xB3"), "video/mpeg"},
+      {MakeConstantString("\x00\x00\x01\x00"), "image/x-icon"},
+      // The leading bytes of these aren't compared.
+      {"\x01\x02\x03\x04"
+       "ftyp3g",
+       "video/3gpp"},
+      {"abcdftypisom", "video/mp4"},
+      {"abcdmoov", "video/quicktime"},
+      // Entries of both tables start with "#!", "II" and "MM".
+      {"#!AMR\n", "audio/amr"},
+      {"#!/bin/sh", "text/plain"},
+      {MakeConstantString("II\x2a\x00\x10\x00\x00\x00CR"),
+       "image/x-canon-cr2"},
+      {"II*", "image/tiff"},
+      {"MMMMRaw", "image/x-phaseone-raw"},
+      {"MMOR", "image/x-olympus-orf"},
+  };
+  for (const auto& test_case : kLocalDataTestCases) {
+    std::string mime_type;
+    EXPECT_TRUE(SniffMimeTypeFromLocalData(test_case.content, &mime_type));
+    EXPECT_EQ(test_case.expected_mime_type, mime_type);
+  }
+
+  std::string mime_type;
+  EXPECT_FALSE(SniffMimeTypeFromLocalData("", &mime_type));
+  EXPECT_FALSE(SniffMimeTypeFromLocalData("\xFF\xC0", &mime_type));
+}
+
+// LooksLikeBinary() skips over text a word at a time, so check that it finds
+// binary looking bytes at every offset in a word, and in the trailing bytes.
+TEST(MimeSnifferTest, LooksLikeBinaryAtEveryOffset) {
+  const std::string kText = "Lorem ipsum\r\n\tdolor\x1b sit amet,\x0c";
+  EXPECT_FALSE(LooksLikeBinary(kText));
+  for (size_t i = 0; i < kText.size(); ++i) {
+    std::string content = kText;
+    content[i] = '\x01';
+    EXPECT_TRUE(LooksLikeBinary(content)) << i;
+    EXPECT_FALSE(LooksLikeBinary(base::StringPiece(content).substr(i + 1)));
+  }
+}
+
 // The tests need char parameters, but the ranges to test include 0xFF, and some
 // platforms have signed chars and are noisy about it. Using an int parameter
 // and casting it to char inside the test case solves both these problems.
@@ -4,12 +4,133 @@
 
 #include "net/base/prioritized_dispatcher.h"
 
+#include <stdint.h>
+
+#include <algorithm>
+#include <map>
 #include <ostream>
+#include <utility>
 
 #include "base/check_op.h"
 
 namespace net {
 
+// Start order of the queued jobs in weighted-fair mode, and whose turn it is.
+//
+// Within a priority, each job gets a start tag one past the later of the tag of
+// the last job started at that priority and the tag of the previous job of its
+// partition. Jobs are started in tag order, which serves partitions with
+// queued jobs round-robin, and lets a partition that was idle start right away.
+class PrioritizedDispatcher::WeightedFairQueue {
+ public:
+  explicit WeightedFairQueue(std::vector<size_t> weights)
+      : weights_(std::move(weights)),
+        levels_(weights_.size()),
+        current_priority_(static_cast<Priority>(weights_.size() - 1)),
+        quantum_(weights_.back()) {}
+
+  WeightedFairQueue(const WeightedFairQueue&) = delete;
+  WeightedFairQueue& operator=(const WeightedFairQueue&) = delete;
+
+  ~WeightedFairQueue() = default;
+
+  // The priority whose turn it is, and whether it may start another job
+  // during this turn.
+  Priority current_priority() const { return current_priority_; }
+  bool has_quantum() const { return quantum_ > 0; }
+
+  void ConsumeQuantum() {
+    DCHECK_GT(quantum_, 0u);
+    --quantum_;
+  }
+
+  // Passes the turn to the next lower priority, or from the lowest back to the
+  // highest one.
+  void NextTurn() {
+    current_priority_ = current_priority_ == 0
+                            ? static_cast<Priority>(levels_.size() - 1)
+                            : current_priority_ - 1;
+    quantum_ = weights_[current_priority_];
+  }
+
+  void Insert(const Handle& handle,
+              const NetworkIsolationKey& partition,
+              bool at_head) {
+    Level& level = levels_[handle.priority()];
+    PartitionState& state = level.partitions[partition];
+    ++state.num_queued;
+
+    Entry entry;
+    if (at_head) {
+      // Take the lowest tag in use, so that the job is started before all
+      // others. This does not count against the turns of |partition|.
+      uint64_t tag = level.jobs.empty() ? level.virtual_time
+                                        : level.jobs.begin()->first;
+      entry.position = level.jobs.emplace_hint(level.jobs.begin(), tag, handle);
+    } else {
+      state.last_tag = std::max(state.last_tag, level.virtual_time) + 1;
+      entry.position = level.jobs.emplace(state.last_tag, handle);
+    }
+    entry.partition = partition;
+    bool inserted = entries_.emplace(handle.value(), std::move(entry)).second;
+    DCHECK(inserted) << "Job is already queued.";
+  }
+
+  NetworkIsolationKey Erase(const Handle& handle, bool started) {
+    auto it = entries_.find(handle.value());
+    DCHECK(it != entries_.end());
+    Level& level = levels_[handle.priority()];
+    if (started) {
+      level.virtual_time =
+          std::max(level.virtual_time, it->second.position->first);
+    }
+    level.jobs.erase(it->second.position);
+
+    NetworkIsolationKey partition = std::move(it->second.partition);
+    entries_.erase(it);
+    auto partition_it = level.partitions.find(partition);
+    DCHECK(partition_it != level.partitions.end());
+    if (--partition_it->second.num_queued == 0)
+      level.partitions.erase(partition_it);
+    return partition;
+  }
+
+  // Returns the next job to start at |priority|, or a null handle if there is
+  // none.
+  Handle Front(Priority priority) const {
+    const Level& level = levels_[priority];
+    return level.jobs.empty() ? Handle() : level.jobs.begin()->second;
+  }
+
+ private:
+  struct PartitionState {
+    // Start tag of the last job of the partition added to the queue.
+    uint64_t last_tag = 0;
+    size_t num_queued = 0;
+  };
+
+  struct Level {
+    // Queued jobs by start tag. Jobs with equal tags are in insertion order.
+    std::multimap<uint64_t, Handle> jobs;
+    // Partitions with queued jobs.
+    std::map<NetworkIsolationKey, PartitionState> partitions;
+    // Start tag of the last job started.
+    uint64_t virtual_time = 0;
+  };
+
+  struct Entry {
+    NetworkIsolationKey partition;
+    std::multimap<uint64_t, Handle>::iterator position;
+  };
+
+  const std::vector<size_t> weights_;
+  std::vector<Level> levels_;
+  std::map<const Job*, Entry> entries_;
+
+  Priority current_priority_;
+  size_t quantum_;
+};
+
 PrioritizedDispatcher::Limits::Limits(Priority num_priorities,
                                       size_t total_jobs)
     : total_jobs(total_jobs), reserved_slots(num_priorities) {}
@@ -24,10 +145,32 @@ PrioritizedDispatcher::PrioritizedDispatcher(const Limits& limits)
   SetLimits(limits);
 }
 
+PrioritizedDispatcher::PrioritizedDispatcher(
+    const Limits& limits,
+    std::vector<size_t> priority_weights)
+    : queue_(limits.reserved_slots.size()),
+      max_running_jobs_(limits.reserved_slots.size()) {
+  DCHECK_EQ(limits.reserved_slots.size(), priority_weights.size());
+  DCHECK(!priority_weights.empty());
+  DCHECK(std::find(priority_weights.begin(), priority_weights.end(), 0u) ==
+         priority_weights.end())
+      << "Every priority needs a non-zero weight.";
+  fair_queue_ =
+      std::make_unique<WeightedFairQueue>(std::move(priority_weights));
+  SetLimits(limits);
+}
+
 PrioritizedDispatcher::~PrioritizedDispatcher() = default;
 
 PrioritizedDispatcher::Handle PrioritizedDispatcher::Add(
     Job* job, Priority priority) {
+  return Add(job, priority, NetworkIsolationKey());
+}
+
+PrioritizedDispatcher::Handle PrioritizedDispatcher::Add(
+    Job* job,
+    Priority priority,
+    const NetworkIsolationKey& partition) {
   DCHECK(job);
   DCHECK_LT(priority, num_priorities());
   if (num_running_jobs_ < max_running_jobs_[priority]) {
@@ -35,7 +178,7 @@ PrioritizedDispatcher::Handle PrioritizedDispatcher::Add(
     job->Start();
     return Handle();
   }
-  return queue_.Insert(job, priority);
+  return InsertInQueue(job, priority, partition, /*at_head=*/false);
 }
 
 PrioritizedDispatcher::Handle PrioritizedDispatcher::AddAtHead(
@@ -47,11 +190,11 @@ PrioritizedDispatcher::Handle PrioritizedDispatcher::AddAtHead(
     job->Start();
     return Handle();
   }
-  return queue_.InsertAtFront(job, priority);
+  return InsertInQueue(job, priority, NetworkIsolationKey(), /*at_head=*/true);
 }
 
 void PrioritizedDispatcher::Cancel(const Handle& handle) {
-  queue_.Erase(handle);
+  RemoveFromQueue(handle, /*started=*/false);
 }
 
 PrioritizedDispatcher::Job* PrioritizedDispatcher::EvictOldestLowest() {
@@ -76,8 +219,8 @@ PrioritizedDispatcher::Handle PrioritizedDispatcher::ChangePriority(
   if (MaybeDispatchJob(handle, priority))
     return Handle();
   Job* job = handle.value();
-  queue_.Erase(handle);
-  return queue_.Insert(job, priority);
+  NetworkIsolationKey partition = RemoveFromQueue(handle, /*started=*/false);
+  return InsertInQueue(job, priority, partition, /*at_head=*/false);
 }
 
 void PrioritizedDispatcher::OnJobFinished() {
@@ -124,19 +267,44 @@ void PrioritizedDispatcher::SetLimitsToZero() {
   SetLimits(Limits(queue_.num_priorities(), 0));
 }
 
+PrioritizedDispatcher::Handle PrioritizedDispatcher::InsertInQueue(
+    Job* job,
+    Priority priority,
+    const NetworkIsolationKey& partition,
+    bool at_head) {
+  Handle handle = at_head ? queue_.InsertAtFront(job, priority)
+                          : queue_.Insert(job, priority);
+  if (fair_queue_)
+    fair_queue_->Insert(handle, partition, at_head);
+  return handle;
+}
+
+NetworkIsolationKey PrioritizedDispatcher::RemoveFromQueue(
+    const Handle& handle,
+    bool started) {
+  NetworkIsolationKey partition;
+  if (fair_queue_)
+    partition = fair_queue_->Erase(handle, started);
+  queue_.Erase(handle);
+  return partition;
+}
+
 bool PrioritizedDispatcher::MaybeDispatchJob(const Handle& handle,
                                              Priority job_priority) {
   DCHECK_LT(job_priority, num_priorities());
   if (num_running_jobs_ >= max_running_jobs_[job_priority])
     return false;
   Job* job = handle.value();
-  queue_.Erase(handle);
+  RemoveFromQueue(handle, /*started=*/true);
   ++num_running_jobs_;
   job->Start();
   return true;
 }
 
 bool PrioritizedDispatcher::MaybeDispatchNextJob() {
+  if (fair_queue_)
+    return MaybeDispatchNextFairJob();
+
   Handle handle = queue_.FirstMax();
   if (handle.is_null()) {
     DCHECK_EQ(0u, queue_.size());
@@ -145,4 +313,27 @@ bool PrioritizedDispatcher::MaybeDispatchNextJob() {
   return MaybeDispatchJob(handle, handle.priority());
 }
 
+bool PrioritizedDispatcher::MaybeDispatchNextFairJob() {
+  if (queue_.empty())
+    return false;
+
+  // Visiting every priority once after the current one is enough to find a
+  // job that can start, if there is any.
+  for (size_t i = 0; i <= num_priorities(); ++i) {
+    Priority priority = fair_queue_->current_priority();
+    if (fair_queue_->has_quantum() &&
+        num_running_jobs_ < max_running_jobs_[priority]) {
+      Handle handle = fair_queue_->Front(priority);
+      if (!handle.is_null()) {
+        // Update the turn before starting the job, which may re-enter or
+        // delete |this|.
+        fair_queue_->ConsumeQuantum();
+        return MaybeDispatchJob(handle, priority);
+      }
+    }
+    fair_queue_->NextTurn();
+  }
+  return false;
+}
+
 }  // namespace net
@@ -7,22 +7,31 @@
 
 #include <stddef.h>
 
+#include <memory>
 #include <vector>
 
 #include "net/base/net_export.h"
+#include "net/base/network_isolation_key.h"
 #include "net/base/priority_queue.h"
 
 namespace net {
 
-// A priority-based dispatcher of jobs. Dispatch order is by priority (highest
-// first) and then FIFO. The dispatcher enforces limits on the number of running
-// jobs. It never revokes a job once started. The job must call OnJobFinished
-// once it finishes in order to dispatch further jobs.
+// A priority-based dispatcher of jobs. By default, dispatch order is by priority
+// (highest first) and then FIFO. The dispatcher enforces limits on the number
+// of running jobs. It never revokes a job once started. The job must call
+// OnJobFinished once it finishes in order to dispatch further jobs.
+//
+// In weighted-fair mode, queued jobs are instead started in turns: priorities
+// take turns from highest to lowest, and each turn starts up to the weight of
+// that priority in jobs. This bounds the share of slots a sustained stream of
+// high priority jobs can take from lower priorities. Within a priority, jobs
+// are started round-robin across the partitions (NetworkIsolationKeys) passed
+// to Add(), and FIFO within a partition. Limits are enforced in both modes.
 //
 // This class is NOT thread-safe which is enforced by the underlying
 // non-thread-safe PriorityQueue. All operations are O(p) time for p priority
-// levels. It is safe to execute any method, including destructor, from within
-// Job::Start.
+// levels, plus O(log n) for n queued jobs in weighted-fair mode. It is safe to
+// execute any method, including destructor, from within Job::Start.
 //
 class NET_EXPORT_PRIVATE PrioritizedDispatcher {
  public:
@@ -69,6 +78,12 @@ class NET_EXPORT_PRIVATE PrioritizedDispatcher {
   // Creates a dispatcher enforcing |limits| on number of running jobs.
   explicit PrioritizedDispatcher(const Limits& limits);
 
+  // Creates a dispatcher in weighted-fair mode. |priority_weights| holds the
+  // number of jobs each priority may start per turn, and must have one
+  // non-zero entry per priority in |limits|.
+  PrioritizedDispatcher(const Limits& limits,
+                        std::vector<size_t> priority_weights);
+
   PrioritizedDispatcher(const PrioritizedDispatcher&) = delete;
   PrioritizedDispatcher& operator=(const PrioritizedDispatcher&) = delete;
   ~PrioritizedDispatcher();
@@ -76,6 +91,7 @@ class NET_EXPORT_PRIVATE PrioritizedDispatcher {
   size_t num_running_jobs() const { return num_running_jobs_; }
   size_t num_queued_jobs() const { return queue_.size(); }
   size_t num_priorities() const { return max_running_jobs_.size(); }
+  bool is_weighted_fair() const { return !!fair_queue_; }
 
   // Adds |job| with |priority| to the dispatcher. If limits permit, |job| is
   // started immediately. Returns handle to the job or null-handle if the job is
@@ -83,6 +99,13 @@ class NET_EXPORT_PRIVATE PrioritizedDispatcher {
   // it is queued in the dispatcher.
   Handle Add(Job* job, Priority priority);
 
+  // Just like Add, except that in weighted-fair mode |job| shares its
+  // priority's turns with the other jobs of |partition|. In strict priority
+  // mode, |partition| is ignored.
+  Handle Add(Job* job,
+             Priority priority,
+             const NetworkIsolationKey& partition);
+
   // Just like Add, except that it adds Job at the font of queue of jobs with
   // priorities of |priority|.
   Handle AddAtHead(Job* job, Priority priority);
@@ -117,6 +140,19 @@ class NET_EXPORT_PRIVATE PrioritizedDispatcher {
   void SetLimitsToZero();
 
  private:
+  class WeightedFairQueue;
+
+  // Inserts |job| into the queue, and into |fair_queue_| if there is one.
+  Handle InsertInQueue(Job* job,
+                       Priority priority,
+                       const NetworkIsolationKey& partition,
+                       bool at_head);
+
+  // Removes the job with |handle| from the queue, and from |fair_queue_| if
+  // there is one. |started| is true if it is removed to be started. Returns
+  // the partition the job was added with.
+  NetworkIsolationKey RemoveFromQueue(const Handle& handle, bool started);
+
   // Attempts to dispatch the job with |handle| at priority |priority| (might be
   // different than |handle.priority()|. Returns true if successful. If so
   // the |handle| becomes invalid.
@@ -126,6 +162,9 @@ class NET_EXPORT_PRIVATE PrioritizedDispatcher {
   // true if successful, and all handles to that job become invalid.
   bool MaybeDispatchNextJob();
 
+  // Like MaybeDispatchNextJob(), but picks the job in weighted-fair order.
+  bool MaybeDispatchNextFairJob();
+
   // Queue for jobs that need to wait for a spare slot.
   PriorityQueue<Job*> queue_;
   // Maximum total number of running jobs allowed after a job at a particular
@@ -134,6 +173,9 @@ class NET_EXPORT_PRIVATE PrioritizedDispatcher {
   std::vector<size_t> max_running_jobs_;
   // Total number of running jobs.
   size_t num_running_jobs_ = 0;
+  // Dispatch order of the queued jobs in weighted-fair mode. Null in strict
+  // priority mode.
+  std::unique_ptr<WeightedFairQueue> fair_queue_;
 };
 
 }  // namespace net
@@ -0,0 +1,215 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/prioritized_dispatcher.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "base/check_op.h"
+#include "base/memory/raw_ptr.h"
+#include "base/strings/string_number_conversions.h"
+#include "net/base/network_isolation_key.h"
+#include "net/base/request_priority.h"
+#include "net/base/schemeful_site.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "url/gurl.h"
+
+namespace net {
+
+namespace {
+
+// The simulated workload: a steady stream of HIGHEST jobs, some MEDIUM jobs,
+// and LOWEST jobs arriving in bursts from a single partition, offered at about
+// 95% of capacity. Time is in simulated milliseconds.
+constexpr size_t kTotalJobs = 8;
+constexpr double kMeanServiceTime = 10;
+constexpr double kHighestRate = 0.5;
+constexpr double kMediumRate = 0.1;
+constexpr int kLowestBurstSize = 20;
+constexpr int64_t kLowestBurstInterval = 125;
+constexpr int64_t kSimulatedTime = 200000;
+constexpr int kNumPartitions = 4;
+
+const RequestPriority kReportedPriorities[] = {HIGHEST, MEDIUM, LOWEST};
+
+class Simulation {
+ public:
+  explicit Simulation(std::unique_ptr<PrioritizedDispatcher> dispatcher)
+      : dispatcher_(std::move(dispatcher)) {
+    for (int i = 0; i < kNumPartitions; ++i) {
+      SchemefulSite site(GURL("https://" + base::NumberToString(i) + ".test"));
+      partitions_.emplace_back(site, site);
+    }
+  }
+
+  // Runs the workload to completion, and returns the time each job spent
+  // queued, by priority.
+  std::vector<std::vector<int64_t>> Run() {
+    std::mt19937 rng(42);
+    std::exponential_distribution<double> service(1 / kMeanServiceTime);
+    std::uniform_int_distribution<int> partition(0, kNumPartitions - 1);
+    auto schedule_poisson = [&](RequestPriority priority, double rate) {
+      std::exponential_distribution<double> gap(rate);
+      for (double t = gap(rng); t < kSimulatedTime; t += gap(rng)) {
+        AddArrival(static_cast<int64_t>(t), priority, partition(rng),
+                   service(rng));
+      }
+    };
+    schedule_poisson(HIGHEST, kHighestRate);
+    schedule_poisson(MEDIUM, kMediumRate);
+    for (int64_t t = 0; t < kSimulatedTime; t += kLowestBurstInterval) {
+      for (int i = 0; i < kLowestBurstSize; ++i)
+        AddArrival(t, LOWEST, /*partition=*/0, service(rng));
+    }
+
+    while (!events_.empty()) {
+      Event event = events_.top();
+      events_.pop();
+      now_ = event.time;
+      if (event.job) {
+        event.job->Arrive();
+      } else {
+        dispatcher_->OnJobFinished();
+      }
+    }
+
+    std::vector<std::vector<int64_t>> waits(NUM_PRIORITIES);
+    for (const auto& job : jobs_) {
+      DCHECK_GE(job->start_time(), 0);
+      waits[job->priority()].push_back(job->start_time() - job->arrival_time());
+    }
+    return waits;
+  }
+
+ private:
+  class SimulatedJob : public PrioritizedDispatcher::Job {
+   public:
+    SimulatedJob(Simulation* simulation,
+                 int64_t arrival_time,
+                 RequestPriority priority,
+                 const NetworkIsolationKey& partition,
+                 int64_t service_time)
+        : simulation_(simulation),
+          arrival_time_(arrival_time),
+          priority_(priority),
+          partition_(partition),
+          service_time_(service_time) {}
+
+    int64_t arrival_time() const { return arrival_time_; }
+    int64_t start_time() const { return start_time_; }
+    RequestPriority priority() const { return priority_; }
+
+    void Arrive() {
+      simulation_->dispatcher_->Add(this, priority_, partition_);
+    }
+
+    // PrioritizedDispatcher::Job implementation:
+    void Start() override {
+      start_time_ = simulation_->now_;
+      simulation_->AddCompletion(start_time_ + service_time_);
+    }
+
+   private:
+    const raw_ptr<Simulation> simulation_;
+    const int64_t arrival_time_;
+    const RequestPriority priority_;
+    const NetworkIsolationKey partition_;
+    const int64_t service_time_;
+    int64_t start_time_ = -1;
+  };
+
+  // A job arrival if |job| is non-null, a job completion otherwise. Events at
+  // the same time are processed in the order they were added.
+  struct Event {
+    bool operator>(const Event& other) const {
+      return std::tie(time, sequence) > std::tie(other.time, other.sequence);
+    }
+
+    int64_t time;
+    uint64_t sequence;
+    SimulatedJob* job;
+  };
+
+  void AddArrival(int64_t time,
+                  RequestPriority priority,
+                  int partition,
+                  double service_time) {
+    jobs_.push_back(std::make_unique<SimulatedJob>(
+        this, time, priority, partitions_[partition],
+        std::max<int64_t>(1, static_cast<int64_t>(service_time))));
+    events_.push({time, next_sequence_++, jobs_.back().get()});
+  }
+
+  void AddCompletion(int64_t time) {
+    events_.push({time, next_sequence_++, nullptr});
+  }
+
+  std::unique_ptr<PrioritizedDispatcher> dispatcher_;
+  std::vector<NetworkIsolationKey> partitions_;
+  std::vector<std::unique_ptr<SimulatedJob>> jobs_;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+  uint64_t next_sequence_ = 0;
+  int64_t now_ = 0;
+};
+
+int64_t Percentile(const std::vector<int64_t>& sorted_values, double fraction) {
+  DCHECK(!sorted_values.empty());
+  size_t index = static_cast<size_t>(fraction * (sorted_values.size() - 1));
+  return sorted_values[index];
+}
+
+void RunSimulation(const std::string& story,
+                   std::unique_ptr<PrioritizedDispatcher> dispatcher) {
+  std::vector<std::vector<int64_t>> waits =
+      Simulation(std::move(dispatcher)).Run();
+
+  perf_test::PerfResultReporter reporter("PrioritizedDispatcher.", story);
+  for (RequestPriority priority : kReportedPriorities) {
+    std::vector<int64_t>& priority_waits = waits[priority];
+    ASSERT_FALSE(priority_waits.empty());
+    std::sort(priority_waits.begin(), priority_waits.end());
+    std::string name = RequestPriorityToString(priority);
+    reporter.RegisterImportantMetric("wait_p50_" + name, "ms");
+    reporter.RegisterImportantMetric("wait_p99_" + name, "ms");
+    reporter.RegisterImportantMetric("wait_max_" + name, "ms");
+    reporter.AddResult("wait_p50_" + name,
+                       static_cast<size_t>(Percentile(priority_waits, 0.5)));
+    reporter.AddResult("wait_p99_" + name,
+                       static_cast<size_t>(Percentile(priority_waits, 0.99)));
+    reporter.AddResult("wait_max_" + name,
+                       static_cast<size_t>(priority_waits.back()));
+  }
+}
+
+TEST(PrioritizedDispatcherPerfTest, StrictPriority) {
+  PrioritizedDispatcher::Limits limits(NUM_PRIORITIES, kTotalJobs);
+  RunSimulation("StrictPriority",
+                std::make_unique<PrioritizedDispatcher>(limits));
+}
+
+TEST(PrioritizedDispatcherPerfTest, WeightedFair) {
+  PrioritizedDispatcher::Limits limits(NUM_PRIORITIES, kTotalJobs);
+  std::vector<size_t> weights(NUM_PRIORITIES, 1);
+  weights[HIGHEST] = 8;
+  weights[MEDIUM] = 4;
+  weights[LOW] = 2;
+  RunSimulation("WeightedFair", std::make_unique<PrioritizedDispatcher>(
+                                    limits, std::move(weights)));
+}
+
+}  // namespace
+
+}  // namespace net
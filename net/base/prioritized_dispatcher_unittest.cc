@@ -8,13 +8,18 @@
 
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/check.h"
 #include "base/compiler_specific.h"
 #include "base/memory/raw_ptr.h"
 #include "base/test/gtest_util.h"
+#include "net/base/network_isolation_key.h"
 #include "net/base/request_priority.h"
+#include "net/base/schemeful_site.h"
 #include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
 
 namespace net {
 
@@ -51,6 +56,10 @@ class PrioritizedDispatcherTest : public testing::Test {
       return handle_;
     }
 
+    void set_partition(const NetworkIsolationKey& partition) {
+      partition_ = partition;
+    }
+
     void Add(bool at_head) {
       CHECK(handle_.is_null());
       CHECK(!running_);
@@ -58,7 +67,7 @@ class PrioritizedDispatcherTest : public testing::Test {
       size_t num_running = dispatcher_->num_running_jobs();
 
       if (!at_head) {
-        handle_ = dispatcher_->Add(this, priority_);
+        handle_ = dispatcher_->Add(this, priority_, partition_);
       } else {
         handle_ = dispatcher_->AddAtHead(this, priority_);
       }
@@ -128,6 +137,7 @@ class PrioritizedDispatcherTest : public testing::Test {
 
     char tag_;
     Priority priority_;
+    NetworkIsolationKey partition_;
 
     PrioritizedDispatcher::Handle handle_;
     bool running_ = false;
@@ -147,6 +157,23 @@ class PrioritizedDispatcherTest : public testing::Test {
     return job;
   }
 
+  void PrepareWeightedFair(const PrioritizedDispatcher::Limits& limits,
+                           std::vector<size_t> weights) {
+    dispatcher_ =
+        std::make_unique<PrioritizedDispatcher>(limits, std::move(weights));
+  }
+
+  std::unique_ptr<TestJob> AddJobToPartition(char data,
+                                             Priority priority,
+                                             const std::string& site) {
+    auto job =
+        std::make_unique<TestJob>(dispatcher_.get(), data, priority, &log_);
+    SchemefulSite schemeful_site(GURL("https://" + site));
+    job->set_partition(NetworkIsolationKey(schemeful_site, schemeful_site));
+    job->Add(false);
+    return job;
+  }
+
   std::unique_ptr<TestJob> AddJobAtHead(char data, Priority priority) {
     auto job =
         std::make_unique<TestJob>(dispatcher_.get(), data, priority, &log_);
@@ -528,6 +555,109 @@ TEST_F(PrioritizedDispatcherTest, ZeroLimitsThenIncreasePriority) {
   Expect("a.");
 }
 
+TEST_F(PrioritizedDispatcherTest, WeightedFairTurns) {
+  PrioritizedDispatcher::Limits limits(NUM_PRIORITIES, 1);
+  std::vector<size_t> weights(NUM_PRIORITIES, 1);
+  weights[HIGHEST] = 2;
+  PrepareWeightedFair(limits, weights);
+  EXPECT_TRUE(dispatcher_->is_weighted_fair());
+
+  std::unique_ptr<TestJob> job_a = AddJob('a', IDLE);
+  std::unique_ptr<TestJob> job_b = AddJob('b', HIGHEST);
+  std::unique_ptr<TestJob> job_c = AddJob('c', HIGHEST);
+  std::unique_ptr<TestJob> job_d = AddJob('d', HIGHEST);
+  std::unique_ptr<TestJob> job_e = AddJob('e', LOWEST);
+  std::unique_ptr<TestJob> job_f = AddJob('f', LOWEST);
+
+  // HIGHEST starts two jobs per turn, then LOWEST gets a turn.
+  ASSERT_TRUE(job_a->running());
+  job_a->Finish();
+  ASSERT_TRUE(job_b->running());
+  job_b->Finish();
+  ASSERT_TRUE(job_c->running());
+  job_c->Finish();
+  ASSERT_TRUE(job_e->running());
+  job_e->Finish();
+  ASSERT_TRUE(job_d->running());
+  job_d->Finish();
+  ASSERT_TRUE(job_f->running());
+  job_f->Finish();
+
+  Expect("a.b.c.e.d.f.");
+}
+
+TEST_F(PrioritizedDispatcherTest, WeightedFairPartitions) {
+  PrioritizedDispatcher::Limits limits(NUM_PRIORITIES, 1);
+  PrepareWeightedFair(limits, std::vector<size_t>(NUM_PRIORITIES, 1));
+
+  std::unique_ptr<TestJob> job_a = AddJob('a', LOW);
+  std::unique_ptr<TestJob> job_b = AddJobToPartition('b', LOW, "a.test");
+  std::unique_ptr<TestJob> job_c = AddJobToPartition('c', LOW, "a.test");
+  std::unique_ptr<TestJob> job_d = AddJobToPartition('d', LOW, "a.test");
+  std::unique_ptr<TestJob> job_e = AddJobToPartition('e', LOW, "b.test");
+  std::unique_ptr<TestJob> job_f = AddJobToPartition('f', LOW, "b.test");
+
+  // The partitions take turns; within one, jobs run in FIFO order.
+  ASSERT_TRUE(job_a->running());
+  job_a->Finish();
+  ASSERT_TRUE(job_b->running());
+  job_b->Finish();
+  ASSERT_TRUE(job_e->running());
+
+  // A partition that had nothing queued does not wait for the others to
+  // drain.
+  std::unique_ptr<TestJob> job_g = AddJobToPartition('g', LOW, "c.test");
+  job_e->Finish();
+  ASSERT_TRUE(job_c->running());
+  job_c->Finish();
+  ASSERT_TRUE(job_f->running());
+  job_f->Finish();
+  ASSERT_TRUE(job_g->running());
+  job_g->Finish();
+  ASSERT_TRUE(job_d->running());
+  job_d->Finish();
+
+  Expect("a.b.e.c.f.g.d.");
+}
+
+TEST_F(PrioritizedDispatcherTest, WeightedFairEnforcesLimits) {
+  // Reserve 1 slot for HIGHEST, which leaves 2 for lower priorities.
+  PrioritizedDispatcher::Limits limits(NUM_PRIORITIES, 3);
+  limits.reserved_slots[HIGHEST] = 1;
+  PrepareWeightedFair(limits, std::vector<size_t>(NUM_PRIORITIES, 1));
+
+  std::unique_ptr<TestJob> job_a = AddJob('a', LOW);
+  std::unique_ptr<TestJob> job_b = AddJob('b', LOW);
+  std::unique_ptr<TestJob> job_c = AddJob('c', LOW);
+  std::unique_ptr<TestJob> job_d = AddJob('d', HIGHEST);
+  std::unique_ptr<TestJob> job_e = AddJob('e', HIGHEST);
+  std::unique_ptr<TestJob> job_f = AddJobAtHead('f', LOW);
+  EXPECT_EQ(3u, dispatcher_->num_queued_jobs());
+
+  job_a->Finish();
+  ASSERT_TRUE(job_e->running());
+  // The freed slot is reserved for HIGHEST, so LOW can't use it on its turn.
+  job_d->Finish();
+  EXPECT_EQ(2u, dispatcher_->num_queued_jobs());
+  job_b->Finish();
+  ASSERT_TRUE(job_f->running());
+
+  // Queued jobs can change priority or be canceled. IDLE gets its turn even
+  // though LOW still has a queued job.
+  std::unique_ptr<TestJob> job_g = AddJob('g', LOW);
+  std::unique_ptr<TestJob> job_h = AddJob('h', LOW);
+  job_h->ChangePriority(IDLE);
+  job_g->Cancel();
+  job_f->Finish();
+  ASSERT_TRUE(job_h->running());
+  job_e->Finish();
+  ASSERT_TRUE(job_c->running());
+  job_h->Finish();
+  job_c->Finish();
+
+  Expect("abd.e..f.h.c..");
+}
+
 #if GTEST_HAS_DEATH_TEST
 TEST_F(PrioritizedDispatcherTest, CancelNull) {
   PrioritizedDispatcher::Limits limits(NUM_PRIORITIES, 1);
@@ -0,0 +1,247 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_BASE_SHARDED_EXPIRING_CACHE_H_
+#define NET_BASE_SHARDED_EXPIRING_CACHE_H_
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+#include "net/base/expiring_cache.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
+
+namespace net {
+
+// A variant of ExpiringCache that can be used from several threads at once.
+// Entries are spread over shards by the hash of their key. Each shard has its
+// own lock, hash table and expiration queue, so operations on different keys
+// rarely contend.
+//
+// The template parameters are those of ExpiringCache, with the same meaning,
+// plus |Hash|. KeyType must also be EqualityComparable and hashable by |Hash|.
+// Switching from ExpiringCache is a type change, with these differences:
+//  - Get() returns an absl::optional copy of the value rather than a pointer,
+//    which another thread could invalidate. Code that tests the result or
+//    dereferences it with * or -> compiles unchanged, but code that stores it
+//    in a |const ValueType*| has to hold the optional instead.
+//  - Each shard holds up to max_entries() / num_shards() entries, rounded up.
+//    When a shard is full, Put() evicts from the front of the shard's
+//    expiration queue, in the order entries were last Put(): first the expired
+//    ones, then the oldest ones, whether they expired or not. With a fixed
+//    time to live, this is the order in which entries expire. This makes
+//    eviction O(1) amortized instead of a scan of the whole cache. Expired
+//    entries behind a live one are removed when looked up, or once they reach
+//    the front.
+//  - EvictionHandler::Handle() is called after the shard's lock is released,
+//    under a lock of the cache's own, so calls never overlap and the handler
+//    needs no synchronization. It must not call back into the cache.
+//  - There is no Iterator.
+template <typename KeyType,
+          typename ValueType,
+          typename ExpirationType,
+          typename ExpirationCompare,
+          typename EvictionHandler =
+              NoopEvictionHandler<KeyType, ValueType, ExpirationType>,
+          typename Hash = std::hash<KeyType>>
+class ShardedExpiringCache {
+ public:
+  typedef KeyType key_type;
+  typedef ValueType value_type;
+  typedef ExpirationType expiration_type;
+
+  static constexpr size_t kDefaultNumShards = 16;
+
+  // Constructs a cache that stores about |max_entries| over |num_shards|
+  // shards. There are never more shards than entries.
+  explicit ShardedExpiringCache(size_t max_entries,
+                                size_t num_shards = kDefaultNumShards)
+      : max_entries_(max_entries),
+        shards_(std::clamp<size_t>(num_shards, 1,
+                                   std::max<size_t>(max_entries, 1))) {
+    size_t max_entries_per_shard =
+        (max_entries + shards_.size() - 1) / shards_.size();
+    for (Shard& shard : shards_)
+      shard.max_entries = max_entries_per_shard;
+  }
+
+  ShardedExpiringCache(const ShardedExpiringCache&) = delete;
+  ShardedExpiringCache& operator=(const ShardedExpiringCache&) = delete;
+
+  ~ShardedExpiringCache() = default;
+
+  // Returns the value matching |key|, which must be valid at the time |now|.
+  // Returns nullopt if the item is not found or has expired. If the item has
+  // expired, it is immediately removed from the cache.
+  absl::optional<ValueType> Get(const KeyType& key, const ExpirationType& now) {
+    Shard& shard = GetShard(key);
+    EvictedEntries evicted;
+    {
+      base::AutoLock lock(shard.lock);
+      auto it = shard.entries.find(key);
+      if (it == shard.entries.end())
+        return absl::nullopt;
+
+      if (expiration_comp_(now, it->second.expiration))
+        return it->second.value;
+
+      // Immediately remove expired entries.
+      Evict(shard, it, &evicted);
+    }
+    HandleEvictions(evicted, now, true);
+    return absl::nullopt;
+  }
+
+  // Updates or replaces the value associated with |key|, and moves it to the
+  // back of its shard's expiration queue.
+  void Put(const KeyType& key,
+           const ValueType& value,
+           const ExpirationType& now,
+           const ExpirationType& expiration) {
+    Shard& shard = GetShard(key);
+    EvictedEntries evicted;
+    {
+      base::AutoLock lock(shard.lock);
+      auto it = shard.entries.find(key);
+      if (it != shard.entries.end()) {
+        // Update an existing cache entry.
+        it->second.value = value;
+        it->second.expiration = expiration;
+        shard.queue.splice(shard.queue.end(), shard.queue,
+                           it->second.queue_position);
+        return;
+      }
+
+      // Make room for the new entry, expired entries first.
+      while (!shard.queue.empty() &&
+             (shard.entries.size() >= shard.max_entries ||
+              !expiration_comp_(now, GetFront(shard)->second.expiration))) {
+        Evict(shard, GetFront(shard), &evicted);
+      }
+
+      shard.queue.push_back(key);
+      shard.entries.emplace(
+          key, Entry{value, expiration, std::prev(shard.queue.end())});
+    }
+    HandleEvictions(evicted, now, false);
+  }
+
+  // Empties the cache.
+  void Clear() {
+    for (Shard& shard : shards_) {
+      base::AutoLock lock(shard.lock);
+      shard.entries.clear();
+      shard.queue.clear();
+    }
+  }
+
+  // Returns the number of entries in the cache. Entries may be added or
+  // removed by other threads while this runs.
+  size_t size() const {
+    size_t size = 0;
+    for (const Shard& shard : shards_) {
+      base::AutoLock lock(shard.lock);
+      size += shard.entries.size();
+    }
+    return size;
+  }
+
+  // Returns the maximum number of entries in the cache.
+  size_t max_entries() const { return max_entries_; }
+
+  size_t num_shards() const { return shards_.size(); }
+
+  bool empty() const { return size() == 0; }
+
+ private:
+  typedef std::list<KeyType> ExpirationQueue;
+
+  struct Entry {
+    ValueType value;
+    ExpirationType expiration;
+    typename ExpirationQueue::iterator queue_position;
+  };
+
+  typedef std::unordered_map<KeyType, Entry, Hash> EntryMap;
+
+  // Entries removed under a shard's lock, for the EvictionHandler to see once
+  // the lock is released.
+  struct EvictedEntry {
+    KeyType key;
+    ValueType value;
+    ExpirationType expiration;
+  };
+  typedef std::vector<EvictedEntry> EvictedEntries;
+
+  // Whether evicted entries need to be kept for the EvictionHandler at all.
+  static constexpr bool kHasEvictionHandler = !std::is_same<
+      EvictionHandler,
+      NoopEvictionHandler<KeyType, ValueType, ExpirationType>>::value;
+
+  struct Shard {
+    mutable base::Lock lock;
+    EntryMap entries GUARDED_BY(lock);
+    // Keys in the order they were last Put(), oldest first.
+    ExpirationQueue queue GUARDED_BY(lock);
+    size_t max_entries = 0;
+  };
+
+  Shard& GetShard(const KeyType& key) {
+    return shards_[hash_(key) % shards_.size()];
+  }
+
+  typename EntryMap::iterator GetFront(Shard& shard)
+      EXCLUSIVE_LOCKS_REQUIRED(shard.lock) {
+    return shard.entries.find(shard.queue.front());
+  }
+
+  // Removes |it| from |shard|, and appends it to |evicted| if there is an
+  // EvictionHandler to pass it to.
+  void Evict(Shard& shard,
+             typename EntryMap::iterator it,
+             EvictedEntries* evicted) EXCLUSIVE_LOCKS_REQUIRED(shard.lock) {
+    if (kHasEvictionHandler) {
+      evicted->push_back(EvictedEntry{it->first, std::move(it->second.value),
+                                      it->second.expiration});
+    }
+    shard.queue.erase(it->second.queue_position);
+    shard.entries.erase(it);
+  }
+
+  // Passes |evicted| to the EvictionHandler. Must be called without any shard
+  // lock held.
+  void HandleEvictions(const EvictedEntries& evicted,
+                       const ExpirationType& now,
+                       bool on_get) {
+    if (evicted.empty())
+      return;
+    base::AutoLock lock(eviction_handler_lock_);
+    for (const EvictedEntry& entry : evicted) {
+      eviction_handler_.Handle(entry.key, entry.value, entry.expiration, now,
+                               on_get);
+    }
+  }
+
+  // Bound on total size of the cache.
+  const size_t max_entries_;
+
+  std::vector<Shard> shards_;
+  Hash hash_;
+  ExpirationCompare expiration_comp_;
+  // Serializes calls to |eviction_handler_| from different shards.
+  base::Lock eviction_handler_lock_;
+  EvictionHandler eviction_handler_ GUARDED_BY(eviction_handler_lock_);
+};
+
+}  // namespace net
+
+#endif  // NET_BASE_SHARDED_EXPIRING_CACHE_H_
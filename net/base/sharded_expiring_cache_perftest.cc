@@ -0,0 +1,150 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/sharded_expiring_cache.h"
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/memory/raw_ptr.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+#include "base/threading/simple_thread.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "net/base/expiring_cache.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace net {
+
+namespace {
+
+// Each thread does kOperationsPerThread lookups on kNumKeys keys, and Put()s
+// the entry back when it is missing. Every kPutInterval-th operation is an
+// unconditional Put(), so about 5% of the operations write.
+constexpr size_t kMaxEntries = 1024;
+constexpr int kNumKeys = 2048;
+constexpr int kOperationsPerThread = 200000;
+constexpr int kPutInterval = 20;
+constexpr base::TimeDelta kTTL = base::Seconds(60);
+
+const int kThreadCounts[] = {1, 2, 4, 8, 16};
+
+// An ExpiringCache behind a single lock, which is what callers on several
+// threads have to do today.
+class LockedExpiringCache {
+ public:
+  typedef ExpiringCache<std::string, int, base::TimeTicks, std::less<>> Cache;
+
+  LockedExpiringCache() : cache_(kMaxEntries) {}
+
+  bool Get(const std::string& key, base::TimeTicks now) {
+    base::AutoLock lock(lock_);
+    return cache_.Get(key, now) != nullptr;
+  }
+
+  void Put(const std::string& key,
+           int value,
+           base::TimeTicks now,
+           base::TimeTicks expiration) {
+    base::AutoLock lock(lock_);
+    cache_.Put(key, value, now, expiration);
+  }
+
+ private:
+  base::Lock lock_;
+  Cache cache_ GUARDED_BY(lock_);
+};
+
+typedef ShardedExpiringCache<std::string, int, base::TimeTicks, std::less<>>
+    ShardedCache;
+
+// Gives ShardedExpiringCache the same interface as LockedExpiringCache.
+class ShardedCacheWrapper : public ShardedCache {
+ public:
+  ShardedCacheWrapper() : ShardedCache(kMaxEntries) {}
+
+  bool Get(const std::string& key, base::TimeTicks now) {
+    return ShardedCache::Get(key, now).has_value();
+  }
+};
+
+template <typename CacheType>
+class Worker : public base::DelegateSimpleThread::Delegate {
+ public:
+  Worker(CacheType* cache, const std::vector<std::string>* keys, int id)
+      : cache_(cache), keys_(keys), id_(id) {}
+
+  void Run() override {
+    base::TimeTicks now = base::TimeTicks::Now();
+    // Each thread walks the keys with a different stride, so that threads
+    // do not move in lockstep.
+    size_t stride = 2 * id_ + 1;
+    size_t index = id_;
+    for (int i = 0; i < kOperationsPerThread; ++i) {
+      index = (index + stride) % keys_->size();
+      const std::string& key = (*keys_)[index];
+      if (i % kPutInterval == 0 || !cache_->Get(key, now))
+        cache_->Put(key, i, now, now + kTTL);
+    }
+  }
+
+ private:
+  const raw_ptr<CacheType> cache_;
+  const raw_ptr<const std::vector<std::string>> keys_;
+  const int id_;
+};
+
+template <typename CacheType>
+void RunContentionTest(const std::string& story) {
+  std::vector<std::string> keys;
+  for (int i = 0; i < kNumKeys; ++i)
+    keys.push_back("https://host" + base::NumberToString(i) + ".test/");
+
+  perf_test::PerfResultReporter reporter("ShardedExpiringCache.", story);
+  for (int num_threads : kThreadCounts) {
+    std::string metric = "throughput_" + base::NumberToString(num_threads) +
+                         (num_threads == 1 ? "_thread" : "_threads");
+    reporter.RegisterImportantMetric(metric, "ops/ms");
+
+    CacheType cache;
+    std::vector<std::unique_ptr<Worker<CacheType>>> workers;
+    std::vector<std::unique_ptr<base::DelegateSimpleThread>> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      workers.push_back(std::make_unique<Worker<CacheType>>(&cache, &keys, i));
+      threads.push_back(std::make_unique<base::DelegateSimpleThread>(
+          workers.back().get(), "ShardedExpiringCachePerfTest"));
+    }
+
+    base::ElapsedTimer timer;
+    for (auto& thread : threads)
+      thread->Start();
+    for (auto& thread : threads)
+      thread->Join();
+    double elapsed_ms = timer.Elapsed().InMillisecondsF();
+
+    reporter.AddResult(
+        metric, static_cast<size_t>(num_threads * kOperationsPerThread /
+                                    std::max(elapsed_ms, 1.0)));
+  }
+}
+
+TEST(ShardedExpiringCachePerfTest, LockedExpiringCache) {
+  RunContentionTest<LockedExpiringCache>("LockedExpiringCache");
+}
+
+TEST(ShardedExpiringCachePerfTest, ShardedExpiringCache) {
+  RunContentionTest<ShardedCacheWrapper>("ShardedExpiringCache");
+}
+
+}  // namespace
+
+}  // namespace net
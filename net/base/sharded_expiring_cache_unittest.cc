@@ -0,0 +1,292 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/sharded_expiring_cache.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/memory/raw_ptr.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "base/threading/simple_thread.h"
+#include "base/time/time.h"
+#include "testing/gmock/include/gmock/gmock.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using testing::Optional;
+
+namespace net {
+
+namespace {
+
+const int kMaxCacheEntries = 10;
+const base::TimeDelta kTTL = base::Seconds(10);
+
+typedef ShardedExpiringCache<std::string,
+                             std::string,
+                             base::TimeTicks,
+                             std::less<>>
+    Cache;
+
+struct TestFunctor {
+  bool operator()(const std::string& now,
+                  const std::string& expiration) const {
+    return now != expiration;
+  }
+};
+
+// Counts the evictions of all caches using it.
+struct CountingEvictionHandler {
+  void Handle(const std::string& key,
+              const std::string& value,
+              const std::string& expiration,
+              const std::string& now,
+              bool on_get) const {
+    ++(on_get ? evictions_on_get : evictions_on_put);
+  }
+
+  static int evictions_on_get;
+  static int evictions_on_put;
+};
+
+int CountingEvictionHandler::evictions_on_get = 0;
+int CountingEvictionHandler::evictions_on_put = 0;
+
+TEST(ShardedExpiringCacheTest, Basic) {
+  Cache cache(kMaxCacheEntries, /*num_shards=*/2);
+
+  // Start at t=0.
+  base::TimeTicks now;
+  EXPECT_TRUE(cache.empty());
+
+  // Add an entry at t=0
+  EXPECT_FALSE(cache.Get("entry1", now));
+  cache.Put("entry1", "test1", now, now + kTTL);
+  EXPECT_THAT(cache.Get("entry1", now), Optional(std::string("test1")));
+  EXPECT_EQ(1U, cache.size());
+
+  // Add an entry at t=5.
+  now += base::Seconds(5);
+  cache.Put("entry2", "test2", now, now + kTTL);
+  EXPECT_THAT(cache.Get("entry2", now), Optional(std::string("test2")));
+  EXPECT_EQ(2U, cache.size());
+
+  // Advance to t=10; entry1 is now expired, and removed.
+  now += base::Seconds(5);
+  EXPECT_FALSE(cache.Get("entry1", now));
+  EXPECT_THAT(cache.Get("entry2", now), Optional(std::string("test2")));
+  EXPECT_EQ(1U, cache.size());
+
+  // Update entry2 so that it outlives its original expiration.
+  cache.Put("entry2", "test3", now, now + kTTL);
+  now += base::Seconds(5);
+  EXPECT_THAT(cache.Get("entry2", now), Optional(std::string("test3")));
+  EXPECT_EQ(1U, cache.size());
+}
+
+TEST(ShardedExpiringCacheTest, EvictsOldest) {
+  Cache cache(3, /*num_shards=*/1);
+
+  // t=10
+  base::TimeTicks now = base::TimeTicks() + kTTL;
+
+  cache.Put("test1", "test1", now, now + kTTL);
+  cache.Put("expired", "expired", now - kTTL, now);
+  cache.Put("test2", "test2", now, now + kTTL);
+  EXPECT_EQ(3U, cache.size());
+
+  // The cache is full, so the oldest entry goes, and so does the expired entry
+  // behind it.
+  cache.Put("test3", "test3", now, now + kTTL);
+  EXPECT_EQ(2U, cache.size());
+  EXPECT_FALSE(cache.Get("test1", now));
+  EXPECT_FALSE(cache.Get("expired", now));
+  EXPECT_THAT(cache.Get("test2", now), Optional(std::string("test2")));
+  EXPECT_THAT(cache.Get("test3", now), Optional(std::string("test3")));
+}
+
+TEST(ShardedExpiringCacheTest, PutMovesToBack) {
+  Cache cache(3, /*num_shards=*/1);
+  base::TimeTicks now;
+
+  cache.Put("test1", "test1", now, now + kTTL);
+  cache.Put("test2", "test2", now, now + kTTL);
+  cache.Put("test3", "test3", now, now + kTTL);
+
+  // Updating "test1" makes "test2" the oldest entry.
+  cache.Put("test1", "updated", now, now + kTTL);
+  cache.Put("test4", "test4", now, now + kTTL);
+
+  EXPECT_THAT(cache.Get("test1", now), Optional(std::string("updated")));
+  EXPECT_FALSE(cache.Get("test2", now));
+  EXPECT_THAT(cache.Get("test3", now), Optional(std::string("test3")));
+  EXPECT_THAT(cache.Get("test4", now), Optional(std::string("test4")));
+}
+
+TEST(ShardedExpiringCacheTest, ExpiredEntriesLeaveOnPut) {
+  Cache cache(kMaxCacheEntries, /*num_shards=*/1);
+  base::TimeTicks now;
+
+  for (int i = 0; i < 5; ++i)
+    cache.Put(base::StringPrintf("old%d", i), "old", now, now + kTTL);
+  EXPECT_EQ(5U, cache.size());
+
+  // Adding an entry after the others expired removes them, although the
+  // cache is not full.
+  now += kTTL;
+  cache.Put("new", "new", now, now + kTTL);
+  EXPECT_EQ(1U, cache.size());
+}
+
+TEST(ShardedExpiringCacheTest, Clear) {
+  Cache cache(kMaxCacheEntries, /*num_shards=*/2);
+  base::TimeTicks now;
+
+  cache.Put("test1", "foo", now, now + kTTL);
+  cache.Put("test2", "foo", now, now + kTTL);
+  cache.Put("test3", "foo", now, now + kTTL);
+  EXPECT_EQ(3U, cache.size());
+
+  cache.Clear();
+  EXPECT_EQ(0U, cache.size());
+  EXPECT_FALSE(cache.Get("test1", now));
+}
+
+TEST(ShardedExpiringCacheTest, ShardsShareMaxEntries) {
+  // There are never more shards than entries.
+  EXPECT_EQ(4u, Cache(4).num_shards());
+  EXPECT_EQ(1u, Cache(0).num_shards());
+
+  Cache cache(100, /*num_shards=*/8);
+  EXPECT_EQ(100u, cache.max_entries());
+  EXPECT_EQ(8u, cache.num_shards());
+  base::TimeTicks now;
+
+  // Each shard holds up to 13 entries.
+  for (int i = 0; i < 1000; ++i)
+    cache.Put(base::NumberToString(i), "foo", now, now + kTTL);
+  EXPECT_LE(cache.size(), 104u);
+  EXPECT_GE(cache.size(), 90u);
+  EXPECT_THAT(cache.Get("999", now), Optional(std::string("foo")));
+}
+
+TEST(ShardedExpiringCacheTest, CustomFunctorAndEvictionHandler) {
+  ShardedExpiringCache<std::string, std::string, std::string, TestFunctor,
+                       CountingEvictionHandler>
+      cache(3, /*num_shards=*/1);
+  CountingEvictionHandler::evictions_on_get = 0;
+  CountingEvictionHandler::evictions_on_put = 0;
+
+  const std::string kNow("Now");
+  const std::string kLater("A little bit later");
+  const std::string kHeatDeath("The heat death of the universe");
+
+  cache.Put("test1", "foo1", kNow, kLater);
+  cache.Put("test2", "foo2", kNow, kLater);
+  cache.Put("test3", "foo3", kNow, kHeatDeath);
+  EXPECT_THAT(cache.Get("test1", kNow), Optional(std::string("foo1")));
+
+  // At kLater, "test2" has expired.
+  EXPECT_FALSE(cache.Get("test2", kLater));
+  EXPECT_EQ(1, CountingEvictionHandler::evictions_on_get);
+
+  // "test1" is at the front of the queue and expired.
+  cache.Put("test4", "foo4", kLater, kHeatDeath);
+  EXPECT_EQ(1, CountingEvictionHandler::evictions_on_put);
+  EXPECT_EQ(2U, cache.size());
+
+  EXPECT_FALSE(cache.Get("test3", kHeatDeath));
+  EXPECT_EQ(2, CountingEvictionHandler::evictions_on_get);
+}
+
+// Puts and gets entries from several threads at once. Mostly useful under
+// ThreadSanitizer.
+TEST(ShardedExpiringCacheTest, ConcurrentAccess) {
+  class Worker : public base::DelegateSimpleThread::Delegate {
+   public:
+    Worker(Cache* cache, int id) : cache_(cache), id_(id) {}
+
+    void Run() override {
+      base::TimeTicks now;
+      for (int i = 0; i < 1000; ++i) {
+        std::string key = base::NumberToString((i * 7 + id_) % 50);
+        if (!cache_->Get(key, now))
+          cache_->Put(key, key, now, now + kTTL);
+        now += base::Milliseconds(20);
+      }
+    }
+
+   private:
+    const raw_ptr<Cache> cache_;
+    const int id_;
+  };
+
+  Cache cache(20, /*num_shards=*/4);
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::unique_ptr<base::DelegateSimpleThread>> threads;
+  for (int i = 0; i < 4; ++i) {
+    workers.push_back(std::make_unique<Worker>(&cache, i));
+    threads.push_back(std::make_unique<base::DelegateSimpleThread>(
+        workers.back().get(), "ShardedExpiringCacheTest"));
+    threads.back()->Start();
+  }
+  for (auto& thread : threads)
+    thread->Join();
+
+  EXPECT_LE(cache.size(), cache.max_entries());
+}
+
+// Evicts entries from several shards on several threads at once. The
+// EvictionHandler's counters are not atomic, so this relies on the cache
+// never calling it concurrently.
+TEST(ShardedExpiringCacheTest, ConcurrentEvictions) {
+  typedef ShardedExpiringCache<std::string, std::string, std::string,
+                               TestFunctor, CountingEvictionHandler>
+      CountingCache;
+  constexpr int kNumThreads = 4;
+  constexpr int kPutsPerThread = 1000;
+
+  class Worker : public base::DelegateSimpleThread::Delegate {
+   public:
+    Worker(CountingCache* cache, int id) : cache_(cache), id_(id) {}
+
+    void Run() override {
+      // Every key is new, and never expires, so each Put() into a full shard
+      // evicts exactly one entry.
+      for (int i = 0; i < kPutsPerThread; ++i) {
+        cache_->Put(base::StringPrintf("%d-%d", id_, i), "foo", "Now",
+                    "Later");
+      }
+    }
+
+   private:
+    const raw_ptr<CountingCache> cache_;
+    const int id_;
+  };
+
+  CountingCache cache(20, /*num_shards=*/4);
+  CountingEvictionHandler::evictions_on_get = 0;
+  CountingEvictionHandler::evictions_on_put = 0;
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::unique_ptr<base::DelegateSimpleThread>> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    workers.push_back(std::make_unique<Worker>(&cache, i));
+    threads.push_back(std::make_unique<base::DelegateSimpleThread>(
+        workers.back().get(), "ShardedExpiringCacheTest"));
+    threads.back()->Start();
+  }
+  for (auto& thread : threads)
+    thread->Join();
+
+  EXPECT_EQ(0, CountingEvictionHandler::evictions_on_get);
+  EXPECT_EQ(kNumThreads * kPutsPerThread - static_cast<int>(cache.size()),
+            CountingEvictionHandler::evictions_on_put);
+}
+
+}  // namespace
+
+}  // namespace net
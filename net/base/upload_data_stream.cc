@@ -89,6 +89,27 @@ int UploadDataStream::Read(IOBuffer* buf,
   return result;
 }
 
+scoped_refptr<IOBuffer> UploadDataStream::ReadWithoutCopying(int max_length,
+                                                             int* length) {
+  DCHECK(initialized_successfully_);
+  DCHECK(callback_.is_null());
+  DCHECK_GT(max_length, 0);
+
+  if (is_eof_)
+    return nullptr;
+
+  scoped_refptr<IOBuffer> buf = ReadWithoutCopyingInternal(max_length, length);
+  if (!buf)
+    return nullptr;
+  DCHECK_GT(*length, 0);
+  DCHECK_LE(*length, max_length);
+
+  net_log_.BeginEvent(NetLogEventType::UPLOAD_DATA_STREAM_READ,
+                      [&] { return CreateReadInfoParams(current_position_); });
+  OnReadCompleted(*length);
+  return buf;
+}
+
 bool UploadDataStream::IsEOF() const {
   DCHECK(initialized_successfully_);
   DCHECK(is_chunked_ || is_eof_ == (current_position_ == total_size_));
@@ -136,6 +157,12 @@ bool UploadDataStream::IsInMemory() const {
   return false;
 }
 
+scoped_refptr<IOBuffer> UploadDataStream::ReadWithoutCopyingInternal(
+    int max_length,
+    int* length) {
+  return nullptr;
+}
+
 const std::vector<std::unique_ptr<UploadElementReader>>*
 UploadDataStream::GetElementReaders() const {
   return nullptr;
@@ -10,6 +10,7 @@
 #include <memory>
 #include <vector>
 
+#include "base/memory/scoped_refptr.h"
 #include "net/base/completion_once_callback.h"
 #include "net/base/net_export.h"
 #include "net/base/upload_progress.h"
@@ -63,6 +64,14 @@ class NET_EXPORT UploadDataStream {
   // TODO(mmenke):  Investigate letting reads fail.
   int Read(IOBuffer* buf, int buf_len, CompletionOnceCallback callback);
 
+  // If the next bytes of the stream can be handed out without copying them,
+  // returns a buffer holding up to |max_length| of them and sets |*length| to
+  // their number, synchronously, as if Read() had copied them. Otherwise,
+  // including at the end of the stream, returns nullptr without reading
+  // anything, and Read() must be used instead. Must not be called while a
+  // Read() is pending.
+  scoped_refptr<IOBuffer> ReadWithoutCopying(int max_length, int* length);
+
   // Returns the total size of the data stream and the current position.
   // When the data is chunked, always returns zero. Must always return the same
   // value after each call to Initialize().
@@ -134,6 +143,11 @@ class NET_EXPORT UploadDataStream {
   // return any error, other than ERR_IO_PENDING.
   virtual int ReadInternal(IOBuffer* buf, int buf_len) = 0;
 
+  // See ReadWithoutCopying(). If it returns a buffer, |*length| must be
+  // between 1 and |max_length|. The default implementation returns nullptr.
+  virtual scoped_refptr<IOBuffer> ReadWithoutCopyingInternal(int max_length,
+                                                             int* length);
+
   // Resets state and cancels any pending callbacks. Guaranteed to be called
   // at least once before every call to InitInternal.
   virtual void ResetInternal() = 0;
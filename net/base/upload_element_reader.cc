@@ -4,6 +4,8 @@
 
 #include "net/base/upload_element_reader.h"
 
+#include "net/base/io_buffer.h"
+
 namespace net {
 
 const UploadBytesElementReader* UploadElementReader::AsBytesReader() const {
@@ -18,4 +20,10 @@ bool UploadElementReader::IsInMemory() const {
   return false;
 }
 
+scoped_refptr<IOBuffer> UploadElementReader::ReadWithoutCopying(
+    int max_length,
+    int* length) {
+  return nullptr;
+}
+
 }  // namespace net
@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 
+#include "base/memory/scoped_refptr.h"
 #include "net/base/completion_once_callback.h"
 #include "net/base/net_export.h"
 
@@ -61,6 +62,15 @@ class NET_EXPORT UploadElementReader {
   virtual int Read(IOBuffer* buf,
                    int buf_length,
                    CompletionOnceCallback callback) = 0;
+
+  // If the next bytes of the element are already in memory that can be shared
+  // as is, returns a buffer holding up to |max_length| of them, sets |*length|
+  // to their number and advances past them, synchronously. Otherwise returns
+  // nullptr without reading anything, and Read() must be used instead. Must
+  // not be called while a Read() is pending. |max_length| must be greater than
+  // 0. The default implementation returns nullptr.
+  virtual scoped_refptr<IOBuffer> ReadWithoutCopying(int max_length,
+                                                     int* length);
 };
 
 }  // namespace net
@@ -4,13 +4,20 @@
 
 #include "net/base/upload_file_element_reader.h"
 
+#include <algorithm>
+#include <limits>
 #include <memory>
+#include <utility>
 
 #include "base/bind.h"
+#include "base/feature_list.h"
 #include "base/files/file_util.h"
+#include "base/files/memory_mapped_file.h"
 #include "base/location.h"
+#include "base/memory/ref_counted_memory.h"
 #include "base/task/task_runner.h"
 #include "base/task/task_runner_util.h"
+#include "net/base/features.h"
 #include "net/base/file_stream.h"
 #include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
@@ -23,6 +30,62 @@ namespace {
 // UploadFileElementReader::GetContentLength() when set to non-zero.
 uint64_t overriding_content_length = 0;
 
+// A memory mapped range of a file.
+class MappedFileMemory : public base::RefCountedMemory {
+ public:
+  MappedFileMemory() = default;
+
+  MappedFileMemory(const MappedFileMemory&) = delete;
+  MappedFileMemory& operator=(const MappedFileMemory&) = delete;
+
+  bool Initialize(base::File file,
+                  const base::MemoryMappedFile::Region& region) {
+    return file_.Initialize(std::move(file), region);
+  }
+
+  // base::RefCountedMemory implementation:
+  const unsigned char* front() const override { return file_.data(); }
+  size_t size() const override { return file_.length(); }
+
+ private:
+  ~MappedFileMemory() override = default;
+
+  base::MemoryMappedFile file_;
+};
+
+// An IOBuffer pointing into a mapped file, which it keeps mapped.
+class MappedFileIOBuffer : public WrappedIOBuffer {
+ public:
+  MappedFileIOBuffer(scoped_refptr<base::RefCountedMemory> mapped_file,
+                     size_t offset)
+      : WrappedIOBuffer(mapped_file->front_as<char>() + offset),
+        mapped_file_(std::move(mapped_file)) {}
+
+ private:
+  ~MappedFileIOBuffer() override = default;
+
+  scoped_refptr<base::RefCountedMemory> mapped_file_;
+};
+
+// Maps |region| of |file|, or of the file at |path| if |file| is not valid.
+// Returns nullptr on failure.
+scoped_refptr<base::RefCountedMemory> MapFile(
+    base::File file,
+    const base::FilePath& path,
+    const base::MemoryMappedFile::Region& region) {
+  if (!file.IsValid())
+    file.Initialize(path, base::File::FLAG_OPEN | base::File::FLAG_READ);
+  if (!file.IsValid())
+    return nullptr;
+
+  auto mapped_file = base::MakeRefCounted<MappedFileMemory>();
+  if (!mapped_file->Initialize(std::move(file), region)) {
+    DLOG(WARNING) << "Failed to map \"" << path.value() << "\"";
+    return nullptr;
+  }
+  return mapped_file;
+}
+
 }  // namespace
 
 UploadFileElementReader::UploadFileElementReader(
@@ -36,9 +99,13 @@ UploadFileElementReader::UploadFileElementReader(
       path_(path),
       range_offset_(range_offset),
       range_length_(range_length),
-      expected_modification_time_(expected_modification_time) {
+      expected_modification_time_(expected_modification_time),
+      use_memory_mapping_(
+          base::FeatureList::IsEnabled(features::kUploadFileMemoryMapping)) {
   DCHECK(file.IsValid());
   DCHECK(task_runner_.get());
+  if (use_memory_mapping_)
+    file_to_map_ = file.Duplicate();
   file_stream_ = std::make_unique<FileStream>(std::move(file), task_runner);
 }
 
@@ -52,7 +119,9 @@ UploadFileElementReader::UploadFileElementReader(
       path_(path),
       range_offset_(range_offset),
       range_length_(range_length),
-      expected_modification_time_(expected_modification_time) {
+      expected_modification_time_(expected_modification_time),
+      use_memory_mapping_(
+          base::FeatureList::IsEnabled(features::kUploadFileMemoryMapping)) {
   DCHECK(task_runner_.get());
 }
 
@@ -67,6 +136,7 @@ int UploadFileElementReader::Init(CompletionOnceCallback callback) {
 
   bytes_remaining_ = 0;
   content_length_ = 0;
+  mapped_file_ = nullptr;
   pending_callback_.Reset();
 
   // If the file is being opened, just update the callback, and continue
@@ -122,6 +192,18 @@ int UploadFileElementReader::Read(IOBuffer* buf,
   if (num_bytes_to_read == 0)
     return 0;
 
+  if (mapped_file_) {
+    // Copying from the mapping may fault pages in on this thread, but that
+    // beats a round trip to |task_runner_| per read.
+    num_bytes_to_read = static_cast<int>(std::min(
+        static_cast<size_t>(num_bytes_to_read),
+        mapped_file_->size() - mapped_position_));
+    std::copy_n(mapped_file_->front_as<char>() + mapped_position_,
+                num_bytes_to_read, buf->data());
+    mapped_position_ += num_bytes_to_read;
+    return DoReadComplete(num_bytes_to_read);
+  }
+
   next_state_ = State::READ_COMPLETE;
   int result = file_stream_->Read(
       buf, num_bytes_to_read,
@@ -137,6 +219,30 @@ int UploadFileElementReader::Read(IOBuffer* buf,
   return result;
 }
 
+scoped_refptr<IOBuffer> UploadFileElementReader::ReadWithoutCopying(
+    int max_length,
+    int* length) {
+  DCHECK_EQ(next_state_, State::IDLE);
+  DCHECK_GT(max_length, 0);
+
+  if (!mapped_file_)
+    return nullptr;
+
+  // If the file turned out shorter than expected, leave it to Read() to fail.
+  uint64_t num_bytes = std::min(
+      {BytesRemaining(), static_cast<uint64_t>(max_length),
+       static_cast<uint64_t>(mapped_file_->size() - mapped_position_)});
+  if (num_bytes == 0)
+    return nullptr;
+
+  auto buf =
+      base::MakeRefCounted<MappedFileIOBuffer>(mapped_file_, mapped_position_);
+  mapped_position_ += num_bytes;
+  bytes_remaining_ -= num_bytes;
+  *length = static_cast<int>(num_bytes);
+  return buf;
+}
+
 int UploadFileElementReader::DoLoop(int result) {
   DCHECK_NE(result, ERR_IO_PENDING);
 
@@ -174,6 +280,13 @@ int UploadFileElementReader::DoLoop(int result) {
       case State::GET_FILE_INFO_COMPLETE:
         result = DoGetFileInfoComplete(result);
         break;
+      case State::MAP:
+        DCHECK_EQ(OK, result);
+        result = DoMap();
+        break;
+      case State::MAP_COMPLETE:
+        result = DoMapComplete(result);
+        break;
 
       case State::READ_COMPLETE:
         result = DoReadComplete(result);
@@ -283,6 +396,36 @@ int UploadFileElementReader::DoGetFileInfoComplete(int result) {
 
   content_length_ = length;
   bytes_remaining_ = GetContentLength();
+
+  if (use_memory_mapping_ && content_length_ > 0 &&
+      range_offset_ < static_cast<uint64_t>(file_info_.size) &&
+      content_length_ <= std::numeric_limits<size_t>::max()) {
+    next_state_ = State::MAP;
+  }
+  return result;
+}
+
+int UploadFileElementReader::DoMap() {
+  next_state_ = State::MAP_COMPLETE;
+
+  base::MemoryMappedFile::Region region;
+  region.offset = static_cast<int64_t>(range_offset_);
+  region.size = static_cast<size_t>(content_length_);
+  base::PostTaskAndReplyWithResult(
+      task_runner_.get(), FROM_HERE,
+      base::BindOnce(&MapFile,
+                     file_to_map_.IsValid() ? file_to_map_.Duplicate()
+                                            : base::File(),
+                     path_, region),
+      base::BindOnce(&UploadFileElementReader::OnMapComplete,
+                     weak_ptr_factory_.GetWeakPtr()));
+  return ERR_IO_PENDING;
+}
+
+int UploadFileElementReader::DoMapComplete(int result) {
+  // If the file could not be mapped, |mapped_file_| is null, and reads fall
+  // back to |file_stream_|, which is already at |range_offset_|.
+  mapped_position_ = 0;
   return result;
 }
 
@@ -307,6 +450,14 @@ void UploadFileElementReader::OnIOComplete(int result) {
     std::move(pending_callback_).Run(result);
 }
 
+void UploadFileElementReader::OnMapComplete(
+    scoped_refptr<base::RefCountedMemory> mapped_file) {
+  // If Init() was called in the meantime, the mapping may be stale.
+  if (!init_called_while_operation_pending_)
+    mapped_file_ = std::move(mapped_file);
+  OnIOComplete(OK);
+}
+
 UploadFileElementReader::ScopedOverridingContentLengthForTests::
     ScopedOverridingContentLengthForTests(uint64_t value) {
   overriding_content_length = value;
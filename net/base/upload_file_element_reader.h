@@ -5,6 +5,7 @@
 #ifndef NET_BASE_UPLOAD_FILE_ELEMENT_READER_H_
 #define NET_BASE_UPLOAD_FILE_ELEMENT_READER_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include <memory>
@@ -20,6 +21,7 @@
 #include "net/base/upload_element_reader.h"
 
 namespace base {
+class RefCountedMemory;
 class TaskRunner;
 }
 
@@ -28,6 +30,11 @@ namespace net {
 class FileStream;
 
 // An UploadElementReader implementation for file.
+//
+// With features::kUploadFileMemoryMapping, the range of the file is memory
+// mapped once its size is known, after which reads complete synchronously and
+// ReadWithoutCopying() hands out the mapped pages themselves. If the file can't
+// be mapped, reads go through a FileStream as usual.
 class NET_EXPORT UploadFileElementReader : public UploadElementReader {
  public:
   // |file| must be valid and opened for reading. On Windows, the file must have
@@ -73,6 +80,8 @@ class NET_EXPORT UploadFileElementReader : public UploadElementReader {
   int Read(IOBuffer* buf,
            int buf_length,
            CompletionOnceCallback callback) override;
+  scoped_refptr<IOBuffer> ReadWithoutCopying(int max_length,
+                                             int* length) override;
 
  private:
   enum class State {
@@ -87,6 +96,9 @@ class NET_EXPORT UploadFileElementReader : public UploadElementReader {
     SEEK,
     GET_FILE_INFO,
     GET_FILE_INFO_COMPLETE,
+    // Memory maps the range of the file. Skipped unless mapping is enabled.
+    MAP,
+    MAP_COMPLETE,
 
     // There is no READ state as reads are always started immediately on Read().
     READ_COMPLETE,
@@ -102,9 +114,12 @@ class NET_EXPORT UploadFileElementReader : public UploadElementReader {
   int DoSeek();
   int DoGetFileInfo(int result);
   int DoGetFileInfoComplete(int result);
+  int DoMap();
+  int DoMapComplete(int result);
   int DoReadComplete(int result);
 
   void OnIOComplete(int result);
+  void OnMapComplete(scoped_refptr<base::RefCountedMemory> mapped_file);
 
   // Sets an value to override the result for GetContentLength().
   // Used for tests.
@@ -119,6 +134,14 @@ class NET_EXPORT UploadFileElementReader : public UploadElementReader {
   const uint64_t range_length_;
   const base::Time expected_modification_time_;
   std::unique_ptr<FileStream> file_stream_;
+  const bool use_memory_mapping_;
+  // With memory mapping, a duplicate of the file passed to the constructor, if
+  // any. Otherwise the file is mapped after opening |path_| again.
+  base::File file_to_map_;
+  // The mapped range of the file, if mapping is enabled and succeeded, and the
+  // offset of the next byte to read from it.
+  scoped_refptr<base::RefCountedMemory> mapped_file_;
+  size_t mapped_position_ = 0;
   uint64_t content_length_ = 0;
   uint64_t bytes_remaining_ = 0;
 
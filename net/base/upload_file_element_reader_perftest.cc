@@ -0,0 +1,208 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/upload_file_element_reader.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/memory/raw_ptr.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/run_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/test/scoped_feature_list.h"
+#include "base/threading/thread_task_runner_handle.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "net/base/address_list.h"
+#include "net/base/elements_upload_data_stream.h"
+#include "net/base/features.h"
+#include "net/base/io_buffer.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+#include "net/base/test_completion_callback.h"
+#include "net/http/http_request_headers.h"
+#include "net/http/http_request_info.h"
+#include "net/http/http_response_info.h"
+#include "net/http/http_stream_parser.h"
+#include "net/log/net_log_source.h"
+#include "net/log/net_log_with_source.h"
+#include "net/socket/stream_socket.h"
+#include "net/socket/tcp_client_socket.h"
+#include "net/socket/tcp_server_socket.h"
+#include "net/test/test_with_task_environment.h"
+#include "net/traffic_annotation/network_traffic_annotation_test_helper.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "url/gurl.h"
+
+namespace net {
+
+namespace {
+
+const size_t kFileSizes[] = {1 << 20, 64 << 20};
+const int kDrainBufferSize = 1 << 18;
+
+// Reads everything the peer sends until |expected_bytes| have arrived.
+class SocketDrainer {
+ public:
+  SocketDrainer(StreamSocket* socket, size_t expected_bytes)
+      : socket_(socket),
+        expected_bytes_(expected_bytes),
+        buf_(base::MakeRefCounted<IOBuffer>(kDrainBufferSize)) {}
+
+  void Start() { DoRead(); }
+
+  // Returns the number of bytes read, once all expected bytes arrived or the
+  // connection closed.
+  size_t WaitForCompletion() {
+    if (!done_)
+      run_loop_.Run();
+    return bytes_read_;
+  }
+
+ private:
+  void DoRead() {
+    while (true) {
+      int result = socket_->Read(
+          buf_.get(), kDrainBufferSize,
+          base::BindOnce(&SocketDrainer::OnRead, base::Unretained(this)));
+      if (result == ERR_IO_PENDING || !HandleResult(result))
+        return;
+    }
+  }
+
+  void OnRead(int result) {
+    if (HandleResult(result))
+      DoRead();
+  }
+
+  // Returns whether to read more.
+  bool HandleResult(int result) {
+    if (result > 0)
+      bytes_read_ += result;
+    if (result > 0 && bytes_read_ < expected_bytes_)
+      return true;
+    done_ = true;
+    run_loop_.Quit();
+    return false;
+  }
+
+  const raw_ptr<StreamSocket> socket_;
+  const size_t expected_bytes_;
+  scoped_refptr<IOBuffer> buf_;
+  size_t bytes_read_ = 0;
+  bool done_ = false;
+  base::RunLoop run_loop_;
+};
+
+class UploadFileElementReaderPerfTest : public TestWithTaskEnvironment {
+ public:
+  void SetUp() override { ASSERT_TRUE(temp_dir_.CreateUniqueTempDir()); }
+
+  // Connects |client_socket_| to |server_socket_| over the loopback interface.
+  void ConnectSockets() {
+    TCPServerSocket listen_socket(nullptr /* net_log */, NetLogSource());
+    ASSERT_EQ(OK, listen_socket.ListenWithAddressAndPort("127.0.0.1", 0, 1));
+    IPEndPoint address;
+    ASSERT_EQ(OK, listen_socket.GetLocalAddress(&address));
+
+    TestCompletionCallback accept_callback;
+    int accept_result =
+        listen_socket.Accept(&server_socket_, accept_callback.callback());
+    client_socket_ = std::make_unique<TCPClientSocket>(
+        AddressList(address), nullptr /* socket_performance_watcher */,
+        nullptr /* network_quality_estimator */, nullptr /* net_log */,
+        NetLogSource());
+    TestCompletionCallback connect_callback;
+    ASSERT_EQ(OK, connect_callback.GetResult(
+                      client_socket_->Connect(connect_callback.callback())));
+    ASSERT_EQ(OK, accept_callback.GetResult(accept_result));
+  }
+
+  // Uploads a file of |file_size| bytes as the body of a POST request to the
+  // server side of a loopback connection, which discards it, and reports the
+  // throughput as |story|.
+  void MeasureUpload(const std::string& story, size_t file_size) {
+    base::FilePath path;
+    ASSERT_TRUE(base::CreateTemporaryFileInDir(temp_dir_.GetPath(), &path));
+    ASSERT_TRUE(base::WriteFile(path, std::string(file_size, 'x')));
+    ConnectSockets();
+
+    std::vector<std::unique_ptr<UploadElementReader>> element_readers;
+    element_readers.push_back(std::make_unique<UploadFileElementReader>(
+        base::ThreadTaskRunnerHandle::Get().get(), path, 0, file_size,
+        base::Time()));
+    ElementsUploadDataStream upload_data_stream(std::move(element_readers), 0);
+    TestCompletionCallback init_callback;
+    ASSERT_EQ(OK, init_callback.GetResult(upload_data_stream.Init(
+                      init_callback.callback(), NetLogWithSource())));
+
+    HttpRequestInfo request;
+    request.method = "POST";
+    request.url = GURL("http://localhost");
+    request.upload_data_stream = &upload_data_stream;
+    HttpRequestHeaders headers;
+    headers.SetHeader("Content-Length", base::NumberToString(file_size));
+    const std::string request_line = "POST / HTTP/1.1\r\n";
+
+    auto read_buffer = base::MakeRefCounted<GrowableIOBuffer>();
+    HttpStreamParser parser(client_socket_.get(), false /* is_reused */,
+                            &request, read_buffer.get(), NetLogWithSource());
+    SocketDrainer drainer(
+        server_socket_.get(),
+        request_line.size() + headers.ToString().size() + file_size);
+    HttpResponseInfo response;
+    TestCompletionCallback send_callback;
+
+    base::ElapsedTimer timer;
+    drainer.Start();
+    int result = parser.SendRequest(request_line, headers,
+                                    TRAFFIC_ANNOTATION_FOR_TESTS, &response,
+                                    send_callback.callback());
+    ASSERT_EQ(OK, send_callback.GetResult(result));
+    size_t bytes_read = drainer.WaitForCompletion();
+    base::TimeDelta upload_time = timer.Elapsed();
+    EXPECT_EQ(static_cast<size_t>(parser.sent_bytes()), bytes_read);
+
+    perf_test::PerfResultReporter reporter("UploadFileElementReader.",
+                                           story);
+    reporter.RegisterImportantMetric("upload_time", "ms");
+    reporter.RegisterImportantMetric("throughput", "bytesPerSecond");
+    reporter.AddResult("upload_time", upload_time);
+    reporter.AddResult("throughput", file_size / upload_time.InSecondsF());
+  }
+
+ protected:
+  base::ScopedTempDir temp_dir_;
+  std::unique_ptr<StreamSocket> client_socket_;
+  std::unique_ptr<StreamSocket> server_socket_;
+};
+
+// Measures uploads that read the file into a buffer on the file task runner,
+// and write the buffer to the socket.
+TEST_F(UploadFileElementReaderPerfTest, Copying) {
+  for (size_t file_size : kFileSizes)
+    MeasureUpload("Copying_" + base::NumberToString(file_size), file_size);
+}
+
+// Measures uploads that write the mapped pages of the file to the socket.
+TEST_F(UploadFileElementReaderPerfTest, MemoryMapped) {
+  base::test::ScopedFeatureList feature_list(
+      features::kUploadFileMemoryMapping);
+  for (size_t file_size : kFileSizes) {
+    MeasureUpload("MemoryMapped_" + base::NumberToString(file_size),
+                  file_size);
+  }
+}
+
+}  // namespace
+
+}  // namespace net
@@ -11,8 +11,10 @@
 #include "base/files/file_util.h"
 #include "base/files/scoped_temp_dir.h"
 #include "base/run_loop.h"
+#include "base/test/scoped_feature_list.h"
 #include "base/threading/thread_task_runner_handle.h"
 #include "build/build_config.h"
+#include "net/base/features.h"
 #include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 #include "net/base/test_completion_callback.h"
@@ -331,4 +333,110 @@ INSTANTIATE_TEST_SUITE_P(All,
                          UploadFileElementReaderTest,
                          testing::ValuesIn({false, true}));
 
+class UploadFileElementReaderMemoryMappedTest
+    : public UploadFileElementReaderTest {
+ protected:
+  UploadFileElementReaderMemoryMappedTest() {
+    feature_list_.InitAndEnableFeature(features::kUploadFileMemoryMapping);
+  }
+
+  base::test::ScopedFeatureList feature_list_;
+};
+
+// Reads from a mapped file complete synchronously.
+TEST_P(UploadFileElementReaderMemoryMappedTest, Read) {
+  const size_t kHalfSize = bytes_.size() / 2;
+  std::vector<char> buf(kHalfSize);
+  scoped_refptr<IOBuffer> wrapped_buffer =
+      base::MakeRefCounted<WrappedIOBuffer>(&buf[0]);
+  TestCompletionCallback read_callback;
+  EXPECT_EQ(static_cast<int>(kHalfSize),
+            reader_->Read(wrapped_buffer.get(), buf.size(),
+                          read_callback.callback()));
+  EXPECT_EQ(bytes_.size() - kHalfSize, reader_->BytesRemaining());
+  EXPECT_EQ(std::vector<char>(bytes_.begin(), bytes_.begin() + kHalfSize), buf);
+
+  EXPECT_EQ(static_cast<int>(kHalfSize),
+            reader_->Read(wrapped_buffer.get(), buf.size(),
+                          read_callback.callback()));
+  EXPECT_EQ(0U, reader_->BytesRemaining());
+  EXPECT_EQ(std::vector<char>(bytes_.begin() + kHalfSize, bytes_.end()), buf);
+  EXPECT_EQ(0, reader_->Read(wrapped_buffer.get(), buf.size(),
+                             read_callback.callback()));
+  EXPECT_FALSE(read_callback.have_result());
+}
+
+TEST_P(UploadFileElementReaderMemoryMappedTest, ReadWithoutCopying) {
+  const int kHalfSize = bytes_.size() / 2;
+  int length = 0;
+  scoped_refptr<IOBuffer> buf1 =
+      reader_->ReadWithoutCopying(kHalfSize, &length);
+  ASSERT_TRUE(buf1);
+  EXPECT_EQ(kHalfSize, length);
+  EXPECT_EQ(bytes_.size() - kHalfSize, reader_->BytesRemaining());
+
+  // Mixing in regular reads is fine.
+  std::vector<char> buf(1);
+  TestCompletionCallback read_callback;
+  EXPECT_EQ(1, reader_->Read(
+                   base::MakeRefCounted<WrappedIOBuffer>(&buf[0]).get(),
+                   buf.size(), read_callback.callback()));
+
+  scoped_refptr<IOBuffer> buf2 =
+      reader_->ReadWithoutCopying(bytes_.size(), &length);
+  ASSERT_TRUE(buf2);
+  EXPECT_EQ(kHalfSize - 1, length);
+  EXPECT_EQ(0U, reader_->BytesRemaining());
+  EXPECT_FALSE(reader_->ReadWithoutCopying(bytes_.size(), &length));
+
+  // The buffers remain valid after the reader is gone.
+  reader_.reset();
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(std::vector<char>(bytes_.begin(), bytes_.begin() + kHalfSize),
+            std::vector<char>(buf1->data(), buf1->data() + kHalfSize));
+  EXPECT_EQ(bytes_[kHalfSize], buf[0]);
+  EXPECT_EQ(std::vector<char>(bytes_.begin() + kHalfSize + 1, bytes_.end()),
+            std::vector<char>(buf2->data(), buf2->data() + kHalfSize - 1));
+}
+
+TEST_P(UploadFileElementReaderMemoryMappedTest, RangeAndMultipleInit) {
+  const uint64_t kOffset = 2;
+  const uint64_t kLength = bytes_.size() - kOffset * 3;
+  reader_ = CreateReader(kOffset, kLength, base::Time());
+  const std::vector<char> expected(bytes_.begin() + kOffset,
+                                   bytes_.begin() + kOffset + kLength);
+
+  for (int i = 0; i < 2; ++i) {
+    TestCompletionCallback init_callback;
+    ASSERT_THAT(reader_->Init(init_callback.callback()),
+                IsError(ERR_IO_PENDING));
+    EXPECT_THAT(init_callback.WaitForResult(), IsOk());
+    EXPECT_EQ(kLength, reader_->GetContentLength());
+
+    int length = 0;
+    scoped_refptr<IOBuffer> buf =
+        reader_->ReadWithoutCopying(bytes_.size(), &length);
+    ASSERT_TRUE(buf);
+    ASSERT_EQ(static_cast<int>(kLength), length);
+    EXPECT_EQ(expected, std::vector<char>(buf->data(), buf->data() + length));
+    EXPECT_EQ(0U, reader_->BytesRemaining());
+  }
+}
+
+// Files that can't be mapped, like empty ones, are read as usual.
+TEST_P(UploadFileElementReaderMemoryMappedTest, EmptyFile) {
+  ASSERT_TRUE(base::WriteFile(temp_file_path_, ""));
+  reader_ = CreateReader(0, std::numeric_limits<uint64_t>::max(), base::Time());
+  TestCompletionCallback init_callback;
+  ASSERT_THAT(reader_->Init(init_callback.callback()), IsError(ERR_IO_PENDING));
+  EXPECT_THAT(init_callback.WaitForResult(), IsOk());
+  EXPECT_EQ(0U, reader_->GetContentLength());
+  int length = 0;
+  EXPECT_FALSE(reader_->ReadWithoutCopying(1, &length));
+}
+
+INSTANTIATE_TEST_SUITE_P(All,
+                         UploadFileElementReaderMemoryMappedTest,
+                         testing::ValuesIn({false, true}));
+
 }  // namespace net
@@ -37,6 +37,7 @@
 #include "net/base/network_isolation_key.h"
 #include "net/base/upload_data_stream.h"
 #include "net/disk_cache/disk_cache.h"
+#include "net/http/http_cache_hot_tier.h"
 #include "net/http/http_cache_lookup_manager.h"
 #include "net/http/http_cache_transaction.h"
 #include "net/http/http_cache_writers.h"
@@ -45,6 +46,7 @@
 #include "net/http/http_request_info.h"
 #include "net/http/http_response_headers.h"
 #include "net/http/http_response_info.h"
+#include "net/http/http_status_code.h"
 #include "net/http/http_util.h"
 #include "net/log/net_log_with_source.h"
 #include "net/quic/quic_server_info.h"
@@ -297,6 +299,7 @@ int HttpCache::GetBackend(disk_cache::Backend** backend,
   DCHECK(!callback.is_null());
 
   if (disk_cache_.get()) {
+    InvalidateHotTier();
     *backend = disk_cache_.get();
     return OK;
   }
@@ -312,6 +315,7 @@ int HttpCache::GetBackend(disk_cache::Backend** backend,
 void HttpCache::ReportGetBackendResult(disk_cache::Backend** backend,
                                        CompletionOnceCallback callback,
                                        int net_error) {
+  InvalidateHotTier();
   *backend = disk_cache_.get();
   std::move(callback).Run(net_error);
 }
@@ -320,6 +324,57 @@ disk_cache::Backend* HttpCache::GetCurrentBackend() const {
   return disk_cache_.get();
 }
 
+int HttpCache::DoomAllEntries(CompletionOnceCallback callback) {
+  if (!disk_cache_)
+    return ERR_FAILED;
+
+  // Serving from the tier stops right away, but only the completion of the
+  // deletion guarantees that no deleted response made it back in.
+  InvalidateHotTier();
+  ++pending_doom_entries_count_;
+  int rv = disk_cache_->DoomAllEntries(
+      base::BindOnce(&HttpCache::OnDoomEntriesComplete, GetWeakPtr(),
+                     std::move(callback)));
+  // The backend only runs the callback when it returns ERR_IO_PENDING.
+  if (rv != ERR_IO_PENDING)
+    OnDoomEntriesComplete(CompletionOnceCallback(), rv);
+  return rv;
+}
+
+int HttpCache::DoomEntriesBetween(base::Time initial_time,
+                                  base::Time end_time,
+                                  CompletionOnceCallback callback) {
+  if (!disk_cache_)
+    return ERR_FAILED;
+
+  InvalidateHotTier();
+  ++pending_doom_entries_count_;
+  int rv = disk_cache_->DoomEntriesBetween(
+      initial_time, end_time,
+      base::BindOnce(&HttpCache::OnDoomEntriesComplete, GetWeakPtr(),
+                     std::move(callback)));
+  // The backend only runs the callback when it returns ERR_IO_PENDING.
+  if (rv != ERR_IO_PENDING)
+    OnDoomEntriesComplete(CompletionOnceCallback(), rv);
+  return rv;
+}
+
+void HttpCache::SetHotTierMaxBytes(size_t max_bytes) {
+  // Responses being read for the old tier must not end up in the new one.
+  ++hot_tier_generation_;
+  if (max_bytes == 0) {
+    hot_tier_.reset();
+    return;
+  }
+  hot_tier_ = std::make_unique<HttpCacheHotTier>(max_bytes);
+}
+
+HotTierCacheCounters HttpCache::GetHotTierCounters() const {
+  if (!hot_tier_)
+    return HotTierCacheCounters();
+  return hot_tier_->counters();
+}
+
 // static
 bool HttpCache::ParseResponseInfo(const char* data, int len,
                                   HttpResponseInfo* response_info,
@@ -453,22 +508,12 @@ Error HttpCache::CheckResourceExistence(
     const NetworkIsolationKey& network_isolation_key,
     bool is_subframe,
     base::OnceCallback<void(Error)> callback) {
-  if (!disk_cache_)
-    return ERR_CACHE_MISS;
-
-  if (IsSplitCacheEnabled() && network_isolation_key.IsTransient())
+  std::string key;
+  if (!GetResourceCheckKey(url, method, network_isolation_key, is_subframe,
+                           &key)) {
     return ERR_CACHE_MISS;
+  }
 
-  HttpRequestInfo request_info;
-  request_info.url = url;
-  request_info.method = std::string(method);
-  request_info.network_isolation_key = network_isolation_key;
-  request_info.is_subframe_document_resource = is_subframe;
-
-  // TODO(https://crbug.com/1325315): Support looking in the single-keyed cache
-  // for the resource.
-  std::string key = GenerateCacheKeyForRequest(
-      &request_info, /*use_single_keyed_cache=*/false);
   disk_cache::EntryResult entry_result = disk_cache_->OpenEntry(
       key, net::IDLE,
       base::BindOnce(&HttpCache::ResourceExistenceCheckCallback, GetWeakPtr(),
@@ -480,6 +525,44 @@ Error HttpCache::CheckResourceExistence(
   return entry_result.net_error();
 }
 
+void HttpCache::CheckResourceFreshness(
+    const GURL& url,
+    const base::StringPiece method,
+    const NetworkIsolationKey& network_isolation_key,
+    bool is_subframe,
+    base::OnceCallback<void(ResourceFreshness)> callback) {
+  std::string key;
+  if (!GetResourceCheckKey(url, method, network_isolation_key, is_subframe,
+                           &key)) {
+    std::move(callback).Run(ResourceFreshness::kAbsent);
+    return;
+  }
+
+  // The in-memory tier only holds complete responses that mirror their disk
+  // entry, so it can answer without touching the backend.
+  if (hot_tier_) {
+    const HttpCacheHotTier::Entry* hot_entry = hot_tier_->Lookup(key);
+    if (hot_entry) {
+      std::move(callback).Run(
+          GetStoredResponseFreshness(hot_entry->response_info->data(),
+                                     hot_entry->response_info->size()));
+      return;
+    }
+  }
+
+  // The callback is split so that a synchronous result can still be
+  // delivered after OpenEntry() has consumed one half.
+  auto split_callback = base::SplitOnceCallback(std::move(callback));
+  disk_cache::EntryResult entry_result = disk_cache_->OpenEntry(
+      key, net::IDLE,
+      base::BindOnce(&HttpCache::OnResourceFreshnessEntryOpened, GetWeakPtr(),
+                     std::move(split_callback.first)));
+  if (entry_result.net_error() != ERR_IO_PENDING) {
+    OnResourceFreshnessEntryOpened(std::move(split_callback.second),
+                                   std::move(entry_result));
+  }
+}
+
 // static
 // Generate a key that can be used inside the cache.
 std::string HttpCache::GenerateCacheKey(
@@ -663,6 +746,9 @@ int HttpCache::DoomEntry(const std::string& key, Transaction* transaction) {
   // should not be impacted.  Dooming an entry only means that it will no
   // longer be returned by FindActiveEntry (and it will also be destroyed once
   // all consumers are finished with the entry).
+  if (hot_tier_)
+    hot_tier_->Remove(key);
+
   auto it = active_entries_.find(key);
   if (it == active_entries_.end()) {
     DCHECK(transaction);
@@ -687,6 +773,9 @@ int HttpCache::DoomEntry(const std::string& key, Transaction* transaction) {
 
 int HttpCache::AsyncDoomEntry(const std::string& key,
                               Transaction* transaction) {
+  if (hot_tier_)
+    hot_tier_->Remove(key);
+
   PendingOp* pending_op = GetPendingOp(key);
   int rv =
       CreateAndSetWorkItem(nullptr, transaction, WI_DOOM_ENTRY, pending_op);
@@ -1582,6 +1671,26 @@ void HttpCache::OnBackendCreated(int result, PendingOp* pending_op) {
     item->NotifyTransaction(result, nullptr);
 }
 
+void HttpCache::InvalidateHotTier() {
+  ++hot_tier_generation_;
+  if (hot_tier_)
+    hot_tier_->Clear();
+}
+
+void HttpCache::OnDoomEntriesComplete(CompletionOnceCallback callback,
+                                      int result) {
+  DCHECK_GT(pending_doom_entries_count_, 0);
+  --pending_doom_entries_count_;
+  InvalidateHotTier();
+  if (callback)
+    std::move(callback).Run(result);
+}
+
+bool HttpCache::CanAddToHotTier(uint64_t generation) const {
+  return hot_tier_ && pending_doom_entries_count_ == 0 &&
+         generation == hot_tier_generation_;
+}
+
 void HttpCache::ResourceExistenceCheckCallback(
     base::OnceCallback<void(Error)> callback,
     disk_cache::EntryResult entry_result) {
@@ -1591,4 +1700,97 @@ void HttpCache::ResourceExistenceCheckCallback(
   std::move(callback).Run(result);
 }
 
+bool HttpCache::GetResourceCheckKey(
+    const GURL& url,
+    const base::StringPiece method,
+    const NetworkIsolationKey& network_isolation_key,
+    bool is_subframe,
+    std::string* key) const {
+  if (!disk_cache_)
+    return false;
+
+  if (IsSplitCacheEnabled() && network_isolation_key.IsTransient())
+    return false;
+
+  HttpRequestInfo request_info;
+  request_info.url = url;
+  request_info.method = std::string(method);
+  request_info.network_isolation_key = network_isolation_key;
+  request_info.is_subframe_document_resource = is_subframe;
+
+  // TODO(https://crbug.com/1325315): Support looking in the single-keyed cache
+  // for the resource.
+  *key = GenerateCacheKeyForRequest(&request_info,
+                                    /*use_single_keyed_cache=*/false);
+  return true;
+}
+
+HttpCache::ResourceFreshness HttpCache::GetStoredResponseFreshness(
+    const char* data,
+    int len) const {
+  HttpResponseInfo response_info;
+  bool truncated = false;
+  if (!ParseResponseInfo(data, len, &response_info, &truncated))
+    return ResourceFreshness::kAbsent;
+
+  if (truncated ||
+      response_info.headers->response_code() == net::HTTP_PARTIAL_CONTENT ||
+      response_info.single_keyed_cache_entry_unusable) {
+    return ResourceFreshness::kStale;
+  }
+
+  return response_info.headers->RequiresValidation(
+             response_info.request_time, response_info.response_time,
+             clock_->Now()) == VALIDATION_NONE
+             ? ResourceFreshness::kFresh
+             : ResourceFreshness::kStale;
+}
+
+void HttpCache::OnResourceFreshnessEntryOpened(
+    base::OnceCallback<void(ResourceFreshness)> callback,
+    disk_cache::EntryResult entry_result) {
+  if (entry_result.net_error() != OK || !entry_result.opened()) {
+    std::move(callback).Run(ResourceFreshness::kAbsent);
+    return;
+  }
+
+  disk_cache::Entry* entry = entry_result.ReleaseEntry();
+  int len = entry->GetDataSize(kResponseInfoIndex);
+  if (len <= 0) {
+    entry->Close();
+    std::move(callback).Run(ResourceFreshness::kAbsent);
+    return;
+  }
+
+  auto buffer = base::MakeRefCounted<IOBufferWithSize>(len);
+  auto split_callback = base::SplitOnceCallback(std::move(callback));
+  int rv = entry->ReadData(
+      kResponseInfoIndex, 0, buffer.get(), len,
+      base::BindOnce(&HttpCache::OnResourceFreshnessInfoRead, GetWeakPtr(),
+                     std::move(split_callback.first), entry, buffer));
+  if (rv != ERR_IO_PENDING) {
+    OnResourceFreshnessInfoRead(GetWeakPtr(), std::move(split_callback.second),
+                                entry, buffer, rv);
+  }
+}
+
+// static
+void HttpCache::OnResourceFreshnessInfoRead(
+    base::WeakPtr<HttpCache> cache,
+    base::OnceCallback<void(ResourceFreshness)> callback,
+    disk_cache::Entry* entry,
+    scoped_refptr<IOBufferWithSize> buffer,
+    int result) {
+  entry->Close();
+  if (!cache)
+    return;
+
+  if (result != buffer->size()) {
+    std::move(callback).Run(ResourceFreshness::kAbsent);
+    return;
+  }
+  std::move(callback).Run(
+      cache->GetStoredResponseFreshness(buffer->data(), buffer->size()));
+}
+
 }  // namespace net
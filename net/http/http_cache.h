@@ -14,6 +14,8 @@
 #ifndef NET_HTTP_HTTP_CACHE_H_
 #define NET_HTTP_HTTP_CACHE_H_
 
+#include <stdint.h>
+
 #include <list>
 #include <map>
 #include <memory>
@@ -28,7 +30,9 @@
 #include "base/memory/weak_ptr.h"
 #include "base/threading/thread_checker.h"
 #include "base/time/clock.h"
+#include "base/time/time.h"
 #include "build/build_config.h"
+#include "net/base/cache_metrics.h"
 #include "net/base/cache_type.h"
 #include "net/base/completion_once_callback.h"
 #include "net/base/load_states.h"
@@ -53,8 +57,10 @@ class EntryResult;
 
 namespace net {
 
+class HttpCacheHotTier;
 class HttpNetworkSession;
 class HttpResponseInfo;
+class IOBufferWithSize;
 class NetLog;
 class NetworkIsolationKey;
 struct HttpRequestInfo;
@@ -187,9 +193,24 @@ class NET_EXPORT HttpCache : public HttpTransactionFactory {
   // `callback` will be notified when the operation completes. The pointer that
   // receives the `backend` must remain valid until the operation completes.
   // `callback` will get cancelled if the HttpCache is destroyed.
+  //
+  // As the caller may change or delete entries through the backend, handing
+  // it out drops the in-memory tier. For deletions, prefer DoomAllEntries()
+  // or DoomEntriesBetween(), which also keep entries that are being deleted
+  // from being added back to the tier before the backend is done.
   int GetBackend(disk_cache::Backend** backend,
                  CompletionOnceCallback callback);
 
+  // Dooms every entry of the backend, or those used between `initial_time`
+  // and `end_time`, and drops the in-memory tier once the backend is done.
+  // Responses read before the deletion completes are not added to the tier.
+  // Returns ERR_FAILED if the backend does not exist yet. Otherwise, behaves
+  // like the disk_cache::Backend method of the same name.
+  int DoomAllEntries(CompletionOnceCallback callback);
+  int DoomEntriesBetween(base::Time initial_time,
+                         base::Time end_time,
+                         CompletionOnceCallback callback);
+
   // Returns the current backend (can be NULL).
   disk_cache::Backend* GetCurrentBackend() const;
 
@@ -202,6 +223,16 @@ class NET_EXPORT HttpCache : public HttpTransactionFactory {
   void set_mode(Mode value) { mode_ = value; }
   Mode mode() { return mode_; }
 
+  // Enables an in-memory tier of at most |max_bytes| that holds small, hot
+  // responses in front of the backend, so that they can be served without
+  // opening a disk entry. Zero disables the tier. Should be called before any
+  // transaction is created.
+  void SetHotTierMaxBytes(size_t max_bytes);
+
+  // Returns the hit, miss and eviction counts of the in-memory tier. All
+  // counts are zero if the tier is disabled.
+  HotTierCacheCounters GetHotTierCounters() const;
+
   // Get/Set the cache's clock. These are public only for testing.
   void SetClockForTesting(base::Clock* clock) { clock_ = clock; }
   base::Clock* clock() const { return clock_; }
@@ -289,6 +320,29 @@ class NET_EXPORT HttpCache : public HttpTransactionFactory {
                                bool is_subframe,
                                base::OnceCallback<void(Error)>);
 
+  // What the cache holds for a resource, as reported by
+  // CheckResourceFreshness().
+  enum class ResourceFreshness {
+    // There is no usable entry.
+    kAbsent,
+    // There is an entry, but it is incomplete or its headers require
+    // validation before it can be used.
+    kStale,
+    // There is a complete entry that can be used without validation.
+    kFresh,
+  };
+
+  // Like CheckResourceExistence(), but also reads the stored response info to
+  // classify the entry. Vary is not evaluated, since there are no request
+  // headers to match against. |callback| may be invoked synchronously, and is
+  // not invoked if the HttpCache is destroyed first.
+  void CheckResourceFreshness(
+      const GURL& url,
+      const base::StringPiece method,
+      const NetworkIsolationKey& network_isolation_key,
+      bool is_subframe,
+      base::OnceCallback<void(ResourceFreshness)> callback);
+
  private:
   // Types --------------------------------------------------------------------
 
@@ -650,9 +704,46 @@ class NET_EXPORT HttpCache : public HttpTransactionFactory {
   // Processes the backend creation notification.
   void OnBackendCreated(int result, PendingOp* pending_op);
 
+  // Drops every entry of the in-memory tier and starts a new generation, so
+  // that responses read before this call are not added to it.
+  void InvalidateHotTier();
+
+  // Called when a deletion started by DoomAllEntries() or DoomEntriesBetween()
+  // completes, synchronously or not.
+  void OnDoomEntriesComplete(CompletionOnceCallback callback, int result);
+
+  // Returns true if a response whose body was read during `generation` may be
+  // added to the in-memory tier.
+  bool CanAddToHotTier(uint64_t generation) const;
+
   void ResourceExistenceCheckCallback(base::OnceCallback<void(Error)> callback,
                                       disk_cache::EntryResult entry_result);
 
+  // Computes the cache key used by the resource checks. Returns false if such
+  // a resource can never be in the cache.
+  bool GetResourceCheckKey(const GURL& url,
+                           const base::StringPiece method,
+                           const NetworkIsolationKey& network_isolation_key,
+                           bool is_subframe,
+                           std::string* key) const;
+
+  // Classifies the serialized response info in |data|.
+  ResourceFreshness GetStoredResponseFreshness(const char* data,
+                                               int len) const;
+
+  // Continuations of CheckResourceFreshness() after the entry is opened and
+  // after its response info is read. The latter is static so that |entry| is
+  // closed even if the HttpCache has been destroyed.
+  void OnResourceFreshnessEntryOpened(
+      base::OnceCallback<void(ResourceFreshness)> callback,
+      disk_cache::EntryResult entry_result);
+  static void OnResourceFreshnessInfoRead(
+      base::WeakPtr<HttpCache> cache,
+      base::OnceCallback<void(ResourceFreshness)> callback,
+      disk_cache::Entry* entry,
+      scoped_refptr<IOBufferWithSize> buffer,
+      int result);
+
   // Constants ----------------------------------------------------------------
 
   // Used when generating and accessing keys if cache is split.
@@ -681,6 +772,17 @@ class NET_EXPORT HttpCache : public HttpTransactionFactory {
 
   std::unique_ptr<disk_cache::Backend> disk_cache_;
 
+  // Optional in-memory tier consulted before |disk_cache_|. Null if disabled.
+  std::unique_ptr<HttpCacheHotTier> hot_tier_;
+
+  // Incremented by InvalidateHotTier().
+  uint64_t hot_tier_generation_ = 0;
+
+  // Number of deletions started by DoomAllEntries() or DoomEntriesBetween()
+  // that have not completed yet. Nothing is added to the in-memory tier while
+  // this is non-zero.
+  int pending_doom_entries_count_ = 0;
+
   // The set of active entries indexed by cache key.
   ActiveEntriesMap active_entries_;
 
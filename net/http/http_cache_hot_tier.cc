@@ -0,0 +1,96 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_cache_hot_tier.h"
+
+#include <utility>
+
+#include "base/check_op.h"
+#include "net/base/io_buffer.h"
+
+namespace net {
+
+HttpCacheHotTier::Entry::Entry() = default;
+
+HttpCacheHotTier::Entry::Entry(scoped_refptr<IOBufferWithSize> response_info,
+                               scoped_refptr<IOBufferWithSize> body)
+    : response_info(std::move(response_info)), body(std::move(body)) {}
+
+HttpCacheHotTier::Entry::Entry(const Entry&) = default;
+
+HttpCacheHotTier::Entry& HttpCacheHotTier::Entry::operator=(const Entry&) =
+    default;
+
+HttpCacheHotTier::Entry::~Entry() = default;
+
+size_t HttpCacheHotTier::Entry::Size() const {
+  size_t size = 0;
+  if (response_info)
+    size += response_info->size();
+  if (body)
+    size += body->size();
+  return size;
+}
+
+HttpCacheHotTier::HttpCacheHotTier(size_t max_bytes)
+    : max_bytes_(max_bytes), entries_(EntryMap::NO_AUTO_EVICT) {}
+
+HttpCacheHotTier::~HttpCacheHotTier() = default;
+
+bool HttpCacheHotTier::CanStoreBody(size_t body_size) const {
+  return body_size <= max_bytes_ / kMaxEntryFraction;
+}
+
+const HttpCacheHotTier::Entry* HttpCacheHotTier::Lookup(
+    const std::string& key) {
+  auto it = entries_.Get(key);
+  if (it == entries_.end())
+    return nullptr;
+  if (base::TimeTicks::Now() - it->second.stored_at > kMaxEntryAge) {
+    Remove(key);
+    return nullptr;
+  }
+  return &it->second;
+}
+
+void HttpCacheHotTier::RecordLookupResult(bool served) {
+  RecordHotTierCacheEvent(
+      served ? HotTierCacheEvent::kHit : HotTierCacheEvent::kMiss, &counters_);
+}
+
+void HttpCacheHotTier::Put(const std::string& key, Entry entry) {
+  DCHECK(entry.response_info);
+  Remove(key);
+
+  size_t size = entry.Size();
+  if (size > max_bytes_ / kMaxEntryFraction)
+    return;
+
+  while (current_bytes_ + size > max_bytes_ && !entries_.empty()) {
+    auto oldest = entries_.rbegin();
+    current_bytes_ -= oldest->second.Size();
+    entries_.Erase(oldest);
+    RecordHotTierCacheEvent(HotTierCacheEvent::kEviction, &counters_);
+  }
+
+  current_bytes_ += size;
+  entry.stored_at = base::TimeTicks::Now();
+  entries_.Put(key, std::move(entry));
+}
+
+void HttpCacheHotTier::Remove(const std::string& key) {
+  auto it = entries_.Peek(key);
+  if (it == entries_.end())
+    return;
+  DCHECK_GE(current_bytes_, it->second.Size());
+  current_bytes_ -= it->second.Size();
+  entries_.Erase(it);
+}
+
+void HttpCacheHotTier::Clear() {
+  entries_.Clear();
+  current_bytes_ = 0;
+}
+
+}  // namespace net
@@ -0,0 +1,105 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_HTTP_HTTP_CACHE_HOT_TIER_H_
+#define NET_HTTP_HTTP_CACHE_HOT_TIER_H_
+
+#include <stddef.h>
+
+#include <string>
+
+#include "base/containers/lru_cache.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/time/time.h"
+#include "net/base/cache_metrics.h"
+#include "net/base/net_export.h"
+
+namespace net {
+
+class IOBufferWithSize;
+
+// A size-bounded, in-memory LRU of small, complete cache entries that sits in
+// front of the disk_cache::Backend used by HttpCache. Each entry holds the
+// serialized HttpResponseInfo exactly as it is stored in the disk entry, plus
+// the full response body, and is keyed by the HttpCache key of the request.
+//
+// The tier is a pure accelerator: HttpCache must drop an entry whenever the
+// corresponding disk entry is doomed or rewritten, and a miss always falls
+// back to the disk cache. The backend does not report the entries it evicts
+// or dooms on its own, so entries also expire kMaxEntryAge after they were
+// stored, which bounds how long such an entry can outlive its disk copy.
+class NET_EXPORT_PRIVATE HttpCacheHotTier {
+ public:
+  struct NET_EXPORT_PRIVATE Entry {
+    Entry();
+    Entry(scoped_refptr<IOBufferWithSize> response_info,
+          scoped_refptr<IOBufferWithSize> body);
+    Entry(const Entry&);
+    Entry& operator=(const Entry&);
+    ~Entry();
+
+    // Number of bytes charged against the tier's capacity.
+    size_t Size() const;
+
+    scoped_refptr<IOBufferWithSize> response_info;
+    scoped_refptr<IOBufferWithSize> body;
+
+    // Set by Put().
+    base::TimeTicks stored_at;
+  };
+
+  // |max_bytes| bounds the total size of all entries. Entries whose size
+  // exceeds |max_bytes| / kMaxEntryFraction are never stored, so that one
+  // large resource cannot flush the whole tier.
+  explicit HttpCacheHotTier(size_t max_bytes);
+
+  HttpCacheHotTier(const HttpCacheHotTier&) = delete;
+  HttpCacheHotTier& operator=(const HttpCacheHotTier&) = delete;
+
+  ~HttpCacheHotTier();
+
+  // Returns true if a body of |body_size| bytes is small enough to be stored.
+  bool CanStoreBody(size_t body_size) const;
+
+  // Looks up |key|, marking it most recently used. Returns nullptr if the key
+  // is not present or its entry has expired.
+  const Entry* Lookup(const std::string& key);
+
+  // Records whether a lookup ended up serving the request. An entry that was
+  // found but could not be used, e.g. because it is stale, counts as a miss.
+  void RecordLookupResult(bool served);
+
+  // Inserts or replaces the entry for |key|, evicting least recently used
+  // entries as needed. Does nothing if the entry is too large.
+  void Put(const std::string& key, Entry entry);
+
+  // Drops the entry for |key|, if any.
+  void Remove(const std::string& key);
+
+  // Drops every entry.
+  void Clear();
+
+  size_t max_bytes() const { return max_bytes_; }
+  size_t current_bytes() const { return current_bytes_; }
+  size_t entry_count() const { return entries_.size(); }
+  const HotTierCacheCounters& counters() const { return counters_; }
+
+  // Divisor of |max_bytes| giving the largest entry that will be stored.
+  static constexpr size_t kMaxEntryFraction = 8;
+
+  // How long an entry may be served after it was stored.
+  static constexpr base::TimeDelta kMaxEntryAge = base::Minutes(1);
+
+ private:
+  using EntryMap = base::HashingLRUCache<std::string, Entry>;
+
+  const size_t max_bytes_;
+  size_t current_bytes_ = 0;
+  EntryMap entries_;
+  HotTierCacheCounters counters_;
+};
+
+}  // namespace net
+
+#endif  // NET_HTTP_HTTP_CACHE_HOT_TIER_H_
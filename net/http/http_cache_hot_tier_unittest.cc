@@ -0,0 +1,119 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_cache_hot_tier.h"
+
+#include <string.h>
+
+#include <string>
+
+#include "base/test/task_environment.h"
+#include "net/base/io_buffer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+scoped_refptr<IOBufferWithSize> MakeBuffer(size_t size) {
+  auto buffer = base::MakeRefCounted<IOBufferWithSize>(size);
+  memset(buffer->data(), 'x', size);
+  return buffer;
+}
+
+HttpCacheHotTier::Entry MakeEntry(size_t info_size, size_t body_size) {
+  return HttpCacheHotTier::Entry(MakeBuffer(info_size), MakeBuffer(body_size));
+}
+
+TEST(HttpCacheHotTierTest, PutAndLookup) {
+  HttpCacheHotTier tier(8000);
+  EXPECT_FALSE(tier.Lookup("a"));
+
+  tier.Put("a", MakeEntry(100, 200));
+  const HttpCacheHotTier::Entry* entry = tier.Lookup("a");
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(100, entry->response_info->size());
+  EXPECT_EQ(200, entry->body->size());
+  EXPECT_EQ(300u, tier.current_bytes());
+  EXPECT_EQ(1u, tier.entry_count());
+
+  // Replacing an entry does not double count it.
+  tier.Put("a", MakeEntry(100, 100));
+  EXPECT_EQ(200u, tier.current_bytes());
+  EXPECT_EQ(1u, tier.entry_count());
+}
+
+TEST(HttpCacheHotTierTest, RejectsLargeEntries) {
+  HttpCacheHotTier tier(8000);
+  EXPECT_TRUE(tier.CanStoreBody(1000));
+  EXPECT_FALSE(tier.CanStoreBody(1001));
+
+  tier.Put("a", MakeEntry(1, 1000));
+  EXPECT_FALSE(tier.Lookup("a"));
+  EXPECT_EQ(0u, tier.current_bytes());
+}
+
+TEST(HttpCacheHotTierTest, EvictsLeastRecentlyUsed) {
+  HttpCacheHotTier tier(8000);
+  tier.Put("a", MakeEntry(0, 1000));
+  tier.Put("b", MakeEntry(0, 1000));
+  for (int i = 0; i < 6; ++i)
+    tier.Put("c" + std::to_string(i), MakeEntry(0, 1000));
+  EXPECT_EQ(8000u, tier.current_bytes());
+
+  // Touch "a" so that "b" is the oldest entry.
+  EXPECT_TRUE(tier.Lookup("a"));
+  tier.Put("d", MakeEntry(0, 1000));
+
+  EXPECT_TRUE(tier.Lookup("a"));
+  EXPECT_FALSE(tier.Lookup("b"));
+  EXPECT_TRUE(tier.Lookup("d"));
+  EXPECT_EQ(8000u, tier.current_bytes());
+  EXPECT_EQ(1u, tier.counters().evictions);
+}
+
+TEST(HttpCacheHotTierTest, RemoveAndClear) {
+  HttpCacheHotTier tier(8000);
+  tier.Put("a", MakeEntry(10, 10));
+  tier.Put("b", MakeEntry(10, 10));
+
+  tier.Remove("a");
+  tier.Remove("missing");
+  EXPECT_FALSE(tier.Lookup("a"));
+  EXPECT_EQ(20u, tier.current_bytes());
+
+  tier.Clear();
+  EXPECT_FALSE(tier.Lookup("b"));
+  EXPECT_EQ(0u, tier.current_bytes());
+  EXPECT_EQ(0u, tier.entry_count());
+}
+
+TEST(HttpCacheHotTierTest, EntriesExpire) {
+  base::test::TaskEnvironment task_environment(
+      base::test::TaskEnvironment::TimeSource::MOCK_TIME);
+  HttpCacheHotTier tier(8000);
+  tier.Put("a", MakeEntry(10, 10));
+
+  task_environment.FastForwardBy(HttpCacheHotTier::kMaxEntryAge);
+  EXPECT_TRUE(tier.Lookup("a"));
+
+  task_environment.FastForwardBy(base::Seconds(1));
+  EXPECT_FALSE(tier.Lookup("a"));
+  EXPECT_EQ(0u, tier.current_bytes());
+  EXPECT_EQ(0u, tier.entry_count());
+}
+
+TEST(HttpCacheHotTierTest, Counters) {
+  HttpCacheHotTier tier(8000);
+  tier.RecordLookupResult(true);
+  tier.RecordLookupResult(false);
+  tier.RecordLookupResult(false);
+  EXPECT_EQ(1u, tier.counters().hits);
+  EXPECT_EQ(2u, tier.counters().misses);
+  EXPECT_EQ(0u, tier.counters().evictions);
+}
+
+}  // namespace
+
+}  // namespace net
@@ -5,11 +5,15 @@
 #include "net/http/http_cache_lookup_manager.h"
 
 #include <memory>
+#include <utility>
 
 #include "base/bind.h"
 #include "base/containers/contains.h"
+#include "base/location.h"
+#include "base/threading/thread_task_runner_handle.h"
 #include "base/values.h"
 #include "net/base/load_flags.h"
+#include "net/base/network_isolation_key.h"
 #include "net/http/http_request_info.h"
 
 namespace net {
@@ -62,6 +66,43 @@ void HttpCacheLookupManager::LookupTransaction::OnLookupComplete(int result) {
       NetLogEventType::SERVER_PUSH_LOOKUP_TRANSACTION, result);
 }
 
+class HttpCacheLookupManager::BatchLookup {
+ public:
+  // |pending_| starts one above |count| so that the batch cannot complete
+  // while its lookups are still being issued; see DoneIssuing().
+  BatchLookup(size_t count, BatchLookupCallback callback)
+      : results_(count, HttpCache::ResourceFreshness::kAbsent),
+        pending_(count + 1),
+        callback_(std::move(callback)) {}
+
+  BatchLookup(const BatchLookup&) = delete;
+  BatchLookup& operator=(const BatchLookup&) = delete;
+
+  ~BatchLookup() = default;
+
+  // Records the result for the URL at |index|. Returns true once every result
+  // is in.
+  bool SetResult(size_t index, HttpCache::ResourceFreshness result) {
+    DCHECK_GT(pending_, 0u);
+    results_[index] = result;
+    return --pending_ == 0;
+  }
+
+  // Called once every lookup has been issued. Returns true if every result is
+  // already in.
+  bool DoneIssuing() {
+    DCHECK_GT(pending_, 0u);
+    return --pending_ == 0;
+  }
+
+  void RunCallback() { std::move(callback_).Run(std::move(results_)); }
+
+ private:
+  std::vector<HttpCache::ResourceFreshness> results_;
+  size_t pending_;
+  BatchLookupCallback callback_;
+};
+
 HttpCacheLookupManager::HttpCacheLookupManager(HttpCache* http_cache)
     : http_cache_(http_cache) {}
 
@@ -103,4 +144,45 @@ void HttpCacheLookupManager::OnLookupComplete(const GURL& url, int rv) {
   lookup_transactions_.erase(it);
 }
 
+void HttpCacheLookupManager::LookupBatch(
+    const std::vector<GURL>& urls,
+    const NetworkIsolationKey& network_isolation_key,
+    BatchLookupCallback callback) {
+  auto owned_batch =
+      std::make_unique<BatchLookup>(urls.size(), std::move(callback));
+  BatchLookup* batch = owned_batch.get();
+  batch_lookups_[batch] = std::move(owned_batch);
+
+  for (size_t i = 0; i < urls.size(); ++i) {
+    http_cache_->CheckResourceFreshness(
+        urls[i], "GET", network_isolation_key, /*is_subframe=*/false,
+        base::BindOnce(&HttpCacheLookupManager::OnBatchEntryChecked,
+                       weak_factory_.GetWeakPtr(), batch, i));
+  }
+
+  if (batch->DoneIssuing()) {
+    // Everything was answered synchronously, e.g. by the in-memory tier, or
+    // |urls| was empty. Never run the callback from within this call.
+    base::ThreadTaskRunnerHandle::Get()->PostTask(
+        FROM_HERE, base::BindOnce(&HttpCacheLookupManager::OnBatchLookupComplete,
+                                  weak_factory_.GetWeakPtr(), batch));
+  }
+}
+
+void HttpCacheLookupManager::OnBatchEntryChecked(
+    BatchLookup* batch,
+    size_t index,
+    HttpCache::ResourceFreshness result) {
+  if (batch->SetResult(index, result))
+    OnBatchLookupComplete(batch);
+}
+
+void HttpCacheLookupManager::OnBatchLookupComplete(BatchLookup* batch) {
+  auto it = batch_lookups_.find(batch);
+  DCHECK(it != batch_lookups_.end());
+  std::unique_ptr<BatchLookup> owned_batch = std::move(it->second);
+  batch_lookups_.erase(it);
+  owned_batch->RunCallback();
+}
+
 }  // namespace net
@@ -5,6 +5,11 @@
 #ifndef NET_HTTP_HTTP_CACHE_LOOKUP_MANAGER_H_
 #define NET_HTTP_HTTP_CACHE_LOOKUP_MANAGER_H_
 
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "base/callback.h"
 #include "base/memory/raw_ptr.h"
 #include "net/base/net_export.h"
 #include "net/http/http_cache.h"
@@ -13,6 +18,7 @@
 
 namespace net {
 
+class NetworkIsolationKey;
 struct HttpRequestInfo;
 
 // An implementation of ServerPushDelegate that issues an HttpCache::Transaction
@@ -32,7 +38,30 @@ class NET_EXPORT_PRIVATE HttpCacheLookupManager : public ServerPushDelegate {
   // server push if the response to the server push is found cached.
   void OnLookupComplete(const GURL& url, int rv);
 
+  using BatchLookupCallback =
+      base::OnceCallback<void(std::vector<HttpCache::ResourceFreshness>)>;
+
+  // Asks the cache about all of |urls| at once, e.g. for a preload list that
+  // is known up front. The entries are opened in parallel without creating an
+  // HttpCache::Transaction for each, and |callback| is invoked once, always
+  // asynchronously, with one result per URL in the order given. |callback| is
+  // not invoked if this object is destroyed first.
+  void LookupBatch(const std::vector<GURL>& urls,
+                   const NetworkIsolationKey& network_isolation_key,
+                   BatchLookupCallback callback);
+
  private:
+  // Collects the results of one LookupBatch() call.
+  class BatchLookup;
+
+  // Invoked when the lookup of the URL at |index| in |batch| completes.
+  void OnBatchEntryChecked(BatchLookup* batch,
+                           size_t index,
+                           HttpCache::ResourceFreshness result);
+
+  // Invoked when every lookup of |batch| has completed.
+  void OnBatchLookupComplete(BatchLookup* batch);
+
   // A class that takes the ownership of ServerPushHelper, issues and owns an
   // HttpCache::Transaction which lookups the response in cache for the server
   // push.
@@ -60,6 +89,7 @@ class NET_EXPORT_PRIVATE HttpCacheLookupManager : public ServerPushDelegate {
   // HttpCache must outlive the HttpCacheLookupManager.
   raw_ptr<HttpCache> http_cache_;
   std::map<GURL, std::unique_ptr<LookupTransaction>> lookup_transactions_;
+  std::map<BatchLookup*, std::unique_ptr<BatchLookup>> batch_lookups_;
   base::WeakPtrFactory<HttpCacheLookupManager> weak_factory_{this};
 };
 
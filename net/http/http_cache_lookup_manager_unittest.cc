@@ -4,9 +4,11 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/feature_list.h"
 #include "base/run_loop.h"
+#include "base/test/bind.h"
 #include "base/test/task_environment.h"
 #include "net/base/features.h"
 #include "net/base/net_errors.h"
@@ -21,6 +23,7 @@
 #include "testing/gtest/include/gtest/gtest.h"
 
 using net::test::IsOk;
+using testing::ElementsAre;
 
 namespace net {
 
@@ -75,11 +78,17 @@ std::unique_ptr<MockTransaction> CreateMockTransaction(const GURL& url) {
   return std::make_unique<MockTransaction>(mock_trans);
 }
 
-void PopulateCacheEntry(HttpCache* cache, const GURL& request_url) {
+// Writes a response for |request_url| to |cache|. If |response_headers| is
+// non-null it replaces the default, heuristically stale, headers.
+void PopulateCacheEntry(HttpCache* cache,
+                        const GURL& request_url,
+                        const char* response_headers = nullptr) {
   TestCompletionCallback callback;
 
   std::unique_ptr<MockTransaction> mock_trans =
       CreateMockTransaction(request_url);
+  if (response_headers)
+    mock_trans->response_headers = response_headers;
   AddMockTransaction(mock_trans.get());
 
   MockHttpRequest request(*(mock_trans.get()));
@@ -343,4 +352,57 @@ TEST(HttpCacheLookupManagerTest, ServerPushLookupOnUrl) {
   RemoveMockTransaction(mock_trans3.get());
 }
 
+TEST(HttpCacheLookupManagerTest, LookupBatch) {
+  base::test::TaskEnvironment task_environment;
+  MockHttpCache mock_cache;
+  HttpCacheLookupManager lookup_manager(mock_cache.http_cache());
+  GURL fresh_url("http://www.example.com/fresh.js");
+  GURL stale_url("http://www.example.com/stale.css");
+  GURL absent_url("http://www.example.com/absent.png");
+
+  PopulateCacheEntry(mock_cache.http_cache(), fresh_url,
+                     "Cache-Control: max-age=10000\n");
+  PopulateCacheEntry(mock_cache.http_cache(), stale_url);
+  EXPECT_EQ(2, mock_cache.network_layer()->transaction_count());
+  EXPECT_EQ(2, mock_cache.disk_cache()->create_count());
+
+  SchemefulSite site(fresh_url);
+  std::vector<HttpCache::ResourceFreshness> results;
+  base::RunLoop run_loop;
+  lookup_manager.LookupBatch(
+      {fresh_url, stale_url, absent_url}, NetworkIsolationKey(site, site),
+      base::BindLambdaForTesting(
+          [&](std::vector<HttpCache::ResourceFreshness> batch_results) {
+            results = std::move(batch_results);
+            run_loop.Quit();
+          }));
+  run_loop.Run();
+
+  EXPECT_THAT(results, ElementsAre(HttpCache::ResourceFreshness::kFresh,
+                                   HttpCache::ResourceFreshness::kStale,
+                                   HttpCache::ResourceFreshness::kAbsent));
+
+  // The lookups neither hit the network nor create entries.
+  EXPECT_EQ(2, mock_cache.network_layer()->transaction_count());
+  EXPECT_EQ(2, mock_cache.disk_cache()->create_count());
+}
+
+TEST(HttpCacheLookupManagerTest, LookupBatchIsAlwaysAsynchronous) {
+  base::test::TaskEnvironment task_environment;
+  MockHttpCache mock_cache;
+  HttpCacheLookupManager lookup_manager(mock_cache.http_cache());
+
+  bool called = false;
+  lookup_manager.LookupBatch(
+      {}, NetworkIsolationKey(),
+      base::BindLambdaForTesting(
+          [&](std::vector<HttpCache::ResourceFreshness> batch_results) {
+            EXPECT_TRUE(batch_results.empty());
+            called = true;
+          }));
+  EXPECT_FALSE(called);
+  base::RunLoop().RunUntilIdle();
+  EXPECT_TRUE(called);
+}
+
 }  // namespace net
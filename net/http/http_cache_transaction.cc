@@ -48,6 +48,7 @@
 #include "net/cert/cert_status_flags.h"
 #include "net/cert/x509_certificate.h"
 #include "net/disk_cache/disk_cache.h"
+#include "net/http/http_cache_hot_tier.h"
 #include "net/http/http_cache_writers.h"
 #include "net/http/http_log_util.h"
 #include "net/http/http_network_session.h"
@@ -363,6 +364,11 @@ int HttpCache::Transaction::Read(IOBuffer* buf,
 
 int HttpCache::Transaction::TransitionToReadingState() {
   if (!entry_) {
+    if (hot_tier_body_) {
+      next_state_ = STATE_CACHE_READ_DATA;
+      return OK;
+    }
+
     if (network_trans_) {
       // This can happen when the request should be handled exclusively by
       // the network layer (skipping the cache entirely using
@@ -1124,6 +1130,9 @@ int HttpCache::Transaction::DoInitEntry() {
     return OK;
   }
 
+  if (MaybeServeFromHotTier())
+    return OK;
+
   TransitionToState(STATE_OPEN_OR_CREATE_ENTRY);
   return OK;
 }
@@ -1545,7 +1554,10 @@ int HttpCache::Transaction::DoCacheReadResponse() {
   TransitionToState(STATE_CACHE_READ_RESPONSE_COMPLETE);
 
   io_buf_len_ = entry_->disk_entry->GetDataSize(kResponseInfoIndex);
-  read_buf_ = base::MakeRefCounted<IOBuffer>(io_buf_len_);
+  auto response_info = base::MakeRefCounted<IOBufferWithSize>(io_buf_len_);
+  read_buf_ = response_info;
+  if (cache_->hot_tier_)
+    hot_tier_response_info_ = std::move(response_info);
 
   net_log_.BeginEvent(NetLogEventType::HTTP_CACHE_READ_INFO);
   return entry_->disk_entry->ReadData(kResponseInfoIndex, 0, read_buf_.get(),
@@ -1566,6 +1578,7 @@ int HttpCache::Transaction::DoCacheReadResponseComplete(int result) {
   if (result != io_buf_len_ ||
       !HttpCache::ParseResponseInfo(read_buf_->data(), io_buf_len_, &response_,
                                     &truncated_)) {
+    hot_tier_response_info_ = nullptr;
     return OnCacheReadError(result, true);
   }
 
@@ -2459,15 +2472,24 @@ int HttpCache::Transaction::DoCacheReadData() {
     return 0;
   }
 
-  DCHECK(entry_);
+  DCHECK(entry_ || hot_tier_body_);
   TransitionToState(STATE_CACHE_READ_DATA_COMPLETE);
 
   net_log_.BeginEvent(NetLogEventType::HTTP_CACHE_READ_DATA);
+  if (hot_tier_body_) {
+    int len = std::min(read_buf_len_, hot_tier_body_->size() - read_offset_);
+    memcpy(read_buf_->data(), hot_tier_body_->data() + read_offset_, len);
+    return len;
+  }
+
   if (partial_) {
     return partial_->CacheRead(entry_->disk_entry, read_buf_.get(),
                                read_buf_len_, io_callback_);
   }
 
+  if (read_offset_ == 0)
+    MaybeStartHotTierCapture();
+
   return entry_->disk_entry->ReadData(kResponseContentIndex, read_offset_,
                                       read_buf_.get(), read_buf_len_,
                                       io_callback_);
@@ -2497,14 +2519,26 @@ int HttpCache::Transaction::DoCacheReadDataComplete(int result) {
     read_offset_ += result;
     if (checksum_)
       checksum_->Update(read_buf_->data(), result);
+    if (capturing_for_hot_tier_)
+      hot_tier_capture_.append(read_buf_->data(), result);
   } else if (result == 0) {  // End of file.
     if (!FinishAndCheckChecksum()) {
       TransitionToState(STATE_MARK_SINGLE_KEYED_CACHE_ENTRY_UNUSABLE);
       return result;
     }
 
+    if (capturing_for_hot_tier_)
+      FinishHotTierCapture();
+    if (hot_tier_body_) {
+      // There is no entry to be done with, but the transaction must not stay
+      // in READ mode.
+      hot_tier_body_ = nullptr;
+      mode_ = NONE;
+    }
     DoneWithEntry(true);
   } else {
+    capturing_for_hot_tier_ = false;
+    hot_tier_capture_.clear();
     return OnCacheReadError(result, false);
   }
 
@@ -3307,6 +3341,10 @@ int HttpCache::Transaction::DoConnectedCallbackComplete(int result) {
     // cache. In that case, proceed to read the bytes themselves.
     DCHECK(partial_);
     TransitionToState(STATE_CACHE_READ_DATA);
+  } else if (hot_tier_body_) {
+    // The response came from the in-memory tier, so there is no entry to
+    // set up.
+    TransitionToState(STATE_FINISH_HEADERS);
   } else {
     // Otherwise, we have just read headers from the cache.
     TransitionToState(STATE_SETUP_ENTRY_FOR_READ);
@@ -3328,6 +3366,9 @@ void HttpCache::Transaction::DoomInconsistentEntry() {
   // during the reading phase in the case of split range requests, since those
   // requests can result in multiple connections being obtained to different
   // remote endpoints.
+  if (cache_->hot_tier_)
+    cache_->hot_tier_->Remove(cache_key_);
+  hot_tier_body_ = nullptr;
   cache_->DoomActiveEntry(cache_key_);
   DoneWithEntry(/*entry_is_complete=*/false);
 }
@@ -3383,6 +3424,12 @@ int HttpCache::Transaction::WriteResponseInfoToEntry(
   if (!entry_)
     return OK;
 
+  // The stored response is about to change, so the in-memory tier must stop
+  // serving the old copy.
+  if (cache_->hot_tier_)
+    cache_->hot_tier_->Remove(cache_key_);
+  hot_tier_response_info_ = nullptr;
+
   net_log_.BeginEvent(NetLogEventType::HTTP_CACHE_WRITE_INFO);
 
   // Do not cache content with cert errors. This is to prevent not reporting net
@@ -3992,6 +4039,103 @@ void HttpCache::Transaction::ChecksumHeaders() {
   checksum_->Update("\n", 1);
 }
 
+bool HttpCache::Transaction::MaybeServeFromHotTier() {
+  // Range requests, single-keyed entries, prefetches and anything but a plain
+  // GET need the full state machine.
+  if (!cache_->hot_tier_ || (mode_ != READ && mode_ != READ_WRITE) ||
+      method_ != "GET" || partial_ || use_single_keyed_cache_ ||
+      (effective_load_flags_ & LOAD_PREFETCH)) {
+    return false;
+  }
+
+  const HttpCacheHotTier::Entry* hot_entry =
+      cache_->hot_tier_->Lookup(cache_key_);
+  if (!hot_entry) {
+    cache_->hot_tier_->RecordLookupResult(false);
+    return false;
+  }
+
+  HttpResponseInfo response;
+  bool truncated = false;
+  if (!HttpCache::ParseResponseInfo(hot_entry->response_info->data(),
+                                    hot_entry->response_info->size(), &response,
+                                    &truncated) ||
+      truncated || response.headers->response_code() != HTTP_OK ||
+      response.unused_since_prefetch || response.restricted_prefetch) {
+    cache_->hot_tier_->Remove(cache_key_);
+    cache_->hot_tier_->RecordLookupResult(false);
+    return false;
+  }
+
+  // RequiresValidation() works on |response_|. Anything short of a fresh
+  // match goes through the disk entry, which knows how to validate.
+  const bool old_vary_mismatch = vary_mismatch_;
+  const ValidationCause old_validation_cause = validation_cause_;
+  response_ = std::move(response);
+  if (RequiresValidation() != VALIDATION_NONE) {
+    response_ = HttpResponseInfo();
+    vary_mismatch_ = old_vary_mismatch;
+    validation_cause_ = old_validation_cause;
+    cache_->hot_tier_->RecordLookupResult(false);
+    return false;
+  }
+
+  cache_->hot_tier_->RecordLookupResult(true);
+  hot_tier_body_ = hot_entry->body;
+  read_offset_ = 0;
+  mode_ = READ;
+  if (first_cache_access_since_.is_null())
+    first_cache_access_since_ = TimeTicks::Now();
+  read_headers_since_ = TimeTicks::Now();
+  UpdateCacheEntryStatus(CacheEntryStatus::ENTRY_USED);
+  TransitionToState(STATE_CONNECTED_CALLBACK);
+  return true;
+}
+
+void HttpCache::Transaction::MaybeStartHotTierCapture() {
+  capturing_for_hot_tier_ = false;
+  hot_tier_capture_.clear();
+  if (!cache_->hot_tier_ || !hot_tier_response_info_ || mode_ != READ ||
+      method_ != "GET" || truncated_ || use_single_keyed_cache_ ||
+      response_.headers->response_code() != HTTP_OK) {
+    return;
+  }
+
+  int body_size = entry_->disk_entry->GetDataSize(kResponseContentIndex);
+  if (body_size < 0 ||
+      !cache_->hot_tier_->CanStoreBody(static_cast<size_t>(body_size))) {
+    return;
+  }
+
+  hot_tier_capture_.reserve(body_size);
+  hot_tier_capture_generation_ = cache_->hot_tier_generation_;
+  capturing_for_hot_tier_ = true;
+}
+
+void HttpCache::Transaction::FinishHotTierCapture() {
+  DCHECK(capturing_for_hot_tier_);
+  capturing_for_hot_tier_ = false;
+
+  // Between reading the headers and finishing the body, the entry may have
+  // been doomed and replaced, or the backend may have been cleared. Only the
+  // current entry may be mirrored.
+  if (entry_ && cache_->CanAddToHotTier(hot_tier_capture_generation_) &&
+      hot_tier_response_info_ &&
+      cache_->FindActiveEntry(cache_key_) == entry_ &&
+      static_cast<int>(hot_tier_capture_.size()) ==
+          entry_->disk_entry->GetDataSize(kResponseContentIndex)) {
+    auto body =
+        base::MakeRefCounted<IOBufferWithSize>(hot_tier_capture_.size());
+    memcpy(body->data(), hot_tier_capture_.data(), hot_tier_capture_.size());
+    cache_->hot_tier_->Put(
+        cache_key_,
+        HttpCacheHotTier::Entry(std::move(hot_tier_response_info_),
+                                std::move(body)));
+  }
+  hot_tier_response_info_ = nullptr;
+  hot_tier_capture_.clear();
+}
+
 bool HttpCache::Transaction::FinishAndCheckChecksum() {
   if (!checksum_)
     return true;
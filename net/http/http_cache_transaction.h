@@ -595,6 +595,20 @@ class NET_EXPORT_PRIVATE HttpCache::Transaction : public HttpTransaction {
   // headers.
   bool ShouldDisableCaching(const HttpResponseHeaders& headers) const;
 
+  // Serves the response from the HttpCache in-memory tier if it holds a fresh,
+  // complete copy for |cache_key_|, skipping the disk entry entirely. Returns
+  // true and sets the next state if it did.
+  bool MaybeServeFromHotTier();
+
+  // Starts copying the body being read from a complete disk entry so that it
+  // can be added to the in-memory tier once the whole body has been read.
+  void MaybeStartHotTierCapture();
+
+  // Adds the captured response to the in-memory tier, provided the entry it was
+  // read from is still the current one for |cache_key_| and the tier has not
+  // been invalidated since the capture started.
+  void FinishHotTierCapture();
+
   // Checksum headers in `request_` for matching against the single-keyed cache
   // checksum. Initializes `checksum_`.
   void ChecksumHeaders();
@@ -726,6 +740,22 @@ class NET_EXPORT_PRIVATE HttpCache::Transaction : public HttpTransaction {
   raw_ptr<WebSocketHandshakeStreamBase::CreateHelper>
       websocket_handshake_stream_base_create_helper_ = nullptr;
 
+  // Body of the response when it is served from the in-memory tier instead of
+  // a disk entry.
+  scoped_refptr<IOBufferWithSize> hot_tier_body_;
+
+  // Serialized response info as read from the disk entry, kept so that the
+  // response can be added to the in-memory tier after its body is read.
+  scoped_refptr<IOBufferWithSize> hot_tier_response_info_;
+
+  // Copy of the body read so far from the disk entry, when it is destined for
+  // the in-memory tier.
+  std::string hot_tier_capture_;
+  bool capturing_for_hot_tier_ = false;
+
+  // HttpCache::hot_tier_generation_ when the capture started.
+  uint64_t hot_tier_capture_generation_ = 0;
+
   // Set if we are currently calculating a checksum of the resource to validate
   // it against the expected checksum for the single-keyed cache. Accumulates a
   // hash of selected headers and the body of the response.
@@ -13828,4 +13828,152 @@ TEST_F(HttpCacheSingleKeyedCacheTest, RevalidationChangingCheckedHeader) {
   }
 }
 
+TEST_F(HttpCacheTest, HotTierDisabledByDefault) {
+  MockHttpCache cache;
+
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+
+  EXPECT_EQ(1, cache.network_layer()->transaction_count());
+  EXPECT_EQ(2, cache.disk_cache()->open_count());
+  HotTierCacheCounters counters = cache.http_cache()->GetHotTierCounters();
+  EXPECT_EQ(0u, counters.hits);
+  EXPECT_EQ(0u, counters.misses);
+}
+
+TEST_F(HttpCacheTest, HotTierServesWithoutOpeningEntry) {
+  MockHttpCache cache;
+  cache.http_cache()->SetHotTierMaxBytes(64 * 1024);
+
+  // The first request writes the entry, the second reads it from the disk
+  // cache and copies it into the in-memory tier.
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+  EXPECT_EQ(1, cache.network_layer()->transaction_count());
+  EXPECT_EQ(1, cache.disk_cache()->open_count());
+  EXPECT_EQ(0u, cache.http_cache()->GetHotTierCounters().hits);
+  EXPECT_EQ(2u, cache.http_cache()->GetHotTierCounters().misses);
+
+  // The third request is served from memory, body included.
+  HttpResponseInfo response_info;
+  RunTransactionTestWithResponseInfo(cache.http_cache(),
+                                     kSimpleGET_Transaction, &response_info);
+  EXPECT_TRUE(response_info.was_cached);
+  EXPECT_FALSE(response_info.network_accessed);
+  EXPECT_EQ(HttpResponseInfo::CacheEntryStatus::ENTRY_USED,
+            response_info.cache_entry_status);
+  EXPECT_EQ(1, cache.network_layer()->transaction_count());
+  EXPECT_EQ(1, cache.disk_cache()->open_count());
+  EXPECT_EQ(1u, cache.http_cache()->GetHotTierCounters().hits);
+}
+
+TEST_F(HttpCacheTest, HotTierDroppedWhenEntryIsReplaced) {
+  MockHttpCache cache;
+  cache.http_cache()->SetHotTierMaxBytes(64 * 1024);
+
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+  EXPECT_EQ(1, cache.disk_cache()->open_count());
+
+  // Rewriting the entry from the network invalidates the in-memory copy.
+  MockTransaction transaction(kSimpleGET_Transaction);
+  transaction.load_flags |= LOAD_BYPASS_CACHE;
+  RunTransactionTest(cache.http_cache(), transaction);
+  EXPECT_EQ(2, cache.network_layer()->transaction_count());
+
+  // So the next request goes back to the disk cache.
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+  EXPECT_EQ(2, cache.network_layer()->transaction_count());
+  EXPECT_EQ(2, cache.disk_cache()->open_count());
+  EXPECT_EQ(0u, cache.http_cache()->GetHotTierCounters().hits);
+}
+
+TEST_F(HttpCacheTest, HotTierRequiresFreshEntry) {
+  MockHttpCache cache;
+  cache.http_cache()->SetHotTierMaxBytes(64 * 1024);
+
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+
+  // A request that must be validated is not answered from memory.
+  MockTransaction transaction(kSimpleGET_Transaction);
+  transaction.load_flags |= LOAD_VALIDATE_CACHE;
+  RunTransactionTest(cache.http_cache(), transaction);
+  EXPECT_EQ(2, cache.network_layer()->transaction_count());
+  EXPECT_EQ(0u, cache.http_cache()->GetHotTierCounters().hits);
+}
+
+TEST_F(HttpCacheTest, HotTierClearedByDoomAllEntries) {
+  MockHttpCache cache;
+  cache.http_cache()->SetHotTierMaxBytes(64 * 1024);
+
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+
+  TestCompletionCallback doom_callback;
+  int rv = cache.http_cache()->DoomAllEntries(doom_callback.callback());
+  EXPECT_THAT(doom_callback.GetResult(rv), IsOk());
+
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+  EXPECT_EQ(2, cache.network_layer()->transaction_count());
+  EXPECT_EQ(0u, cache.http_cache()->GetHotTierCounters().hits);
+}
+
+// Tests that handing out the backend drops the in-memory tier, as callers may
+// delete entries through it directly.
+TEST_F(HttpCacheTest, HotTierClearedByGetBackend) {
+  MockHttpCache cache;
+  cache.http_cache()->SetHotTierMaxBytes(64 * 1024);
+
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+
+  disk_cache::Backend* backend = nullptr;
+  TestCompletionCallback callback;
+  int rv = cache.http_cache()->GetBackend(&backend, callback.callback());
+  ASSERT_THAT(callback.GetResult(rv), IsOk());
+  ASSERT_TRUE(backend);
+  TestCompletionCallback doom_callback;
+  rv = backend->DoomAllEntries(doom_callback.callback());
+  EXPECT_THAT(doom_callback.GetResult(rv), IsOk());
+
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+  EXPECT_EQ(2, cache.network_layer()->transaction_count());
+  EXPECT_EQ(0u, cache.http_cache()->GetHotTierCounters().hits);
+}
+
+// Tests that a response being read from the disk cache while the backend is
+// cleared does not make it into the in-memory tier.
+TEST_F(HttpCacheTest, HotTierIgnoresCaptureAcrossDoomAllEntries) {
+  MockHttpCache cache;
+  cache.http_cache()->SetHotTierMaxBytes(64 * 1024);
+
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+
+  MockHttpRequest request(kSimpleGET_Transaction);
+  std::unique_ptr<HttpTransaction> trans;
+  ASSERT_THAT(cache.CreateTransaction(&trans), IsOk());
+  TestCompletionCallback callback;
+  int rv = trans->Start(&request, callback.callback(), NetLogWithSource());
+  ASSERT_THAT(callback.GetResult(rv), IsOk());
+
+  auto buf = base::MakeRefCounted<IOBuffer>(10);
+  rv = trans->Read(buf.get(), 10, callback.callback());
+  EXPECT_EQ(10, callback.GetResult(rv));
+
+  TestCompletionCallback doom_callback;
+  rv = cache.http_cache()->DoomAllEntries(doom_callback.callback());
+  EXPECT_THAT(doom_callback.GetResult(rv), IsOk());
+
+  // Finish reading the body, which completes the capture.
+  std::string content;
+  EXPECT_THAT(ReadTransaction(trans.get(), &content), IsOk());
+  trans.reset();
+
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+  EXPECT_EQ(2, cache.network_layer()->transaction_count());
+  EXPECT_EQ(0u, cache.http_cache()->GetHotTierCounters().hits);
+}
+
 }  // namespace net
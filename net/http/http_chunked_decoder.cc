@@ -44,13 +44,16 @@
 
 #include "net/http/http_chunked_decoder.h"
 
+#include <string.h>
+
 #include <algorithm>
+#include <limits>
 
 #include "base/logging.h"
-#include "base/strings/string_number_conversions.h"
 #include "base/strings/string_piece.h"
 #include "base/strings/string_util.h"
 #include "net/base/net_errors.h"
+#include "net/http/http_header_scanner.h"
 
 namespace net {
 
@@ -61,40 +64,47 @@ const size_t HttpChunkedDecoder::kMaxLineBufLen = 16384;
 HttpChunkedDecoder::HttpChunkedDecoder() = default;
 
 int HttpChunkedDecoder::FilterBuf(char* buf, int buf_len) {
-  int result = 0;
-
-  while (buf_len > 0) {
+  // Chunk data is compacted towards the start of |buf| as chunk markers are
+  // dropped. |out| trails |in|, so every byte is moved at most once, however
+  // many chunks the buffer holds.
+  char* out = buf;
+  const char* in = buf;
+  const char* const end = buf + buf_len;
+
+  while (in < end) {
     if (chunk_remaining_ > 0) {
       // Since |chunk_remaining_| is positive and |buf_len| an int, the minimum
       // of the two must be an int.
       int num = static_cast<int>(
-          std::min(chunk_remaining_, static_cast<int64_t>(buf_len)));
+          std::min(chunk_remaining_, static_cast<int64_t>(end - in)));
 
-      buf_len -= num;
+      if (out != in)
+        memmove(out, in, num);
       chunk_remaining_ -= num;
-
-      result += num;
-      buf += num;
+      out += num;
+      in += num;
 
       // After each chunk's data there should be a CRLF.
       if (chunk_remaining_ == 0)
         chunk_terminator_remaining_ = true;
       continue;
     } else if (reached_eof_) {
-      bytes_after_eof_ += buf_len;
+      // Leave the extra bytes right after the decoded data.
+      int num = static_cast<int>(end - in);
+      if (out != in)
+        memmove(out, in, num);
+      bytes_after_eof_ += num;
       break;  // Done!
     }
 
-    int bytes_consumed = ScanForChunkRemaining(buf, buf_len);
+    int bytes_consumed = ScanForChunkRemaining(in, static_cast<int>(end - in));
     if (bytes_consumed < 0)
       return bytes_consumed; // Error
 
-    buf_len -= bytes_consumed;
-    if (buf_len > 0)
-      memmove(buf, buf + bytes_consumed, buf_len);
+    in += bytes_consumed;
   }
 
-  return result;
+  return static_cast<int>(out - buf);
 }
 
 int HttpChunkedDecoder::ScanForChunkRemaining(const char* buf, int buf_len) {
@@ -103,8 +113,9 @@ int HttpChunkedDecoder::ScanForChunkRemaining(const char* buf, int buf_len) {
 
   int bytes_consumed = 0;
 
-  size_t index_of_lf = base::StringPiece(buf, buf_len).find('\n');
-  if (index_of_lf != base::StringPiece::npos) {
+  size_t index_of_lf =
+      FindHeaderByte(base::StringPiece(buf, buf_len), 0, '\n');
+  if (index_of_lf != static_cast<size_t>(buf_len)) {
     buf_len = static_cast<int>(index_of_lf);
     if (buf_len && buf[buf_len - 1] == '\r')  // Eliminate a preceding CR.
       buf_len--;
@@ -195,21 +206,21 @@ bool HttpChunkedDecoder::ParseChunkSize(const char* start,
   while (len > 0 && start[len - 1] == ' ')
     len--;
 
-  // Be more restrictive than HexStringToInt64;
-  // don't allow inputs with leading "-", "+", "0x", "0X"
-  base::StringPiece chunk_size(start, len);
-  if (chunk_size.find_first_not_of("0123456789abcdefABCDEF")
-      != base::StringPiece::npos) {
+  // Be more restrictive than HexStringToInt64: don't allow inputs with leading
+  // "-", "+", "0x", "0X". Validate and convert in the same pass.
+  if (len == 0)
     return false;
-  }
 
-  int64_t parsed_number;
-  bool ok = base::HexStringToInt64(chunk_size, &parsed_number);
-  if (ok && parsed_number >= 0) {
-    *out = parsed_number;
-    return true;
+  int64_t parsed_number = 0;
+  for (int i = 0; i < len; ++i) {
+    if (!base::IsHexDigit(start[i]))
+      return false;
+    if (parsed_number > std::numeric_limits<int64_t>::max() >> 4)
+      return false;  // Overflow.
+    parsed_number = parsed_number * 16 + base::HexDigitToInt(start[i]);
   }
-  return false;
+  *out = parsed_number;
+  return true;
 }
 
 }  // namespace net
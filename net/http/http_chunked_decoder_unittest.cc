@@ -4,11 +4,17 @@
 
 #include "net/http/http_chunked_decoder.h"
 
+#include <string.h>
+
+#include <algorithm>
 #include <memory>
+#include <random>
 #include <string>
 #include <vector>
 
 #include "base/format_macros.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_piece.h"
 #include "base/strings/stringprintf.h"
 #include "net/base/net_errors.h"
 #include "net/test/gtest_util.h"
@@ -421,6 +427,189 @@ TEST(HttpChunkedDecoderTest, LongLengthLengthLine) {
   RunTestUntilFailure(inputs, std::size(inputs), 1);
 }
 
+// The decoder as it was before FilterBuf() was changed to compact the buffer
+// in a single pass. Used to check that the two behave identically.
+class ReferenceChunkedDecoder {
+ public:
+  bool reached_eof() const { return reached_eof_; }
+  int bytes_after_eof() const { return bytes_after_eof_; }
+
+  int FilterBuf(char* buf, int buf_len) {
+    int result = 0;
+    while (buf_len > 0) {
+      if (chunk_remaining_ > 0) {
+        int num = static_cast<int>(
+            std::min(chunk_remaining_, static_cast<int64_t>(buf_len)));
+        buf_len -= num;
+        chunk_remaining_ -= num;
+        result += num;
+        buf += num;
+        if (chunk_remaining_ == 0)
+          chunk_terminator_remaining_ = true;
+        continue;
+      } else if (reached_eof_) {
+        bytes_after_eof_ += buf_len;
+        break;
+      }
+
+      int bytes_consumed = ScanForChunkRemaining(buf, buf_len);
+      if (bytes_consumed < 0)
+        return bytes_consumed;
+
+      buf_len -= bytes_consumed;
+      if (buf_len > 0)
+        memmove(buf, buf + bytes_consumed, buf_len);
+    }
+    return result;
+  }
+
+ private:
+  int ScanForChunkRemaining(const char* buf, int buf_len) {
+    int bytes_consumed = 0;
+    size_t index_of_lf = base::StringPiece(buf, buf_len).find('\n');
+    if (index_of_lf != base::StringPiece::npos) {
+      buf_len = static_cast<int>(index_of_lf);
+      if (buf_len && buf[buf_len - 1] == '\r')
+        buf_len--;
+      bytes_consumed = static_cast<int>(index_of_lf) + 1;
+
+      if (!line_buf_.empty()) {
+        line_buf_.append(buf, buf_len);
+        buf = line_buf_.data();
+        buf_len = static_cast<int>(line_buf_.size());
+      }
+
+      if (reached_last_chunk_) {
+        if (buf_len == 0)
+          reached_eof_ = true;
+      } else if (chunk_terminator_remaining_) {
+        if (buf_len > 0)
+          return ERR_INVALID_CHUNKED_ENCODING;
+        chunk_terminator_remaining_ = false;
+      } else if (buf_len > 0) {
+        size_t index_of_semicolon = base::StringPiece(buf, buf_len).find(';');
+        if (index_of_semicolon != base::StringPiece::npos)
+          buf_len = static_cast<int>(index_of_semicolon);
+        if (!ParseChunkSize(buf, buf_len, &chunk_remaining_))
+          return ERR_INVALID_CHUNKED_ENCODING;
+        if (chunk_remaining_ == 0)
+          reached_last_chunk_ = true;
+      } else {
+        return ERR_INVALID_CHUNKED_ENCODING;
+      }
+      line_buf_.clear();
+    } else {
+      bytes_consumed = buf_len;
+      if (buf[buf_len - 1] == '\r')
+        buf_len--;
+      if (line_buf_.length() + buf_len > HttpChunkedDecoder::kMaxLineBufLen)
+        return ERR_INVALID_CHUNKED_ENCODING;
+      line_buf_.append(buf, buf_len);
+    }
+    return bytes_consumed;
+  }
+
+  static bool ParseChunkSize(const char* start, int len, int64_t* out) {
+    while (len > 0 && start[len - 1] == ' ')
+      len--;
+    base::StringPiece chunk_size(start, len);
+    if (chunk_size.find_first_not_of("0123456789abcdefABCDEF") !=
+        base::StringPiece::npos) {
+      return false;
+    }
+    int64_t parsed_number;
+    if (base::HexStringToInt64(chunk_size, &parsed_number) &&
+        parsed_number >= 0) {
+      *out = parsed_number;
+      return true;
+    }
+    return false;
+  }
+
+  int64_t chunk_remaining_ = 0;
+  std::string line_buf_;
+  bool chunk_terminator_remaining_ = false;
+  bool reached_last_chunk_ = false;
+  bool reached_eof_ = false;
+  int bytes_after_eof_ = 0;
+};
+
+// Returns a mostly well-formed chunked body, with the occasional stray byte.
+std::string MakeRandomChunkedBody(std::mt19937* rng) {
+  static const char* const kFragments[] = {
+      "0",  "00", "1",    "a",   "F",   "10",   "7fffffffffffffff",
+      "8000000000000000", "0000000000000000000001", ";",  ";ext=1",
+      " ",  "\t", "\r",   "\n",  "\r\n", "+",   "0x",  "-",  "zz",
+  };
+  auto random = [rng](int max) {
+    return std::uniform_int_distribution<int>(0, max)(*rng);
+  };
+
+  std::string body;
+  int num_chunks = random(20);
+  for (int i = 0; i < num_chunks; ++i) {
+    if (random(15) == 0)
+      body += kFragments[random(static_cast<int>(std::size(kFragments)) - 1)];
+    int size = random(3) == 0 ? random(2000) : random(20);
+    body += base::StringPrintf(random(1) ? "%x" : "%X", size);
+    if (random(7) == 0)
+      body += ";name=value";
+    if (random(7) == 0)
+      body += "  ";
+    body += random(5) == 0 ? "\n" : "\r\n";
+    for (int j = 0; j < size; ++j)
+      body += static_cast<char>(random(255));
+    body += random(5) == 0 ? "\n" : "\r\n";
+  }
+  if (random(3) != 0) {
+    body += "0\r\n";
+    if (random(3) == 0)
+      body += "Trailer: value\r\n";
+    body += "\r\n";
+    if (random(3) == 0)
+      body += "HTTP/1.1 200 OK\r\n";
+  }
+  return body;
+}
+
+// Decodes randomly generated bodies, split at random points, with both
+// HttpChunkedDecoder and ReferenceChunkedDecoder, and expects the same
+// results, including for the bytes after the end of the body.
+TEST(HttpChunkedDecoderTest, MatchesReferenceDecoder) {
+  std::mt19937 rng(1234);
+  for (int iteration = 0; iteration < 2000; ++iteration) {
+    SCOPED_TRACE(iteration);
+    std::string body = MakeRandomChunkedBody(&rng);
+
+    HttpChunkedDecoder decoder;
+    ReferenceChunkedDecoder reference;
+    size_t offset = 0;
+    while (offset < body.size()) {
+      size_t max_block = std::uniform_int_distribution<int>(0, 2)(rng) == 0
+                             ? body.size()
+                             : 64;
+      size_t block_size =
+          std::uniform_int_distribution<size_t>(1, max_block)(rng);
+      block_size = std::min(block_size, body.size() - offset);
+      std::string input = body.substr(offset, block_size);
+      std::string reference_input = input;
+      offset += block_size;
+
+      int n = decoder.FilterBuf(&input[0], static_cast<int>(input.size()));
+      int reference_n = reference.FilterBuf(
+          &reference_input[0], static_cast<int>(reference_input.size()));
+      ASSERT_EQ(reference_n, n);
+      if (n < 0)
+        break;
+      ASSERT_EQ(reference.reached_eof(), decoder.reached_eof());
+      ASSERT_EQ(reference.bytes_after_eof(), decoder.bytes_after_eof());
+      size_t used = n + (decoder.reached_eof() ? decoder.bytes_after_eof() : 0);
+      used = std::min(used, input.size());
+      ASSERT_EQ(reference_input.substr(0, used), input.substr(0, used));
+    }
+  }
+}
+
 }  // namespace
 
 }  // namespace net
@@ -0,0 +1,1089 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_coalescing_layer.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/callback.h"
+#include "base/check_op.h"
+#include "base/location.h"
+#include "base/memory/raw_ptr.h"
+#include "base/memory/ref_counted.h"
+#include "base/strings/strcat.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/threading/thread_task_runner_handle.h"
+#include "net/base/io_buffer.h"
+#include "net/base/load_timing_info.h"
+#include "net/base/net_errors.h"
+#include "net/base/transport_info.h"
+#include "net/http/http_raw_request_headers.h"
+#include "net/http/http_request_info.h"
+#include "net/http/http_response_headers.h"
+#include "net/http/http_response_info.h"
+#include "net/http/http_status_code.h"
+#include "net/http/http_transaction.h"
+#include "net/log/net_log_with_source.h"
+#include "net/socket/socket_tag.h"
+
+namespace net {
+
+namespace {
+
+// Size of the reads issued on the network transaction when the body is being
+// buffered for more than one consumer.
+constexpr int kNetworkReadSize = 32 * 1024;
+
+// Returns true if a successful response can be handed to requests other than
+// the one that started it.
+bool IsShareableResponse(const HttpResponseInfo& response) {
+  if (!response.headers)
+    return false;
+  // An auth challenge is answered per request, with that request's
+  // credentials.
+  int response_code = response.headers->response_code();
+  return response_code != HTTP_UNAUTHORIZED &&
+         response_code != HTTP_PROXY_AUTHENTICATION_REQUIRED;
+}
+
+}  // namespace
+
+// A consumer of a Job. The transaction that creates a job is its leader and
+// drives the network transaction until the response headers arrive; the
+// others are followers until then. Once the headers are in, every transaction
+// left on the job reads the body through it.
+class HttpCoalescingLayer::Transaction : public HttpTransaction {
+ public:
+  Transaction(RequestPriority priority,
+              base::WeakPtr<HttpCoalescingLayer> layer);
+
+  Transaction(const Transaction&) = delete;
+  Transaction& operator=(const Transaction&) = delete;
+
+  ~Transaction() override;
+
+  // HttpTransaction methods:
+  int Start(const HttpRequestInfo* request_info,
+            CompletionOnceCallback callback,
+            const NetLogWithSource& net_log) override;
+  int RestartIgnoringLastError(CompletionOnceCallback callback) override;
+  int RestartWithCertificate(scoped_refptr<X509Certificate> client_cert,
+                             scoped_refptr<SSLPrivateKey> client_private_key,
+                             CompletionOnceCallback callback) override;
+  int RestartWithAuth(const AuthCredentials& credentials,
+                      CompletionOnceCallback callback) override;
+  bool IsReadyToRestartForAuth() override;
+  int Read(IOBuffer* buf,
+           int buf_len,
+           CompletionOnceCallback callback) override;
+  void StopCaching() override;
+  int64_t GetTotalReceivedBytes() const override;
+  int64_t GetTotalSentBytes() const override;
+  void DoneReading() override;
+  const HttpResponseInfo* GetResponseInfo() const override;
+  LoadState GetLoadState() const override;
+  void SetQuicServerInfo(QuicServerInfo* quic_server_info) override;
+  bool GetLoadTimingInfo(LoadTimingInfo* load_timing_info) const override;
+  bool GetRemoteEndpoint(IPEndPoint* endpoint) const override;
+  void PopulateNetErrorDetails(NetErrorDetails* details) const override;
+  void SetPriority(RequestPriority priority) override;
+  void SetWebSocketHandshakeStreamCreateHelper(
+      WebSocketHandshakeStreamBase::CreateHelper* create_helper) override;
+  void SetBeforeNetworkStartCallback(
+      BeforeNetworkStartCallback callback) override;
+  void SetConnectedCallback(const ConnectedCallback& callback) override;
+  void SetRequestHeadersCallback(RequestHeadersCallback callback) override;
+  void SetEarlyResponseHeadersCallback(
+      ResponseHeadersCallback callback) override;
+  void SetResponseHeadersCallback(ResponseHeadersCallback callback) override;
+  int ResumeNetworkStart() override;
+  ConnectionAttempts GetConnectionAttempts() const override;
+  void CloseConnectionOnDestruction() override;
+
+  // The following are used by Job.
+  RequestPriority priority() const { return priority_; }
+  const HttpRequestInfo* request_info() const { return request_info_; }
+  const NetLogWithSource& net_log() const { return net_log_; }
+  const ConnectedCallback& connected_callback() const {
+    return connected_callback_;
+  }
+  const RequestHeadersCallback& request_headers_callback() const {
+    return request_headers_callback_;
+  }
+  const ResponseHeadersCallback& early_response_headers_callback() const {
+    return early_response_headers_callback_;
+  }
+  const ResponseHeadersCallback& response_headers_callback() const {
+    return response_headers_callback_;
+  }
+  BeforeNetworkStartCallback TakeBeforeNetworkStartCallback() {
+    return std::move(before_network_start_callback_);
+  }
+  WebSocketHandshakeStreamBase::CreateHelper*
+  websocket_handshake_stream_create_helper() const {
+    return websocket_handshake_stream_create_helper_;
+  }
+
+  void SetJob(scoped_refptr<Job> job, bool is_leader);
+
+  int64_t read_offset() const { return read_offset_; }
+  void AdvanceReadOffset(int bytes) { read_offset_ += bytes; }
+
+  bool has_pending_read() const { return !!pending_read_buf_; }
+  void SetPendingRead(IOBuffer* buf,
+                      int buf_len,
+                      CompletionOnceCallback callback);
+  // Retries the pending Read() now that |job_| may have data for it.
+  void ResumePendingRead();
+  // Completes the pending Read() with |result|, for data that the network
+  // transaction wrote straight into the read buffer.
+  void CompletePendingRead(int result);
+
+  // Completes the pending Start() or restart of the leader.
+  void OnLeaderIOComplete(int result);
+
+  // Called on a follower once the leader's response turned out to be
+  // shareable.
+  void OnSharedHeadersAvailable();
+
+  // Called on a follower once the leader's response turned out not to be
+  // shareable, or the leader went away before receiving it.
+  void RestartIndependently();
+
+  base::WeakPtr<Transaction> GetWeakPtr() { return weak_factory_.GetWeakPtr(); }
+
+ private:
+  // Starts or joins a job, according to the request and the callbacks set so
+  // far.
+  int StartInternal();
+
+  // Returns the network transaction if this transaction drives it, i.e. it is
+  // the leader of its job.
+  HttpTransaction* GetLeaderNetworkTransaction() const;
+
+  // Runs a restart on the network transaction, if this is the leader.
+  int RestartLeader(
+      base::OnceCallback<int(HttpTransaction*, CompletionOnceCallback)> restart,
+      CompletionOnceCallback callback);
+
+  void OnFollowerConnectedCallbackComplete(int result);
+
+  RequestPriority priority_;
+  const base::WeakPtr<HttpCoalescingLayer> layer_;
+
+  raw_ptr<const HttpRequestInfo> request_info_ = nullptr;
+  NetLogWithSource net_log_;
+  CompletionOnceCallback callback_;
+
+  scoped_refptr<Job> job_;
+  bool is_leader_ = false;
+  int64_t read_offset_ = 0;
+
+  scoped_refptr<IOBuffer> pending_read_buf_;
+  int pending_read_buf_len_ = 0;
+  CompletionOnceCallback pending_read_callback_;
+
+  ConnectedCallback connected_callback_;
+  RequestHeadersCallback request_headers_callback_;
+  ResponseHeadersCallback early_response_headers_callback_;
+  ResponseHeadersCallback response_headers_callback_;
+  BeforeNetworkStartCallback before_network_start_callback_;
+  raw_ptr<WebSocketHandshakeStreamBase::CreateHelper>
+      websocket_handshake_stream_create_helper_ = nullptr;
+
+  base::WeakPtrFactory<Transaction> weak_factory_{this};
+};
+
+// One network transaction and the transactions consuming it.
+class HttpCoalescingLayer::Job : public base::RefCounted<Job> {
+ public:
+  Job(base::WeakPtr<HttpCoalescingLayer> layer,
+      std::string key,
+      std::unique_ptr<HttpTransaction> network_trans);
+
+  Job(const Job&) = delete;
+  Job& operator=(const Job&) = delete;
+
+  const std::string& key() const { return key_; }
+
+  // Null once the job has been abandoned.
+  HttpTransaction* network_trans() const { return network_trans_.get(); }
+
+  bool headers_received() const { return state_ != State::kWaitingForHeaders; }
+  bool is_leader(const Transaction* transaction) const {
+    return transaction == leader_;
+  }
+
+  // Starts the network transaction for |leader|, with the semantics of
+  // HttpTransaction::Start().
+  int Start(Transaction* leader);
+
+  // Must be called with every result of the network transaction's Start() and
+  // restarts, whether synchronous or not. The first one decides what happens
+  // to the followers.
+  void OnLeaderResult(int result);
+
+  // Returns a callback for an asynchronous Start() or restart of the network
+  // transaction.
+  CompletionOnceCallback GetLeaderCallback();
+
+  void AddFollower(Transaction* follower);
+  void RemoveTransaction(Transaction* transaction);
+
+  // Has the semantics of HttpTransaction::Read(). If the data is not available
+  // yet, the caller records the read and is later resumed through
+  // Transaction::ResumePendingRead().
+  int Read(Transaction* consumer, IOBuffer* buf, int buf_len);
+
+  void DoneReading(Transaction* consumer);
+  void UpdatePriority();
+
+ private:
+  friend class base::RefCounted<Job>;
+
+  enum class State {
+    kWaitingForHeaders,
+    // The response goes to every consumer.
+    kShared,
+    // The response is only for the leader.
+    kNotShared,
+  };
+
+  ~Job();
+
+  // Copies data this job already has for |consumer| into |buf|. Returns
+  // ERR_IO_PENDING if there is none yet.
+  int ReadAvailable(Transaction* consumer, IOBuffer* buf, int buf_len);
+
+  // Reads from the network straight into the buffer of the only consumer.
+  int ReadDirect(Transaction* consumer, IOBuffer* buf, int buf_len);
+  void OnDirectReadComplete(Transaction* consumer, int result);
+
+  bool IsBufferFull() const;
+
+  // Reads from the network into |buffer_|. A synchronous result has already
+  // been appended when this returns.
+  int StartBufferedRead();
+  // Starts a buffered read if a consumer is waiting for data and the buffer
+  // has room.
+  void MaybeStartBufferedRead();
+  void OnBufferedReadComplete(int result);
+  void PostNotifyPendingReaders();
+  void AppendNetworkResult(int result);
+  void NotifyPendingReaders();
+
+  int64_t GetMinReadOffset() const;
+  void TrimBuffer();
+
+  // Forwarded to the leader, if it is still around.
+  int OnConnected(const TransportInfo& info, CompletionOnceCallback callback);
+  void OnRequestHeaders(HttpRawRequestHeaders headers);
+  void OnEarlyResponseHeaders(scoped_refptr<const HttpResponseHeaders> headers);
+  void OnResponseHeaders(scoped_refptr<const HttpResponseHeaders> headers);
+
+  const base::WeakPtr<HttpCoalescingLayer> layer_;
+  const std::string key_;
+  std::unique_ptr<HttpTransaction> network_trans_;
+  State state_ = State::kWaitingForHeaders;
+
+  raw_ptr<Transaction> leader_ = nullptr;
+  // Transactions waiting for the leader's response headers.
+  std::set<Transaction*> followers_;
+  // Transactions reading the body.
+  std::set<Transaction*> consumers_;
+
+  // Body bytes not yet read by every consumer. |buffer_[buffer_begin_]| is
+  // the byte at |buffer_offset_| in the body.
+  std::string buffer_;
+  size_t buffer_begin_ = 0;
+  int64_t buffer_offset_ = 0;
+  // Number of body bytes read from the network so far.
+  int64_t network_offset_ = 0;
+
+  scoped_refptr<IOBufferWithSize> read_buf_;
+  bool network_read_pending_ = false;
+  bool network_done_ = false;
+  // 0 at the end of the body, or the error that ended it.
+  int network_result_ = OK;
+};
+
+//-----------------------------------------------------------------------------
+
+HttpCoalescingLayer::Job::Job(base::WeakPtr<HttpCoalescingLayer> layer,
+                              std::string key,
+                              std::unique_ptr<HttpTransaction> network_trans)
+    : layer_(std::move(layer)),
+      key_(std::move(key)),
+      network_trans_(std::move(network_trans)) {}
+
+HttpCoalescingLayer::Job::~Job() {
+  if (layer_)
+    layer_->RemoveJoinableJob(this);
+}
+
+int HttpCoalescingLayer::Job::Start(Transaction* leader) {
+  DCHECK(!leader_);
+  leader_ = leader;
+
+  // The callbacks are forwarded rather than handed over, since the leader may
+  // leave while the network transaction carries on for the followers.
+  if (!leader->connected_callback().is_null()) {
+    network_trans_->SetConnectedCallback(
+        base::BindRepeating(&Job::OnConnected, base::Unretained(this)));
+  }
+  if (!leader->request_headers_callback().is_null()) {
+    network_trans_->SetRequestHeadersCallback(
+        base::BindRepeating(&Job::OnRequestHeaders, base::Unretained(this)));
+  }
+  if (!leader->early_response_headers_callback().is_null()) {
+    network_trans_->SetEarlyResponseHeadersCallback(base::BindRepeating(
+        &Job::OnEarlyResponseHeaders, base::Unretained(this)));
+  }
+  if (!leader->response_headers_callback().is_null()) {
+    network_trans_->SetResponseHeadersCallback(
+        base::BindRepeating(&Job::OnResponseHeaders, base::Unretained(this)));
+  }
+  // Requests with these are never merged, so the leader is the only consumer.
+  BeforeNetworkStartCallback before_network_start_callback =
+      leader->TakeBeforeNetworkStartCallback();
+  if (!before_network_start_callback.is_null()) {
+    DCHECK(key_.empty());
+    network_trans_->SetBeforeNetworkStartCallback(
+        std::move(before_network_start_callback));
+  }
+  if (leader->websocket_handshake_stream_create_helper()) {
+    DCHECK(key_.empty());
+    network_trans_->SetWebSocketHandshakeStreamCreateHelper(
+        leader->websocket_handshake_stream_create_helper());
+  }
+
+  UpdatePriority();
+  int rv = network_trans_->Start(leader->request_info(), GetLeaderCallback(),
+                                 leader->net_log());
+  if (rv != ERR_IO_PENDING)
+    OnLeaderResult(rv);
+  return rv;
+}
+
+CompletionOnceCallback HttpCoalescingLayer::Job::GetLeaderCallback() {
+  DCHECK(leader_);
+  // The network transaction is owned by this job, so it cannot outlive it.
+  return base::BindOnce(
+      [](Job* job, int result) {
+        job->OnLeaderResult(result);
+        if (job->leader_)
+          job->leader_->OnLeaderIOComplete(result);
+      },
+      base::Unretained(this));
+}
+
+void HttpCoalescingLayer::Job::OnLeaderResult(int result) {
+  if (state_ != State::kWaitingForHeaders)
+    return;
+
+  if (layer_)
+    layer_->RemoveJoinableJob(this);
+
+  bool shareable = result == OK &&
+                   !network_trans_->IsReadyToRestartForAuth() &&
+                   IsShareableResponse(*network_trans_->GetResponseInfo());
+  state_ = shareable ? State::kShared : State::kNotShared;
+  consumers_.insert(leader_);
+
+  // Followers are told from a fresh stack, since they may start network
+  // transactions or run consumer callbacks.
+  std::set<Transaction*> followers;
+  followers.swap(followers_);
+  for (Transaction* follower : followers) {
+    if (shareable) {
+      consumers_.insert(follower);
+      base::ThreadTaskRunnerHandle::Get()->PostTask(
+          FROM_HERE, base::BindOnce(&Transaction::OnSharedHeadersAvailable,
+                                    follower->GetWeakPtr()));
+    } else {
+      base::ThreadTaskRunnerHandle::Get()->PostTask(
+          FROM_HERE, base::BindOnce(&Transaction::RestartIndependently,
+                                    follower->GetWeakPtr()));
+    }
+  }
+  UpdatePriority();
+}
+
+void HttpCoalescingLayer::Job::AddFollower(Transaction* follower) {
+  DCHECK_EQ(State::kWaitingForHeaders, state_);
+  followers_.insert(follower);
+  UpdatePriority();
+}
+
+void HttpCoalescingLayer::Job::RemoveTransaction(Transaction* transaction) {
+  followers_.erase(transaction);
+  consumers_.erase(transaction);
+
+  if (transaction == leader_) {
+    leader_ = nullptr;
+    if (state_ == State::kWaitingForHeaders) {
+      // Nobody can restart the network transaction on the followers' behalf,
+      // so give up on it and let each of them start over.
+      if (layer_)
+        layer_->RemoveJoinableJob(this);
+      state_ = State::kNotShared;
+      network_trans_.reset();
+      std::set<Transaction*> followers;
+      followers.swap(followers_);
+      for (Transaction* follower : followers) {
+        base::ThreadTaskRunnerHandle::Get()->PostTask(
+            FROM_HERE, base::BindOnce(&Transaction::RestartIndependently,
+                                      follower->GetWeakPtr()));
+      }
+      return;
+    }
+  }
+
+  if (!network_trans_)
+    return;
+  UpdatePriority();
+  if (!headers_received())
+    return;
+  // The leaving transaction may have been the one holding back the others.
+  TrimBuffer();
+  MaybeStartBufferedRead();
+}
+
+int HttpCoalescingLayer::Job::Read(Transaction* consumer,
+                                   IOBuffer* buf,
+                                   int buf_len) {
+  DCHECK(headers_received());
+  DCHECK(consumers_.count(consumer));
+
+  int rv = ReadAvailable(consumer, buf, buf_len);
+  if (rv != ERR_IO_PENDING || network_read_pending_)
+    return rv;
+
+  // With a single consumer and nothing buffered, there is nothing to fan
+  // out; skip the copy.
+  if (consumers_.size() == 1 && buffer_begin_ == buffer_.size())
+    return ReadDirect(consumer, buf, buf_len);
+
+  if (IsBufferFull())
+    return ERR_IO_PENDING;
+
+  rv = StartBufferedRead();
+  if (rv == ERR_IO_PENDING)
+    return rv;
+  PostNotifyPendingReaders();
+  return ReadAvailable(consumer, buf, buf_len);
+}
+
+void HttpCoalescingLayer::Job::DoneReading(Transaction* consumer) {
+  if (!network_trans_)
+    return;
+  if (consumers_.size() == 1 && consumers_.count(consumer) && !network_done_ &&
+      consumer->read_offset() == network_offset_) {
+    network_trans_->DoneReading();
+  }
+  RemoveTransaction(consumer);
+}
+
+void HttpCoalescingLayer::Job::UpdatePriority() {
+  if (!network_trans_)
+    return;
+  RequestPriority priority = MINIMUM_PRIORITY;
+  if (leader_)
+    priority = std::max(priority, leader_->priority());
+  for (Transaction* transaction : followers_)
+    priority = std::max(priority, transaction->priority());
+  for (Transaction* transaction : consumers_)
+    priority = std::max(priority, transaction->priority());
+  network_trans_->SetPriority(priority);
+}
+
+int HttpCoalescingLayer::Job::ReadAvailable(Transaction* consumer,
+                                            IOBuffer* buf,
+                                            int buf_len) {
+  int64_t available = network_offset_ - consumer->read_offset();
+  if (available == 0)
+    return network_done_ ? network_result_ : ERR_IO_PENDING;
+
+  DCHECK_GE(consumer->read_offset(), buffer_offset_);
+  size_t start =
+      buffer_begin_ + static_cast<size_t>(consumer->read_offset() -
+                                          buffer_offset_);
+  int bytes = static_cast<int>(
+      std::min(static_cast<int64_t>(buf_len), available));
+  memcpy(buf->data(), buffer_.data() + start, bytes);
+  consumer->AdvanceReadOffset(bytes);
+
+  TrimBuffer();
+  MaybeStartBufferedRead();
+  return bytes;
+}
+
+int HttpCoalescingLayer::Job::ReadDirect(Transaction* consumer,
+                                         IOBuffer* buf,
+                                         int buf_len) {
+  network_read_pending_ = true;
+  // The job may be kept alive by a posted task after |consumer| is gone.
+  int rv = network_trans_->Read(
+      buf, buf_len,
+      base::BindOnce(
+          [](Job* job, base::WeakPtr<Transaction> consumer, int result) {
+            job->OnDirectReadComplete(consumer.get(), result);
+            if (consumer)
+              consumer->CompletePendingRead(result);
+          },
+          base::Unretained(this), consumer->GetWeakPtr()));
+  if (rv != ERR_IO_PENDING)
+    OnDirectReadComplete(consumer, rv);
+  return rv;
+}
+
+void HttpCoalescingLayer::Job::OnDirectReadComplete(Transaction* consumer,
+                                                    int result) {
+  network_read_pending_ = false;
+  if (result > 0) {
+    // The data went straight to |consumer|, so nothing is buffered.
+    network_offset_ += result;
+    buffer_offset_ = network_offset_;
+    if (consumer)
+      consumer->AdvanceReadOffset(result);
+  } else {
+    network_done_ = true;
+    network_result_ = result;
+  }
+}
+
+bool HttpCoalescingLayer::Job::IsBufferFull() const {
+  return network_offset_ - GetMinReadOffset() >=
+         static_cast<int64_t>(kMaxBufferedBytes);
+}
+
+int HttpCoalescingLayer::Job::StartBufferedRead() {
+  DCHECK(!network_read_pending_);
+  if (!read_buf_)
+    read_buf_ = base::MakeRefCounted<IOBufferWithSize>(kNetworkReadSize);
+  network_read_pending_ = true;
+  int rv = network_trans_->Read(
+      read_buf_.get(), read_buf_->size(),
+      base::BindOnce(&Job::OnBufferedReadComplete, base::Unretained(this)));
+  if (rv != ERR_IO_PENDING) {
+    network_read_pending_ = false;
+    AppendNetworkResult(rv);
+  }
+  return rv;
+}
+
+void HttpCoalescingLayer::Job::MaybeStartBufferedRead() {
+  if (!network_trans_ || network_read_pending_ || network_done_ ||
+      !headers_received() || IsBufferFull()) {
+    return;
+  }
+  bool has_pending_read = false;
+  for (Transaction* consumer : consumers_)
+    has_pending_read |= consumer->has_pending_read();
+  if (!has_pending_read)
+    return;
+
+  if (StartBufferedRead() != ERR_IO_PENDING)
+    PostNotifyPendingReaders();
+}
+
+void HttpCoalescingLayer::Job::OnBufferedReadComplete(int result) {
+  network_read_pending_ = false;
+  AppendNetworkResult(result);
+  NotifyPendingReaders();
+}
+
+void HttpCoalescingLayer::Job::PostNotifyPendingReaders() {
+  // Consumers that were already waiting are served from a fresh stack.
+  base::ThreadTaskRunnerHandle::Get()->PostTask(
+      FROM_HERE,
+      base::BindOnce(&Job::NotifyPendingReaders, base::WrapRefCounted(this)));
+}
+
+void HttpCoalescingLayer::Job::AppendNetworkResult(int result) {
+  if (result <= 0) {
+    network_done_ = true;
+    network_result_ = result;
+    return;
+  }
+  buffer_.append(read_buf_->data(), result);
+  network_offset_ += result;
+}
+
+void HttpCoalescingLayer::Job::NotifyPendingReaders() {
+  // A consumer may destroy itself, and with it the last other reference to
+  // this job, from its callback.
+  scoped_refptr<Job> self(this);
+  std::vector<base::WeakPtr<Transaction>> pending_readers;
+  for (Transaction* consumer : consumers_) {
+    if (consumer->has_pending_read())
+      pending_readers.push_back(consumer->GetWeakPtr());
+  }
+  for (const auto& consumer : pending_readers) {
+    if (consumer)
+      consumer->ResumePendingRead();
+  }
+}
+
+int64_t HttpCoalescingLayer::Job::GetMinReadOffset() const {
+  int64_t min_offset = network_offset_;
+  for (const Transaction* consumer : consumers_)
+    min_offset = std::min(min_offset, consumer->read_offset());
+  return min_offset;
+}
+
+void HttpCoalescingLayer::Job::TrimBuffer() {
+  int64_t min_offset = GetMinReadOffset();
+  DCHECK_GE(min_offset, buffer_offset_);
+  buffer_begin_ += static_cast<size_t>(min_offset - buffer_offset_);
+  buffer_offset_ = min_offset;
+  // Compact only once most of the buffer is dead, so that each byte is moved
+  // a bounded number of times.
+  if (buffer_begin_ == buffer_.size()) {
+    buffer_.clear();
+    buffer_begin_ = 0;
+  } else if (buffer_begin_ > buffer_.size() / 2) {
+    buffer_.erase(0, buffer_begin_);
+    buffer_begin_ = 0;
+  }
+}
+
+int HttpCoalescingLayer::Job::OnConnected(const TransportInfo& info,
+                                          CompletionOnceCallback callback) {
+  if (!leader_ || leader_->connected_callback().is_null())
+    return OK;
+  return leader_->connected_callback().Run(info, std::move(callback));
+}
+
+void HttpCoalescingLayer::Job::OnRequestHeaders(
+    HttpRawRequestHeaders headers) {
+  if (leader_ && !leader_->request_headers_callback().is_null())
+    leader_->request_headers_callback().Run(std::move(headers));
+}
+
+void HttpCoalescingLayer::Job::OnEarlyResponseHeaders(
+    scoped_refptr<const HttpResponseHeaders> headers) {
+  if (leader_ && !leader_->early_response_headers_callback().is_null())
+    leader_->early_response_headers_callback().Run(std::move(headers));
+}
+
+void HttpCoalescingLayer::Job::OnResponseHeaders(
+    scoped_refptr<const HttpResponseHeaders> headers) {
+  if (leader_ && !leader_->response_headers_callback().is_null())
+    leader_->response_headers_callback().Run(std::move(headers));
+}
+
+//-----------------------------------------------------------------------------
+
+HttpCoalescingLayer::Transaction::Transaction(
+    RequestPriority priority,
+    base::WeakPtr<HttpCoalescingLayer> layer)
+    : priority_(priority), layer_(std::move(layer)) {}
+
+HttpCoalescingLayer::Transaction::~Transaction() {
+  if (job_)
+    job_->RemoveTransaction(this);
+}
+
+int HttpCoalescingLayer::Transaction::Start(
+    const HttpRequestInfo* request_info,
+    CompletionOnceCallback callback,
+    const NetLogWithSource& net_log) {
+  DCHECK(!job_);
+  request_info_ = request_info;
+  net_log_ = net_log;
+  callback_ = std::move(callback);
+  int rv = StartInternal();
+  if (rv != ERR_IO_PENDING)
+    callback_.Reset();
+  return rv;
+}
+
+int HttpCoalescingLayer::Transaction::StartInternal() {
+  if (!layer_)
+    return ERR_UNEXPECTED;
+  std::string key;
+  if (before_network_start_callback_.is_null() &&
+      !websocket_handshake_stream_create_helper_) {
+    key = GetCoalescingKey(*request_info_);
+  }
+  return layer_->StartTransaction(this, key);
+}
+
+void HttpCoalescingLayer::Transaction::SetJob(scoped_refptr<Job> job,
+                                              bool is_leader) {
+  job_ = std::move(job);
+  is_leader_ = is_leader;
+  read_offset_ = 0;
+}
+
+HttpTransaction*
+HttpCoalescingLayer::Transaction::GetLeaderNetworkTransaction() const {
+  if (!job_ || !is_leader_)
+    return nullptr;
+  return job_->network_trans();
+}
+
+int HttpCoalescingLayer::Transaction::RestartLeader(
+    base::OnceCallback<int(HttpTransaction*, CompletionOnceCallback)> restart,
+    CompletionOnceCallback callback) {
+  // Followers never see a result that needs a restart; they are moved to
+  // their own network transaction instead.
+  HttpTransaction* network_trans = GetLeaderNetworkTransaction();
+  if (!network_trans)
+    return ERR_UNEXPECTED;
+  callback_ = std::move(callback);
+  int rv = std::move(restart).Run(network_trans, job_->GetLeaderCallback());
+  if (rv != ERR_IO_PENDING) {
+    callback_.Reset();
+    job_->OnLeaderResult(rv);
+  }
+  return rv;
+}
+
+int HttpCoalescingLayer::Transaction::RestartIgnoringLastError(
+    CompletionOnceCallback callback) {
+  return RestartLeader(
+      base::BindOnce([](HttpTransaction* network_trans,
+                        CompletionOnceCallback callback) {
+        return network_trans->RestartIgnoringLastError(std::move(callback));
+      }),
+      std::move(callback));
+}
+
+int HttpCoalescingLayer::Transaction::RestartWithCertificate(
+    scoped_refptr<X509Certificate> client_cert,
+    scoped_refptr<SSLPrivateKey> client_private_key,
+    CompletionOnceCallback callback) {
+  return RestartLeader(
+      base::BindOnce(
+          [](scoped_refptr<X509Certificate> client_cert,
+             scoped_refptr<SSLPrivateKey> client_private_key,
+             HttpTransaction* network_trans, CompletionOnceCallback callback) {
+            return network_trans->RestartWithCertificate(
+                std::move(client_cert), std::move(client_private_key),
+                std::move(callback));
+          },
+          std::move(client_cert), std::move(client_private_key)),
+      std::move(callback));
+}
+
+int HttpCoalescingLayer::Transaction::RestartWithAuth(
+    const AuthCredentials& credentials,
+    CompletionOnceCallback callback) {
+  return RestartLeader(
+      base::BindOnce(
+          [](const AuthCredentials& credentials,
+             HttpTransaction* network_trans, CompletionOnceCallback callback) {
+            return network_trans->RestartWithAuth(credentials,
+                                                  std::move(callback));
+          },
+          credentials),
+      std::move(callback));
+}
+
+bool HttpCoalescingLayer::Transaction::IsReadyToRestartForAuth() {
+  HttpTransaction* network_trans = GetLeaderNetworkTransaction();
+  return network_trans && network_trans->IsReadyToRestartForAuth();
+}
+
+int HttpCoalescingLayer::Transaction::Read(IOBuffer* buf,
+                                           int buf_len,
+                                           CompletionOnceCallback callback) {
+  DCHECK(!has_pending_read());
+  DCHECK_GT(buf_len, 0);
+  if (!job_ || !job_->network_trans() || !job_->headers_received())
+    return ERR_UNEXPECTED;
+
+  int rv = job_->Read(this, buf, buf_len);
+  if (rv == ERR_IO_PENDING)
+    SetPendingRead(buf, buf_len, std::move(callback));
+  return rv;
+}
+
+void HttpCoalescingLayer::Transaction::SetPendingRead(
+    IOBuffer* buf,
+    int buf_len,
+    CompletionOnceCallback callback) {
+  pending_read_buf_ = buf;
+  pending_read_buf_len_ = buf_len;
+  pending_read_callback_ = std::move(callback);
+}
+
+void HttpCoalescingLayer::Transaction::ResumePendingRead() {
+  if (!has_pending_read() || !job_)
+    return;
+
+  // The read is no longer pending while it is retried, so that the job does
+  // not read ahead on its behalf.
+  scoped_refptr<IOBuffer> buf = std::move(pending_read_buf_);
+  int buf_len = pending_read_buf_len_;
+  CompletionOnceCallback callback = std::move(pending_read_callback_);
+  pending_read_buf_len_ = 0;
+
+  int rv = job_->Read(this, buf.get(), buf_len);
+  if (rv == ERR_IO_PENDING) {
+    SetPendingRead(buf.get(), buf_len, std::move(callback));
+    return;
+  }
+  std::move(callback).Run(rv);
+}
+
+void HttpCoalescingLayer::Transaction::CompletePendingRead(int result) {
+  DCHECK(has_pending_read());
+  pending_read_buf_ = nullptr;
+  pending_read_buf_len_ = 0;
+  std::move(pending_read_callback_).Run(result);
+}
+
+void HttpCoalescingLayer::Transaction::StopCaching() {
+  if (HttpTransaction* network_trans = GetLeaderNetworkTransaction())
+    network_trans->StopCaching();
+}
+
+int64_t HttpCoalescingLayer::Transaction::GetTotalReceivedBytes() const {
+  // Bytes are attributed to the transaction that started the network
+  // transaction, like HttpCache does for readers of an entry.
+  HttpTransaction* network_trans = GetLeaderNetworkTransaction();
+  return network_trans ? network_trans->GetTotalReceivedBytes() : 0;
+}
+
+int64_t HttpCoalescingLayer::Transaction::GetTotalSentBytes() const {
+  HttpTransaction* network_trans = GetLeaderNetworkTransaction();
+  return network_trans ? network_trans->GetTotalSentBytes() : 0;
+}
+
+void HttpCoalescingLayer::Transaction::DoneReading() {
+  if (job_ && job_->headers_received())
+    job_->DoneReading(this);
+}
+
+const HttpResponseInfo* HttpCoalescingLayer::Transaction::GetResponseInfo()
+    const {
+  if (!job_ || !job_->network_trans())
+    return nullptr;
+  // Followers only see the response once it has been handed to them.
+  if (!is_leader_ && !job_->headers_received())
+    return nullptr;
+  return job_->network_trans()->GetResponseInfo();
+}
+
+LoadState HttpCoalescingLayer::Transaction::GetLoadState() const {
+  if (!job_ || !job_->network_trans())
+    return LOAD_STATE_IDLE;
+  return job_->network_trans()->GetLoadState();
+}
+
+void HttpCoalescingLayer::Transaction::SetQuicServerInfo(
+    QuicServerInfo* quic_server_info) {
+  if (HttpTransaction* network_trans = GetLeaderNetworkTransaction())
+    network_trans->SetQuicServerInfo(quic_server_info);
+}
+
+bool HttpCoalescingLayer::Transaction::GetLoadTimingInfo(
+    LoadTimingInfo* load_timing_info) const {
+  HttpTransaction* network_trans = GetLeaderNetworkTransaction();
+  return network_trans && network_trans->GetLoadTimingInfo(load_timing_info);
+}
+
+bool HttpCoalescingLayer::Transaction::GetRemoteEndpoint(
+    IPEndPoint* endpoint) const {
+  if (HttpTransaction* network_trans = GetLeaderNetworkTransaction())
+    return network_trans->GetRemoteEndpoint(endpoint);
+  const HttpResponseInfo* response = GetResponseInfo();
+  if (!response || response->remote_endpoint.address().empty())
+    return false;
+  *endpoint = response->remote_endpoint;
+  return true;
+}
+
+void HttpCoalescingLayer::Transaction::PopulateNetErrorDetails(
+    NetErrorDetails* details) const {
+  if (HttpTransaction* network_trans = GetLeaderNetworkTransaction())
+    network_trans->PopulateNetErrorDetails(details);
+}
+
+void HttpCoalescingLayer::Transaction::SetPriority(RequestPriority priority) {
+  priority_ = priority;
+  if (job_)
+    job_->UpdatePriority();
+}
+
+void HttpCoalescingLayer::Transaction::SetWebSocketHandshakeStreamCreateHelper(
+    WebSocketHandshakeStreamBase::CreateHelper* create_helper) {
+  DCHECK(!job_);
+  websocket_handshake_stream_create_helper_ = create_helper;
+}
+
+void HttpCoalescingLayer::Transaction::SetBeforeNetworkStartCallback(
+    BeforeNetworkStartCallback callback) {
+  DCHECK(!job_);
+  before_network_start_callback_ = std::move(callback);
+}
+
+void HttpCoalescingLayer::Transaction::SetConnectedCallback(
+    const ConnectedCallback& callback) {
+  connected_callback_ = callback;
+}
+
+void HttpCoalescingLayer::Transaction::SetRequestHeadersCallback(
+    RequestHeadersCallback callback) {
+  request_headers_callback_ = std::move(callback);
+}
+
+void HttpCoalescingLayer::Transaction::SetEarlyResponseHeadersCallback(
+    ResponseHeadersCallback callback) {
+  early_response_headers_callback_ = std::move(callback);
+}
+
+void HttpCoalescingLayer::Transaction::SetResponseHeadersCallback(
+    ResponseHeadersCallback callback) {
+  response_headers_callback_ = std::move(callback);
+}
+
+int HttpCoalescingLayer::Transaction::ResumeNetworkStart() {
+  HttpTransaction* network_trans = GetLeaderNetworkTransaction();
+  return network_trans ? network_trans->ResumeNetworkStart() : ERR_UNEXPECTED;
+}
+
+ConnectionAttempts HttpCoalescingLayer::Transaction::GetConnectionAttempts()
+    const {
+  HttpTransaction* network_trans = GetLeaderNetworkTransaction();
+  return network_trans ? network_trans->GetConnectionAttempts()
+                       : ConnectionAttempts();
+}
+
+void HttpCoalescingLayer::Transaction::CloseConnectionOnDestruction() {
+  // Whoever asks, the shared connection must not be reused.
+  if (job_ && job_->network_trans())
+    job_->network_trans()->CloseConnectionOnDestruction();
+}
+
+void HttpCoalescingLayer::Transaction::OnLeaderIOComplete(int result) {
+  DCHECK(is_leader_);
+  std::move(callback_).Run(result);
+}
+
+void HttpCoalescingLayer::Transaction::OnSharedHeadersAvailable() {
+  DCHECK(!is_leader_);
+  DCHECK(job_->headers_received());
+  if (connected_callback_.is_null()) {
+    OnFollowerConnectedCallbackComplete(OK);
+    return;
+  }
+
+  // Like a reader of a cache entry, a follower reports the transport of the
+  // response it was handed.
+  const HttpResponseInfo* response = GetResponseInfo();
+  TransportType type = response->was_fetched_via_proxy
+                           ? TransportType::kProxied
+                           : TransportType::kDirect;
+  int rv = connected_callback_.Run(
+      TransportInfo(type, response->remote_endpoint, ""),
+      base::BindOnce(&Transaction::OnFollowerConnectedCallbackComplete,
+                     weak_factory_.GetWeakPtr()));
+  if (rv != ERR_IO_PENDING)
+    OnFollowerConnectedCallbackComplete(rv);
+}
+
+void HttpCoalescingLayer::Transaction::OnFollowerConnectedCallbackComplete(
+    int result) {
+  if (result != OK) {
+    job_->RemoveTransaction(this);
+    job_ = nullptr;
+  } else if (!response_headers_callback_.is_null()) {
+    response_headers_callback_.Run(GetResponseInfo()->headers);
+  }
+  std::move(callback_).Run(result);
+}
+
+void HttpCoalescingLayer::Transaction::RestartIndependently() {
+  DCHECK(!is_leader_);
+  job_ = nullptr;
+  int rv = StartInternal();
+  if (rv != ERR_IO_PENDING)
+    std::move(callback_).Run(rv);
+}
+
+//-----------------------------------------------------------------------------
+
+HttpCoalescingLayer::HttpCoalescingLayer(
+    std::unique_ptr<HttpTransactionFactory> network_layer)
+    : network_layer_(std::move(network_layer)) {}
+
+HttpCoalescingLayer::~HttpCoalescingLayer() = default;
+
+int HttpCoalescingLayer::CreateTransaction(
+    RequestPriority priority,
+    std::unique_ptr<HttpTransaction>* trans) {
+  *trans = std::make_unique<Transaction>(priority, weak_factory_.GetWeakPtr());
+  return OK;
+}
+
+HttpCache* HttpCoalescingLayer::GetCache() {
+  return network_layer_->GetCache();
+}
+
+HttpNetworkSession* HttpCoalescingLayer::GetSession() {
+  return network_layer_->GetSession();
+}
+
+// static
+std::string HttpCoalescingLayer::GetCoalescingKey(
+    const HttpRequestInfo& request) {
+  if (request.method != "GET" || request.upload_data_stream ||
+      request.socket_tag != SocketTag()) {
+    return std::string();
+  }
+  // ToDebugString() tells transient keys apart, unlike ToString().
+  return base::StrCat(
+      {base::NumberToString(request.load_flags), " ",
+       base::NumberToString(static_cast<int>(request.privacy_mode)), " ",
+       base::NumberToString(static_cast<int>(request.secure_dns_policy)), " ",
+       base::NumberToString(static_cast<int>(request.idempotency)), " ",
+       request.network_isolation_key.ToDebugString(), " ", request.checksum,
+       " ", request.url.spec(), "\n", request.extra_headers.ToString()});
+}
+
+int HttpCoalescingLayer::StartTransaction(Transaction* transaction,
+                                          const std::string& key) {
+  if (!key.empty()) {
+    auto it = joinable_jobs_.find(key);
+    if (it != joinable_jobs_.end()) {
+      transaction->SetJob(base::WrapRefCounted(it->second),
+                          /*is_leader=*/false);
+      it->second->AddFollower(transaction);
+      return ERR_IO_PENDING;
+    }
+  }
+
+  std::unique_ptr<HttpTransaction> network_trans;
+  int rv = network_layer_->CreateTransaction(transaction->priority(),
+                                             &network_trans);
+  if (rv != OK)
+    return rv;
+
+  auto job = base::MakeRefCounted<Job>(weak_factory_.GetWeakPtr(), key,
+                                       std::move(network_trans));
+  if (!key.empty())
+    joinable_jobs_[key] = job.get();
+  transaction->SetJob(job, /*is_leader=*/true);
+  return job->Start(transaction);
+}
+
+void HttpCoalescingLayer::RemoveJoinableJob(Job* job) {
+  if (job->key().empty())
+    return;
+  auto it = joinable_jobs_.find(job->key());
+  if (it != joinable_jobs_.end() && it->second == job)
+    joinable_jobs_.erase(it);
+}
+
+}  // namespace net
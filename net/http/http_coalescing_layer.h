@@ -0,0 +1,96 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_HTTP_HTTP_COALESCING_LAYER_H_
+#define NET_HTTP_HTTP_COALESCING_LAYER_H_
+
+#include <stddef.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "base/memory/weak_ptr.h"
+#include "net/base/net_export.h"
+#include "net/base/request_priority.h"
+#include "net/http/http_transaction_factory.h"
+
+namespace net {
+
+struct HttpRequestInfo;
+
+// An HttpTransactionFactory that merges concurrent, identical GET requests
+// into a single network transaction, fanning the one response out to every
+// consumer in the way HttpCache::Writers does for cache entries.
+//
+// The first request for a given key starts a network transaction and behaves
+// exactly like a plain network transaction, auth and certificate restarts
+// included. Identical requests started before its response headers arrive
+// wait for them. If the response can be shared, they receive the same
+// HttpResponseInfo and their own copy of the body; otherwise, e.g. on an
+// error or an auth challenge, each is restarted on its own network
+// transaction. Requests started after the headers arrived are never merged.
+//
+// Requests are identical if they have the same URL, NetworkIsolationKey, load
+// flags, privacy mode, secure DNS policy and request headers. Requests with a
+// body, a SocketTag, a WebSocket handshake or a BeforeNetworkStartCallback are
+// never merged.
+//
+// Body data that has not been read by every consumer is kept in memory. Once
+// kMaxBufferedBytes are buffered, consumers that are ahead wait for the
+// slowest one.
+class NET_EXPORT HttpCoalescingLayer : public HttpTransactionFactory {
+ public:
+  // Maximum number of body bytes buffered for consumers that are behind.
+  static constexpr size_t kMaxBufferedBytes = 1024 * 1024;
+
+  explicit HttpCoalescingLayer(
+      std::unique_ptr<HttpTransactionFactory> network_layer);
+
+  HttpCoalescingLayer(const HttpCoalescingLayer&) = delete;
+  HttpCoalescingLayer& operator=(const HttpCoalescingLayer&) = delete;
+
+  ~HttpCoalescingLayer() override;
+
+  // HttpTransactionFactory methods:
+  int CreateTransaction(RequestPriority priority,
+                        std::unique_ptr<HttpTransaction>* trans) override;
+  HttpCache* GetCache() override;
+  HttpNetworkSession* GetSession() override;
+
+  HttpTransactionFactory* network_layer() { return network_layer_.get(); }
+
+  // Returns the number of network transactions that new requests can still
+  // join.
+  size_t GetJoinableJobCountForTesting() const {
+    return joinable_jobs_.size();
+  }
+
+ private:
+  class Job;
+  class Transaction;
+
+  // Returns the key under which |request| may be merged with others, or an
+  // empty string if it must run on its own.
+  static std::string GetCoalescingKey(const HttpRequestInfo& request);
+
+  // Attaches |transaction| to the joinable job for |key|, or to a new job if
+  // there is none or |key| is empty. Has the semantics of
+  // HttpTransaction::Start().
+  int StartTransaction(Transaction* transaction, const std::string& key);
+
+  // Called when |job| receives its response headers or goes away.
+  void RemoveJoinableJob(Job* job);
+
+  std::unique_ptr<HttpTransactionFactory> network_layer_;
+
+  // Jobs that are still waiting for response headers, by coalescing key.
+  std::map<std::string, Job*> joinable_jobs_;
+
+  base::WeakPtrFactory<HttpCoalescingLayer> weak_factory_{this};
+};
+
+}  // namespace net
+
+#endif  // NET_HTTP_HTTP_COALESCING_LAYER_H_
@@ -0,0 +1,261 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_coalescing_layer.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/memory/raw_ptr.h"
+#include "net/base/load_flags.h"
+#include "net/base/net_errors.h"
+#include "net/base/test_completion_callback.h"
+#include "net/http/http_response_info.h"
+#include "net/http/http_transaction.h"
+#include "net/http/http_transaction_test_util.h"
+#include "net/log/net_log_with_source.h"
+#include "net/test/gtest_util.h"
+#include "net/test/test_with_task_environment.h"
+#include "testing/gmock/include/gmock/gmock.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using net::test::IsError;
+using net::test::IsOk;
+
+namespace net {
+
+namespace {
+
+class HttpCoalescingLayerTest : public TestWithTaskEnvironment {
+ protected:
+  HttpCoalescingLayerTest() {
+    auto network_layer = std::make_unique<MockNetworkLayer>();
+    network_layer_ = network_layer.get();
+    layer_ = std::make_unique<HttpCoalescingLayer>(std::move(network_layer));
+  }
+
+  std::unique_ptr<HttpTransaction> CreateTransaction() {
+    std::unique_ptr<HttpTransaction> trans;
+    EXPECT_THAT(layer_->CreateTransaction(DEFAULT_PRIORITY, &trans), IsOk());
+    return trans;
+  }
+
+  // Starts |count| transactions for |request| without waiting for them.
+  void StartTransactions(const HttpRequestInfo& request,
+                         size_t count,
+                         std::vector<std::unique_ptr<HttpTransaction>>* trans,
+                         std::vector<TestCompletionCallback>* callbacks) {
+    *callbacks = std::vector<TestCompletionCallback>(count);
+    for (size_t i = 0; i < count; ++i) {
+      trans->push_back(CreateTransaction());
+      EXPECT_THAT(trans->back()->Start(&request, (*callbacks)[i].callback(),
+                                       NetLogWithSource()),
+                  IsError(ERR_IO_PENDING));
+    }
+  }
+
+  raw_ptr<MockNetworkLayer> network_layer_;
+  std::unique_ptr<HttpCoalescingLayer> layer_;
+};
+
+TEST_F(HttpCoalescingLayerTest, CoalescesIdenticalRequests) {
+  MockHttpRequest request(kSimpleGET_Transaction);
+  std::vector<std::unique_ptr<HttpTransaction>> trans;
+  std::vector<TestCompletionCallback> callbacks;
+  StartTransactions(request, 3, &trans, &callbacks);
+  EXPECT_EQ(1, network_layer_->transaction_count());
+  EXPECT_EQ(1u, layer_->GetJoinableJobCountForTesting());
+
+  for (size_t i = 0; i < trans.size(); ++i) {
+    EXPECT_THAT(callbacks[i].WaitForResult(), IsOk());
+    ASSERT_TRUE(trans[i]->GetResponseInfo());
+    EXPECT_EQ(200, trans[i]->GetResponseInfo()->headers->response_code());
+  }
+  EXPECT_EQ(0u, layer_->GetJoinableJobCountForTesting());
+
+  for (auto& transaction : trans) {
+    std::string content;
+    EXPECT_THAT(ReadTransaction(transaction.get(), &content), IsOk());
+    EXPECT_EQ(kSimpleGET_Transaction.data, content);
+  }
+  EXPECT_EQ(1, network_layer_->transaction_count());
+}
+
+TEST_F(HttpCoalescingLayerTest, LateRequestIsNotCoalesced) {
+  MockHttpRequest request(kSimpleGET_Transaction);
+  std::vector<std::unique_ptr<HttpTransaction>> trans;
+  std::vector<TestCompletionCallback> callbacks;
+  StartTransactions(request, 1, &trans, &callbacks);
+  EXPECT_THAT(callbacks[0].WaitForResult(), IsOk());
+
+  std::vector<std::unique_ptr<HttpTransaction>> late_trans;
+  StartTransactions(request, 1, &late_trans, &callbacks);
+  EXPECT_THAT(callbacks[0].WaitForResult(), IsOk());
+  EXPECT_EQ(2, network_layer_->transaction_count());
+}
+
+TEST_F(HttpCoalescingLayerTest, DifferentRequestsAreNotCoalesced) {
+  MockHttpRequest request(kSimpleGET_Transaction);
+  MockHttpRequest other_headers(kSimpleGET_Transaction);
+  other_headers.extra_headers.SetHeader("Accept", "text/plain");
+  MockHttpRequest other_flags(kSimpleGET_Transaction);
+  other_flags.load_flags |= LOAD_BYPASS_CACHE;
+  MockHttpRequest post(kSimplePOST_Transaction);
+
+  std::vector<std::unique_ptr<HttpTransaction>> trans;
+  std::vector<TestCompletionCallback> callbacks[4];
+  StartTransactions(request, 1, &trans, &callbacks[0]);
+  StartTransactions(other_headers, 1, &trans, &callbacks[1]);
+  StartTransactions(other_flags, 1, &trans, &callbacks[2]);
+  StartTransactions(post, 2, &trans, &callbacks[3]);
+  EXPECT_EQ(5, network_layer_->transaction_count());
+
+  for (auto& request_callbacks : callbacks) {
+    for (auto& callback : request_callbacks)
+      EXPECT_THAT(callback.WaitForResult(), IsOk());
+  }
+}
+
+TEST_F(HttpCoalescingLayerTest, AuthChallengeIsNotShared) {
+  ScopedMockTransaction transaction(kSimpleGET_Transaction);
+  transaction.status = "HTTP/1.1 401 Unauthorized";
+  transaction.response_headers = "WWW-Authenticate: Basic realm=\"x\"\n";
+  MockHttpRequest request(transaction);
+
+  std::vector<std::unique_ptr<HttpTransaction>> trans;
+  std::vector<TestCompletionCallback> callbacks;
+  StartTransactions(request, 2, &trans, &callbacks);
+  EXPECT_EQ(1, network_layer_->transaction_count());
+
+  // The follower is moved to a network transaction of its own.
+  for (auto& callback : callbacks)
+    EXPECT_THAT(callback.WaitForResult(), IsOk());
+  EXPECT_EQ(2, network_layer_->transaction_count());
+  for (auto& transaction : trans)
+    EXPECT_EQ(401, transaction->GetResponseInfo()->headers->response_code());
+}
+
+TEST_F(HttpCoalescingLayerTest, ErrorIsNotShared) {
+  ScopedMockTransaction transaction(kSimpleGET_Transaction);
+  transaction.start_return_code = ERR_CONNECTION_RESET;
+  MockHttpRequest request(transaction);
+
+  std::vector<std::unique_ptr<HttpTransaction>> trans;
+  std::vector<TestCompletionCallback> callbacks;
+  StartTransactions(request, 3, &trans, &callbacks);
+
+  for (auto& callback : callbacks)
+    EXPECT_THAT(callback.WaitForResult(), IsError(ERR_CONNECTION_RESET));
+  EXPECT_EQ(3, network_layer_->transaction_count());
+}
+
+TEST_F(HttpCoalescingLayerTest, LeaderCancelledBeforeHeaders) {
+  MockHttpRequest request(kSimpleGET_Transaction);
+  std::vector<std::unique_ptr<HttpTransaction>> trans;
+  std::vector<TestCompletionCallback> callbacks;
+  StartTransactions(request, 3, &trans, &callbacks);
+  trans[0].reset();
+
+  // The remaining requests start over, and share again.
+  for (size_t i = 1; i < trans.size(); ++i) {
+    EXPECT_THAT(callbacks[i].WaitForResult(), IsOk());
+    std::string content;
+    EXPECT_THAT(ReadTransaction(trans[i].get(), &content), IsOk());
+    EXPECT_EQ(kSimpleGET_Transaction.data, content);
+  }
+  EXPECT_EQ(2, network_layer_->transaction_count());
+}
+
+TEST_F(HttpCoalescingLayerTest, LeaderCancelledWhileReading) {
+  MockHttpRequest request(kSimpleGET_Transaction);
+  std::vector<std::unique_ptr<HttpTransaction>> trans;
+  std::vector<TestCompletionCallback> callbacks;
+  StartTransactions(request, 2, &trans, &callbacks);
+  for (auto& callback : callbacks)
+    EXPECT_THAT(callback.WaitForResult(), IsOk());
+
+  auto buf = base::MakeRefCounted<IOBuffer>(5);
+  TestCompletionCallback read_callback;
+  int rv = trans[0]->Read(buf.get(), 5, read_callback.callback());
+  EXPECT_EQ(5, read_callback.GetResult(rv));
+  trans[0].reset();
+
+  std::string content;
+  EXPECT_THAT(ReadTransaction(trans[1].get(), &content), IsOk());
+  EXPECT_EQ(kSimpleGET_Transaction.data, content);
+  EXPECT_EQ(1, network_layer_->transaction_count());
+}
+
+TEST_F(HttpCoalescingLayerTest, ConsumersReadAtTheirOwnPace) {
+  ScopedMockTransaction transaction(kSimpleGET_Transaction);
+  transaction.test_mode = TEST_MODE_SLOW_READ;
+  MockHttpRequest request(transaction);
+
+  std::vector<std::unique_ptr<HttpTransaction>> trans;
+  std::vector<TestCompletionCallback> callbacks;
+  StartTransactions(request, 2, &trans, &callbacks);
+  for (auto& callback : callbacks)
+    EXPECT_THAT(callback.WaitForResult(), IsOk());
+
+  // The second consumer only starts once the first has the whole body.
+  std::string content;
+  EXPECT_THAT(ReadTransaction(trans[0].get(), &content), IsOk());
+  EXPECT_EQ(kSimpleGET_Transaction.data, content);
+  EXPECT_THAT(ReadTransaction(trans[1].get(), &content), IsOk());
+  EXPECT_EQ(kSimpleGET_Transaction.data, content);
+  EXPECT_EQ(1, network_layer_->transaction_count());
+}
+
+TEST_F(HttpCoalescingLayerTest, FollowerRunsConnectedCallback) {
+  MockHttpRequest request(kSimpleGET_Transaction);
+  ConnectedHandler leader_handler;
+  ConnectedHandler follower_handler;
+
+  std::vector<std::unique_ptr<HttpTransaction>> trans;
+  std::vector<TestCompletionCallback> callbacks(2);
+  ConnectedHandler* handlers[] = {&leader_handler, &follower_handler};
+  for (size_t i = 0; i < 2; ++i) {
+    trans.push_back(CreateTransaction());
+    trans.back()->SetConnectedCallback(handlers[i]->Callback());
+    EXPECT_THAT(trans.back()->Start(&request, callbacks[i].callback(),
+                                    NetLogWithSource()),
+                IsError(ERR_IO_PENDING));
+  }
+  for (auto& callback : callbacks)
+    EXPECT_THAT(callback.WaitForResult(), IsOk());
+
+  EXPECT_THAT(leader_handler.transports(),
+              testing::ElementsAre(DefaultTransportInfo()));
+  EXPECT_THAT(follower_handler.transports(),
+              testing::ElementsAre(DefaultTransportInfo()));
+}
+
+TEST_F(HttpCoalescingLayerTest, FollowerConnectedCallbackError) {
+  MockHttpRequest request(kSimpleGET_Transaction);
+  ConnectedHandler follower_handler;
+  follower_handler.set_result(ERR_NOT_IMPLEMENTED);
+
+  std::vector<std::unique_ptr<HttpTransaction>> trans;
+  std::vector<TestCompletionCallback> callbacks;
+  StartTransactions(request, 1, &trans, &callbacks);
+  trans.push_back(CreateTransaction());
+  trans.back()->SetConnectedCallback(follower_handler.Callback());
+  TestCompletionCallback follower_callback;
+  EXPECT_THAT(trans.back()->Start(&request, follower_callback.callback(),
+                                  NetLogWithSource()),
+              IsError(ERR_IO_PENDING));
+
+  EXPECT_THAT(callbacks[0].WaitForResult(), IsOk());
+  EXPECT_THAT(follower_callback.WaitForResult(), IsError(ERR_NOT_IMPLEMENTED));
+
+  // The failed follower does not hold back the leader.
+  std::string content;
+  EXPECT_THAT(ReadTransaction(trans[0].get(), &content), IsOk());
+  EXPECT_EQ(kSimpleGET_Transaction.data, content);
+}
+
+}  // namespace
+
+}  // namespace net
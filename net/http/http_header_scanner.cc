@@ -0,0 +1,96 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_header_scanner.h"
+
+#include <stdint.h>
+
+#include "base/bits.h"
+#include "base/check_op.h"
+#include "build/build_config.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(ARCH_CPU_ARM64)
+#include <arm_neon.h>
+#endif
+
+namespace net {
+
+namespace {
+
+constexpr size_t kBlockSize = 16;
+
+#if defined(__SSE2__)
+
+// Returns a bitmask with bit i set if byte i of the 16-byte block at |p|
+// equals |a| or |b|.
+inline uint32_t MatchMask(const char* p, __m128i a, __m128i b) {
+  const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  const __m128i matches =
+      _mm_or_si128(_mm_cmpeq_epi8(block, a), _mm_cmpeq_epi8(block, b));
+  return static_cast<uint32_t>(_mm_movemask_epi8(matches));
+}
+
+size_t FindInBlocks(const char* data, size_t size, size_t pos, char a, char b) {
+  const __m128i va = _mm_set1_epi8(a);
+  const __m128i vb = _mm_set1_epi8(b);
+  for (; pos + kBlockSize <= size; pos += kBlockSize) {
+    uint32_t mask = MatchMask(data + pos, va, vb);
+    if (mask)
+      return pos + base::bits::CountTrailingZeroBits(mask);
+  }
+  return pos;
+}
+
+#elif defined(ARCH_CPU_ARM64)
+
+size_t FindInBlocks(const char* data, size_t size, size_t pos, char a, char b) {
+  const uint8x16_t va = vdupq_n_u8(static_cast<uint8_t>(a));
+  const uint8x16_t vb = vdupq_n_u8(static_cast<uint8_t>(b));
+  for (; pos + kBlockSize <= size; pos += kBlockSize) {
+    const uint8x16_t block =
+        vld1q_u8(reinterpret_cast<const uint8_t*>(data + pos));
+    const uint8x16_t matches =
+        vorrq_u8(vceqq_u8(block, va), vceqq_u8(block, vb));
+    if (vmaxvq_u8(matches)) {
+      // Matches are rare relative to the bytes scanned, so locating the exact
+      // byte with the scalar loop below is cheaper than building a bitmask.
+      break;
+    }
+  }
+  return pos;
+}
+
+#else
+
+size_t FindInBlocks(const char* data, size_t size, size_t pos, char a, char b) {
+  return pos;
+}
+
+#endif
+
+}  // namespace
+
+size_t FindHeaderByte(base::StringPiece buf, size_t pos, char c) {
+  return FindFirstOfHeaderBytes(buf, pos, c, c);
+}
+
+size_t FindFirstOfHeaderBytes(base::StringPiece buf,
+                              size_t pos,
+                              char a,
+                              char b) {
+  DCHECK_LE(pos, buf.size());
+  const char* data = buf.data();
+  const size_t size = buf.size();
+
+  pos = FindInBlocks(data, size, pos, a, b);
+  for (; pos < size; ++pos) {
+    if (data[pos] == a || data[pos] == b)
+      return pos;
+  }
+  return size;
+}
+
+}  // namespace net
@@ -0,0 +1,37 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_HTTP_HTTP_HEADER_SCANNER_H_
+#define NET_HTTP_HTTP_HEADER_SCANNER_H_
+
+#include <stddef.h>
+
+#include "base/strings/string_piece.h"
+#include "net/base/net_export.h"
+
+namespace net {
+
+// Byte scanners used on the response header hot paths (locating the end of
+// the header block, and splitting the block into lines and name/value pairs),
+// and to find chunk-size lines in chunked response bodies.
+// They compare 16 bytes at a time with SSE2 on x86 and NEON on ARM64, and fall
+// back to a plain loop elsewhere and for the tail of the input.
+
+// Returns the index of the first byte at or after |pos| in |buf| that is equal
+// to |c|, or |buf.size()| if there is none.
+NET_EXPORT_PRIVATE size_t FindHeaderByte(base::StringPiece buf,
+                                         size_t pos,
+                                         char c);
+
+// Returns the index of the first byte at or after |pos| in |buf| that is equal
+// to either |a| or |b|, or |buf.size()| if there is none. Used to find the
+// colon and the end of a header line in a single pass.
+NET_EXPORT_PRIVATE size_t FindFirstOfHeaderBytes(base::StringPiece buf,
+                                                 size_t pos,
+                                                 char a,
+                                                 char b);
+
+}  // namespace net
+
+#endif  // NET_HTTP_HTTP_HEADER_SCANNER_H_
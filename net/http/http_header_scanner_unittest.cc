@@ -0,0 +1,58 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_header_scanner.h"
+
+#include <string>
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+TEST(HttpHeaderScannerTest, FindHeaderByte) {
+  EXPECT_EQ(0u, FindHeaderByte("", 0, '\n'));
+  EXPECT_EQ(3u, FindHeaderByte("abc", 0, '\n'));
+  EXPECT_EQ(1u, FindHeaderByte("a\nb\n", 0, '\n'));
+  EXPECT_EQ(3u, FindHeaderByte("a\nb\n", 2, '\n'));
+  EXPECT_EQ(4u, FindHeaderByte("a\nb\n", 4, '\n'));
+}
+
+TEST(HttpHeaderScannerTest, FindFirstOfHeaderBytes) {
+  EXPECT_EQ(4u, FindFirstOfHeaderBytes("Host: a", 0, ':', '\0'));
+  EXPECT_EQ(4u, FindFirstOfHeaderBytes(base::StringPiece("Host\0: a", 8), 0,
+                                       ':', '\0'));
+  EXPECT_EQ(7u, FindFirstOfHeaderBytes("Host: a", 5, ':', '\0'));
+}
+
+// Checks every match position and start offset around the 16-byte blocks
+// compared by the vectorized paths against a plain scan.
+TEST(HttpHeaderScannerTest, MatchesScalarScanAcrossBlocks) {
+  for (size_t size = 0; size < 70; ++size) {
+    for (size_t match = 0; match <= size; ++match) {
+      std::string input(size, 'x');
+      if (match < size)
+        input[match] = ':';
+      // High-bit bytes must not be mistaken for matches.
+      if (size > 0 && match != 0)
+        input[0] = '\xba';
+      for (size_t pos = 0; pos <= size; ++pos) {
+        size_t expected = input.find_first_of(":\n", pos);
+        if (expected == std::string::npos)
+          expected = size;
+        EXPECT_EQ(expected, FindFirstOfHeaderBytes(input, pos, ':', '\n'))
+            << "size=" << size << " match=" << match << " pos=" << pos;
+        EXPECT_EQ(input.find(':', pos) == std::string::npos
+                      ? size
+                      : input.find(':', pos),
+                  FindHeaderByte(input, pos, ':'));
+      }
+    }
+  }
+}
+
+}  // namespace
+
+}  // namespace net
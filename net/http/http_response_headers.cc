@@ -9,6 +9,8 @@
 
 #include "net/http/http_response_headers.h"
 
+#include <string.h>
+
 #include <algorithm>
 #include <limits>
 #include <memory>
@@ -30,6 +32,7 @@
 #include "base/values.h"
 #include "net/base/parse_number.h"
 #include "net/http/http_byte_range.h"
+#include "net/http/http_header_scanner.h"
 #include "net/http/http_log_util.h"
 #include "net/http/http_status_code.h"
 #include "net/http/http_util.h"
@@ -121,6 +124,131 @@ bool ShouldUpdateHeader(base::StringPiece name) {
   return true;
 }
 
+// Lowercase names of the headers that are looked up most often, interned at
+// compile time. A header's position in this list is its HeaderNameId. Must be
+// kept sorted.
+constexpr base::StringPiece kWellKnownHeaderNames[] = {
+    "accept-ch",
+    "accept-ranges",
+    "access-control-allow-credentials",
+    "access-control-allow-headers",
+    "access-control-allow-methods",
+    "access-control-allow-origin",
+    "access-control-expose-headers",
+    "access-control-max-age",
+    "age",
+    "alt-svc",
+    "cache-control",
+    "clear-site-data",
+    "connection",
+    "content-disposition",
+    "content-encoding",
+    "content-language",
+    "content-length",
+    "content-location",
+    "content-range",
+    "content-security-policy",
+    "content-type",
+    "cross-origin-embedder-policy",
+    "cross-origin-opener-policy",
+    "cross-origin-resource-policy",
+    "date",
+    "etag",
+    "expect-ct",
+    "expires",
+    "keep-alive",
+    "last-modified",
+    "link",
+    "location",
+    "pragma",
+    "proxy-authenticate",
+    "proxy-connection",
+    "referrer-policy",
+    "retry-after",
+    "server",
+    "set-cookie",
+    "strict-transport-security",
+    "timing-allow-origin",
+    "trailer",
+    "transfer-encoding",
+    "upgrade",
+    "vary",
+    "www-authenticate",
+    "x-content-type-options",
+    "x-frame-options",
+    "x-xss-protection",
+};
+
+constexpr bool IsStrictlyLess(base::StringPiece a, base::StringPiece b) {
+  for (size_t i = 0; i < a.size() && i < b.size(); ++i) {
+    if (a[i] != b[i])
+      return a[i] < b[i];
+  }
+  return a.size() < b.size();
+}
+
+constexpr bool IsSortedAndLowercase(const base::StringPiece* names,
+                                    size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    for (size_t j = 0; j < names[i].size(); ++j) {
+      if (names[i][j] >= 'A' && names[i][j] <= 'Z')
+        return false;
+    }
+    if (i > 0 && !IsStrictlyLess(names[i - 1], names[i]))
+      return false;
+  }
+  return true;
+}
+
+static_assert(IsSortedAndLowercase(kWellKnownHeaderNames,
+                                   std::size(kWellKnownHeaderNames)),
+              "kWellKnownHeaderNames must be sorted and lowercase");
+
+// Value of a HeaderNameId for names that are not in kWellKnownHeaderNames.
+constexpr uint8_t kUnknownHeaderNameId = 0xFF;
+
+// FNV-1a hash of kWellKnownHeaderNames. PersistParsed() stores it next to the
+// serialized header name ids, which are indices into the table, so that ids
+// written against a different table are recomputed rather than trusted.
+constexpr uint32_t HashWellKnownHeaderNames(const base::StringPiece* names,
+                                            size_t count) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < count; ++i) {
+    for (size_t j = 0; j <= names[i].size(); ++j) {
+      hash ^= j < names[i].size() ? static_cast<uint8_t>(names[i][j]) : 0;
+      hash *= 16777619u;
+    }
+  }
+  return hash;
+}
+
+constexpr uint32_t kWellKnownHeaderNamesHash = HashWellKnownHeaderNames(
+    kWellKnownHeaderNames,
+    std::size(kWellKnownHeaderNames));
+
+// Number of uint32_t words PersistParsed() writes for each ParsedHeader.
+constexpr size_t kPersistedHeaderWords = 5;
+
+// Largest index into the parsed header list that |first_header_index_| can
+// record exactly. Larger indices are clamped, which keeps the stored value a
+// valid lower bound.
+constexpr size_t kMaxIndexedHeaderPosition = 0xFFFE;
+
+// Compares |name| case-insensitively with the lowercase |known| name. Returns
+// a negative value, zero or a positive value, like memcmp().
+int CompareWithWellKnownName(base::StringPiece name, base::StringPiece known) {
+  size_t length = std::min(name.size(), known.size());
+  for (size_t i = 0; i < length; ++i) {
+    unsigned char c = base::ToLowerASCII(name[i]);
+    unsigned char k = known[i];
+    if (c != k)
+      return c < k ? -1 : 1;
+  }
+  if (name.size() == known.size())
+    return 0;
+  return name.size() < known.size() ? -1 : 1;
+}
+
 bool HasEmbeddedNulls(base::StringPiece str) {
   for (char c : str) {
     if (c == '\0')
@@ -147,17 +275,17 @@ struct HttpResponseHeaders::ParsedHeader {
   // preceding header.  (Header values are comma separated.)
   bool is_continuation() const { return name_begin == name_end; }
 
-  std::string::const_iterator name_begin;
-  std::string::const_iterator name_end;
-  std::string::const_iterator value_begin;
-  std::string::const_iterator value_end;
-
-  // Write a representation of this object into a tracing proto.
-  void WriteIntoTrace(perfetto::TracedValue context) const {
-    auto dict = std::move(context).WriteDictionary();
-    dict.Add("name", base::MakeStringPiece(name_begin, name_end));
-    dict.Add("value", base::MakeStringPiece(value_begin, value_end));
-  }
+  // Offsets into raw_headers_, which is bounded well below 4GB. Offsets are
+  // less than half the size of iterators on 64-bit platforms and stay valid
+  // when the string is moved.
+  uint32_t name_begin;
+  uint32_t name_end;
+  uint32_t value_begin;
+  uint32_t value_end;
+
+  // Interned id of the name, or kUnknownHeaderNameId. Always
+  // kUnknownHeaderNameId for continuations.
+  HeaderNameId name_id;
 };
 
 //-----------------------------------------------------------------------------
@@ -192,6 +320,164 @@ HttpResponseHeaders::HttpResponseHeaders(base::PickleIterator* iter)
     Parse(raw_input);
 }
 
+HttpResponseHeaders::HttpResponseHeaders(std::string raw_headers,
+                                         int response_code,
+                                         HttpVersion http_version)
+    : raw_headers_(std::move(raw_headers)),
+      response_code_(response_code),
+      http_version_(http_version) {}
+
+// static
+scoped_refptr<HttpResponseHeaders> HttpResponseHeaders::CreateFromParsedPickle(
+    base::PickleIterator* iter) {
+  std::string raw_headers;
+  int response_code;
+  uint16_t major_version;
+  uint16_t minor_version;
+  if (!iter->ReadString(&raw_headers) || !iter->ReadInt(&response_code) ||
+      !iter->ReadUInt16(&major_version) || !iter->ReadUInt16(&minor_version)) {
+    return nullptr;
+  }
+
+  // Parse() never produces a negative status code, and always leaves the
+  // block terminated by two nulls.
+  if (response_code < 0 || raw_headers.size() < 2 ||
+      raw_headers.size() > std::numeric_limits<uint32_t>::max() ||
+      raw_headers[raw_headers.size() - 2] != '\0' ||
+      raw_headers[raw_headers.size() - 1] != '\0') {
+    return nullptr;
+  }
+
+  uint32_t names_hash;
+  uint32_t count;
+  if (!iter->ReadUInt32(&names_hash) || !iter->ReadUInt32(&count))
+    return nullptr;
+
+  // The stored status code and version only save parsing the status line. If
+  // they disagree with it, the entry is corrupt or stale, so the stored
+  // offsets are skipped as well and the block is parsed again.
+  const HttpVersion http_version(major_version, minor_version);
+  if (!StatusLineMatches(raw_headers, response_code, http_version)) {
+    const char* data;
+    size_t length;
+    if (!iter->ReadData(&data, &length))
+      return nullptr;
+    return base::MakeRefCounted<HttpResponseHeaders>(raw_headers);
+  }
+
+  // The constructor is private, so MakeRefCounted() cannot be used.
+  scoped_refptr<HttpResponseHeaders> headers =
+      base::WrapRefCounted(new HttpResponseHeaders(
+          std::move(raw_headers), response_code, http_version));
+  if (!headers->RestoreParsed(iter, count,
+                              names_hash == kWellKnownHeaderNamesHash)) {
+    return nullptr;
+  }
+
+  return headers;
+}
+
+// static
+bool HttpResponseHeaders::StatusLineMatches(const std::string& raw_headers,
+                                            int response_code,
+                                            HttpVersion http_version) {
+  // Parse() normalizes the status line to "HTTP/x.y CODE[ reason]".
+  const std::string::const_iterator line_begin = raw_headers.begin();
+  const std::string::const_iterator line_end =
+      line_begin + strlen(raw_headers.c_str());
+  if (ParseVersion(line_begin, line_end) != http_version)
+    return false;
+
+  std::string::const_iterator code = std::find(line_begin, line_end, ' ');
+  if (code == line_end)
+    return false;
+  ++code;
+  std::string::const_iterator p = code;
+  while (p < line_end && base::IsAsciiDigit(*p))
+    ++p;
+
+  int parsed_response_code;
+  return base::StringToInt(base::MakeStringPiece(code, p),
+                           &parsed_response_code) &&
+         parsed_response_code == response_code;
+}
+
+bool HttpResponseHeaders::RestoreParsed(base::PickleIterator* iter,
+                                        uint32_t count,
+                                        bool name_ids_match_table) {
+  DCHECK(parsed_.empty());
+  first_header_index_.fill(0);
+
+  constexpr size_t kEntrySize = kPersistedHeaderWords * sizeof(uint32_t);
+  const char* data;
+  size_t length;
+  if (!iter->ReadData(&data, &length) || length % kEntrySize != 0 ||
+      length / kEntrySize != count) {
+    return false;
+  }
+
+  // Every header lies between the status line and the final double null.
+  const uint32_t headers_begin =
+      static_cast<uint32_t>(strlen(raw_headers_.c_str()) + 1);
+  const uint32_t headers_end = static_cast<uint32_t>(raw_headers_.size() - 1);
+
+  // Entries are in the order of the block and never overlap, which
+  // HeaderLine() and GetNormalizedHeader() rely on.
+  uint32_t previous_end = headers_begin;
+  parsed_.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t words[kPersistedHeaderWords];
+    memcpy(words, data + i * kEntrySize, kEntrySize);
+
+    ParsedHeader& header = parsed_[i];
+    header.name_begin = words[0];
+    header.name_end = words[1];
+    header.value_begin = words[2];
+    header.value_end = words[3];
+    header.name_id = kUnknownHeaderNameId;
+    if (header.name_begin < previous_end ||
+        header.name_begin > header.name_end ||
+        header.name_end > header.value_begin ||
+        header.value_begin > header.value_end ||
+        header.value_end > headers_end) {
+      return false;
+    }
+    previous_end = header.value_end;
+
+    // The first entry must name a header. Continuations start at their value
+    // and never carry an id.
+    if (header.is_continuation()) {
+      if (i == 0 || header.name_begin != header.value_begin ||
+          words[4] != kUnknownHeaderNameId) {
+        return false;
+      }
+      continue;
+    }
+
+    // Ids written against a different kWellKnownHeaderNames table are
+    // meaningless and are looked up again. That is still much cheaper than a
+    // full Parse().
+    if (!name_ids_match_table) {
+      header.name_id = LookupHeaderNameId(HeaderName(header));
+    } else if (words[4] != kUnknownHeaderNameId) {
+      if (words[4] >= std::size(kWellKnownHeaderNames) ||
+          !base::EqualsCaseInsensitiveASCII(
+              HeaderName(header), kWellKnownHeaderNames[words[4]])) {
+        return false;
+      }
+      header.name_id = static_cast<HeaderNameId>(words[4]);
+    }
+
+    if (header.name_id != kUnknownHeaderNameId &&
+        !first_header_index_[header.name_id]) {
+      first_header_index_[header.name_id] = static_cast<uint16_t>(
+          std::min(i, kMaxIndexedHeaderPosition) + 1);
+    }
+  }
+
+  return true;
+}
+
 scoped_refptr<HttpResponseHeaders> HttpResponseHeaders::TryToCreate(
     base::StringPiece headers) {
   // Reject strings with nulls.
@@ -211,6 +497,45 @@ void HttpResponseHeaders::Persist(base::Pickle* pickle,
     return;  // Done.
   }
 
+  pickle->WriteString(
+      GetFilteredRawHeaders(GetPersistFilter(options), nullptr));
+}
+
+void HttpResponseHeaders::PersistParsed(base::Pickle* pickle,
+                                        PersistOptions options) {
+  HeaderList filtered_parsed;
+  std::string filtered_raw_headers;
+  const std::string* raw_headers = &raw_headers_;
+  const HeaderList* parsed = &parsed_;
+  if (options != PERSIST_RAW) {
+    filtered_raw_headers =
+        GetFilteredRawHeaders(GetPersistFilter(options), &filtered_parsed);
+    raw_headers = &filtered_raw_headers;
+    parsed = &filtered_parsed;
+  }
+
+  pickle->WriteString(*raw_headers);
+  pickle->WriteInt(response_code_);
+  pickle->WriteUInt16(http_version_.major_value());
+  pickle->WriteUInt16(http_version_.minor_value());
+  pickle->WriteUInt32(kWellKnownHeaderNamesHash);
+  pickle->WriteUInt32(static_cast<uint32_t>(parsed->size()));
+
+  std::vector<uint32_t> words;
+  words.reserve(parsed->size() * kPersistedHeaderWords);
+  for (const ParsedHeader& header : *parsed) {
+    words.push_back(header.name_begin);
+    words.push_back(header.name_end);
+    words.push_back(header.value_begin);
+    words.push_back(header.value_end);
+    words.push_back(header.name_id);
+  }
+  pickle->WriteData(reinterpret_cast<const char*>(words.data()),
+                    words.size() * sizeof(uint32_t));
+}
+
+HttpResponseHeaders::HeaderSet HttpResponseHeaders::GetPersistFilter(
+    PersistOptions options) const {
   HeaderSet filter_headers;
 
   // Construct set of headers to filter out based on options.
@@ -232,6 +557,12 @@ void HttpResponseHeaders::Persist(base::Pickle* pickle,
   if ((options & PERSIST_SANS_SECURITY_STATE) == PERSIST_SANS_SECURITY_STATE)
     AddSecurityStateHeaders(&filter_headers);
 
+  return filter_headers;
+}
+
+std::string HttpResponseHeaders::GetFilteredRawHeaders(
+    const HeaderSet& filter_headers,
+    HeaderList* parsed) const {
   std::string blob;
   blob.reserve(raw_headers_.size());
 
@@ -248,11 +579,25 @@ void HttpResponseHeaders::Persist(base::Pickle* pickle,
     while (++k < parsed_.size() && parsed_[k].is_continuation()) {}
     --k;
 
-    std::string header_name = base::ToLowerASCII(
-        base::MakeStringPiece(parsed_[i].name_begin, parsed_[i].name_end));
+    std::string header_name = base::ToLowerASCII(HeaderName(parsed_[i]));
     if (filter_headers.find(header_name) == filter_headers.end()) {
+      // The line is copied verbatim, so the offsets of its entries all move
+      // by the same amount.
+      if (parsed) {
+        const uint32_t line_begin = static_cast<uint32_t>(blob.size());
+        for (size_t j = i; j <= k; ++j) {
+          ParsedHeader header = parsed_[j];
+          header.name_begin += line_begin - parsed_[i].name_begin;
+          header.name_end += line_begin - parsed_[i].name_begin;
+          header.value_begin += line_begin - parsed_[i].name_begin;
+          header.value_end += line_begin - parsed_[i].name_begin;
+          parsed->push_back(header);
+        }
+      }
+
       // Make sure there is a null after the value.
-      blob.append(parsed_[i].name_begin, parsed_[k].value_end);
+      base::StringPiece line = HeaderLine(parsed_[i], parsed_[k]);
+      blob.append(line.data(), line.size());
       blob.push_back('\0');
     }
 
@@ -260,7 +605,7 @@ void HttpResponseHeaders::Persist(base::Pickle* pickle,
   }
   blob.push_back('\0');
 
-  pickle->WriteString(blob);
+  return blob;
 }
 
 void HttpResponseHeaders::Update(const HttpResponseHeaders& new_headers) {
@@ -287,15 +632,16 @@ void HttpResponseHeaders::Update(const HttpResponseHeaders& new_headers) {
     while (++k < new_parsed.size() && new_parsed[k].is_continuation()) {}
     --k;
 
-    auto name =
-        base::MakeStringPiece(new_parsed[i].name_begin, new_parsed[i].name_end);
+    base::StringPiece name = new_headers.HeaderName(new_parsed[i]);
     if (ShouldUpdateHeader(name)) {
       std::string name_lower = base::ToLowerASCII(name);
       updated_headers.insert(name_lower);
 
       // Preserve this header line in the merged result, making sure there is
       // a null after the value.
-      new_raw_headers.append(new_parsed[i].name_begin, new_parsed[k].value_end);
+      base::StringPiece line =
+          new_headers.HeaderLine(new_parsed[i], new_parsed[k]);
+      new_raw_headers.append(line.data(), line.size());
       new_raw_headers.push_back('\0');
     }
 
@@ -317,11 +663,11 @@ void HttpResponseHeaders::MergeWithHeaders(const std::string& raw_headers,
     while (++k < parsed_.size() && parsed_[k].is_continuation()) {}
     --k;
 
-    std::string name = base::ToLowerASCII(
-        base::MakeStringPiece(parsed_[i].name_begin, parsed_[i].name_end));
+    std::string name = base::ToLowerASCII(HeaderName(parsed_[i]));
     if (headers_to_remove.find(name) == headers_to_remove.end()) {
       // It's ok to preserve this header in the final result.
-      new_raw_headers.append(parsed_[i].name_begin, parsed_[k].value_end);
+      base::StringPiece line = HeaderLine(parsed_[i], parsed_[k]);
+      new_raw_headers.append(line.data(), line.size());
       new_raw_headers.push_back('\0');
     }
 
@@ -456,6 +802,8 @@ void HttpResponseHeaders::UpdateWithNewRange(const HttpByteRange& byte_range,
 }
 
 void HttpResponseHeaders::Parse(const std::string& raw_input) {
+  DCHECK(parsed_.empty());
+  first_header_index_.fill(0);
   raw_headers_.reserve(raw_input.size());
 
   // ParseStatusLine adds a normalized status line to raw_headers_
@@ -495,11 +843,42 @@ void HttpResponseHeaders::Parse(const std::string& raw_input) {
   // Adjust to point at the null byte following the status line
   line_end = raw_headers_.begin() + status_line_len - 1;
 
-  HttpUtil::HeadersIterator headers(line_end + 1, raw_headers_.end(),
-                                    std::string(1, '\0'));
-  while (headers.GetNext()) {
-    AddHeader(headers.name_begin(), headers.name_end(), headers.values_begin(),
-              headers.values_end());
+  // Split the remaining lines into name/value pairs. This matches what
+  // HttpUtil::HeadersIterator would produce, but finds each line's colon and
+  // terminating null in a single vectorized pass instead of tokenizing the
+  // block and then searching each line for the colon again.
+  const base::StringPiece block(raw_headers_);
+  const std::string::const_iterator block_begin = raw_headers_.begin();
+  size_t line_start = status_line_len;
+  while (line_start < block.size()) {
+    size_t colon = FindFirstOfHeaderBytes(block, line_start, ':', '\0');
+    size_t line_stop = colon;
+    if (colon < block.size() && block[colon] == ':')
+      line_stop = FindHeaderByte(block, colon + 1, '\0');
+    else
+      colon = std::string::npos;
+
+    const size_t name_start = line_start;
+    line_start = line_stop + 1;
+
+    // Skip empty and malformed lines. A name starting with LWS implies a line
+    // continuation, which AssembleRawHeaders() should already have joined.
+    if (colon == std::string::npos || colon == name_start ||
+        HttpUtil::IsLWS(block[name_start])) {
+      continue;
+    }
+
+    std::string::const_iterator name_begin = block_begin + name_start;
+    std::string::const_iterator name_end = block_begin + colon;
+    HttpUtil::TrimLWS(&name_begin, &name_end);
+    DCHECK(name_begin < name_end);
+    if (!HttpUtil::IsToken(base::MakeStringPiece(name_begin, name_end)))
+      continue;
+
+    std::string::const_iterator values_begin = block_begin + colon + 1;
+    std::string::const_iterator values_end = block_begin + line_stop;
+    HttpUtil::TrimLWS(&values_begin, &values_end);
+    AddHeader(name_begin, name_end, values_begin, values_end);
   }
 
   DCHECK_EQ('\0', raw_headers_[raw_headers_.size() - 2]);
@@ -525,11 +904,11 @@ bool HttpResponseHeaders::GetNormalizedHeader(base::StringPiece name,
 
     found = true;
 
-    std::string::const_iterator value_begin = parsed_[i].value_begin;
-    std::string::const_iterator value_end = parsed_[i].value_end;
+    size_t value_begin = parsed_[i].value_begin;
+    size_t value_end = parsed_[i].value_end;
     while (++i < parsed_.size() && parsed_[i].is_continuation())
       value_end = parsed_[i].value_end;
-    value->append(value_begin, value_end);
+    value->append(raw_headers_, value_begin, value_end - value_begin);
   }
 
   return found;
@@ -570,14 +949,15 @@ bool HttpResponseHeaders::EnumerateHeaderLines(size_t* iter,
 
   DCHECK(!parsed_[i].is_continuation());
 
-  name->assign(parsed_[i].name_begin, parsed_[i].name_end);
+  base::StringPiece header_name = HeaderName(parsed_[i]);
+  name->assign(header_name.data(), header_name.size());
 
-  std::string::const_iterator value_begin = parsed_[i].value_begin;
-  std::string::const_iterator value_end = parsed_[i].value_end;
+  size_t value_begin = parsed_[i].value_begin;
+  size_t value_end = parsed_[i].value_end;
   while (++i < parsed_.size() && parsed_[i].is_continuation())
     value_end = parsed_[i].value_end;
 
-  value->assign(value_begin, value_end);
+  value->assign(raw_headers_, value_begin, value_end - value_begin);
 
   *iter = i;
   return true;
@@ -605,7 +985,8 @@ bool HttpResponseHeaders::EnumerateHeader(size_t* iter,
 
   if (iter)
     *iter = i + 1;
-  value->assign(parsed_[i].value_begin, parsed_[i].value_end);
+  base::StringPiece header_value = HeaderValue(parsed_[i]);
+  value->assign(header_value.data(), header_value.size());
   return true;
 }
 
@@ -747,18 +1128,75 @@ void HttpResponseHeaders::ParseStatusLine(
 
 size_t HttpResponseHeaders::FindHeader(size_t from,
                                        base::StringPiece search) const {
+  const HeaderNameId search_id = LookupHeaderNameId(search);
+  if (search_id != kUnknownHeaderNameId) {
+    // Well-known names are compared by id, starting from the first entry that
+    // can possibly carry the name.
+    if (!first_header_index_[search_id])
+      return std::string::npos;
+    size_t first = first_header_index_[search_id] - 1;
+    for (size_t i = std::max(from, first); i < parsed_.size(); ++i) {
+      if (parsed_[i].name_id == search_id)
+        return i;
+    }
+    return std::string::npos;
+  }
+
   for (size_t i = from; i < parsed_.size(); ++i) {
-    if (parsed_[i].is_continuation())
+    // A header whose name is well-known cannot match a name that is not.
+    if (parsed_[i].is_continuation() ||
+        parsed_[i].name_id != kUnknownHeaderNameId) {
       continue;
-    auto name =
-        base::MakeStringPiece(parsed_[i].name_begin, parsed_[i].name_end);
-    if (base::EqualsCaseInsensitiveASCII(search, name))
+    }
+    if (base::EqualsCaseInsensitiveASCII(search, HeaderName(parsed_[i])))
       return i;
   }
 
   return std::string::npos;
 }
 
+// static
+HttpResponseHeaders::HeaderNameId HttpResponseHeaders::LookupHeaderNameId(
+    base::StringPiece name) {
+  static_assert(std::size(kWellKnownHeaderNames) <= kMaxWellKnownHeaderNames,
+                "first_header_index_ is too small");
+  static_assert(std::size(kWellKnownHeaderNames) < kUnknownHeaderNameId,
+                "HeaderNameId cannot represent every well-known name");
+
+  size_t low = 0;
+  size_t high = std::size(kWellKnownHeaderNames);
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    int order = CompareWithWellKnownName(name, kWellKnownHeaderNames[mid]);
+    if (order == 0)
+      return static_cast<HeaderNameId>(mid);
+    if (order < 0)
+      high = mid;
+    else
+      low = mid + 1;
+  }
+  return kUnknownHeaderNameId;
+}
+
+base::StringPiece HttpResponseHeaders::HeaderName(
+    const ParsedHeader& header) const {
+  return base::StringPiece(raw_headers_).substr(
+      header.name_begin, header.name_end - header.name_begin);
+}
+
+base::StringPiece HttpResponseHeaders::HeaderValue(
+    const ParsedHeader& header) const {
+  return base::StringPiece(raw_headers_).substr(
+      header.value_begin, header.value_end - header.value_begin);
+}
+
+base::StringPiece HttpResponseHeaders::HeaderLine(
+    const ParsedHeader& first,
+    const ParsedHeader& last) const {
+  return base::StringPiece(raw_headers_).substr(
+      first.name_begin, last.value_end - first.name_begin);
+}
+
 bool HttpResponseHeaders::GetCacheControlDirective(
     base::StringPiece directive,
     base::TimeDelta* result) const {
@@ -808,18 +1246,26 @@ void HttpResponseHeaders::AddHeader(std::string::const_iterator name_begin,
                                     std::string::const_iterator name_end,
                                     std::string::const_iterator values_begin,
                                     std::string::const_iterator values_end) {
+  base::StringPiece name = base::MakeStringPiece(name_begin, name_end);
+  HeaderNameId name_id = LookupHeaderNameId(name);
+
   // If the header can be coalesced, then we should split it up.
-  if (values_begin == values_end ||
-      HttpUtil::IsNonCoalescingHeader(
-          base::MakeStringPiece(name_begin, name_end))) {
-    AddToParsed(name_begin, name_end, values_begin, values_end);
+  if (values_begin == values_end || HttpUtil::IsNonCoalescingHeader(name)) {
+    AddToParsed(name_begin, name_end, values_begin, values_end, name_id);
   } else {
     HttpUtil::ValuesIterator it(values_begin, values_end, ',',
                                 false /* ignore_empty_values */);
+    bool is_continuation = false;
     while (it.GetNext()) {
-      AddToParsed(name_begin, name_end, it.value_begin(), it.value_end());
-      // clobber these so that subsequent values are treated as continuations
-      name_begin = name_end = raw_headers_.end();
+      // Subsequent values are continuations, with an empty name at the start
+      // of the value. That keeps every offset within the header's line, which
+      // GetFilteredRawHeaders() and RestoreParsed() rely on.
+      if (is_continuation)
+        name_begin = name_end = it.value_begin();
+      AddToParsed(name_begin, name_end, it.value_begin(), it.value_end(),
+                  name_id);
+      is_continuation = true;
+      name_id = kUnknownHeaderNameId;
     }
   }
 }
@@ -827,12 +1273,20 @@ void HttpResponseHeaders::AddHeader(std::string::const_iterator name_begin,
 void HttpResponseHeaders::AddToParsed(std::string::const_iterator name_begin,
                                       std::string::const_iterator name_end,
                                       std::string::const_iterator value_begin,
-                                      std::string::const_iterator value_end) {
+                                      std::string::const_iterator value_end,
+                                      HeaderNameId name_id) {
+  const std::string::const_iterator raw_begin = raw_headers_.begin();
   ParsedHeader header;
-  header.name_begin = name_begin;
-  header.name_end = name_end;
-  header.value_begin = value_begin;
-  header.value_end = value_end;
+  header.name_begin = static_cast<uint32_t>(name_begin - raw_begin);
+  header.name_end = static_cast<uint32_t>(name_end - raw_begin);
+  header.value_begin = static_cast<uint32_t>(value_begin - raw_begin);
+  header.value_end = static_cast<uint32_t>(value_end - raw_begin);
+  header.name_id = name_id;
+
+  if (name_id != kUnknownHeaderNameId && !first_header_index_[name_id]) {
+    first_header_index_[name_id] = static_cast<uint16_t>(
+        std::min(parsed_.size(), kMaxIndexedHeaderPosition) + 1);
+  }
   parsed_.push_back(header);
 }
 
@@ -954,8 +1408,7 @@ bool HttpResponseHeaders::IsRedirect(std::string* location) const {
   } while (parsed_[i].value_begin == parsed_[i].value_end);
 
   if (location) {
-    auto location_strpiece =
-        base::MakeStringPiece(parsed_[i].value_begin, parsed_[i].value_end);
+    base::StringPiece location_strpiece = HeaderValue(parsed_[i]);
     // Escape any non-ASCII characters to preserve them.  The server should
     // only be returning ASCII here, but for compat we need to do this.
     //
@@ -1405,7 +1858,22 @@ bool HttpResponseHeaders::IsCookieResponseHeader(base::StringPiece name) {
 void HttpResponseHeaders::WriteIntoTrace(perfetto::TracedValue context) const {
   perfetto::TracedDictionary dict = std::move(context).WriteDictionary();
   dict.Add("response_code", response_code_);
-  dict.Add("headers", parsed_);
+  perfetto::TracedArray headers = dict.AddArray("headers");
+  for (const ParsedHeader& header : parsed_) {
+    perfetto::TracedDictionary header_dict = headers.AppendDictionary();
+    header_dict.Add("name", HeaderName(header));
+    header_dict.Add("value", HeaderValue(header));
+  }
+}
+
+size_t HttpResponseHeaders::GetMemoryUsageForTesting() const {
+  return sizeof(*this) + raw_headers_.capacity() +
+         parsed_.capacity() * sizeof(ParsedHeader);
+}
+
+// static
+size_t HttpResponseHeaders::GetParsedHeaderSizeForTesting() {
+  return sizeof(ParsedHeader);
 }
 
 }  // namespace net
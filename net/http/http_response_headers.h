@@ -8,6 +8,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <array>
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -83,6 +84,13 @@ class NET_EXPORT HttpResponseHeaders
   // be passed to the pickle's various Read* methods.
   explicit HttpResponseHeaders(base::PickleIterator* pickle_iter);
 
+  // Initializes from the representation written by PersistParsed(). The
+  // stored header offsets are validated and reused, so the raw headers are not
+  // parsed again, unless the stored status code or HTTP version disagree with
+  // the status line. Returns nullptr if the data is malformed.
+  static scoped_refptr<HttpResponseHeaders> CreateFromParsedPickle(
+      base::PickleIterator* pickle_iter);
+
   // Takes headers as an ASCII string and tries to parse them as HTTP response
   // headers. returns nullptr on failure. Unlike the HttpResponseHeaders
   // constructor that takes a std::string, HttpUtil::AssembleRawHeaders should
@@ -97,6 +105,10 @@ class NET_EXPORT HttpResponseHeaders
   // The options argument can be a combination of PersistOptions.
   void Persist(base::Pickle* pickle, PersistOptions options);
 
+  // Like Persist(), but also records the status code, the HTTP version and
+  // the position of every header, for use by CreateFromParsedPickle().
+  void PersistParsed(base::Pickle* pickle, PersistOptions options);
+
   // Performs header merging as described in 13.5.3 of RFC 2616.
   void Update(const HttpResponseHeaders& new_headers);
 
@@ -341,20 +353,65 @@ class NET_EXPORT HttpResponseHeaders
   // Write a representation of this object into tracing proto.
   void WriteIntoTrace(perfetto::TracedValue context) const;
 
+  // Returns the number of heap and inline bytes used to hold the parsed
+  // headers, including the raw header block and the lookup index.
+  size_t GetMemoryUsageForTesting() const;
+
+  // Returns the size of a single entry of the parsed header list.
+  static size_t GetParsedHeaderSizeForTesting();
+
  private:
   friend class base::RefCountedThreadSafe<HttpResponseHeaders>;
 
   using HeaderSet = std::unordered_set<std::string>;
 
-  // The members of this structure point into raw_headers_.
+  // Index of a header name in the compile-time table of well-known header
+  // names, or kUnknownHeaderNameId.
+  using HeaderNameId = uint8_t;
+
+  // The members of this structure are offsets into raw_headers_.
   struct ParsedHeader;
   typedef std::vector<ParsedHeader> HeaderList;
 
+  // Upper bound on the number of well-known header names, used to size the
+  // lookup index.
+  static constexpr size_t kMaxWellKnownHeaderNames = 64;
+
+  // Used by CreateFromParsedPickle(). |raw_headers| must already be in the
+  // normalized form described for |raw_headers_|.
+  HttpResponseHeaders(std::string raw_headers,
+                      int response_code,
+                      HttpVersion http_version);
+
   ~HttpResponseHeaders();
 
   // Initializes from the given raw headers.
   void Parse(const std::string& raw_input);
 
+  // Returns true if the status line at the start of |raw_headers|, which must
+  // be normalized, has the given status code and HTTP version.
+  static bool StatusLineMatches(const std::string& raw_headers,
+                                int response_code,
+                                HttpVersion http_version);
+
+  // Reads |count| serialized ParsedHeader entries written by PersistParsed()
+  // and checks that they describe |raw_headers_|. Returns false if they do
+  // not. Unless |name_ids_match_table|, the stored name ids are ignored and
+  // recomputed.
+  bool RestoreParsed(base::PickleIterator* iter,
+                     uint32_t count,
+                     bool name_ids_match_table);
+
+  // Returns the set of header names that |options| excludes from persisted
+  // headers.
+  HeaderSet GetPersistFilter(PersistOptions options) const;
+
+  // Returns the status line and every header not named in |filter_headers|,
+  // in the format of |raw_headers_|. If |parsed| is non-null, it receives the
+  // entries of |parsed_| for the copied headers, rebased onto the result.
+  std::string GetFilteredRawHeaders(const HeaderSet& filter_headers,
+                                    HeaderList* parsed) const;
+
   // Helper function for ParseStatusLine.
   // Tries to extract the "HTTP/X.Y" from a status line formatted like:
   //    HTTP/1.1 200 OK
@@ -377,6 +434,18 @@ class NET_EXPORT HttpResponseHeaders
   // index |from|.  Returns string::npos if not found.
   size_t FindHeader(size_t from, base::StringPiece name) const;
 
+  // Returns the id of |name| in the well-known header name table, or
+  // kUnknownHeaderNameId. Matching is case-insensitive.
+  static HeaderNameId LookupHeaderNameId(base::StringPiece name);
+
+  // Accessors for the parts of raw_headers_ described by a ParsedHeader.
+  base::StringPiece HeaderName(const ParsedHeader& header) const;
+  base::StringPiece HeaderValue(const ParsedHeader& header) const;
+  // Returns the bytes from the start of |first|'s name through the end of
+  // |last|'s value, i.e. a complete header line including continuations.
+  base::StringPiece HeaderLine(const ParsedHeader& first,
+                               const ParsedHeader& last) const;
+
   // Search the Cache-Control header for a directive matching |directive|. If
   // present, treat its value as a time offset in seconds, write it to |result|,
   // and return true.
@@ -390,11 +459,13 @@ class NET_EXPORT HttpResponseHeaders
                  std::string::const_iterator value_begin,
                  std::string::const_iterator value_end);
 
-  // Add to parsed_ given the fields of a ParsedHeader object.
+  // Add to parsed_ given the fields of a ParsedHeader object, and record the
+  // entry in |first_header_index_| if it is the first with its name.
   void AddToParsed(std::string::const_iterator name_begin,
                    std::string::const_iterator name_end,
                    std::string::const_iterator value_begin,
-                   std::string::const_iterator value_end);
+                   std::string::const_iterator value_end,
+                   HeaderNameId name_id);
 
   // Replaces the current headers with the merged version of |raw_headers| and
   // the current headers without the headers in |headers_to_remove|. Note that
@@ -428,6 +499,13 @@ class NET_EXPORT HttpResponseHeaders
   // header-value pairs within raw_headers_.
   HeaderList parsed_;
 
+  // For each well-known header name, one more than a lower bound on the index
+  // in |parsed_| of the first header with that name, or 0 if there is none.
+  // Built once at parse time so that lookups of well-known headers, which the
+  // cache, CORS and security code repeat many times per response, do not scan
+  // the whole list.
+  std::array<uint16_t, kMaxWellKnownHeaderNames> first_header_index_ = {};
+
   // The raw_headers_ consists of the normalized status line (terminated with a
   // null byte) and then followed by the raw null-terminated headers from the
   // input that was passed to our constructor.  We preserve the input [*] to
@@ -0,0 +1,153 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_response_headers.h"
+
+#include <string>
+
+#include "base/check_op.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/timer/elapsed_timer.h"
+#include "net/http/http_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace net {
+namespace {
+
+// A static asset served from a CDN edge.
+const char kCdnResponse[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: application/javascript; charset=utf-8\r\n"
+    "Content-Length: 48213\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: public, max-age=31536000, immutable\r\n"
+    "Date: Tue, 04 Oct 2022 10:21:34 GMT\r\n"
+    "Last-Modified: Mon, 03 Oct 2022 18:02:11 GMT\r\n"
+    "ETag: \"5f1c2a7e9b4d3c8a1e6f0b2d4c7a9e13\"\r\n"
+    "Accept-Ranges: bytes\r\n"
+    "Server: AmazonS3\r\n"
+    "Vary: Accept-Encoding\r\n"
+    "X-Cache: Hit from cloudfront\r\n"
+    "Via: 1.1 0c9b8d7e6f5a4b3c2d1e.cloudfront.net (CloudFront)\r\n"
+    "X-Amz-Cf-Pop: FRA56-P7\r\n"
+    "X-Amz-Cf-Id: 3x9JQm2Yk1Lr8WcV5bN0pT7sHdG4fA6eU_zKiOqRlXyCnMvBw==\r\n"
+    "Age: 86142\r\n"
+    "\r\n";
+
+// A JSON API response with CORS and security headers.
+const char kApiResponse[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Date: Tue, 04 Oct 2022 10:21:35 GMT\r\n"
+    "Content-Type: application/json; charset=utf-8\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: no-cache, no-store, must-revalidate\r\n"
+    "Pragma: no-cache\r\n"
+    "Expires: 0\r\n"
+    "Access-Control-Allow-Origin: https://app.example.com\r\n"
+    "Access-Control-Allow-Credentials: true\r\n"
+    "Access-Control-Expose-Headers: X-Request-Id, X-RateLimit-Remaining\r\n"
+    "Vary: Origin, Accept-Encoding\r\n"
+    "X-Request-Id: 7c1f2b9e-4d3a-4c8b-9e2f-1a6d5b0c3e7f\r\n"
+    "X-RateLimit-Limit: 5000\r\n"
+    "X-RateLimit-Remaining: 4987\r\n"
+    "X-RateLimit-Reset: 1664880000\r\n"
+    "Strict-Transport-Security: max-age=63072000; includeSubDomains\r\n"
+    "X-Content-Type-Options: nosniff\r\n"
+    "X-Frame-Options: DENY\r\n"
+    "\r\n";
+
+// Builds a document response carrying more than 40 headers, including
+// repeated Set-Cookie and Link headers and a long Content-Security-Policy.
+std::string MakeLargeResponse() {
+  std::string response =
+      "HTTP/1.1 200 OK\r\n"
+      "Date: Tue, 04 Oct 2022 10:21:36 GMT\r\n"
+      "Content-Type: text/html; charset=utf-8\r\n"
+      "Content-Length: 183402\r\n"
+      "Connection: keep-alive\r\n"
+      "Cache-Control: private, max-age=0\r\n"
+      "Expires: -1\r\n"
+      "Content-Security-Policy: default-src 'self'; script-src 'self' "
+      "'nonce-r4nd0m' https://cdn.example.com https://www.gstatic.com; "
+      "style-src 'self' 'unsafe-inline' https://fonts.googleapis.com; "
+      "img-src * data: blob:; connect-src 'self' https://api.example.com "
+      "wss://push.example.com; frame-ancestors 'none'; report-uri "
+      "https://csp.example.com/report\r\n"
+      "Cross-Origin-Opener-Policy: same-origin\r\n"
+      "Cross-Origin-Embedder-Policy: require-corp\r\n"
+      "Permissions-Policy: geolocation=(), camera=(), microphone=()\r\n"
+      "Referrer-Policy: strict-origin-when-cross-origin\r\n"
+      "Strict-Transport-Security: max-age=63072000; includeSubDomains\r\n"
+      "X-Content-Type-Options: nosniff\r\n"
+      "X-XSS-Protection: 0\r\n"
+      "Accept-CH: Sec-CH-UA-Platform-Version, Sec-CH-UA-Model\r\n"
+      "Server-Timing: db;dur=53, app;dur=47.2, cache;desc=\"miss\"\r\n"
+      "Alt-Svc: h3=\":443\"; ma=2592000,h3-29=\":443\"; ma=2592000\r\n"
+      "Vary: Accept-Encoding, Cookie\r\n";
+  for (int i = 0; i < 12; ++i) {
+    response += "Set-Cookie: session_part_" + base::NumberToString(i) +
+                "=c2Vzc2lvbi1kYXRhLWZvci1wYXJ0; Path=/; Secure; HttpOnly; "
+                "SameSite=Lax\r\n";
+  }
+  for (int i = 0; i < 10; ++i) {
+    response += "Link: </static/chunk-" + base::NumberToString(i) +
+                ".js>; rel=preload; as=script\r\n";
+  }
+  for (int i = 0; i < 6; ++i) {
+    response += "X-Backend-Trace-" + base::NumberToString(i) +
+                ": span=4bf92f3577b34da6a3ce929d0e0e4736\r\n";
+  }
+  response += "\r\n";
+  return response;
+}
+
+void RunParse(const std::string& response, size_t iterations) {
+  size_t header_count = 0;
+  for (size_t i = 0; i < iterations; ++i) {
+    size_t end = HttpUtil::LocateEndOfHeaders(response.data(), response.size());
+    CHECK_EQ(response.size(), end);
+    auto headers = base::MakeRefCounted<HttpResponseHeaders>(
+        HttpUtil::AssembleRawHeaders(response));
+    if (headers->HasHeader("Content-Type"))
+      ++header_count;
+  }
+  CHECK_EQ(iterations, header_count);
+}
+
+void RunPerfTest(const std::string& story, const std::string& response) {
+  const size_t kWarmupIterations = 1000;
+  const size_t kMeasuredIterations = 100000;
+  RunParse(response, kWarmupIterations);
+  base::ElapsedTimer elapsed_timer;
+  RunParse(response, kMeasuredIterations);
+  perf_test::PerfResultReporter reporter("HttpResponseHeaders.", story);
+  reporter.RegisterImportantMetric("throughput",
+                                   "bytesPerSecond_biggerIsBetter");
+  reporter.RegisterImportantMetric("time_per_parse", "ns");
+  base::TimeDelta elapsed = elapsed_timer.Elapsed();
+  reporter.AddResult("throughput", static_cast<int64_t>(response.size()) *
+                                       kMeasuredIterations /
+                                       elapsed.InSecondsF());
+  reporter.AddResult("time_per_parse",
+                     elapsed.InNanoseconds() /
+                         static_cast<double>(kMeasuredIterations));
+}
+
+TEST(HttpResponseHeadersPerfTest, CdnResponse) {
+  RunPerfTest("CdnResponse", kCdnResponse);
+}
+
+TEST(HttpResponseHeadersPerfTest, ApiResponse) {
+  RunPerfTest("ApiResponse", kApiResponse);
+}
+
+TEST(HttpResponseHeadersPerfTest, LargeResponse) {
+  RunPerfTest("LargeResponse", MakeLargeResponse());
+}
+
+}  // namespace
+}  // namespace net
@@ -11,6 +11,8 @@
 #include <limits>
 #include <memory>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "base/pickle.h"
 #include "base/time/time.h"
@@ -335,6 +337,41 @@ TEST_P(PersistenceTest, Persist) {
   EXPECT_EQ(std::string(test.expected_headers), ToSimpleString(parsed2));
 }
 
+TEST_P(PersistenceTest, PersistParsed) {
+  const PersistData test = GetParam();
+
+  std::string headers = test.raw_headers;
+  HeadersToRaw(&headers);
+  auto parsed1 = base::MakeRefCounted<HttpResponseHeaders>(headers);
+
+  base::Pickle pickle;
+  parsed1->PersistParsed(&pickle, test.options);
+
+  base::PickleIterator iter(pickle);
+  scoped_refptr<HttpResponseHeaders> parsed2 =
+      HttpResponseHeaders::CreateFromParsedPickle(&iter);
+  ASSERT_TRUE(parsed2);
+  EXPECT_EQ(std::string(test.expected_headers), ToSimpleString(parsed2));
+
+  // The restored headers must match what parsing the persisted block gives.
+  base::Pickle raw_pickle;
+  parsed1->Persist(&raw_pickle, test.options);
+  base::PickleIterator raw_iter(raw_pickle);
+  auto reparsed = base::MakeRefCounted<HttpResponseHeaders>(&raw_iter);
+  EXPECT_EQ(reparsed->raw_headers(), parsed2->raw_headers());
+  EXPECT_EQ(reparsed->GetHttpVersion(), parsed2->GetHttpVersion());
+  EXPECT_EQ(reparsed->response_code(), parsed2->response_code());
+  for (const char* name : {"cache-control", "etag", "foo", "set-cookie",
+                           "strict-transport-security", "vary"}) {
+    std::string expected_value;
+    std::string value;
+    EXPECT_EQ(reparsed->GetNormalizedHeader(name, &expected_value),
+              parsed2->GetNormalizedHeader(name, &value))
+        << name;
+    EXPECT_EQ(expected_value, value) << name;
+  }
+}
+
 const struct PersistData persistence_tests[] = {
     {HttpResponseHeaders::PERSIST_ALL,
      "HTTP/1.1 200 OK\n"
@@ -2311,6 +2348,309 @@ TEST_F(HttpResponseHeadersCacheControlTest,
   EXPECT_EQ(base::Seconds(1), GetStaleWhileRevalidateValue());
 }
 
+TEST(HttpResponseHeadersIndexTest, WellKnownNamesAreCaseInsensitive) {
+  std::string headers(
+      "HTTP/1.1 200 OK\n"
+      "CONTENT-TYPE: text/html\n"
+      "cache-control: no-cache\n"
+      "X-Custom: a\n"
+      "eTaG: \"abc\"\n");
+  HeadersToRaw(&headers);
+  auto parsed = base::MakeRefCounted<HttpResponseHeaders>(headers);
+
+  std::string value;
+  EXPECT_TRUE(parsed->GetNormalizedHeader("Content-Type", &value));
+  EXPECT_EQ("text/html", value);
+  EXPECT_TRUE(parsed->GetNormalizedHeader("CACHE-CONTROL", &value));
+  EXPECT_EQ("no-cache", value);
+  EXPECT_TRUE(parsed->GetNormalizedHeader("ETag", &value));
+  EXPECT_EQ("\"abc\"", value);
+  EXPECT_TRUE(parsed->GetNormalizedHeader("x-custom", &value));
+  EXPECT_EQ("a", value);
+
+  // Well-known and unknown names that are absent.
+  EXPECT_FALSE(parsed->HasHeader("Location"));
+  EXPECT_FALSE(parsed->HasHeader("X-Other"));
+  // Prefixes of well-known names must not match.
+  EXPECT_FALSE(parsed->HasHeader("content"));
+  EXPECT_FALSE(parsed->HasHeader("content-typ"));
+}
+
+TEST(HttpResponseHeadersIndexTest, RepeatedHeadersAndContinuations) {
+  std::string headers(
+      "HTTP/1.1 200 OK\n"
+      "Vary: Accept\n"
+      "X-Custom: 1, 2\n"
+      "Cache-Control: private, max-age=10\n"
+      "vary: Cookie\n"
+      "x-custom: 3\n");
+  HeadersToRaw(&headers);
+  auto parsed = base::MakeRefCounted<HttpResponseHeaders>(headers);
+
+  std::string value;
+  EXPECT_TRUE(parsed->GetNormalizedHeader("vary", &value));
+  EXPECT_EQ("Accept, Cookie", value);
+  EXPECT_TRUE(parsed->GetNormalizedHeader("X-CUSTOM", &value));
+  EXPECT_EQ("1, 2, 3", value);
+
+  size_t iter = 0;
+  std::vector<std::string> values;
+  while (parsed->EnumerateHeader(&iter, "cache-control", &value))
+    values.push_back(value);
+  EXPECT_EQ(std::vector<std::string>({"private", "max-age=10"}), values);
+
+  iter = 0;
+  values.clear();
+  while (parsed->EnumerateHeader(&iter, "x-custom", &value))
+    values.push_back(value);
+  EXPECT_EQ(std::vector<std::string>({"1", "2", "3"}), values);
+
+  // The continuation of Cache-Control is not reported as its own header.
+  EXPECT_FALSE(parsed->HasHeaderValue("max-age=10", "private"));
+  EXPECT_TRUE(parsed->HasHeaderValue("cache-control", "max-age=10"));
+}
+
+TEST(HttpResponseHeadersIndexTest, IndexIsRebuiltOnModification) {
+  std::string headers(
+      "HTTP/1.1 200 OK\n"
+      "Content-Type: text/html\n"
+      "Content-Length: 10\n");
+  HeadersToRaw(&headers);
+  auto parsed = base::MakeRefCounted<HttpResponseHeaders>(headers);
+
+  parsed->RemoveHeader("Content-Type");
+  EXPECT_FALSE(parsed->HasHeader("Content-Type"));
+  EXPECT_TRUE(parsed->HasHeader("Content-Length"));
+
+  parsed->AddHeader("ETag", "\"v1\"");
+  parsed->AddHeader("Content-Type", "text/plain");
+  std::string value;
+  EXPECT_TRUE(parsed->GetNormalizedHeader("etag", &value));
+  EXPECT_EQ("\"v1\"", value);
+  EXPECT_TRUE(parsed->GetNormalizedHeader("content-type", &value));
+  EXPECT_EQ("text/plain", value);
+
+  std::string new_headers(
+      "HTTP/1.1 304 Not Modified\n"
+      "ETag: \"v2\"\n"
+      "Date: Wed, 28 Nov 2007 01:40:10 GMT\n");
+  HeadersToRaw(&new_headers);
+  parsed->Update(*base::MakeRefCounted<HttpResponseHeaders>(new_headers));
+  EXPECT_TRUE(parsed->GetNormalizedHeader("ETag", &value));
+  EXPECT_EQ("\"v1\"", value);
+  EXPECT_TRUE(parsed->GetNormalizedHeader("Date", &value));
+  EXPECT_EQ("Wed, 28 Nov 2007 01:40:10 GMT", value);
+  EXPECT_TRUE(parsed->HasHeader("Content-Length"));
+}
+
+// Writes the format of PersistParsed() for |raw_headers| by hand, so that tests
+// can control every field.
+base::Pickle MakeParsedPickle(const std::string& raw_headers,
+                              uint32_t names_hash,
+                              const std::vector<uint32_t>& words,
+                              int response_code = 200,
+                              HttpVersion http_version = HttpVersion(1, 1)) {
+  base::Pickle pickle;
+  pickle.WriteString(raw_headers);
+  pickle.WriteInt(response_code);
+  pickle.WriteUInt16(http_version.major_value());
+  pickle.WriteUInt16(http_version.minor_value());
+  pickle.WriteUInt32(names_hash);
+  pickle.WriteUInt32(static_cast<uint32_t>(words.size() / 5));
+  pickle.WriteData(reinterpret_cast<const char*>(words.data()),
+                   words.size() * sizeof(uint32_t));
+  return pickle;
+}
+
+// Returns the hash of the well-known header name table stored by
+// PersistParsed().
+uint32_t GetStoredNamesHash() {
+  std::string headers("HTTP/1.1 200 OK\n");
+  HeadersToRaw(&headers);
+  base::Pickle pickle;
+  base::MakeRefCounted<HttpResponseHeaders>(headers)->PersistParsed(
+      &pickle, HttpResponseHeaders::PERSIST_RAW);
+  base::PickleIterator iter(pickle);
+  std::string raw_headers;
+  int response_code;
+  uint16_t version;
+  uint32_t names_hash = 0;
+  EXPECT_TRUE(iter.ReadString(&raw_headers));
+  EXPECT_TRUE(iter.ReadInt(&response_code));
+  EXPECT_TRUE(iter.ReadUInt16(&version));
+  EXPECT_TRUE(iter.ReadUInt16(&version));
+  EXPECT_TRUE(iter.ReadUInt32(&names_hash));
+  return names_hash;
+}
+
+TEST(HttpResponseHeadersIndexTest, CreateFromParsedPickle) {
+  // "HTTP/1.1 200 OK\0" is 16 bytes, so "Date" starts at offset 16 and
+  // "X-Foo" at offset 24.
+  const std::string raw_headers("HTTP/1.1 200 OK\0Date: 1\0X-Foo: a\0\0", 34);
+  const uint32_t kUnknown = 0xFF;
+
+  // With ids from an unknown table, every name is looked up again.
+  base::Pickle pickle = MakeParsedPickle(
+      raw_headers, GetStoredNamesHash() + 1,
+      {16, 20, 22, 23, kUnknown, 24, 29, 31, 32, kUnknown});
+  base::PickleIterator iter(pickle);
+  scoped_refptr<HttpResponseHeaders> headers =
+      HttpResponseHeaders::CreateFromParsedPickle(&iter);
+  ASSERT_TRUE(headers);
+  EXPECT_EQ(200, headers->response_code());
+  EXPECT_EQ(HttpVersion(1, 1), headers->GetHttpVersion());
+  std::string value;
+  EXPECT_TRUE(headers->GetNormalizedHeader("date", &value));
+  EXPECT_EQ("1", value);
+  EXPECT_TRUE(headers->GetNormalizedHeader("x-foo", &value));
+  EXPECT_EQ("a", value);
+}
+
+TEST(HttpResponseHeadersIndexTest, CreateFromParsedPickleRejectsCorruption) {
+  const std::string raw_headers("HTTP/1.1 200 OK\0Date: 1\0X-Foo: a\0\0", 34);
+  const uint32_t kUnknown = 0xFF;
+  const uint32_t hash = GetStoredNamesHash();
+
+  const std::vector<uint32_t> bad_entries[] = {
+      // Name overlapping the status line.
+      {10, 20, 22, 23, kUnknown},
+      // Value past the end of the block.
+      {16, 20, 22, 40, kUnknown},
+      // Reversed offsets.
+      {20, 16, 22, 23, kUnknown},
+      // A continuation as the first entry.
+      {16, 16, 22, 23, kUnknown},
+      // A continuation whose name is not at the start of its value.
+      {16, 20, 22, 23, kUnknown, 24, 24, 31, 32, kUnknown},
+      // Entries out of order.
+      {24, 29, 31, 32, kUnknown, 16, 20, 22, 23, kUnknown},
+      // Entries that overlap.
+      {16, 20, 22, 23, kUnknown, 22, 22, 22, 23, kUnknown},
+      // A well-known id that does not match the name.
+      {24, 29, 31, 32, 0},
+      // An id outside the well-known table.
+      {16, 20, 22, 23, 200},
+      // A truncated entry.
+      {16, 20, 22, 23},
+  };
+  for (const auto& words : bad_entries) {
+    base::Pickle pickle = MakeParsedPickle(raw_headers, hash, words);
+    base::PickleIterator iter(pickle);
+    EXPECT_FALSE(HttpResponseHeaders::CreateFromParsedPickle(&iter));
+  }
+
+  // A block that is not terminated by two nulls.
+  base::Pickle pickle = MakeParsedPickle("HTTP/1.1 200 OK", hash, {});
+  base::PickleIterator iter(pickle);
+  EXPECT_FALSE(HttpResponseHeaders::CreateFromParsedPickle(&iter));
+}
+
+// A status code or version that disagrees with the status line makes the
+// whole block get parsed again, ignoring the stored offsets.
+TEST(HttpResponseHeadersIndexTest, CreateFromParsedPickleStatusMismatch) {
+  const std::string raw_headers("HTTP/1.1 200 OK\0Date: 1\0X-Foo: a\0\0", 34);
+  const uint32_t kUnknown = 0xFF;
+  // Offsets that would make "X-Foo" read as "Date".
+  const std::vector<uint32_t> words = {24, 29, 31, 32, kUnknown};
+
+  for (const auto& [response_code, http_version] :
+       {std::make_pair(404, HttpVersion(1, 1)),
+        std::make_pair(200, HttpVersion(1, 0)),
+        std::make_pair(200, HttpVersion(2, 0))}) {
+    base::Pickle pickle =
+        MakeParsedPickle(raw_headers, GetStoredNamesHash(), words,
+                         response_code, http_version);
+    base::PickleIterator iter(pickle);
+    scoped_refptr<HttpResponseHeaders> headers =
+        HttpResponseHeaders::CreateFromParsedPickle(&iter);
+    ASSERT_TRUE(headers);
+    EXPECT_EQ(200, headers->response_code());
+    EXPECT_EQ(HttpVersion(1, 1), headers->GetHttpVersion());
+    std::string value;
+    EXPECT_TRUE(headers->GetNormalizedHeader("date", &value));
+    EXPECT_EQ("1", value);
+    EXPECT_TRUE(headers->GetNormalizedHeader("x-foo", &value));
+    EXPECT_EQ("a", value);
+    // The whole pickle was consumed.
+    EXPECT_TRUE(iter.ReachedEnd());
+  }
+}
+
+// Comma-separated values are split into continuations, which must survive
+// being persisted, including when filtering moves them within the block.
+TEST(HttpResponseHeadersIndexTest, PersistParsedContinuations) {
+  std::string headers(
+      "HTTP/1.1 200 OK\n"
+      "Set-Cookie: a=b\n"
+      "Cache-Control: private, max-age=10, no-transform\n"
+      "Vary: accept, accept-encoding\n");
+  HeadersToRaw(&headers);
+  auto parsed = base::MakeRefCounted<HttpResponseHeaders>(headers);
+
+  for (HttpResponseHeaders::PersistOptions options :
+       {HttpResponseHeaders::PERSIST_RAW, HttpResponseHeaders::PERSIST_ALL,
+        HttpResponseHeaders::PERSIST_SANS_COOKIES}) {
+    base::Pickle pickle;
+    parsed->PersistParsed(&pickle, options);
+    base::PickleIterator iter(pickle);
+    scoped_refptr<HttpResponseHeaders> restored =
+        HttpResponseHeaders::CreateFromParsedPickle(&iter);
+    ASSERT_TRUE(restored) << options;
+
+    std::string value;
+    EXPECT_TRUE(restored->GetNormalizedHeader("cache-control", &value));
+    EXPECT_EQ("private, max-age=10, no-transform", value);
+    EXPECT_TRUE(restored->GetNormalizedHeader("vary", &value));
+    EXPECT_EQ("accept, accept-encoding", value);
+    EXPECT_TRUE(restored->HasHeaderValue("cache-control", "max-age=10"));
+    EXPECT_TRUE(restored->HasHeaderValue("vary", "accept-encoding"));
+    EXPECT_EQ(options != HttpResponseHeaders::PERSIST_SANS_COOKIES,
+              restored->HasHeader("set-cookie"));
+
+    size_t iter_index = 0;
+    std::vector<std::string> values;
+    while (restored->EnumerateHeader(&iter_index, "cache-control", &value))
+      values.push_back(value);
+    EXPECT_EQ(
+        std::vector<std::string>({"private", "max-age=10", "no-transform"}),
+        values);
+  }
+}
+
+TEST(HttpResponseHeadersIndexTest, MemoryUsage) {
+  // Each parsed entry holds four 32-bit offsets and a one byte name id.
+  EXPECT_LE(HttpResponseHeaders::GetParsedHeaderSizeForTesting(), 20u);
+
+  std::string headers(
+      "HTTP/1.1 200 OK\n"
+      "Date: Wed, 28 Nov 2007 01:40:10 GMT\n"
+      "Server: cdn\n"
+      "Content-Type: text/html; charset=utf-8\n"
+      "Content-Length: 12345\n"
+      "Cache-Control: public, max-age=3600\n"
+      "ETag: \"0123456789abcdef\"\n"
+      "Last-Modified: Tue, 27 Nov 2007 01:40:10 GMT\n"
+      "Vary: Accept-Encoding\n"
+      "Accept-Ranges: bytes\n"
+      "Age: 12\n"
+      "Strict-Transport-Security: max-age=31536000\n"
+      "X-Content-Type-Options: nosniff\n"
+      "X-Frame-Options: DENY\n"
+      "Access-Control-Allow-Origin: *\n"
+      "Timing-Allow-Origin: *\n"
+      "Alt-Svc: h3=\":443\"; ma=86400\n"
+      "X-Cache: HIT\n"
+      "X-Served-By: cache-1\n"
+      "Link: </style.css>; rel=preload\n"
+      "Referrer-Policy: no-referrer\n");
+  HeadersToRaw(&headers);
+  auto parsed = base::MakeRefCounted<HttpResponseHeaders>(headers);
+
+  // The parsed representation, including the name index, must stay within a
+  // small constant factor of the raw header block.
+  EXPECT_LT(parsed->GetMemoryUsageForTesting(), 3 * headers.size());
+}
+
 struct GetCurrentAgeTestData {
   const char* headers;
   const char* request_time;
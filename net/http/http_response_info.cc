@@ -43,7 +43,12 @@ bool KeyExchangeGroupIsValid(int ssl_connection_status) {
 // serialized HttpResponseInfo.
 enum {
   // The version of the response info used when persisting response info.
-  RESPONSE_INFO_VERSION = 3,
+  RESPONSE_INFO_VERSION = 4,
+
+  // The first version that stores the headers together with their parsed
+  // offsets, see HttpResponseHeaders::PersistParsed(). Older versions store
+  // only the raw headers, which have to be parsed again when read.
+  RESPONSE_INFO_PARSED_HEADERS_VERSION = 4,
 
   // The minimum version supported for deserializing response info.
   RESPONSE_INFO_MINIMUM_VERSION = 3,
@@ -228,9 +233,15 @@ bool HttpResponseInfo::InitFromPickle(const base::Pickle& pickle,
   response_time = Time::FromInternalValue(time_val);
 
   // Read response-headers
-  headers = base::MakeRefCounted<HttpResponseHeaders>(&iter);
-  if (headers->response_code() == -1)
-    return false;
+  if (version >= RESPONSE_INFO_PARSED_HEADERS_VERSION) {
+    headers = HttpResponseHeaders::CreateFromParsedPickle(&iter);
+    if (!headers)
+      return false;
+  } else {
+    headers = base::MakeRefCounted<HttpResponseHeaders>(&iter);
+    if (headers->response_code() == -1)
+      return false;
+  }
 
   // Read ssl-info
   if (flags & RESPONSE_INFO_HAS_CERT) {
@@ -452,7 +463,7 @@ void HttpResponseInfo::Persist(base::Pickle* pickle,
                       HttpResponseHeaders::PERSIST_SANS_SECURITY_STATE;
   }
 
-  headers->Persist(pickle, persist_options);
+  headers->PersistParsed(pickle, persist_options);
 
   if (ssl_info.is_valid()) {
     ssl_info.cert->Persist(pickle);
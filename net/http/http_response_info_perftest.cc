@@ -0,0 +1,153 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_response_info.h"
+
+#include <string>
+
+#include "base/check.h"
+#include "base/pickle.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "net/http/http_response_headers.h"
+#include "net/http/http_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace net {
+namespace {
+
+// A typical cacheable static asset.
+const char kCachedResponse[] =
+    "HTTP/1.1 200 OK\n"
+    "Content-Type: application/javascript; charset=utf-8\n"
+    "Content-Length: 48213\n"
+    "Cache-Control: public, max-age=31536000, immutable\n"
+    "Date: Tue, 04 Oct 2022 10:21:34 GMT\n"
+    "Last-Modified: Mon, 03 Oct 2022 18:02:11 GMT\n"
+    "ETag: \"5f1c2a7e9b4d3c8a1e6f0b2d4c7a9e13\"\n"
+    "Accept-Ranges: bytes\n"
+    "Server: AmazonS3\n"
+    "Vary: Accept-Encoding\n"
+    "X-Cache: Hit from cloudfront\n"
+    "Via: 1.1 0c9b8d7e6f5a4b3c2d1e.cloudfront.net (CloudFront)\n"
+    "X-Amz-Cf-Pop: FRA56-P7\n"
+    "X-Amz-Cf-Id: 3x9JQm2Yk1Lr8WcV5bN0pT7sHdG4fA6eU_zKiOqRlXyCnMvBw==\n"
+    "Access-Control-Allow-Origin: *\n"
+    "Timing-Allow-Origin: *\n"
+    "Age: 86142\n"
+    "\n";
+
+scoped_refptr<HttpResponseHeaders> MakeHeaders() {
+  return base::MakeRefCounted<HttpResponseHeaders>(
+      HttpUtil::AssembleRawHeaders(kCachedResponse));
+}
+
+// Returns the entry as HttpCache stores it today.
+base::Pickle MakeCurrentPickle() {
+  HttpResponseInfo response_info;
+  response_info.request_time = base::Time::Now();
+  response_info.response_time = response_info.request_time;
+  response_info.headers = MakeHeaders();
+  base::Pickle pickle;
+  response_info.Persist(&pickle, /*skip_transient_headers=*/true,
+                        /*response_truncated=*/false);
+  return pickle;
+}
+
+// Returns the same entry in the version 3 format, which stores only the raw
+// headers.
+base::Pickle MakeVersion3Pickle() {
+  base::Pickle pickle;
+  pickle.WriteInt(3);
+  pickle.WriteInt64(base::Time::Now().ToInternalValue());
+  pickle.WriteInt64(base::Time::Now().ToInternalValue());
+  MakeHeaders()->Persist(&pickle, HttpResponseHeaders::PERSIST_RAW);
+  pickle.WriteString("");
+  pickle.WriteUInt16(0);
+  return pickle;
+}
+
+void RunLoad(const base::Pickle& pickle, size_t iterations) {
+  size_t validator_count = 0;
+  for (size_t i = 0; i < iterations; ++i) {
+    HttpResponseInfo response_info;
+    bool truncated;
+    CHECK(response_info.InitFromPickle(pickle, &truncated));
+    // Touch the headers the cache checks on every hit.
+    if (response_info.headers->HasValidators() &&
+        response_info.headers->HasHeader("Vary")) {
+      ++validator_count;
+    }
+  }
+  CHECK_EQ(iterations, validator_count);
+}
+
+void RunPerfTest(const std::string& story, const base::Pickle& pickle) {
+  const size_t kWarmupIterations = 1000;
+  const size_t kMeasuredIterations = 100000;
+  RunLoad(pickle, kWarmupIterations);
+  base::ElapsedTimer elapsed_timer;
+  RunLoad(pickle, kMeasuredIterations);
+  perf_test::PerfResultReporter reporter("HttpResponseInfo.", story);
+  reporter.RegisterImportantMetric("time_per_load", "ns");
+  reporter.RegisterImportantMetric("entry_size", "bytes");
+  reporter.AddResult("time_per_load",
+                     elapsed_timer.Elapsed().InNanoseconds() /
+                         static_cast<double>(kMeasuredIterations));
+  reporter.AddResult("entry_size", pickle.size());
+}
+
+// Measures writing a response the way HttpCache does before each write of its
+// headers to the disk cache, which reuses the buffers of earlier Pickles.
+void RunPersistPerfTest(const std::string& story) {
+  const size_t kWarmupIterations = 1000;
+  const size_t kMeasuredIterations = 100000;
+  HttpResponseInfo response_info;
+  response_info.request_time = base::Time::Now();
+  response_info.response_time = response_info.request_time;
+  response_info.headers = MakeHeaders();
+  size_t entry_size = 0;
+  auto persist = [&](size_t iterations) {
+    for (size_t i = 0; i < iterations; ++i) {
+      base::Pickle pickle;
+      response_info.Persist(&pickle, /*skip_transient_headers=*/true,
+                            /*response_truncated=*/false);
+      entry_size = pickle.size();
+    }
+  };
+
+  persist(kWarmupIterations);
+  const size_t allocation_count = base::Pickle::GetAllocationCountForTesting();
+  base::ElapsedTimer elapsed_timer;
+  persist(kMeasuredIterations);
+  const base::TimeDelta elapsed = elapsed_timer.Elapsed();
+  perf_test::PerfResultReporter reporter("HttpResponseInfo.", story);
+  reporter.RegisterImportantMetric("time_per_persist", "ns");
+  reporter.RegisterImportantMetric("allocations_per_persist", "count");
+  reporter.RegisterImportantMetric("entry_size", "bytes");
+  reporter.AddResult("time_per_persist",
+                     elapsed.InNanoseconds() /
+                         static_cast<double>(kMeasuredIterations));
+  reporter.AddResult(
+      "allocations_per_persist",
+      (base::Pickle::GetAllocationCountForTesting() - allocation_count) /
+          static_cast<double>(kMeasuredIterations));
+  reporter.AddResult("entry_size", entry_size);
+}
+
+TEST(HttpResponseInfoPerfTest, LoadParsedHeaders) {
+  RunPerfTest("LoadParsedHeaders", MakeCurrentPickle());
+}
+
+TEST(HttpResponseInfoPerfTest, LoadRawHeaders) {
+  RunPerfTest("LoadRawHeaders", MakeVersion3Pickle());
+}
+
+TEST(HttpResponseInfoPerfTest, Persist) {
+  RunPersistPerfTest("Persist");
+}
+
+}  // namespace
+}  // namespace net
@@ -8,6 +8,7 @@
 #include "net/cert/signed_certificate_timestamp.h"
 #include "net/cert/signed_certificate_timestamp_and_status.h"
 #include "net/http/http_response_headers.h"
+#include "net/http/http_util.h"
 #include "net/ssl/ssl_connection_status_flags.h"
 #include "net/test/cert_test_util.h"
 #include "net/test/ct_test_util.h"
@@ -261,6 +262,59 @@ TEST_F(HttpResponseInfoTest, EmptyDnsAliases) {
   EXPECT_TRUE(restored_response_info.dns_aliases.empty());
 }
 
+// Test that headers survive a round trip through the current format, with and
+// without transient headers.
+TEST_F(HttpResponseInfoTest, HeadersRoundTrip) {
+  response_info_.headers = base::MakeRefCounted<HttpResponseHeaders>(
+      HttpUtil::AssembleRawHeaders("HTTP/1.1 200 OK\n"
+                                   "Cache-Control: max-age=60\n"
+                                   "Set-Cookie: a=b\n"
+                                   "ETag: \"v1\"\n"
+                                   "Vary: Accept-Encoding\n\n"));
+
+  for (bool skip_transient_headers : {false, true}) {
+    base::Pickle pickle;
+    response_info_.Persist(&pickle, skip_transient_headers, false);
+    HttpResponseInfo restored_response_info;
+    bool truncated = true;
+    ASSERT_TRUE(restored_response_info.InitFromPickle(pickle, &truncated));
+    EXPECT_FALSE(truncated);
+
+    const HttpResponseHeaders& headers = *restored_response_info.headers;
+    EXPECT_EQ(200, headers.response_code());
+    EXPECT_TRUE(headers.HasHeaderValue("cache-control", "max-age=60"));
+    EXPECT_TRUE(headers.HasHeaderValue("etag", "\"v1\""));
+    EXPECT_TRUE(headers.HasHeaderValue("vary", "accept-encoding"));
+    EXPECT_EQ(!skip_transient_headers, headers.HasHeader("set-cookie"));
+  }
+}
+
+// Test that entries written before header offsets were persisted can still be
+// read.
+TEST_F(HttpResponseInfoTest, ReadsVersion3) {
+  const std::string raw_headers = HttpUtil::AssembleRawHeaders(
+      "HTTP/1.1 200 OK\n"
+      "ETag: \"v1\"\n\n");
+  const base::Time request_time = base::Time::Now();
+
+  base::Pickle pickle;
+  pickle.WriteInt(3);
+  pickle.WriteInt64(request_time.ToInternalValue());
+  pickle.WriteInt64(request_time.ToInternalValue());
+  pickle.WriteString(raw_headers);
+  pickle.WriteString("");
+  pickle.WriteUInt16(0);
+
+  HttpResponseInfo restored_response_info;
+  bool truncated = true;
+  ASSERT_TRUE(restored_response_info.InitFromPickle(pickle, &truncated));
+  EXPECT_FALSE(truncated);
+  EXPECT_EQ(request_time, restored_response_info.request_time);
+  EXPECT_EQ(200, restored_response_info.headers->response_code());
+  EXPECT_TRUE(
+      restored_response_info.headers->HasHeaderValue("etag", "\"v1\""));
+}
+
 }  // namespace
 
 }  // namespace net
@@ -0,0 +1,408 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_server_properties_binary_format.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <utility>
+#include <vector>
+
+#include "base/check.h"
+#include "base/containers/adapters.h"
+#include "base/containers/span.h"
+#include "base/hash/hash.h"
+#include "base/logging.h"
+#include "base/time/time.h"
+#include "base/values.h"
+#include "net/base/network_isolation_key.h"
+#include "net/socket/next_proto.h"
+#include "net/third_party/quiche/src/quiche/quic/core/quic_server_id.h"
+#include "net/third_party/quiche/src/quiche/quic/core/quic_versions.h"
+#include "third_party/abseil-cpp/absl/strings/string_view.h"
+#include "url/scheme_host_port.h"
+#include "url/url_constants.h"
+
+namespace net {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x48535042;  // "HSPB"
+constexpr uint32_t kFormatVersion = 1;
+constexpr size_t kChecksumSize = sizeof(uint32_t);
+
+enum RecordType : int {
+  kServer = 1,
+  kQuicServer = 2,
+  kLastLocalAddressWhenQuicWorked = 3,
+};
+
+// Bits of the flags of a kServer record.
+constexpr uint32_t kSupportsSpdy = 1 << 0;
+constexpr uint32_t kHasNetworkStats = 1 << 1;
+
+using ServerEntry = std::pair<HttpServerProperties::ServerInfoMapKey,
+                              HttpServerProperties::ServerInfo>;
+using QuicServerEntry =
+    std::pair<HttpServerProperties::QuicServerInfoMapKey, std::string>;
+
+uint32_t Checksum(base::StringPiece data) {
+  return base::PersistentHash(base::as_bytes(base::make_span(data)));
+}
+
+// NetworkIsolationKey::ToValue() produces a list of strings, which is written
+// as its size followed by the strings.
+void WriteNetworkIsolationKey(const base::Value& value, base::Pickle* pickle) {
+  const base::Value::List& list = value.GetList();
+  pickle->WriteUInt32(list.size());
+  for (const base::Value& item : list)
+    pickle->WriteString(item.GetString());
+}
+
+// Reads a NetworkIsolationKey written by WriteNetworkIsolationKey() into
+// |out|, if not null. |out| is left empty if the key is not valid. Returns
+// false if the data is truncated.
+bool ReadNetworkIsolationKey(base::PickleIterator* iter,
+                             absl::optional<NetworkIsolationKey>* out) {
+  uint32_t size;
+  if (!iter->ReadUInt32(&size))
+    return false;
+  base::Value::List list;
+  for (uint32_t i = 0; i < size; ++i) {
+    base::StringPiece item;
+    if (!iter->ReadStringPiece(&item))
+      return false;
+    if (out)
+      list.Append(item);
+  }
+  if (!out)
+    return true;
+
+  // Most keys are empty, so don't go through FromValue() for those.
+  if (list.empty()) {
+    *out = NetworkIsolationKey();
+    return true;
+  }
+  NetworkIsolationKey network_isolation_key;
+  if (NetworkIsolationKey::FromValue(base::Value(std::move(list)),
+                                     &network_isolation_key)) {
+    *out = std::move(network_isolation_key);
+  }
+  return true;
+}
+
+// Returns whether an entry with |network_isolation_key| should be loaded.
+bool ShouldLoad(
+    const absl::optional<NetworkIsolationKey>& network_isolation_key,
+    bool use_network_isolation_key) {
+  return network_isolation_key &&
+         (use_network_isolation_key || network_isolation_key->IsEmpty());
+}
+
+// Reads the rest of a kServer record. Returns false if it is truncated.
+// Otherwise appends the server to |servers|, unless |servers| is null or the
+// server should not be loaded.
+bool ReadServer(base::PickleIterator* iter,
+                bool use_network_isolation_key,
+                base::Time now,
+                std::vector<ServerEntry>* servers) {
+  absl::optional<NetworkIsolationKey> network_isolation_key;
+  base::StringPiece scheme;
+  base::StringPiece host;
+  uint16_t port;
+  uint32_t flags;
+  if (!ReadNetworkIsolationKey(iter,
+                               servers ? &network_isolation_key : nullptr) ||
+      !iter->ReadStringPiece(&scheme) || !iter->ReadStringPiece(&host) ||
+      !iter->ReadUInt16(&port) || !iter->ReadUInt32(&flags)) {
+    return false;
+  }
+
+  HttpServerProperties::ServerInfo server_info;
+  if (flags & kSupportsSpdy)
+    server_info.supports_spdy = true;
+  if (flags & kHasNetworkStats) {
+    int64_t srtt;
+    if (!iter->ReadInt64(&srtt))
+      return false;
+    ServerNetworkStats server_network_stats;
+    server_network_stats.srtt = base::Microseconds(srtt);
+    server_info.server_network_stats = server_network_stats;
+  }
+
+  uint32_t num_alternative_services;
+  if (!iter->ReadUInt32(&num_alternative_services))
+    return false;
+  AlternativeServiceInfoVector alternative_services;
+  for (uint32_t i = 0; i < num_alternative_services; ++i) {
+    int protocol;
+    base::StringPiece alternative_host;
+    uint16_t alternative_port;
+    int64_t expiration;
+    uint32_t num_versions;
+    if (!iter->ReadInt(&protocol) ||
+        !iter->ReadStringPiece(&alternative_host) ||
+        !iter->ReadUInt16(&alternative_port) ||
+        !iter->ReadInt64(&expiration) || !iter->ReadUInt32(&num_versions)) {
+      return false;
+    }
+    quic::ParsedQuicVersionVector advertised_versions;
+    for (uint32_t j = 0; j < num_versions; ++j) {
+      base::StringPiece alpn;
+      if (!iter->ReadStringPiece(&alpn))
+        return false;
+      if (!servers)
+        continue;
+      quic::ParsedQuicVersion version = quic::ParseQuicVersionString(
+          absl::string_view(alpn.data(), alpn.size()));
+      if (version != quic::ParsedQuicVersion::Unsupported())
+        advertised_versions.push_back(version);
+    }
+
+    if (!servers || protocol < kProtoUnknown || protocol > kProtoLast ||
+        !IsAlternateProtocolValid(static_cast<NextProto>(protocol)) ||
+        base::Time::FromInternalValue(expiration) <= now) {
+      continue;
+    }
+    AlternativeServiceInfo alternative_service_info;
+    alternative_service_info.set_alternative_service(
+        AlternativeService(static_cast<NextProto>(protocol),
+                           std::string(alternative_host), alternative_port));
+    alternative_service_info.set_expiration(
+        base::Time::FromInternalValue(expiration));
+    alternative_service_info.set_advertised_versions(advertised_versions);
+    alternative_services.push_back(std::move(alternative_service_info));
+  }
+
+  if (!ShouldLoad(network_isolation_key, use_network_isolation_key))
+    return true;
+  url::SchemeHostPort server(std::string(scheme), std::string(host), port);
+  if (!server.IsValid()) {
+    DVLOG(1) << "Malformed http_server_properties for server: " << scheme
+             << "://" << host << ":" << port;
+    return true;
+  }
+  // Alternative services are only used for secure origins.
+  if (!alternative_services.empty() && server.scheme() == url::kHttpsScheme)
+    server_info.alternative_services = std::move(alternative_services);
+  if (server_info.empty())
+    return true;
+
+  servers->emplace_back(
+      HttpServerProperties::ServerInfoMapKey(std::move(server),
+                                             *network_isolation_key,
+                                             use_network_isolation_key),
+      std::move(server_info));
+  return true;
+}
+
+// Like ReadServer(), for kQuicServer records.
+bool ReadQuicServer(base::PickleIterator* iter,
+                    bool use_network_isolation_key,
+                    std::vector<QuicServerEntry>* quic_servers) {
+  absl::optional<NetworkIsolationKey> network_isolation_key;
+  base::StringPiece host;
+  uint16_t port;
+  bool privacy_mode_enabled;
+  base::StringPiece server_info;
+  if (!ReadNetworkIsolationKey(iter,
+                               quic_servers ? &network_isolation_key
+                                            : nullptr) ||
+      !iter->ReadStringPiece(&host) || !iter->ReadUInt16(&port) ||
+      !iter->ReadBool(&privacy_mode_enabled) ||
+      !iter->ReadStringPiece(&server_info)) {
+    return false;
+  }
+
+  if (!quic_servers ||
+      !ShouldLoad(network_isolation_key, use_network_isolation_key) ||
+      host.empty()) {
+    return true;
+  }
+  quic_servers->emplace_back(
+      HttpServerProperties::QuicServerInfoMapKey(
+          quic::QuicServerId(std::string(host), port, privacy_mode_enabled),
+          *network_isolation_key, use_network_isolation_key),
+      std::string(server_info));
+  return true;
+}
+
+}  // namespace
+
+HttpServerPropertiesBinaryWriter::HttpServerPropertiesBinaryWriter() {
+  pickle_.WriteUInt32(kMagic);
+  pickle_.WriteUInt32(kFormatVersion);
+}
+
+HttpServerPropertiesBinaryWriter::~HttpServerPropertiesBinaryWriter() =
+    default;
+
+bool HttpServerPropertiesBinaryWriter::AddServer(
+    const HttpServerProperties::ServerInfoMapKey& key,
+    bool supports_spdy,
+    const AlternativeServiceInfoVector& alternative_services,
+    const absl::optional<ServerNetworkStats>& server_network_stats) {
+  DCHECK(!finished_);
+  base::Value network_isolation_key_value;
+  if (!key.network_isolation_key.ToValue(&network_isolation_key_value))
+    return false;
+
+  pickle_.WriteInt(kServer);
+  WriteNetworkIsolationKey(network_isolation_key_value, &pickle_);
+  pickle_.WriteString(key.server.scheme());
+  pickle_.WriteString(key.server.host());
+  pickle_.WriteUInt16(key.server.port());
+  pickle_.WriteUInt32((supports_spdy ? kSupportsSpdy : 0) |
+                      (server_network_stats ? kHasNetworkStats : 0));
+  if (server_network_stats)
+    pickle_.WriteInt64(server_network_stats->srtt.InMicroseconds());
+
+  pickle_.WriteUInt32(alternative_services.size());
+  for (const AlternativeServiceInfo& alternative_service_info :
+       alternative_services) {
+    const AlternativeService& alternative_service =
+        alternative_service_info.alternative_service();
+    pickle_.WriteInt(alternative_service.protocol);
+    pickle_.WriteString(alternative_service.host);
+    pickle_.WriteUInt16(alternative_service.port);
+    pickle_.WriteInt64(alternative_service_info.expiration().ToInternalValue());
+    pickle_.WriteUInt32(alternative_service_info.advertised_versions().size());
+    for (const auto& version : alternative_service_info.advertised_versions())
+      pickle_.WriteString(quic::AlpnForVersion(version));
+  }
+  return true;
+}
+
+bool HttpServerPropertiesBinaryWriter::AddQuicServer(
+    const HttpServerProperties::QuicServerInfoMapKey& key,
+    const std::string& server_info) {
+  DCHECK(!finished_);
+  base::Value network_isolation_key_value;
+  if (!key.network_isolation_key.ToValue(&network_isolation_key_value))
+    return false;
+
+  pickle_.WriteInt(kQuicServer);
+  WriteNetworkIsolationKey(network_isolation_key_value, &pickle_);
+  pickle_.WriteString(key.server_id.host());
+  pickle_.WriteUInt16(key.server_id.port());
+  pickle_.WriteBool(key.server_id.privacy_mode_enabled());
+  pickle_.WriteString(server_info);
+  return true;
+}
+
+void HttpServerPropertiesBinaryWriter::SetLastLocalAddressWhenQuicWorked(
+    const IPAddress& address) {
+  DCHECK(!finished_);
+  if (!address.IsValid())
+    return;
+  pickle_.WriteInt(kLastLocalAddressWhenQuicWorked);
+  pickle_.WriteData(reinterpret_cast<const char*>(address.bytes().data()),
+                    address.size());
+}
+
+std::string HttpServerPropertiesBinaryWriter::Finish() {
+  DCHECK(!finished_);
+  finished_ = true;
+
+  std::string data(static_cast<const char*>(pickle_.data()), pickle_.size());
+  uint32_t checksum = Checksum(data);
+  data.append(reinterpret_cast<const char*>(&checksum), kChecksumSize);
+  return data;
+}
+
+HttpServerPropertiesBinaryContents::HttpServerPropertiesBinaryContents() =
+    default;
+
+HttpServerPropertiesBinaryContents::~HttpServerPropertiesBinaryContents() =
+    default;
+
+std::unique_ptr<HttpServerPropertiesBinaryContents>
+DecodeHttpServerPropertiesBinary(base::StringPiece data,
+                                 bool use_network_isolation_key,
+                                 size_t max_quic_server_infos) {
+  auto contents = std::make_unique<HttpServerPropertiesBinaryContents>();
+  if (data.size() < kChecksumSize)
+    return contents;
+  base::StringPiece pickled = data.substr(0, data.size() - kChecksumSize);
+  uint32_t checksum;
+  memcpy(&checksum, data.data() + pickled.size(), kChecksumSize);
+  if (Checksum(pickled) != checksum) {
+    DVLOG(1) << "http_server_properties binary data failed its checksum.";
+    return contents;
+  }
+
+  base::Pickle pickle(pickled.data(), pickled.size());
+  base::PickleIterator iter(pickle);
+  uint32_t magic;
+  uint32_t version;
+  if (!iter.ReadUInt32(&magic) || !iter.ReadUInt32(&version) ||
+      magic != kMagic || version != kFormatVersion) {
+    DVLOG(1) << "Unsupported http_server_properties binary data.";
+    return contents;
+  }
+
+  auto server_info_map =
+      std::make_unique<HttpServerProperties::ServerInfoMap>();
+  auto quic_server_info_map =
+      std::make_unique<HttpServerProperties::QuicServerInfoMap>(
+          max_quic_server_infos);
+  IPAddress last_local_address_when_quic_worked;
+
+  // Records are most recently used first, so once a map is full, the rest of
+  // its records are skipped over without being decoded. The entries that are
+  // kept are then inserted from oldest to newest.
+  std::vector<ServerEntry> servers;
+  std::vector<QuicServerEntry> quic_servers;
+  const base::Time now = base::Time::Now();
+  while (!iter.ReachedEnd()) {
+    int type;
+    if (!iter.ReadInt(&type))
+      return contents;
+    bool success = false;
+    switch (type) {
+      case kServer:
+        success = ReadServer(
+            &iter, use_network_isolation_key, now,
+            servers.size() < server_info_map->max_size() ? &servers : nullptr);
+        break;
+      case kQuicServer:
+        success = ReadQuicServer(
+            &iter, use_network_isolation_key,
+            quic_servers.size() < quic_server_info_map->max_size()
+                ? &quic_servers
+                : nullptr);
+        break;
+      case kLastLocalAddressWhenQuicWorked: {
+        const char* address;
+        size_t address_size;
+        success = iter.ReadData(&address, &address_size);
+        if (success) {
+          last_local_address_when_quic_worked = IPAddress(
+              reinterpret_cast<const uint8_t*>(address), address_size);
+        }
+        break;
+      }
+    }
+    if (!success) {
+      DVLOG(1) << "Malformed http_server_properties binary data.";
+      return contents;
+    }
+  }
+
+  for (auto& [key, server_info] : base::Reversed(servers))
+    server_info_map->Put(std::move(key), std::move(server_info));
+  for (auto& [key, server_info] : base::Reversed(quic_servers))
+    quic_server_info_map->Put(std::move(key), std::move(server_info));
+
+  contents->server_info_map = std::move(server_info_map);
+  if (last_local_address_when_quic_worked.IsValid()) {
+    contents->last_local_address_when_quic_worked =
+        last_local_address_when_quic_worked;
+  }
+  contents->quic_server_info_map = std::move(quic_server_info_map);
+  return contents;
+}
+
+}  // namespace net
@@ -0,0 +1,94 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_HTTP_HTTP_SERVER_PROPERTIES_BINARY_FORMAT_H_
+#define NET_HTTP_HTTP_SERVER_PROPERTIES_BINARY_FORMAT_H_
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+
+#include "base/pickle.h"
+#include "base/strings/string_piece.h"
+#include "net/base/ip_address.h"
+#include "net/base/net_export.h"
+#include "net/http/alternative_service.h"
+#include "net/http/http_server_properties.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
+
+namespace net {
+
+// A compact binary encoding of the servers, the QUIC server infos and the last
+// local address QUIC worked on, which HttpServerPropertiesManager can persist
+// instead of a base::Value dictionary per entry. Broken alternative services
+// are few, and remain JSON.
+//
+// The encoding is a base::Pickle that starts with a magic number and a format
+// version, and holds one tagged record per entry, most recently used first,
+// followed by a checksum of the Pickle.
+
+// Encodes entries one at a time, so that they need not be copied into a map.
+class NET_EXPORT_PRIVATE HttpServerPropertiesBinaryWriter {
+ public:
+  HttpServerPropertiesBinaryWriter();
+
+  HttpServerPropertiesBinaryWriter(const HttpServerPropertiesBinaryWriter&) =
+      delete;
+  HttpServerPropertiesBinaryWriter& operator=(
+      const HttpServerPropertiesBinaryWriter&) = delete;
+
+  ~HttpServerPropertiesBinaryWriter();
+
+  // Adds a server, which should be less recently used than the ones added
+  // before it. |alternative_services| should already have been filtered down
+  // to the ones worth persisting. Returns false, and adds nothing, if the
+  // NetworkIsolationKey of |key| can't be persisted.
+  bool AddServer(
+      const HttpServerProperties::ServerInfoMapKey& key,
+      bool supports_spdy,
+      const AlternativeServiceInfoVector& alternative_services,
+      const absl::optional<ServerNetworkStats>& server_network_stats);
+
+  // Like AddServer(), for QUIC server infos.
+  bool AddQuicServer(const HttpServerProperties::QuicServerInfoMapKey& key,
+                     const std::string& server_info);
+
+  void SetLastLocalAddressWhenQuicWorked(const IPAddress& address);
+
+  // Returns the encoded entries. Nothing may be added afterwards.
+  std::string Finish();
+
+ private:
+  base::Pickle pickle_;
+  bool finished_ = false;
+};
+
+// What DecodeHttpServerPropertiesBinary() found.
+struct NET_EXPORT_PRIVATE HttpServerPropertiesBinaryContents {
+  HttpServerPropertiesBinaryContents();
+  ~HttpServerPropertiesBinaryContents();
+
+  // Both maps are null if the data was not valid.
+  std::unique_ptr<HttpServerProperties::ServerInfoMap> server_info_map;
+  IPAddress last_local_address_when_quic_worked;
+  std::unique_ptr<HttpServerProperties::QuicServerInfoMap>
+      quic_server_info_map;
+};
+
+// Decodes data returned by HttpServerPropertiesBinaryWriter::Finish(). Entries
+// with a non-empty NetworkIsolationKey are dropped if
+// |use_network_isolation_key| is false, as are expired alternative services,
+// and entries beyond the capacity of the maps. Data that is truncated, fails
+// its checksum or has another format version is invalid as a whole.
+//
+// Only |data| is accessed, so this may run on any sequence.
+NET_EXPORT_PRIVATE std::unique_ptr<HttpServerPropertiesBinaryContents>
+DecodeHttpServerPropertiesBinary(base::StringPiece data,
+                                 bool use_network_isolation_key,
+                                 size_t max_quic_server_infos);
+
+}  // namespace net
+
+#endif  // NET_HTTP_HTTP_SERVER_PROPERTIES_BINARY_FORMAT_H_
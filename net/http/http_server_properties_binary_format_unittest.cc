@@ -0,0 +1,192 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_server_properties_binary_format.h"
+
+#include <memory>
+#include <string>
+
+#include "base/strings/string_number_conversions.h"
+#include "base/time/time.h"
+#include "net/base/ip_address.h"
+#include "net/base/network_isolation_key.h"
+#include "net/base/schemeful_site.h"
+#include "net/quic/quic_context.h"
+#include "net/third_party/quiche/src/quiche/quic/core/quic_server_id.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+#include "url/scheme_host_port.h"
+
+namespace net {
+
+namespace {
+
+using ServerInfoMapKey = HttpServerProperties::ServerInfoMapKey;
+using QuicServerInfoMapKey = HttpServerProperties::QuicServerInfoMapKey;
+
+const size_t kMaxQuicServerInfos = 10;
+
+std::unique_ptr<HttpServerPropertiesBinaryContents> Decode(
+    const std::string& data,
+    bool use_network_isolation_key = false) {
+  return DecodeHttpServerPropertiesBinary(data, use_network_isolation_key,
+                                          kMaxQuicServerInfos);
+}
+
+ServerInfoMapKey ServerKey(const std::string& host,
+                           const NetworkIsolationKey& network_isolation_key =
+                               NetworkIsolationKey()) {
+  return ServerInfoMapKey(url::SchemeHostPort("https", host, 443),
+                          network_isolation_key,
+                          true /* use_network_isolation_key */);
+}
+
+TEST(HttpServerPropertiesBinaryFormatTest, RoundTrip) {
+  const base::Time expiration = base::Time::Now() + base::Days(1);
+  const AlternativeServiceInfoVector alternative_services = {
+      AlternativeServiceInfo::CreateHttp2AlternativeServiceInfo(
+          AlternativeService(kProtoHTTP2, "alt.example", 444), expiration),
+      AlternativeServiceInfo::CreateQuicAlternativeServiceInfo(
+          AlternativeService(kProtoQUIC, "", 443), expiration,
+          DefaultSupportedQuicVersions())};
+  ServerNetworkStats server_network_stats;
+  server_network_stats.srtt = base::Microseconds(42);
+  const QuicServerInfoMapKey quic_key(
+      quic::QuicServerId("quic.example", 443, true /* privacy_mode_enabled */),
+      NetworkIsolationKey(), false /* use_network_isolation_key */);
+  const IPAddress address(192, 168, 0, 1);
+
+  HttpServerPropertiesBinaryWriter writer;
+  EXPECT_TRUE(writer.AddServer(ServerKey("newest.example"), true,
+                               AlternativeServiceInfoVector(), absl::nullopt));
+  EXPECT_TRUE(writer.AddServer(ServerKey("oldest.example"), false,
+                               alternative_services, server_network_stats));
+  EXPECT_TRUE(writer.AddQuicServer(quic_key, "server info"));
+  writer.SetLastLocalAddressWhenQuicWorked(address);
+  std::unique_ptr<HttpServerPropertiesBinaryContents> contents =
+      Decode(writer.Finish());
+
+  ASSERT_TRUE(contents->server_info_map);
+  ASSERT_EQ(2u, contents->server_info_map->size());
+  auto it = contents->server_info_map->begin();
+  EXPECT_EQ("newest.example", it->first.server.host());
+  EXPECT_EQ(true, it->second.supports_spdy);
+  EXPECT_FALSE(it->second.alternative_services);
+  EXPECT_FALSE(it->second.server_network_stats);
+  ++it;
+  EXPECT_EQ("oldest.example", it->first.server.host());
+  EXPECT_FALSE(it->second.supports_spdy);
+  EXPECT_EQ(alternative_services, it->second.alternative_services);
+  EXPECT_EQ(server_network_stats, it->second.server_network_stats);
+
+  ASSERT_TRUE(contents->quic_server_info_map);
+  ASSERT_EQ(1u, contents->quic_server_info_map->size());
+  EXPECT_EQ(quic_key, contents->quic_server_info_map->begin()->first);
+  EXPECT_EQ("server info", contents->quic_server_info_map->begin()->second);
+  EXPECT_EQ(address, contents->last_local_address_when_quic_worked);
+}
+
+TEST(HttpServerPropertiesBinaryFormatTest, DropsExpiredAlternativeServices) {
+  HttpServerPropertiesBinaryWriter writer;
+  writer.AddServer(
+      ServerKey("expired.example"), false,
+      {AlternativeServiceInfo::CreateHttp2AlternativeServiceInfo(
+          AlternativeService(kProtoHTTP2, "alt.example", 443),
+          base::Time::Now() - base::Seconds(1))},
+      absl::nullopt);
+  std::unique_ptr<HttpServerPropertiesBinaryContents> contents =
+      Decode(writer.Finish());
+  ASSERT_TRUE(contents->server_info_map);
+  EXPECT_TRUE(contents->server_info_map->empty());
+}
+
+TEST(HttpServerPropertiesBinaryFormatTest, NetworkIsolationKeys) {
+  const SchemefulSite kSite(GURL("https://foo.test/"));
+  const NetworkIsolationKey kNetworkIsolationKey(kSite, kSite);
+
+  HttpServerPropertiesBinaryWriter writer;
+  EXPECT_TRUE(writer.AddServer(ServerKey("a.example", kNetworkIsolationKey),
+                               true, AlternativeServiceInfoVector(),
+                               absl::nullopt));
+  EXPECT_TRUE(writer.AddServer(ServerKey("b.example"), true,
+                               AlternativeServiceInfoVector(), absl::nullopt));
+  // Keys that can't be persisted are skipped.
+  EXPECT_FALSE(writer.AddServer(
+      ServerKey("c.example", NetworkIsolationKey::CreateTransient()), true,
+      AlternativeServiceInfoVector(), absl::nullopt));
+  std::string data = writer.Finish();
+
+  std::unique_ptr<HttpServerPropertiesBinaryContents> contents =
+      Decode(data, true /* use_network_isolation_key */);
+  ASSERT_TRUE(contents->server_info_map);
+  ASSERT_EQ(2u, contents->server_info_map->size());
+  EXPECT_EQ(kNetworkIsolationKey,
+            contents->server_info_map->begin()->first.network_isolation_key);
+
+  // Without NetworkIsolationKeys, only the entry without one is loaded.
+  contents = Decode(data, false /* use_network_isolation_key */);
+  ASSERT_TRUE(contents->server_info_map);
+  ASSERT_EQ(1u, contents->server_info_map->size());
+  EXPECT_EQ("b.example",
+            contents->server_info_map->begin()->first.server.host());
+}
+
+TEST(HttpServerPropertiesBinaryFormatTest, KeepsMostRecentlyUsed) {
+  const size_t kNumServers = HttpServerProperties::kMaxServerInfoEntries + 10;
+  const size_t kNumQuicServers = kMaxQuicServerInfos + 10;
+
+  HttpServerPropertiesBinaryWriter writer;
+  for (size_t i = 0; i < kNumServers; ++i) {
+    writer.AddServer(ServerKey(base::NumberToString(i) + ".example"), true,
+                     AlternativeServiceInfoVector(), absl::nullopt);
+  }
+  for (size_t i = 0; i < kNumQuicServers; ++i) {
+    writer.AddQuicServer(
+        QuicServerInfoMapKey(
+            quic::QuicServerId(base::NumberToString(i) + ".example", 443,
+                               false /* privacy_mode_enabled */),
+            NetworkIsolationKey(), false /* use_network_isolation_key */),
+        "server info");
+  }
+  std::unique_ptr<HttpServerPropertiesBinaryContents> contents =
+      Decode(writer.Finish());
+
+  ASSERT_TRUE(contents->server_info_map);
+  ASSERT_EQ(static_cast<size_t>(HttpServerProperties::kMaxServerInfoEntries),
+            contents->server_info_map->size());
+  size_t i = 0;
+  for (const auto& [key, server_info] : *contents->server_info_map)
+    EXPECT_EQ(base::NumberToString(i++) + ".example", key.server.host());
+
+  ASSERT_TRUE(contents->quic_server_info_map);
+  ASSERT_EQ(kMaxQuicServerInfos, contents->quic_server_info_map->size());
+  i = 0;
+  for (const auto& [key, server_info] : *contents->quic_server_info_map)
+    EXPECT_EQ(base::NumberToString(i++) + ".example", key.server_id.host());
+}
+
+TEST(HttpServerPropertiesBinaryFormatTest, InvalidData) {
+  HttpServerPropertiesBinaryWriter writer;
+  writer.AddServer(ServerKey("a.example"), true,
+                   AlternativeServiceInfoVector(), absl::nullopt);
+  const std::string data = writer.Finish();
+  ASSERT_TRUE(Decode(data)->server_info_map);
+
+  EXPECT_FALSE(Decode("")->server_info_map);
+  EXPECT_FALSE(Decode(data.substr(0, data.size() - 1))->server_info_map);
+
+  // Any change fails the checksum.
+  for (size_t i = 0; i < data.size(); ++i) {
+    std::string corrupted = data;
+    corrupted[i] ^= 1;
+    std::unique_ptr<HttpServerPropertiesBinaryContents> contents =
+        Decode(corrupted);
+    EXPECT_FALSE(contents->server_info_map);
+    EXPECT_FALSE(contents->quic_server_info_map);
+  }
+}
+
+}  // namespace
+
+}  // namespace net
@@ -7,11 +7,14 @@
 #include <algorithm>
 #include <utility>
 
+#include "base/base64.h"
 #include "base/bind.h"
 #include "base/containers/adapters.h"
 #include "base/feature_list.h"
 #include "base/metrics/histogram_macros.h"
 #include "base/strings/string_number_conversions.h"
+#include "base/task/task_traits.h"
+#include "base/task/thread_pool.h"
 #include "base/time/tick_clock.h"
 #include "base/time/time.h"
 #include "base/values.h"
@@ -21,6 +24,7 @@
 #include "net/base/port_util.h"
 #include "net/base/privacy_mode.h"
 #include "net/http/http_server_properties.h"
+#include "net/http/http_server_properties_binary_format.h"
 #include "net/third_party/quiche/src/quiche/quic/platform/api/quic_hostname_utils.h"
 #include "third_party/abseil-cpp/absl/types/optional.h"
 #include "url/gurl.h"
@@ -62,6 +66,7 @@ const char kSrttKey[] = "srtt";
 const char kBrokenAlternativeServicesKey[] = "broken_alternative_services";
 const char kBrokenUntilKey[] = "broken_until";
 const char kBrokenCountKey[] = "broken_count";
+const char kBinaryKey[] = "binary";
 
 // Utility method to return only those AlternativeServiceInfos that should be
 // persisted to disk. In particular, removes expired and invalid alternative
@@ -179,6 +184,19 @@ bool GetNetworkIsolationKeyFromDict(
   return true;
 }
 
+// Decodes |encoded|, the base64 encoded value of |kBinaryKey|. Runs on the
+// thread pool when loading prefs.
+std::unique_ptr<HttpServerPropertiesBinaryContents> DecodeBinaryPrefs(
+    const std::string& encoded,
+    bool use_network_isolation_key,
+    size_t max_server_configs_stored_in_properties) {
+  std::string data;
+  if (!base::Base64Decode(encoded, &data))
+    return std::make_unique<HttpServerPropertiesBinaryContents>();
+  return DecodeHttpServerPropertiesBinary(
+      data, use_network_isolation_key, max_server_configs_stored_in_properties);
+}
+
 }  // namespace
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -222,6 +240,22 @@ void HttpServerPropertiesManager::ReadPrefs(
         broken_alternative_service_list,
     std::unique_ptr<RecentlyBrokenAlternativeServices>*
         recently_broken_alternative_services) {
+  ReadPrefsInternal(nullptr /* binary_contents */, server_info_map,
+                    last_local_address_when_quic_worked, quic_server_info_map,
+                    broken_alternative_service_list,
+                    recently_broken_alternative_services);
+}
+
+void HttpServerPropertiesManager::ReadPrefsInternal(
+    std::unique_ptr<HttpServerPropertiesBinaryContents> binary_contents,
+    std::unique_ptr<HttpServerProperties::ServerInfoMap>* server_info_map,
+    IPAddress* last_local_address_when_quic_worked,
+    std::unique_ptr<HttpServerProperties::QuicServerInfoMap>*
+        quic_server_info_map,
+    std::unique_ptr<BrokenAlternativeServiceList>*
+        broken_alternative_service_list,
+    std::unique_ptr<RecentlyBrokenAlternativeServices>*
+        recently_broken_alternative_services) {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
 
   net_log_.EndEvent(NetLogEventType::HTTP_SERVER_PROPERTIES_INITIALIZATION);
@@ -246,50 +280,71 @@ void HttpServerPropertiesManager::ReadPrefs(
     return;
   }
 
-  // For Version 5, data is stored in the following format.
-  // `servers` are saved in LRU order (least-recently-used item is in the
-  // front). `servers` are in the format flattened representation of
-  // (scheme/host/port) where port might be ignored if is default with scheme.
-  //
-  // "http_server_properties": {
-  //      "servers": [
-  //          {"https://yt3.ggpht.com" : {...}},
-  //          {"http://0.client-channel.google.com:443" : {...}},
-  //          {"http://0-edge-chat.facebook.com" : {...}},
-  //          ...
-  //      ], ...
-  // },
-  const base::Value::List* servers_list =
-      http_server_properties_dict.FindList(kServersKey);
-  if (!servers_list) {
-    DVLOG(1) << "Malformed http_server_properties for servers list.";
-    return;
-  }
-
-  ReadLastLocalAddressWhenQuicWorked(http_server_properties_dict,
-                                     last_local_address_when_quic_worked);
+  bool use_network_isolation_key = base::FeatureList::IsEnabled(
+      features::kPartitionHttpServerPropertiesByNetworkIsolationKey);
 
-  *server_info_map = std::make_unique<HttpServerProperties::ServerInfoMap>();
-  *quic_server_info_map =
-      std::make_unique<HttpServerProperties::QuicServerInfoMap>(
+  // Servers, QUIC server infos and the last address QUIC worked on are either
+  // in the binary format, or, as they always were before it, in JSON.
+  if (const std::string* binary =
+          http_server_properties_dict.FindString(kBinaryKey)) {
+    if (!binary_contents) {
+      binary_contents = DecodeBinaryPrefs(
+          *binary, use_network_isolation_key,
           max_server_configs_stored_in_properties_);
+    }
+    if (!binary_contents->server_info_map) {
+      DVLOG(1) << "Malformed http_server_properties binary data.";
+      return;
+    }
+    DCHECK(binary_contents->quic_server_info_map);
+    *server_info_map = std::move(binary_contents->server_info_map);
+    *last_local_address_when_quic_worked =
+        binary_contents->last_local_address_when_quic_worked;
+    *quic_server_info_map = std::move(binary_contents->quic_server_info_map);
+  } else {
+    // For Version 5, data is stored in the following format.
+    // `servers` are saved in LRU order (least-recently-used item is in the
+    // front). `servers` are in the format flattened representation of
+    // (scheme/host/port) where port might be ignored if is default with scheme.
+    //
+    // "http_server_properties": {
+    //      "servers": [
+    //          {"https://yt3.ggpht.com" : {...}},
+    //          {"http://0.client-channel.google.com:443" : {...}},
+    //          {"http://0-edge-chat.facebook.com" : {...}},
+    //          ...
+    //      ], ...
+    // },
+    const base::Value::List* servers_list =
+        http_server_properties_dict.FindList(kServersKey);
+    if (!servers_list) {
+      DVLOG(1) << "Malformed http_server_properties for servers list.";
+      return;
+    }
 
-  bool use_network_isolation_key = base::FeatureList::IsEnabled(
-      features::kPartitionHttpServerPropertiesByNetworkIsolationKey);
+    ReadLastLocalAddressWhenQuicWorked(http_server_properties_dict,
+                                       last_local_address_when_quic_worked);
 
-  // Iterate `servers_list` (least-recently-used item is in the front) so that
-  // entries are inserted into `server_info_map` from oldest to newest.
-  for (const auto& server_dict_value : *servers_list) {
-    if (!server_dict_value.is_dict()) {
-      DVLOG(1) << "Malformed http_server_properties for servers dictionary.";
-      continue;
+    *server_info_map = std::make_unique<HttpServerProperties::ServerInfoMap>();
+    *quic_server_info_map =
+        std::make_unique<HttpServerProperties::QuicServerInfoMap>(
+            max_server_configs_stored_in_properties_);
+
+    // Iterate `servers_list` (least-recently-used item is in the front) so
+    // that entries are inserted into `server_info_map` from oldest to newest.
+    for (const auto& server_dict_value : *servers_list) {
+      if (!server_dict_value.is_dict()) {
+        DVLOG(1) << "Malformed http_server_properties for servers dictionary.";
+        continue;
+      }
+      AddServerData(server_dict_value.GetDict(), server_info_map->get(),
+                    use_network_isolation_key);
     }
-    AddServerData(server_dict_value.GetDict(), server_info_map->get(),
-                  use_network_isolation_key);
-  }
 
-  AddToQuicServerInfoMap(http_server_properties_dict, use_network_isolation_key,
-                         quic_server_info_map->get());
+    AddToQuicServerInfoMap(http_server_properties_dict,
+                           use_network_isolation_key,
+                           quic_server_info_map->get());
+  }
 
   // Read list containing broken and recently-broken alternative services, if
   // it exists.
@@ -706,13 +761,45 @@ void HttpServerPropertiesManager::WriteToPrefs(
   // existing prefs.
   on_prefs_loaded_callback_.Reset();
 
-  std::set<std::pair<std::string, NetworkIsolationKey>>
-      persisted_canonical_suffix_set;
-  const base::Time now = base::Time::Now();
   base::Value http_server_properties_value(base::Value::Type::DICTIONARY);
   base::Value::Dict& http_server_properties_dict =
       http_server_properties_value.GetDict();
 
+  if (base::FeatureList::IsEnabled(
+          features::kHttpServerPropertiesBinaryFormat)) {
+    SaveBinaryToPrefs(server_info_map, get_canonical_suffix,
+                      last_local_address_when_quic_worked,
+                      quic_server_info_map, http_server_properties_dict);
+  } else {
+    SaveServerInfoMapToPrefs(server_info_map, get_canonical_suffix,
+                             http_server_properties_dict);
+    SaveLastLocalAddressWhenQuicWorkedToPrefs(
+        last_local_address_when_quic_worked, http_server_properties_dict);
+    SaveQuicServerInfoMapToServerPrefs(quic_server_info_map,
+                                       http_server_properties_dict);
+  }
+
+  http_server_properties_dict.Set(kVersionKey, kVersionNumber);
+
+  SaveBrokenAlternativeServicesToPrefs(
+      broken_alternative_service_list, kMaxBrokenAlternativeServicesToPersist,
+      recently_broken_alternative_services, http_server_properties_dict);
+
+  pref_delegate_->SetServerProperties(http_server_properties_value,
+                                      std::move(callback));
+
+  net_log_.AddEvent(NetLogEventType::HTTP_SERVER_PROPERTIES_UPDATE_PREFS,
+                    [&] { return http_server_properties_value.Clone(); });
+}
+
+void HttpServerPropertiesManager::SaveServerInfoMapToPrefs(
+    const HttpServerProperties::ServerInfoMap& server_info_map,
+    const GetCannonicalSuffix& get_canonical_suffix,
+    base::Value::Dict& http_server_properties_dict) {
+  std::set<std::pair<std::string, NetworkIsolationKey>>
+      persisted_canonical_suffix_set;
+  const base::Time now = base::Time::Now();
+
   // Convert |server_info_map| to a list Value and add it to
   // |http_server_properties_dict|.
   base::Value::List servers_list;
@@ -755,24 +842,49 @@ void HttpServerPropertiesManager::WriteToPrefs(
   std::reverse(servers_list.begin(), servers_list.end());
 
   http_server_properties_dict.Set(kServersKey, std::move(servers_list));
+}
 
-  http_server_properties_dict.Set(kVersionKey, kVersionNumber);
+void HttpServerPropertiesManager::SaveBinaryToPrefs(
+    const HttpServerProperties::ServerInfoMap& server_info_map,
+    const GetCannonicalSuffix& get_canonical_suffix,
+    const IPAddress& last_local_address_when_quic_worked,
+    const HttpServerProperties::QuicServerInfoMap& quic_server_info_map,
+    base::Value::Dict& http_server_properties_dict) {
+  std::set<std::pair<std::string, NetworkIsolationKey>>
+      persisted_canonical_suffix_set;
+  const base::Time now = base::Time::Now();
 
-  SaveLastLocalAddressWhenQuicWorkedToPrefs(last_local_address_when_quic_worked,
-                                            http_server_properties_dict);
+  // Like SaveServerInfoMapToPrefs(), but entries are written most recently
+  // used first.
+  HttpServerPropertiesBinaryWriter writer;
+  for (const auto& [key, server_info] : server_info_map) {
+    if (!key.network_isolation_key.IsEmpty() &&
+        key.network_isolation_key.IsTransient()) {
+      continue;
+    }
 
-  SaveQuicServerInfoMapToServerPrefs(quic_server_info_map,
-                                     http_server_properties_dict);
+    bool supports_spdy = server_info.supports_spdy.value_or(false);
+    AlternativeServiceInfoVector alternative_services =
+        GetAlternativeServiceToPersist(server_info.alternative_services, key,
+                                       now, get_canonical_suffix,
+                                       &persisted_canonical_suffix_set);
+    if (!supports_spdy && alternative_services.empty() &&
+        !server_info.server_network_stats) {
+      continue;
+    }
+    writer.AddServer(key, supports_spdy, alternative_services,
+                     server_info.server_network_stats);
+  }
 
-  SaveBrokenAlternativeServicesToPrefs(
-      broken_alternative_service_list, kMaxBrokenAlternativeServicesToPersist,
-      recently_broken_alternative_services, http_server_properties_dict);
+  // Entries with ephemeral NIKs are skipped by the writer.
+  for (const auto& [key, server_info] : quic_server_info_map)
+    writer.AddQuicServer(key, server_info);
 
-  pref_delegate_->SetServerProperties(http_server_properties_value,
-                                      std::move(callback));
+  writer.SetLastLocalAddressWhenQuicWorked(last_local_address_when_quic_worked);
 
-  net_log_.AddEvent(NetLogEventType::HTTP_SERVER_PROPERTIES_UPDATE_PREFS,
-                    [&] { return http_server_properties_value.Clone(); });
+  std::string encoded;
+  base::Base64Encode(writer.Finish(), &encoded);
+  http_server_properties_dict.Set(kBinaryKey, std::move(encoded));
 }
 
 void HttpServerPropertiesManager::SaveAlternativeServiceToServerPrefs(
@@ -944,6 +1056,43 @@ void HttpServerPropertiesManager::OnHttpServerPropertiesLoaded() {
   if (!on_prefs_loaded_callback_)
     return;
 
+  // Decoding the binary format is most of the work of loading it, so do that
+  // on the thread pool, and the rest once it's done.
+  const base::Value* http_server_properties_value =
+      pref_delegate_->GetServerProperties();
+  const std::string* binary =
+      http_server_properties_value && http_server_properties_value->is_dict()
+          ? http_server_properties_value->GetDict().FindString(kBinaryKey)
+          : nullptr;
+  if (binary) {
+    base::ThreadPool::PostTaskAndReplyWithResult(
+        FROM_HERE, {base::TaskPriority::USER_VISIBLE},
+        base::BindOnce(
+            &DecodeBinaryPrefs, *binary,
+            base::FeatureList::IsEnabled(
+                features::kPartitionHttpServerPropertiesByNetworkIsolationKey),
+            max_server_configs_stored_in_properties_),
+        base::BindOnce(&HttpServerPropertiesManager::OnBinaryPrefsDecoded,
+                       pref_load_weak_ptr_factory_.GetWeakPtr()));
+    return;
+  }
+
+  RunOnPrefsLoadedCallback(nullptr /* binary_contents */);
+}
+
+void HttpServerPropertiesManager::OnBinaryPrefsDecoded(
+    std::unique_ptr<HttpServerPropertiesBinaryContents> binary_contents) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+
+  // If prefs have been written in the meantime, nothing to do.
+  if (!on_prefs_loaded_callback_)
+    return;
+
+  RunOnPrefsLoadedCallback(std::move(binary_contents));
+}
+
+void HttpServerPropertiesManager::RunOnPrefsLoadedCallback(
+    std::unique_ptr<HttpServerPropertiesBinaryContents> binary_contents) {
   std::unique_ptr<HttpServerProperties::ServerInfoMap> server_info_map;
   IPAddress last_local_address_when_quic_worked;
   std::unique_ptr<HttpServerProperties::QuicServerInfoMap> quic_server_info_map;
@@ -951,9 +1100,10 @@ void HttpServerPropertiesManager::OnHttpServerPropertiesLoaded() {
   std::unique_ptr<RecentlyBrokenAlternativeServices>
       recently_broken_alternative_services;
 
-  ReadPrefs(&server_info_map, &last_local_address_when_quic_worked,
-            &quic_server_info_map, &broken_alternative_service_list,
-            &recently_broken_alternative_services);
+  ReadPrefsInternal(std::move(binary_contents), &server_info_map,
+                    &last_local_address_when_quic_worked,
+                    &quic_server_info_map, &broken_alternative_service_list,
+                    &recently_broken_alternative_services);
 
   std::move(on_prefs_loaded_callback_)
       .Run(std::move(server_info_map), last_local_address_when_quic_worked,
@@ -13,6 +13,7 @@
 #include "base/memory/raw_ptr.h"
 #include "base/memory/weak_ptr.h"
 #include "base/sequence_checker.h"
+#include "base/values.h"
 #include "net/base/host_port_pair.h"
 #include "net/base/net_export.h"
 #include "net/http/alternative_service.h"
@@ -27,6 +28,7 @@ class TickClock;
 namespace net {
 
 class IPAddress;
+struct HttpServerPropertiesBinaryContents;
 
 ////////////////////////////////////////////////////////////////////////////////
 // HttpServerPropertiesManager
@@ -79,7 +81,8 @@ class NET_EXPORT_PRIVATE HttpServerPropertiesManager {
   // present, leaves all values alone. Otherwise, populates them all, with the
   // possible exception of the two broken alt services lists.
   //
-  // Corrupted data is ignored.
+  // Corrupted data is ignored. Prefs in the binary format are decoded on the
+  // calling sequence; only the initial load decodes them on the thread pool.
   //
   // TODO(mmenke): Consider always populating fields, unconditionally, for a
   // simpler API.
@@ -108,6 +111,12 @@ class NET_EXPORT_PRIVATE HttpServerPropertiesManager {
   //
   // Entries associated with NetworkIsolationKeys for opaque origins are not
   // written to disk.
+  //
+  // If features::kHttpServerPropertiesBinaryFormat is enabled, servers, QUIC
+  // server infos and the last local address QUIC worked on are written in the
+  // format of HttpServerPropertiesBinaryWriter instead, as a single base64
+  // string. Prefs are read in either format regardless, so JSON prefs are
+  // migrated by the first write.
   void WriteToPrefs(
       const HttpServerProperties::ServerInfoMap& server_info_map,
       const GetCannonicalSuffix& get_canonical_suffix,
@@ -132,6 +141,19 @@ class NET_EXPORT_PRIVATE HttpServerPropertiesManager {
   FRIEND_TEST_ALL_PREFIXES(HttpServerPropertiesManagerTest,
                            AdvertisedVersionsRoundTrip);
 
+  // Like ReadPrefs(). If the prefs are in the binary format and
+  // |binary_contents| is non-null, it is used instead of decoding them again.
+  void ReadPrefsInternal(
+      std::unique_ptr<HttpServerPropertiesBinaryContents> binary_contents,
+      std::unique_ptr<HttpServerProperties::ServerInfoMap>* server_info_map,
+      IPAddress* last_local_address_when_quic_worked,
+      std::unique_ptr<HttpServerProperties::QuicServerInfoMap>*
+          quic_server_info_map,
+      std::unique_ptr<BrokenAlternativeServiceList>*
+          broken_alternative_service_list,
+      std::unique_ptr<RecentlyBrokenAlternativeServices>*
+          recently_broken_alternative_services);
+
   void AddServerData(const base::Value::Dict& server_dict,
                      HttpServerProperties::ServerInfoMap* server_info_map,
                      bool use_network_isolation_key);
@@ -180,6 +202,16 @@ class NET_EXPORT_PRIVATE HttpServerPropertiesManager {
       BrokenAlternativeServiceList* broken_alternative_service_list,
       RecentlyBrokenAlternativeServices* recently_broken_alternative_services);
 
+  void SaveServerInfoMapToPrefs(
+      const HttpServerProperties::ServerInfoMap& server_info_map,
+      const GetCannonicalSuffix& get_canonical_suffix,
+      base::Value::Dict& http_server_properties_dict);
+  void SaveBinaryToPrefs(
+      const HttpServerProperties::ServerInfoMap& server_info_map,
+      const GetCannonicalSuffix& get_canonical_suffix,
+      const IPAddress& last_local_address_when_quic_worked,
+      const HttpServerProperties::QuicServerInfoMap& quic_server_info_map,
+      base::Value::Dict& http_server_properties_dict);
   void SaveAlternativeServiceToServerPrefs(
       const AlternativeServiceInfoVector& alternative_service_info_vector,
       base::Value::Dict& server_pref_dict);
@@ -200,6 +232,10 @@ class NET_EXPORT_PRIVATE HttpServerPropertiesManager {
       base::Value::Dict& http_server_properties_dict);
 
   void OnHttpServerPropertiesLoaded();
+  void OnBinaryPrefsDecoded(
+      std::unique_ptr<HttpServerPropertiesBinaryContents> binary_contents);
+  void RunOnPrefsLoadedCallback(
+      std::unique_ptr<HttpServerPropertiesBinaryContents> binary_contents);
 
   std::unique_ptr<HttpServerProperties::PrefDelegate> pref_delegate_;
 
@@ -0,0 +1,237 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_server_properties_manager.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include "base/base64.h"
+#include "base/bind.h"
+#include "base/callback_helpers.h"
+#include "base/json/json_reader.h"
+#include "base/json/json_writer.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/test/scoped_feature_list.h"
+#include "base/time/default_tick_clock.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "base/values.h"
+#include "net/base/features.h"
+#include "net/base/ip_address.h"
+#include "net/base/network_isolation_key.h"
+#include "net/http/alternative_service.h"
+#include "net/http/http_server_properties.h"
+#include "net/http/http_server_properties_binary_format.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "url/scheme_host_port.h"
+
+namespace net {
+
+namespace {
+
+const size_t kNumServers[] = {1000, 10000, 50000};
+const size_t kNumServersToLoad[] = {10000, 100000};
+
+const std::string* NoCanonicalSuffix(const std::string& host) {
+  return nullptr;
+}
+
+class PrefDelegate : public HttpServerProperties::PrefDelegate {
+ public:
+  const base::Value* GetServerProperties() const override { return &prefs_; }
+  void SetServerProperties(const base::Value& value,
+                           base::OnceClosure callback) override {
+    prefs_ = value.Clone();
+  }
+  void WaitForPrefLoad(base::OnceClosure callback) override {}
+
+  void set_prefs(base::Value prefs) { prefs_ = std::move(prefs); }
+
+ private:
+  base::Value prefs_;
+};
+
+HttpServerProperties::ServerInfoMapKey CreateKey(size_t i) {
+  return HttpServerProperties::ServerInfoMapKey(
+      url::SchemeHostPort("https",
+                          "host" + base::NumberToString(i) + ".example.test",
+                          443),
+      NetworkIsolationKey(), false /* use_network_isolation_key */);
+}
+
+AlternativeServiceInfoVector CreateAlternativeServices(size_t i) {
+  return AlternativeServiceInfoVector{
+      AlternativeServiceInfo::CreateHttp2AlternativeServiceInfo(
+          AlternativeService(kProtoHTTP2,
+                             "alt" + base::NumberToString(i) + ".example.test",
+                             443),
+          base::Time::Now() + base::Days(1))};
+}
+
+ServerNetworkStats CreateServerNetworkStats() {
+  ServerNetworkStats stats;
+  stats.srtt = base::Milliseconds(10);
+  return stats;
+}
+
+// Returns the prefs that WriteToPrefs() writes for servers |first| to
+// |last| - 1, each with an alternative service and network stats.
+base::Value WriteServers(size_t first, size_t last) {
+  auto pref_delegate = std::make_unique<PrefDelegate>();
+  PrefDelegate* unowned_pref_delegate = pref_delegate.get();
+  HttpServerPropertiesManager manager(
+      std::move(pref_delegate), base::DoNothing(),
+      10 /* max_server_configs_stored_in_properties */, nullptr /* net_log */,
+      base::DefaultTickClock::GetInstance());
+
+  HttpServerProperties::ServerInfoMap server_info_map;
+  for (size_t i = first; i < last; ++i) {
+    HttpServerProperties::ServerInfo& server_info =
+        server_info_map.GetOrPut(CreateKey(i))->second;
+    server_info.alternative_services = CreateAlternativeServices(i);
+    server_info.server_network_stats = CreateServerNetworkStats();
+  }
+  manager.WriteToPrefs(
+      server_info_map, base::BindRepeating(&NoCanonicalSuffix),
+      IPAddress() /* last_quic_address */,
+      HttpServerProperties::QuicServerInfoMap(10),
+      BrokenAlternativeServiceList(), RecentlyBrokenAlternativeServices(10),
+      base::OnceClosure());
+  return unowned_pref_delegate->GetServerProperties()->Clone();
+}
+
+// Returns JSON prefs with |num_servers| servers. ServerInfoMap holds at most
+// HttpServerProperties::kMaxServerInfoEntries servers, so they are written in
+// batches of that size.
+base::Value CreateJSONPrefs(size_t num_servers) {
+  base::Value prefs = WriteServers(0, 0);
+  base::Value::List& servers = *prefs.GetDict().FindList("servers");
+  for (size_t first = 0; first < num_servers;
+       first += HttpServerProperties::kMaxServerInfoEntries) {
+    base::Value batch = WriteServers(
+        first, std::min(num_servers,
+                        first + HttpServerProperties::kMaxServerInfoEntries));
+    for (base::Value& server : *batch.GetDict().FindList("servers"))
+      servers.Append(std::move(server));
+  }
+  return prefs;
+}
+
+// Like CreateJSONPrefs(), in the binary format. As there, the servers are
+// the same as if written by WriteToPrefs(), with the map size limit lifted.
+base::Value CreateBinaryPrefs(size_t num_servers) {
+  base::test::ScopedFeatureList feature_list(
+      features::kHttpServerPropertiesBinaryFormat);
+  base::Value prefs = WriteServers(0, 0);
+
+  HttpServerPropertiesBinaryWriter writer;
+  for (size_t i = num_servers; i > 0; --i) {
+    writer.AddServer(CreateKey(i - 1), false /* supports_spdy */,
+                     CreateAlternativeServices(i - 1),
+                     CreateServerNetworkStats());
+  }
+  std::string encoded;
+  base::Base64Encode(writer.Finish(), &encoded);
+  prefs.GetDict().Set("binary", std::move(encoded));
+  return prefs;
+}
+
+// Measures loading |prefs| at startup, from parsing the JSON the pref store
+// reads from disk to having an HttpServerProperties::ServerInfoMap, and the
+// memory the pref store keeps for them afterwards.
+void MeasureLoad(const std::string& format, const base::Value& prefs) {
+  std::string serialized;
+  ASSERT_TRUE(base::JSONWriter::Write(prefs, &serialized));
+
+  auto pref_delegate = std::make_unique<PrefDelegate>();
+  PrefDelegate* unowned_pref_delegate = pref_delegate.get();
+  HttpServerPropertiesManager manager(
+      std::move(pref_delegate), base::DoNothing(),
+      10 /* max_server_configs_stored_in_properties */, nullptr /* net_log */,
+      base::DefaultTickClock::GetInstance());
+  std::unique_ptr<HttpServerProperties::ServerInfoMap> server_info_map;
+  IPAddress last_local_address_when_quic_worked;
+  std::unique_ptr<HttpServerProperties::QuicServerInfoMap> quic_server_info_map;
+  std::unique_ptr<BrokenAlternativeServiceList> broken_alternative_service_list;
+  std::unique_ptr<RecentlyBrokenAlternativeServices>
+      recently_broken_alternative_services;
+
+  base::ElapsedTimer timer;
+  absl::optional<base::Value> value = base::JSONReader::Read(serialized);
+  ASSERT_TRUE(value);
+  size_t resident_size = value->EstimateMemoryUsage();
+  unowned_pref_delegate->set_prefs(std::move(*value));
+  manager.ReadPrefs(&server_info_map, &last_local_address_when_quic_worked,
+                    &quic_server_info_map, &broken_alternative_service_list,
+                    &recently_broken_alternative_services);
+  base::TimeDelta parse_time = timer.Elapsed();
+  ASSERT_TRUE(server_info_map);
+  EXPECT_EQ(static_cast<size_t>(HttpServerProperties::kMaxServerInfoEntries),
+            server_info_map->size());
+
+  perf_test::PerfResultReporter reporter("HttpServerPropertiesManager.",
+                                         format);
+  reporter.RegisterImportantMetric("parse_time", "ms");
+  reporter.RegisterImportantMetric("resident_size", "bytes");
+  reporter.RegisterImportantMetric("file_size", "bytes");
+  reporter.AddResult("parse_time", parse_time);
+  reporter.AddResult("resident_size", resident_size);
+  reporter.AddResult("file_size", serialized.size());
+}
+
+// Measures writing |num_servers| servers with alternative services to prefs.
+// Every write rebuilds the whole pref value, so this grows with the number of
+// servers.
+TEST(HttpServerPropertiesManagerPerfTest, WriteToPrefs) {
+  for (size_t num_servers : kNumServers) {
+    HttpServerPropertiesManager manager(
+        std::make_unique<PrefDelegate>(), base::DoNothing(),
+        10 /* max_server_configs_stored_in_properties */, nullptr /* net_log */,
+        base::DefaultTickClock::GetInstance());
+
+    const base::Time expiration = base::Time::Now() + base::Days(1);
+    HttpServerProperties::ServerInfoMap server_info_map;
+    for (size_t i = 0; i < num_servers; ++i) {
+      std::string host = "host" + base::NumberToString(i) + ".example.test";
+      server_info_map
+          .GetOrPut(HttpServerProperties::ServerInfoMapKey(
+              url::SchemeHostPort("https", host, 443), NetworkIsolationKey(),
+              false /* use_network_isolation_key */))
+          ->second.alternative_services = AlternativeServiceInfoVector{
+          AlternativeServiceInfo::CreateHttp2AlternativeServiceInfo(
+              AlternativeService(kProtoHTTP2, "alt." + host, 443),
+              expiration)};
+    }
+
+    base::ElapsedTimer timer;
+    manager.WriteToPrefs(
+        server_info_map, base::BindRepeating(&NoCanonicalSuffix),
+        IPAddress() /* last_quic_address */,
+        HttpServerProperties::QuicServerInfoMap(10),
+        BrokenAlternativeServiceList(), RecentlyBrokenAlternativeServices(10),
+        base::OnceClosure());
+    base::TimeDelta write_time = timer.Elapsed();
+
+    perf_test::PerfResultReporter reporter(
+        "HttpServerPropertiesManager.", base::NumberToString(num_servers));
+    reporter.RegisterImportantMetric("write_time", "ms");
+    reporter.AddResult("write_time", write_time);
+  }
+}
+
+TEST(HttpServerPropertiesManagerPerfTest, Load) {
+  for (size_t num_servers : kNumServersToLoad) {
+    MeasureLoad("JSON_" + base::NumberToString(num_servers),
+                CreateJSONPrefs(num_servers));
+    MeasureLoad("Binary_" + base::NumberToString(num_servers),
+                CreateBinaryPrefs(num_servers));
+  }
+}
+
+}  // namespace
+
+}  // namespace net
@@ -133,6 +133,11 @@ class MockPrefDelegate : public net::HttpServerProperties::PrefDelegate {
   base::OnceClosure set_properties_callback_;
 };
 
+// A GetCannonicalSuffix callback for hosts that have no canonical suffix.
+const std::string* NoCanonicalSuffix(const std::string& host) {
+  return nullptr;
+}
+
 // Converts |server_info_map| to a base::Value by running it through an
 // HttpServerPropertiesManager. Other fields are left empty.
 base::Value ServerInfoMapToValue(
@@ -159,7 +164,7 @@ base::Value ServerInfoMapToValue(
       10 /* max_server_configs_stored_in_properties */, nullptr /* net_log */,
       base::DefaultTickClock::GetInstance());
   manager.WriteToPrefs(
-      server_info_map, HttpServerPropertiesManager::GetCannonicalSuffix(),
+      server_info_map, base::BindRepeating(&NoCanonicalSuffix),
       IPAddress() /* last_quic_address */,
       HttpServerProperties::QuicServerInfoMap(10),
       BrokenAlternativeServiceList(), RecentlyBrokenAlternativeServices(10),
@@ -181,6 +186,7 @@ std::unique_ptr<HttpServerProperties::ServerInfoMap> ValueToServerInfoMap(
 
   std::unique_ptr<HttpServerProperties::ServerInfoMap> out;
   bool callback_invoked = false;
+  base::RunLoop run_loop;
   HttpServerPropertiesManager::OnPrefsLoadedCallback on_prefs_loaded_callback =
       base::BindLambdaForTesting(
           [&](std::unique_ptr<HttpServerProperties::ServerInfoMap>
@@ -195,6 +201,7 @@ std::unique_ptr<HttpServerProperties::ServerInfoMap> ValueToServerInfoMap(
             ASSERT_FALSE(callback_invoked);
             callback_invoked = true;
             out = std::move(server_info_map);
+            run_loop.Quit();
           });
 
   HttpServerPropertiesManager manager(
@@ -203,6 +210,9 @@ std::unique_ptr<HttpServerProperties::ServerInfoMap> ValueToServerInfoMap(
       base::DefaultTickClock::GetInstance());
 
   unowned_pref_delegate->InitializePrefs(value);
+  // Prefs in the binary format are decoded asynchronously.
+  if (!callback_invoked)
+    run_loop.Run();
   EXPECT_TRUE(callback_invoked);
   return out;
 }
@@ -3196,4 +3206,56 @@ TEST_F(HttpServerPropertiesManagerTest, SameOrderAfterReload) {
                 ->first.alternative_service.host);
 }
 
+TEST_F(HttpServerPropertiesManagerTest, BinaryFormat) {
+  const HttpServerProperties::ServerInfoMapKey kKey1(
+      url::SchemeHostPort("https", "1.example", 443), NetworkIsolationKey(),
+      false /* use_network_isolation_key */);
+  const HttpServerProperties::ServerInfoMapKey kKey2(
+      url::SchemeHostPort("https", "2.example", 443), NetworkIsolationKey(),
+      false /* use_network_isolation_key */);
+  const HttpServerProperties::ServerInfoMapKey kKey3(
+      url::SchemeHostPort("http", "3.example", 80), NetworkIsolationKey(),
+      false /* use_network_isolation_key */);
+  ServerNetworkStats stats;
+  stats.srtt = base::Microseconds(42);
+
+  HttpServerProperties::ServerInfoMap server_info_map;
+  server_info_map.GetOrPut(kKey1)->second.supports_spdy = true;
+  server_info_map.GetOrPut(kKey2)->second.alternative_services =
+      AlternativeServiceInfoVector{
+          AlternativeServiceInfo::CreateQuicAlternativeServiceInfo(
+              AlternativeService(kProtoQUIC, "alt.example", 443),
+              one_day_from_now_, advertised_versions_)};
+  server_info_map.GetOrPut(kKey2)->second.server_network_stats = stats;
+  server_info_map.GetOrPut(kKey3)->second.server_network_stats = stats;
+  base::Value json = ServerInfoMapToValue(server_info_map);
+
+  base::test::ScopedFeatureList feature_list(
+      features::kHttpServerPropertiesBinaryFormat);
+  base::Value binary = ServerInfoMapToValue(server_info_map);
+  ASSERT_TRUE(binary.GetDict().FindString("binary"));
+  EXPECT_FALSE(binary.GetDict().Find("servers"));
+
+  // JSON prefs are still read, so they are migrated by the next write, and
+  // both formats load the same servers in the same order.
+  std::unique_ptr<HttpServerProperties::ServerInfoMap> from_json =
+      ValueToServerInfoMap(json);
+  std::unique_ptr<HttpServerProperties::ServerInfoMap> from_binary =
+      ValueToServerInfoMap(binary);
+  ASSERT_TRUE(from_json);
+  ASSERT_TRUE(from_binary);
+  ASSERT_EQ(3u, from_binary->size());
+  ASSERT_EQ(from_json->size(), from_binary->size());
+  for (auto it1 = from_json->begin(), it2 = from_binary->begin();
+       it1 != from_json->end(); ++it1, ++it2) {
+    EXPECT_EQ(it1->first.server, it2->first.server);
+    EXPECT_EQ(it1->second, it2->second);
+  }
+
+  // Corrupted data is ignored.
+  std::string& data = *binary.GetDict().FindString("binary");
+  data[data.size() / 2] = data[data.size() / 2] == 'A' ? 'B' : 'A';
+  EXPECT_FALSE(ValueToServerInfoMap(binary));
+}
+
 }  // namespace net
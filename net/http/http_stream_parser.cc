@@ -5,6 +5,7 @@
 #include "net/http/http_stream_parser.h"
 
 #include <algorithm>
+#include <iterator>
 #include <memory>
 #include <utility>
 
@@ -40,6 +41,18 @@ namespace {
 
 const uint64_t kMaxMergedHeaderAndBodySize = 1400;
 const size_t kRequestBodyBufferSize = 1 << 14;  // 16KB
+// The most request body bytes written at once when the UploadDataStream can
+// hand them out without copying them. Since they need not fit in
+// |request_body_send_buf_|, this can be larger.
+const int kMaxUncopiedRequestBodyWriteSize = 1 << 18;  // 256KB
+// The largest chunk header: 8 hex chars and a CRLF.
+const int kMaxChunkHeaderSize = 10;
+// The CRLF that follows the data of a chunk.
+const char kChunkFooter[] = "\r\n";
+const int kChunkFooterSize = std::size(kChunkFooter) - 1;
+// The last chunk, which ends chunked request bodies.
+const char kLastChunk[] = "0\r\n\r\n";
+const int kLastChunkSize = std::size(kLastChunk) - 1;
 
 std::string GetResponseHeaderLines(const HttpResponseHeaders& headers) {
   std::string raw_headers = headers.raw_headers();
@@ -172,9 +185,6 @@ class HttpStreamParser::SeekableIOBuffer : public IOBuffer {
   int used_ = 0;
 };
 
-// 2 CRLFs + max of 8 hex chars.
-const size_t HttpStreamParser::kChunkHeaderFooterSize = 12;
-
 HttpStreamParser::HttpStreamParser(StreamSocket* stream_socket,
                                    bool connection_is_reused,
                                    const HttpRequestInfo* request,
@@ -225,15 +235,6 @@ int HttpStreamParser::SendRequest(
   if (request_->upload_data_stream != nullptr) {
     request_body_send_buf_ =
         base::MakeRefCounted<SeekableIOBuffer>(kRequestBodyBufferSize);
-    if (request_->upload_data_stream->is_chunked()) {
-      // Read buffer is adjusted to guarantee that |request_body_send_buf_| is
-      // large enough to hold the encoded chunk.
-      request_body_read_buf_ = base::MakeRefCounted<SeekableIOBuffer>(
-          kRequestBodyBufferSize - kChunkHeaderFooterSize);
-    } else {
-      // No need to encode request body, just send the raw data.
-      request_body_read_buf_ = request_body_send_buf_;
-    }
   }
 
   io_state_ = STATE_SEND_HEADERS;
@@ -492,16 +493,48 @@ int HttpStreamParser::DoSendBody() {
         io_callback_, NetworkTrafficAnnotationTag(traffic_annotation_));
   }
 
-  if (request_->upload_data_stream->is_chunked() && sent_last_chunk_) {
-    // Finished sending the request.
-    io_state_ = STATE_SEND_REQUEST_COMPLETE;
-    return OK;
+  if (request_body_uncopied_buf_ &&
+      request_body_uncopied_buf_->BytesRemaining() > 0) {
+    io_state_ = STATE_SEND_BODY_COMPLETE;
+    return stream_socket_->Write(
+        request_body_uncopied_buf_.get(),
+        request_body_uncopied_buf_->BytesRemaining(), io_callback_,
+        NetworkTrafficAnnotationTag(traffic_annotation_));
+  }
+
+  if (request_->upload_data_stream->is_chunked()) {
+    if (sent_last_chunk_) {
+      // Finished sending the request.
+      io_state_ = STATE_SEND_REQUEST_COMPLETE;
+      return OK;
+    }
+  } else {
+    // Write the data directly from the stream's memory when it allows that,
+    // e.g. for memory mapped files.
+    int length = 0;
+    scoped_refptr<IOBuffer> uncopied_buf =
+        request_->upload_data_stream->ReadWithoutCopying(
+            kMaxUncopiedRequestBodyWriteSize, &length);
+    if (uncopied_buf) {
+      request_body_uncopied_buf_ = base::MakeRefCounted<DrainableIOBuffer>(
+          std::move(uncopied_buf), length);
+      io_state_ = STATE_SEND_BODY;
+      return OK;
+    }
   }
 
-  request_body_read_buf_->Clear();
+  request_body_send_buf_->Clear();
+  int read_size = request_body_send_buf_->capacity();
+  if (request_->upload_data_stream->is_chunked()) {
+    // Read chunked data after room for the chunk header, and leave room for
+    // the chunk footer and the last chunk, so that it can be encoded in place.
+    request_body_send_buf_->DidAppend(kMaxChunkHeaderSize);
+    request_body_send_buf_->SetOffset(kMaxChunkHeaderSize);
+    read_size -= kMaxChunkHeaderSize + kChunkFooterSize + kLastChunkSize;
+  }
   io_state_ = STATE_SEND_REQUEST_READ_BODY_COMPLETE;
   return request_->upload_data_stream->Read(
-      request_body_read_buf_.get(), request_body_read_buf_->capacity(),
+      request_body_send_buf_.get(), read_size,
       base::BindOnce(&HttpStreamParser::OnIOComplete,
                      weak_ptr_factory_.GetWeakPtr()));
 }
@@ -519,7 +552,11 @@ int HttpStreamParser::DoSendBodyComplete(int result) {
   }
 
   sent_bytes_ += result;
-  request_body_send_buf_->DidConsume(result);
+  if (request_body_send_buf_->BytesRemaining() > 0) {
+    request_body_send_buf_->DidConsume(result);
+  } else {
+    request_body_uncopied_buf_->DidConsume(result);
+  }
 
   io_state_ = STATE_SEND_BODY;
   return OK;
@@ -535,16 +572,9 @@ int HttpStreamParser::DoSendRequestReadBodyComplete(int result) {
 
   // Chunked data needs to be encoded.
   if (request_->upload_data_stream->is_chunked()) {
-    if (result == 0) {  // Reached the end.
-      DCHECK(request_->upload_data_stream->IsEOF());
-      sent_last_chunk_ = true;
-    }
-    // Encode the buffer as 1 chunk.
-    const base::StringPiece payload(request_body_read_buf_->data(), result);
-    request_body_send_buf_->Clear();
-    result = EncodeChunk(payload,
-                         request_body_send_buf_->data(),
-                         request_body_send_buf_->capacity());
+    EncodeChunkInPlace(result);
+    io_state_ = STATE_SEND_BODY;
+    return OK;
   }
 
   if (result == 0) {  // Reached the end.
@@ -562,11 +592,39 @@ int HttpStreamParser::DoSendRequestReadBodyComplete(int result) {
   return result;
 }
 
+void HttpStreamParser::EncodeChunkInPlace(int payload_size) {
+  // If this read reached the end of the data, the last chunk goes out in the
+  // same write.
+  sent_last_chunk_ = request_->upload_data_stream->IsEOF();
+  DCHECK(payload_size > 0 || sent_last_chunk_);
+
+  // Go back to the start of the buffer, where |kMaxChunkHeaderSize| bytes were
+  // left before the payload.
+  request_body_send_buf_->SetOffset(0);
+  char* buf = request_body_send_buf_->data();
+  int start = kMaxChunkHeaderSize;
+  if (payload_size > 0) {
+    char header[kMaxChunkHeaderSize + 1];
+    int header_size =
+        base::snprintf(header, sizeof(header), "%X\r\n", payload_size);
+    start -= header_size;
+    memcpy(buf + start, header, header_size);
+    memcpy(buf + kMaxChunkHeaderSize + payload_size, kChunkFooter,
+           kChunkFooterSize);
+    request_body_send_buf_->DidAppend(payload_size + kChunkFooterSize);
+  }
+  if (sent_last_chunk_) {
+    memcpy(buf + request_body_send_buf_->size(), kLastChunk, kLastChunkSize);
+    request_body_send_buf_->DidAppend(kLastChunkSize);
+  }
+  request_body_send_buf_->SetOffset(start);
+}
+
 int HttpStreamParser::DoSendRequestComplete(int result) {
   DCHECK_NE(result, ERR_IO_PENDING);
   request_headers_ = nullptr;
   request_body_send_buf_ = nullptr;
-  request_body_read_buf_ = nullptr;
+  request_body_uncopied_buf_ = nullptr;
 
   return result;
 }
@@ -1143,30 +1201,6 @@ void HttpStreamParser::GetSSLCertRequestInfo(
     stream_socket_->GetSSLCertRequestInfo(cert_request_info);
 }
 
-int HttpStreamParser::EncodeChunk(const base::StringPiece& payload,
-                                  char* output,
-                                  size_t output_size) {
-  if (output_size < payload.size() + kChunkHeaderFooterSize)
-    return ERR_INVALID_ARGUMENT;
-
-  char* cursor = output;
-  // Add the header.
-  const int num_chars = base::snprintf(output, output_size,
-                                       "%X\r\n",
-                                       static_cast<int>(payload.size()));
-  cursor += num_chars;
-  // Add the payload if any.
-  if (payload.size() > 0) {
-    memcpy(cursor, payload.data(), payload.size());
-    cursor += payload.size();
-  }
-  // Add the trailing CRLF.
-  memcpy(cursor, "\r\n", 2);
-  cursor += 2;
-
-  return cursor - output;
-}
-
 // static
 bool HttpStreamParser::ShouldMergeRequestHeadersAndBody(
     const std::string& request_headers,
@@ -1183,7 +1217,7 @@ bool HttpStreamParser::ShouldMergeRequestHeadersAndBody(
 
 bool HttpStreamParser::SendRequestBuffersEmpty() {
   return request_headers_ == nullptr && request_body_send_buf_ == nullptr &&
-         request_body_read_buf_ == nullptr;
+         request_body_uncopied_buf_ == nullptr;
 }
 
 }  // namespace net
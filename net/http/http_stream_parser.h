@@ -111,27 +111,12 @@ class NET_EXPORT_PRIVATE HttpStreamParser {
 
   void GetSSLCertRequestInfo(SSLCertRequestInfo* cert_request_info);
 
-  // Encodes the given |payload| in the chunked format to |output|.
-  // Returns the number of bytes written to |output|. |output_size| should
-  // be large enough to store the encoded chunk, which is payload.size() +
-  // kChunkHeaderFooterSize. Returns ERR_INVALID_ARGUMENT if |output_size|
-  // is not large enough.
-  //
-  // The output will look like: "HEX\r\n[payload]\r\n"
-  // where HEX is a length in hexdecimal (without the "0x" prefix).
-  static int EncodeChunk(const base::StringPiece& payload,
-                         char* output,
-                         size_t output_size);
-
   // Returns true if request headers and body should be merged (i.e. the
   // sum is small enough and the body is in memory, and not chunked).
   static bool ShouldMergeRequestHeadersAndBody(
       const std::string& request_headers,
       const UploadDataStream* request_body);
 
-  // The number of extra bytes required to encode a chunk.
-  static const size_t kChunkHeaderFooterSize;
-
  private:
   class SeekableIOBuffer;
 
@@ -179,6 +164,10 @@ class NET_EXPORT_PRIVATE HttpStreamParser {
   int DoSendBody();
   int DoSendBodyComplete(int result);
   int DoSendRequestReadBodyComplete(int result);
+  // Encodes the |payload_size| bytes of chunked data just read into
+  // |request_body_send_buf_| as a chunk, followed by the last chunk if the
+  // data has ended.
+  void EncodeChunkInPlace(int payload_size);
   int DoSendRequestComplete(int result);
   int DoReadHeaders();
   int DoReadHeadersComplete(int result);
@@ -312,11 +301,13 @@ class NET_EXPORT_PRIVATE HttpStreamParser {
   // Callback to be used when doing IO.
   CompletionRepeatingCallback io_callback_;
 
-  // Buffer used to read the request body from UploadDataStream.
-  scoped_refptr<SeekableIOBuffer> request_body_read_buf_;
-  // Buffer used to send the request body. This points the same buffer as
-  // |request_body_read_buf_| unless the data is chunked.
+  // Buffer used to read the request body from UploadDataStream and to send it.
+  // Chunked data is encoded in place.
   scoped_refptr<SeekableIOBuffer> request_body_send_buf_;
+  // Request body data the UploadDataStream handed out without copying it,
+  // which is written before |request_body_send_buf_| is used again. Only used
+  // when the data is not chunked.
+  scoped_refptr<DrainableIOBuffer> request_body_uncopied_buf_;
   bool sent_last_chunk_ = false;
 
   // Error received when uploading the body, if any.
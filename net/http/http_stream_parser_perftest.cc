@@ -0,0 +1,198 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_stream_parser.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "base/bind.h"
+#include "base/memory/raw_ptr.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/run_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "net/base/address_list.h"
+#include "net/base/chunked_upload_data_stream.h"
+#include "net/base/io_buffer.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+#include "net/base/test_completion_callback.h"
+#include "net/http/http_request_headers.h"
+#include "net/http/http_request_info.h"
+#include "net/http/http_response_info.h"
+#include "net/log/net_log_source.h"
+#include "net/log/net_log_with_source.h"
+#include "net/socket/stream_socket.h"
+#include "net/socket/tcp_client_socket.h"
+#include "net/socket/tcp_server_socket.h"
+#include "net/test/test_with_task_environment.h"
+#include "net/traffic_annotation/network_traffic_annotation_test_helper.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "url/gurl.h"
+
+namespace net {
+
+namespace {
+
+const int kNumRequests = 1000;
+const int kChunkSizes[] = {100, 1000, 10000};
+const int kChunksPerRequest = 4;
+const int kDrainBufferSize = 1 << 16;
+
+// A TCPClientSocket that counts its writes, each of which is a send() call.
+class WriteCountingTCPClientSocket : public TCPClientSocket {
+ public:
+  explicit WriteCountingTCPClientSocket(const IPEndPoint& address)
+      : TCPClientSocket(AddressList(address),
+                        nullptr /* socket_performance_watcher */,
+                        nullptr /* network_quality_estimator */,
+                        nullptr /* net_log */,
+                        NetLogSource()) {}
+
+  int Write(IOBuffer* buf,
+            int buf_len,
+            CompletionOnceCallback callback,
+            const NetworkTrafficAnnotationTag& traffic_annotation) override {
+    ++num_writes_;
+    return TCPClientSocket::Write(buf, buf_len, std::move(callback),
+                                  traffic_annotation);
+  }
+
+  int num_writes() const { return num_writes_; }
+
+ private:
+  int num_writes_ = 0;
+};
+
+// Reads and discards everything the peer sends.
+class SocketDrainer {
+ public:
+  explicit SocketDrainer(StreamSocket* socket)
+      : socket_(socket),
+        buf_(base::MakeRefCounted<IOBuffer>(kDrainBufferSize)) {}
+
+  void Start() { DoRead(); }
+
+  // Waits until |num_bytes| bytes were read in total.
+  void WaitForBytes(int64_t num_bytes) {
+    expected_bytes_ = num_bytes;
+    if (bytes_read_ >= expected_bytes_ || failed_)
+      return;
+    base::RunLoop run_loop;
+    quit_closure_ = run_loop.QuitClosure();
+    run_loop.Run();
+  }
+
+ private:
+  void DoRead() {
+    while (true) {
+      int result = socket_->Read(
+          buf_.get(), kDrainBufferSize,
+          base::BindOnce(&SocketDrainer::OnRead, base::Unretained(this)));
+      if (result == ERR_IO_PENDING || !HandleResult(result))
+        return;
+    }
+  }
+
+  void OnRead(int result) {
+    if (HandleResult(result))
+      DoRead();
+  }
+
+  // Returns whether to read more.
+  bool HandleResult(int result) {
+    if (result <= 0)
+      failed_ = true;
+    else
+      bytes_read_ += result;
+    if ((failed_ || bytes_read_ >= expected_bytes_) && quit_closure_)
+      std::move(quit_closure_).Run();
+    return !failed_;
+  }
+
+  const raw_ptr<StreamSocket> socket_;
+  scoped_refptr<IOBuffer> buf_;
+  int64_t bytes_read_ = 0;
+  int64_t expected_bytes_ = 0;
+  bool failed_ = false;
+  base::OnceClosure quit_closure_;
+};
+
+class HttpStreamParserPerfTest : public TestWithTaskEnvironment {};
+
+// Measures sending chunked POST requests whose chunks are all available up
+// front, like most ChunkedUploadDataStream uploads, over a loopback
+// connection: the number of socket writes per request and the time it takes.
+TEST_F(HttpStreamParserPerfTest, ChunkedPost) {
+  for (int chunk_size : kChunkSizes) {
+    TCPServerSocket listen_socket(nullptr /* net_log */, NetLogSource());
+    ASSERT_EQ(OK, listen_socket.ListenWithAddressAndPort("127.0.0.1", 0, 1));
+    IPEndPoint address;
+    ASSERT_EQ(OK, listen_socket.GetLocalAddress(&address));
+    std::unique_ptr<StreamSocket> server_socket;
+    TestCompletionCallback accept_callback;
+    int accept_result =
+        listen_socket.Accept(&server_socket, accept_callback.callback());
+    WriteCountingTCPClientSocket client_socket(address);
+    TestCompletionCallback connect_callback;
+    ASSERT_EQ(OK, connect_callback.GetResult(
+                      client_socket.Connect(connect_callback.callback())));
+    ASSERT_EQ(OK, accept_callback.GetResult(accept_result));
+
+    SocketDrainer drainer(server_socket.get());
+    drainer.Start();
+
+    const std::string chunk(chunk_size, 'x');
+    HttpRequestHeaders headers;
+    headers.SetHeader("Transfer-Encoding", "chunked");
+    int64_t sent_bytes = 0;
+
+    base::ElapsedTimer timer;
+    for (int i = 0; i < kNumRequests; ++i) {
+      ChunkedUploadDataStream upload_data_stream(0);
+      for (int j = 0; j < kChunksPerRequest; ++j) {
+        upload_data_stream.AppendData(chunk.data(), chunk.size(),
+                                      j == kChunksPerRequest - 1);
+      }
+      TestCompletionCallback init_callback;
+      ASSERT_EQ(OK, upload_data_stream.Init(init_callback.callback(),
+                                            NetLogWithSource()));
+
+      HttpRequestInfo request;
+      request.method = "POST";
+      request.url = GURL("http://localhost");
+      request.upload_data_stream = &upload_data_stream;
+      auto read_buffer = base::MakeRefCounted<GrowableIOBuffer>();
+      HttpStreamParser parser(&client_socket, i > 0 /* is_reused */, &request,
+                              read_buffer.get(), NetLogWithSource());
+      HttpResponseInfo response;
+      TestCompletionCallback send_callback;
+      ASSERT_EQ(OK, send_callback.GetResult(parser.SendRequest(
+                        "POST / HTTP/1.1\r\n", headers,
+                        TRAFFIC_ANNOTATION_FOR_TESTS, &response,
+                        send_callback.callback())));
+      sent_bytes += parser.sent_bytes();
+    }
+    drainer.WaitForBytes(sent_bytes);
+    base::TimeDelta send_time = timer.Elapsed();
+
+    perf_test::PerfResultReporter reporter(
+        "HttpStreamParser.", "ChunkedPost_" + base::NumberToString(chunk_size));
+    reporter.RegisterImportantMetric("writes_per_request", "count");
+    reporter.RegisterImportantMetric("send_time_per_request", "us");
+    reporter.AddResult(
+        "writes_per_request",
+        static_cast<double>(client_socket.num_writes()) / kNumRequests);
+    reporter.AddResult("send_time_per_request",
+                       send_time.InMicrosecondsF() / kNumRequests);
+  }
+}
+
+}  // namespace
+
+}  // namespace net
@@ -19,10 +19,12 @@
 #include "base/memory/ref_counted.h"
 #include "base/run_loop.h"
 #include "base/strings/string_piece.h"
+#include "base/test/scoped_feature_list.h"
 #include "base/test/task_environment.h"
 #include "base/threading/thread_task_runner_handle.h"
 #include "net/base/chunked_upload_data_stream.h"
 #include "net/base/elements_upload_data_stream.h"
+#include "net/base/features.h"
 #include "net/base/io_buffer.h"
 #include "net/base/load_flags.h"
 #include "net/base/net_errors.h"
@@ -48,11 +50,6 @@ namespace net {
 
 namespace {
 
-const size_t kOutputSize = 1024;  // Just large enough for this test.
-// The number of bytes that can fit in a buffer of kOutputSize.
-const size_t kMaxPayloadSize =
-    kOutputSize - HttpStreamParser::kChunkHeaderFooterSize;
-
 // Helper method to create a connected ClientSocketHandle using |data|.
 // Modifies |data|.
 std::unique_ptr<StreamSocket> CreateConnectedSocket(SequencedSocketData* data) {
@@ -67,6 +64,49 @@ std::unique_ptr<StreamSocket> CreateConnectedSocket(SequencedSocketData* data) {
   return socket;
 }
 
+// Sends a request whose chunked body is the single, final chunk |payload|,
+// and expects the body to go out as |expected_body| in one write.
+void ExpectChunkedBody(base::StringPiece payload,
+                       base::StringPiece expected_body) {
+  MockWrite writes[] = {
+      MockWrite(SYNCHRONOUS, 0,
+                "GET /one.html HTTP/1.1\r\n"
+                "Transfer-Encoding: chunked\r\n\r\n"),
+      MockWrite(SYNCHRONOUS, expected_body.data(), expected_body.size(), 1),
+  };
+
+  ChunkedUploadDataStream upload_stream(0);
+  ASSERT_THAT(upload_stream.Init(TestCompletionCallback().callback(),
+                                 NetLogWithSource()),
+              IsOk());
+  upload_stream.AppendData(payload.data(), payload.size(), true);
+
+  SequencedSocketData data(base::span<MockRead>(), writes);
+  std::unique_ptr<StreamSocket> stream_socket = CreateConnectedSocket(&data);
+
+  HttpRequestInfo request_info;
+  request_info.method = "GET";
+  request_info.url = GURL("http://localhost");
+  request_info.upload_data_stream = &upload_stream;
+
+  scoped_refptr<GrowableIOBuffer> read_buffer =
+      base::MakeRefCounted<GrowableIOBuffer>();
+  HttpStreamParser parser(stream_socket.get(), false /* is_reused */,
+                          &request_info, read_buffer.get(), NetLogWithSource());
+
+  HttpRequestHeaders request_headers;
+  request_headers.SetHeader("Transfer-Encoding", "chunked");
+
+  HttpResponseInfo response_info;
+  TestCompletionCallback callback;
+  EXPECT_THAT(parser.SendRequest("GET /one.html HTTP/1.1\r\n", request_headers,
+                                 TRAFFIC_ANNOTATION_FOR_TESTS, &response_info,
+                                 callback.callback()),
+              IsOk());
+  EXPECT_TRUE(data.AllWriteDataConsumed());
+  EXPECT_EQ(CountWriteBytes(writes), parser.sent_bytes());
+}
+
 class ReadErrorUploadDataStream : public UploadDataStream {
  public:
   enum class FailureMode { SYNC, ASYNC };
@@ -286,62 +326,22 @@ TEST(HttpStreamParser, InitAsynchronousUploadDataStream) {
   EXPECT_EQ(0u, progress.position());
 }
 
-// The empty payload is how the last chunk is encoded.
-TEST(HttpStreamParser, EncodeChunk_EmptyPayload) {
-  char output[kOutputSize];
-
-  const base::StringPiece kPayload = "";
-  const base::StringPiece kExpected = "0\r\n\r\n";
-  const int num_bytes_written =
-      HttpStreamParser::EncodeChunk(kPayload, output, sizeof(output));
-  ASSERT_EQ(kExpected.size(), static_cast<size_t>(num_bytes_written));
-  EXPECT_EQ(kExpected, base::StringPiece(output, num_bytes_written));
-}
-
 TEST(HttpStreamParser, EncodeChunk_ShortPayload) {
-  char output[kOutputSize];
+  base::test::TaskEnvironment task_environment;
 
   const std::string kPayload("foo\x00\x11\x22", 6);
-  // 11 = payload size + sizeof("6") + CRLF x 2.
-  const std::string kExpected("6\r\nfoo\x00\x11\x22\r\n", 11);
-  const int num_bytes_written =
-      HttpStreamParser::EncodeChunk(kPayload, output, sizeof(output));
-  ASSERT_EQ(kExpected.size(), static_cast<size_t>(num_bytes_written));
-  EXPECT_EQ(kExpected, base::StringPiece(output, num_bytes_written));
+  // The chunk, followed by the last chunk.
+  const std::string kExpected("6\r\nfoo\x00\x11\x22\r\n0\r\n\r\n", 16);
+  ExpectChunkedBody(kPayload, kExpected);
 }
 
 TEST(HttpStreamParser, EncodeChunk_LargePayload) {
-  char output[kOutputSize];
+  base::test::TaskEnvironment task_environment;
 
   const std::string kPayload(1000, '\xff');  // '\xff' x 1000.
   // 3E8 = 1000 in hex.
-  const std::string kExpected = "3E8\r\n" + kPayload + "\r\n";
-  const int num_bytes_written =
-      HttpStreamParser::EncodeChunk(kPayload, output, sizeof(output));
-  ASSERT_EQ(kExpected.size(), static_cast<size_t>(num_bytes_written));
-  EXPECT_EQ(kExpected, base::StringPiece(output, num_bytes_written));
-}
-
-TEST(HttpStreamParser, EncodeChunk_FullPayload) {
-  char output[kOutputSize];
-
-  const std::string kPayload(kMaxPayloadSize, '\xff');
-  // 3F4 = 1012 in hex.
-  const std::string kExpected = "3F4\r\n" + kPayload + "\r\n";
-  const int num_bytes_written =
-      HttpStreamParser::EncodeChunk(kPayload, output, sizeof(output));
-  ASSERT_EQ(kExpected.size(), static_cast<size_t>(num_bytes_written));
-  EXPECT_EQ(kExpected, base::StringPiece(output, num_bytes_written));
-}
-
-TEST(HttpStreamParser, EncodeChunk_TooLargePayload) {
-  char output[kOutputSize];
-
-  // The payload is one byte larger the output buffer size.
-  const std::string kPayload(kMaxPayloadSize + 1, '\xff');
-  const int num_bytes_written =
-      HttpStreamParser::EncodeChunk(kPayload, output, sizeof(output));
-  ASSERT_THAT(num_bytes_written, IsError(ERR_INVALID_ARGUMENT));
+  const std::string kExpected = "3E8\r\n" + kPayload + "\r\n0\r\n\r\n";
+  ExpectChunkedBody(kPayload, kExpected);
 }
 
 TEST(HttpStreamParser, ShouldMergeRequestHeadersAndBody_NoBody) {
@@ -606,6 +606,71 @@ TEST(HttpStreamParser, SentBytesPost) {
   EXPECT_EQ(12u, progress.position());
 }
 
+// Memory mapped file data is written to the socket as is, in writes that may
+// be larger than the buffer used otherwise.
+TEST(HttpStreamParser, PostMemoryMappedFile) {
+  base::test::ScopedFeatureList feature_list(
+      features::kUploadFileMemoryMapping);
+  base::test::TaskEnvironment task_environment(
+      base::test::TaskEnvironment::MainThreadType::IO);
+
+  const std::string kBody(100000, 'x');
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath temp_file_path;
+  ASSERT_TRUE(
+      base::CreateTemporaryFileInDir(temp_dir.GetPath(), &temp_file_path));
+  ASSERT_TRUE(base::WriteFile(temp_file_path, kBody));
+
+  MockWrite writes[] = {
+      MockWrite(SYNCHRONOUS, 0, "POST / HTTP/1.1\r\n"),
+      MockWrite(SYNCHRONOUS, 1, "Content-Length: 100000\r\n\r\n"),
+      MockWrite(SYNCHRONOUS, kBody.data(), kBody.size(), 2),
+  };
+
+  SequencedSocketData data(base::span<MockRead>(), writes);
+  std::unique_ptr<StreamSocket> stream_socket = CreateConnectedSocket(&data);
+
+  {
+    std::vector<std::unique_ptr<UploadElementReader>> element_readers;
+    element_readers.push_back(std::make_unique<UploadFileElementReader>(
+        base::ThreadTaskRunnerHandle::Get().get(), temp_file_path, 0,
+        kBody.size(), base::Time()));
+    ElementsUploadDataStream upload_data_stream(std::move(element_readers), 0);
+    TestCompletionCallback init_callback;
+    ASSERT_THAT(upload_data_stream.Init(init_callback.callback(),
+                                        NetLogWithSource()),
+                IsError(ERR_IO_PENDING));
+    ASSERT_THAT(init_callback.WaitForResult(), IsOk());
+
+    HttpRequestInfo request;
+    request.method = "POST";
+    request.url = GURL("http://localhost");
+    request.upload_data_stream = &upload_data_stream;
+
+    scoped_refptr<GrowableIOBuffer> read_buffer =
+        base::MakeRefCounted<GrowableIOBuffer>();
+    HttpStreamParser parser(stream_socket.get(), false /* is_reused */,
+                            &request, read_buffer.get(), NetLogWithSource());
+
+    HttpRequestHeaders headers;
+    headers.SetHeader("Content-Length", "100000");
+
+    HttpResponseInfo response;
+    TestCompletionCallback callback;
+    EXPECT_EQ(OK, parser.SendRequest("POST / HTTP/1.1\r\n", headers,
+                                     TRAFFIC_ANNOTATION_FOR_TESTS, &response,
+                                     callback.callback()));
+
+    EXPECT_EQ(CountWriteBytes(writes), parser.sent_bytes());
+    EXPECT_TRUE(upload_data_stream.IsEOF());
+    EXPECT_EQ(kBody.size(), upload_data_stream.GetUploadProgress().position());
+  }
+
+  // UploadFileElementReaders may post clean-up tasks on destruction.
+  base::RunLoop().RunUntilIdle();
+}
+
 TEST(HttpStreamParser, SentBytesChunkedPostError) {
   base::test::TaskEnvironment task_environment;
 
@@ -672,8 +737,8 @@ TEST(HttpStreamParser, AsyncSingleChunkAndAsyncSocket) {
       MockWrite(ASYNC, 0,
                 "GET /one.html HTTP/1.1\r\n"
                 "Transfer-Encoding: chunked\r\n\r\n"),
-      MockWrite(ASYNC, 1, "5\r\nChunk\r\n"),
-      MockWrite(ASYNC, 2, "0\r\n\r\n"),
+      // The last chunk is sent along with the final data.
+      MockWrite(ASYNC, 1, "5\r\nChunk\r\n0\r\n\r\n"),
   };
 
   // The size of the response body, as reflected in the Content-Length of the
@@ -681,10 +746,10 @@ TEST(HttpStreamParser, AsyncSingleChunkAndAsyncSocket) {
   static const int kBodySize = 8;
 
   MockRead reads[] = {
-      MockRead(ASYNC, 3, "HTTP/1.1 200 OK\r\n"),
-      MockRead(ASYNC, 4, "Content-Length: 8\r\n\r\n"),
-      MockRead(ASYNC, 5, "one.html"),
-      MockRead(SYNCHRONOUS, 0, 6),  // EOF
+      MockRead(ASYNC, 2, "HTTP/1.1 200 OK\r\n"),
+      MockRead(ASYNC, 3, "Content-Length: 8\r\n\r\n"),
+      MockRead(ASYNC, 4, "one.html"),
+      MockRead(SYNCHRONOUS, 0, 5),  // EOF
   };
 
   ChunkedUploadDataStream upload_stream(0);
@@ -754,8 +819,8 @@ TEST(HttpStreamParser, SyncSingleChunkAndAsyncSocket) {
       MockWrite(ASYNC, 0,
                 "GET /one.html HTTP/1.1\r\n"
                 "Transfer-Encoding: chunked\r\n\r\n"),
-      MockWrite(ASYNC, 1, "5\r\nChunk\r\n"),
-      MockWrite(ASYNC, 2, "0\r\n\r\n"),
+      // The last chunk is sent along with the final data.
+      MockWrite(ASYNC, 1, "5\r\nChunk\r\n0\r\n\r\n"),
   };
 
   // The size of the response body, as reflected in the Content-Length of the
@@ -763,10 +828,10 @@ TEST(HttpStreamParser, SyncSingleChunkAndAsyncSocket) {
   static const int kBodySize = 8;
 
   MockRead reads[] = {
-      MockRead(ASYNC, 3, "HTTP/1.1 200 OK\r\n"),
-      MockRead(ASYNC, 4, "Content-Length: 8\r\n\r\n"),
-      MockRead(ASYNC, 5, "one.html"),
-      MockRead(SYNCHRONOUS, 0, 6),  // EOF
+      MockRead(ASYNC, 2, "HTTP/1.1 200 OK\r\n"),
+      MockRead(ASYNC, 3, "Content-Length: 8\r\n\r\n"),
+      MockRead(ASYNC, 4, "one.html"),
+      MockRead(SYNCHRONOUS, 0, 5),  // EOF
   };
 
   ChunkedUploadDataStream upload_stream(0);
@@ -839,8 +904,7 @@ TEST(HttpStreamParser, AsyncChunkAndAsyncSocketWithMultipleChunks) {
                 "Transfer-Encoding: chunked\r\n\r\n"),
       MockWrite(ASYNC, 1, "7\r\nChunk 1\r\n"),
       MockWrite(ASYNC, 2, "8\r\nChunky 2\r\n"),
-      MockWrite(ASYNC, 3, "6\r\nTest 3\r\n"),
-      MockWrite(ASYNC, 4, "0\r\n\r\n"),
+      MockWrite(ASYNC, 3, "6\r\nTest 3\r\n0\r\n\r\n"),
   };
 
   // The size of the response body, as reflected in the Content-Length of the
@@ -848,10 +912,10 @@ TEST(HttpStreamParser, AsyncChunkAndAsyncSocketWithMultipleChunks) {
   static const int kBodySize = 8;
 
   MockRead reads[] = {
-    MockRead(ASYNC, 5, "HTTP/1.1 200 OK\r\n"),
-    MockRead(ASYNC, 6, "Content-Length: 8\r\n\r\n"),
-    MockRead(ASYNC, 7, "one.html"),
-    MockRead(SYNCHRONOUS, 0, 8),  // EOF
+    MockRead(ASYNC, 4, "HTTP/1.1 200 OK\r\n"),
+    MockRead(ASYNC, 5, "Content-Length: 8\r\n\r\n"),
+    MockRead(ASYNC, 6, "one.html"),
+    MockRead(SYNCHRONOUS, 0, 7),  // EOF
   };
 
   ChunkedUploadDataStream upload_stream(0);
@@ -23,6 +23,7 @@
 #include "net/base/mime_util.h"
 #include "net/base/parse_number.h"
 #include "net/base/url_util.h"
+#include "net/http/http_header_scanner.h"
 #include "net/http/http_response_headers.h"
 
 namespace net {
@@ -536,25 +537,28 @@ static size_t LocateEndOfHeadersHelper(const char* buf,
                                        size_t buf_len,
                                        size_t i,
                                        bool accept_empty_header_list) {
-  char last_c = '\0';
-  bool was_lf = false;
-  if (accept_empty_header_list) {
-    // Normally two line breaks signal the end of a header list. An empty header
-    // list ends with a single line break at the start of the buffer.
-    last_c = '\n';
-    was_lf = true;
-  }
+  // The headers end at a line feed that directly follows another line feed,
+  // optionally with a single carriage return in between. Only line feeds can
+  // end the block, so jump from one to the next with the vectorized scanner
+  // and look back at the bytes preceding each. Bytes before |i| were not
+  // scanned; normally they are treated as not being line breaks. An empty
+  // header list ends with a single line break at the start of the buffer, so
+  // in that case the byte before |i| is treated as a line feed.
+  const size_t start = i;
+  auto byte_before = [&](size_t pos, size_t distance) {
+    if (pos >= start + distance)
+      return buf[pos - distance];
+    if (accept_empty_header_list && pos + 1 == start + distance)
+      return '\n';
+    return '\0';
+  };
 
-  for (; i < buf_len; ++i) {
-    char c = buf[i];
-    if (c == '\n') {
-      if (was_lf)
-        return i + 1;
-      was_lf = true;
-    } else if (c != '\r' || last_c != '\n') {
-      was_lf = false;
-    }
-    last_c = c;
+  base::StringPiece input(buf, buf_len);
+  for (i = FindHeaderByte(input, i, '\n'); i < buf_len;
+       i = FindHeaderByte(input, i + 1, '\n')) {
+    char prev = byte_before(i, 1);
+    if (prev == '\n' || (prev == '\r' && byte_before(i, 2) == '\n'))
+      return i + 1;
   }
   return std::string::npos;
 }
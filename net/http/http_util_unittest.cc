@@ -346,6 +346,30 @@ TEST(HttpUtilTest, LocateEndOfHeaders) {
   }
 }
 
+// The terminator may straddle the blocks compared by the vectorized scanner,
+// and bytes before the search start are never treated as line breaks.
+TEST(HttpUtilTest, LocateEndOfHeadersLongLines) {
+  for (size_t padding = 0; padding < 40; ++padding) {
+    std::string line = "X-Padding: " + std::string(padding, 'p');
+    std::string crlf = "HTTP/1.1 200 OK\r\n" + line + "\r\n\r\nbody";
+    EXPECT_EQ(crlf.size() - 4,
+              HttpUtil::LocateEndOfHeaders(crlf.data(), crlf.size()));
+
+    std::string lf = "HTTP/1.1 200 OK\n" + line + "\n\nbody";
+    EXPECT_EQ(lf.size() - 4, HttpUtil::LocateEndOfHeaders(lf.data(), lf.size()));
+
+    std::string lone_crs = line + "\r\r\n\r\r\n";
+    EXPECT_EQ(std::string::npos,
+              HttpUtil::LocateEndOfHeaders(lone_crs.data(), lone_crs.size()));
+  }
+
+  const std::string kSplit = "foo\n\nbar\n";
+  EXPECT_EQ(std::string::npos,
+            HttpUtil::LocateEndOfHeaders(kSplit.data(), kSplit.size(), 4));
+  EXPECT_EQ(5u, HttpUtil::LocateEndOfAdditionalHeaders(kSplit.data(),
+                                                       kSplit.size(), 4));
+}
+
 TEST(HttpUtilTest, LocateEndOfAdditionalHeaders) {
   struct {
     const char* const input;
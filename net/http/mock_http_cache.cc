@@ -554,7 +554,19 @@ net::Error MockDiskCache::DoomEntry(const std::string& key,
 }
 
 net::Error MockDiskCache::DoomAllEntries(CompletionOnceCallback callback) {
-  return ERR_NOT_IMPLEMENTED;
+  DCHECK(!callback.is_null());
+  if (fail_requests_)
+    return ERR_CACHE_DOOM_FAILURE;
+
+  for (auto& entry : entries_) {
+    entry.second->Doom();
+    entry.second->Release();
+    doomed_count_++;
+  }
+  entries_.clear();
+
+  CallbackLater(base::BindOnce(std::move(callback), OK));
+  return ERR_IO_PENDING;
 }
 
 net::Error MockDiskCache::DoomEntriesBetween(const base::Time initial_time,
@@ -673,7 +685,11 @@ disk_cache::Backend* MockHttpCache::backend() {
 }
 
 MockDiskCache* MockHttpCache::disk_cache() {
-  return static_cast<MockDiskCache*>(backend());
+  // Inspecting the mock should not drop the in-memory tier, as handing the
+  // backend out through GetBackend() does.
+  disk_cache::Backend* current_backend = http_cache_.GetCurrentBackend();
+  return static_cast<MockDiskCache*>(current_backend ? current_backend
+                                                     : backend());
 }
 
 int MockHttpCache::CreateTransaction(std::unique_ptr<HttpTransaction>* trans) {
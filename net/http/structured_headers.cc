@@ -0,0 +1,647 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/structured_headers.h"
+
+#include <utility>
+
+#include "base/check.h"
+#include "base/check_op.h"
+#include "base/memory/raw_ptr.h"
+#include "base/strings/string_util.h"
+
+namespace net::structured_headers {
+
+namespace {
+
+// Characters allowed in keys, after the first one.
+// https://www.rfc-editor.org/rfc/rfc8941.html#section-3.1.2
+bool IsKeyChar(char c) {
+  return base::IsAsciiLower(c) || base::IsAsciiDigit(c) || c == '_' ||
+         c == '-' || c == '.' || c == '*';
+}
+
+// Characters allowed in tokens, after the first one.
+// https://www.rfc-editor.org/rfc/rfc8941.html#section-3.3.4
+bool IsTokenChar(char c) {
+  if (base::IsAsciiAlpha(c) || base::IsAsciiDigit(c))
+    return true;
+  switch (c) {
+    case '!':
+    case '#':
+    case '$':
+    case '%':
+    case '&':
+    case '\'':
+    case '*':
+    case '+':
+    case '-':
+    case '.':
+    case '^':
+    case '_':
+    case '`':
+    case '|':
+    case '~':
+    case ':':
+    case '/':
+      return true;
+    default:
+      return false;
+  }
+}
+
+const int64_t kPowersOfTen[] = {1, 10, 100, 1000};
+
+// The maximum number of digits of integers, and of the integer and fractional
+// parts of decimals.
+const size_t kMaxIntegerDigits = 15;
+const size_t kMaxDecimalIntegerDigits = 12;
+const size_t kMaxDecimalFractionDigits = 3;
+
+std::string Unescape(base::StringPiece escaped) {
+  std::string unescaped;
+  unescaped.reserve(escaped.size());
+  for (size_t i = 0; i < escaped.size(); ++i) {
+    if (escaped[i] == '\\')
+      ++i;
+    unescaped.push_back(escaped[i]);
+  }
+  return unescaped;
+}
+
+Parameters ToParameters(base::span<const ParameterView> params) {
+  Parameters parameters;
+  parameters.reserve(params.size());
+  for (const ParameterView& param : params)
+    parameters.emplace_back(std::string(param.key), param.value.ToItem());
+  return parameters;
+}
+
+ParameterizedItem ToParameterizedItem(const ParameterizedItemView& item) {
+  return ParameterizedItem(item.item.ToItem(), ToParameters(item.params));
+}
+
+ParameterizedMember ToParameterizedMember(
+    const ParameterizedMemberView& member) {
+  std::vector<ParameterizedItem> items;
+  items.reserve(member.member.size());
+  for (const ParameterizedItemView& item : member.member)
+    items.push_back(ToParameterizedItem(item));
+  return ParameterizedMember(std::move(items), member.member_is_inner_list,
+                             ToParameters(member.params));
+}
+
+}  // namespace
+
+// Parses RFC 8941 fields into the views of a ViewArena. This follows the
+// parsing algorithms of the RFC, as quiche::structured_headers does for
+// owning types, so both accept the same fields.
+class ViewParser {
+ public:
+  ViewParser(base::StringPiece str, ViewArena* arena)
+      : input_(str), arena_(arena) {
+    arena_->Clear();
+    // Discard any leading SP characters.
+    SkipWhitespaces();
+  }
+
+  ViewParser(const ViewParser&) = delete;
+  ViewParser& operator=(const ViewParser&) = delete;
+
+  // Returns whether the rest of the input is only SP characters, and if so,
+  // points the spans of the parsed views into the arena.
+  bool FinishParsing() {
+    SkipWhitespaces();
+    if (!input_.empty())
+      return false;
+    arena_->SetSpans();
+    return true;
+  }
+
+  // The item read by the last ReadItem() call.
+  const ParameterizedItemView& last_item() const {
+    return arena_->items_.back();
+  }
+
+  // The members read by ReadList() or ReadDictionary().
+  base::span<const ParameterizedMemberView> members() const {
+    return arena_->members_;
+  }
+
+  // https://www.rfc-editor.org/rfc/rfc8941.html#section-4.2.1
+  bool ReadList() {
+    while (!input_.empty()) {
+      if (!ReadItemOrInnerList(base::StringPiece()))
+        return false;
+      if (!ReadListSeparator())
+        return false;
+    }
+    return true;
+  }
+
+  // https://www.rfc-editor.org/rfc/rfc8941.html#section-4.2.2
+  bool ReadDictionary() {
+    while (!input_.empty()) {
+      base::StringPiece key;
+      if (!ReadKey(&key))
+        return false;
+      size_t index = arena_->members_.size();
+      if (ConsumeChar('=')) {
+        if (!ReadItemOrInnerList(key))
+          return false;
+      } else {
+        BareItemView value;
+        value.type_ = Item::kBooleanType;
+        value.boolean_ = true;
+        AddMember(key, value);
+        if (!ReadParameters(&arena_->member_params_.back()))
+          return false;
+      }
+
+      // A later value of a key replaces the earlier one, in its place.
+      for (size_t i = 0; i < index; ++i) {
+        if (arena_->members_[i].key == key) {
+          arena_->members_[i] = arena_->members_[index];
+          arena_->member_items_[i] = arena_->member_items_[index];
+          arena_->member_params_[i] = arena_->member_params_[index];
+          arena_->members_.pop_back();
+          arena_->member_items_.pop_back();
+          arena_->member_params_.pop_back();
+          break;
+        }
+      }
+
+      if (!ReadListSeparator())
+        return false;
+    }
+    return true;
+  }
+
+  // https://www.rfc-editor.org/rfc/rfc8941.html#section-4.2.3
+  bool ReadItem(ViewArena::Range* params) {
+    BareItemView item;
+    if (!ReadBareItem(&item))
+      return false;
+    AddItem(item);
+    if (!ReadParameters(&arena_->item_params_.back()))
+      return false;
+    if (params)
+      *params = arena_->item_params_.back();
+    return true;
+  }
+
+  // https://www.rfc-editor.org/rfc/rfc8941.html#section-4.2.3.1
+  bool ReadBareItem(BareItemView* item) {
+    if (input_.empty())
+      return false;
+    switch (input_.front()) {
+      case '"':
+        return ReadString(item);
+      case '*':
+        return ReadToken(item);
+      case ':':
+        return ReadByteSequence(item);
+      case '?':
+        return ReadBoolean(item);
+      default:
+        if (input_.front() == '-' || base::IsAsciiDigit(input_.front()))
+          return ReadNumber(item);
+        if (base::IsAsciiAlpha(input_.front()))
+          return ReadToken(item);
+        return false;
+    }
+  }
+
+ private:
+  // Reads the separator after a list or dictionary member, if there is one.
+  bool ReadListSeparator() {
+    SkipOWS();
+    if (input_.empty())
+      return true;
+    if (!ConsumeChar(','))
+      return false;
+    SkipOWS();
+    // Trailing commas aren't allowed.
+    return !input_.empty();
+  }
+
+  // https://www.rfc-editor.org/rfc/rfc8941.html#section-4.2.1.1
+  bool ReadItemOrInnerList(base::StringPiece key) {
+    if (input_.empty() || input_.front() != '(') {
+      ViewArena::Range item_params;
+      size_t item_index = arena_->items_.size();
+      if (!ReadItem(&item_params))
+        return false;
+      // The parameters of a single item belong to the member.
+      AddMember(key, item_index, 1, false /* member_is_inner_list */);
+      arena_->member_params_.back() = item_params;
+      arena_->item_params_[item_index] = ViewArena::Range();
+      return true;
+    }
+    return ReadInnerList(key);
+  }
+
+  // https://www.rfc-editor.org/rfc/rfc8941.html#section-4.2.1.2
+  bool ReadInnerList(base::StringPiece key) {
+    if (!ConsumeChar('('))
+      return false;
+    size_t first_item = arena_->items_.size();
+    while (true) {
+      SkipWhitespaces();
+      if (ConsumeChar(')')) {
+        AddMember(key, first_item, arena_->items_.size() - first_item,
+                  true /* member_is_inner_list */);
+        return ReadParameters(&arena_->member_params_.back());
+      }
+      if (!ReadItem(nullptr))
+        return false;
+      if (input_.empty() || (input_.front() != ' ' && input_.front() != ')'))
+        return false;
+    }
+  }
+
+  // https://www.rfc-editor.org/rfc/rfc8941.html#section-4.2.3.2
+  bool ReadParameters(ViewArena::Range* params) {
+    params->begin = arena_->params_.size();
+    params->size = 0;
+    while (ConsumeChar(';')) {
+      SkipWhitespaces();
+      ParameterView param;
+      if (!ReadKey(&param.key))
+        return false;
+      if (ConsumeChar('=')) {
+        if (!ReadBareItem(&param.value))
+          return false;
+      } else {
+        param.value.type_ = Item::kBooleanType;
+        param.value.boolean_ = true;
+      }
+
+      // A later value of a key replaces the earlier one, in its place.
+      bool is_duplicate_key = false;
+      for (size_t i = params->begin; i < arena_->params_.size(); ++i) {
+        if (arena_->params_[i].key == param.key) {
+          arena_->params_[i].value = param.value;
+          is_duplicate_key = true;
+          break;
+        }
+      }
+      if (!is_duplicate_key) {
+        arena_->params_.push_back(param);
+        ++params->size;
+      }
+    }
+    return true;
+  }
+
+  // https://www.rfc-editor.org/rfc/rfc8941.html#section-4.2.3.3
+  bool ReadKey(base::StringPiece* key) {
+    if (input_.empty() ||
+        !(base::IsAsciiLower(input_.front()) || input_.front() == '*')) {
+      return false;
+    }
+    size_t length = 1;
+    while (length < input_.size() && IsKeyChar(input_[length]))
+      ++length;
+    *key = input_.substr(0, length);
+    input_.remove_prefix(length);
+    return true;
+  }
+
+  // https://www.rfc-editor.org/rfc/rfc8941.html#section-4.2.4
+  bool ReadNumber(BareItemView* item) {
+    bool is_negative = ConsumeChar('-');
+    size_t length = 0;
+    size_t decimal_position = 0;
+    bool is_decimal = false;
+    for (; length < input_.size(); ++length) {
+      if (length > 0 && input_[length] == '.' && !is_decimal) {
+        is_decimal = true;
+        decimal_position = length;
+        continue;
+      }
+      if (!base::IsAsciiDigit(input_[length]))
+        break;
+    }
+    if (length == 0)
+      return false;
+
+    size_t fraction_digits = 0;
+    if (!is_decimal) {
+      if (length > kMaxIntegerDigits)
+        return false;
+    } else {
+      fraction_digits = length - decimal_position - 1;
+      if (decimal_position > kMaxDecimalIntegerDigits ||
+          fraction_digits > kMaxDecimalFractionDigits ||
+          fraction_digits == 0) {
+        return false;
+      }
+    }
+
+    // At most 15 digits, so this can't overflow.
+    int64_t value = 0;
+    for (char c : input_.substr(0, length)) {
+      if (c != '.')
+        value = value * 10 + (c - '0');
+    }
+    input_.remove_prefix(length);
+
+    if (!is_decimal) {
+      item->type_ = Item::kIntegerType;
+      item->integer_ = is_negative ? -value : value;
+      return true;
+    }
+    // |value| and the power of ten are exact, so this is the closest double to
+    // the decimal, as if it were parsed with strtod().
+    double decimal = static_cast<double>(value) /
+                     static_cast<double>(kPowersOfTen[fraction_digits]);
+    item->type_ = Item::kDecimalType;
+    item->decimal_ = is_negative ? -decimal : decimal;
+    return true;
+  }
+
+  // https://www.rfc-editor.org/rfc/rfc8941.html#section-4.2.5
+  bool ReadString(BareItemView* item) {
+    if (!ConsumeChar('"'))
+      return false;
+    bool has_escapes = false;
+    for (size_t i = 0; i < input_.size(); ++i) {
+      char c = input_[i];
+      if (c == '"') {
+        item->type_ = Item::kStringType;
+        item->raw_value_ = input_.substr(0, i);
+        item->has_escapes_ = has_escapes;
+        input_.remove_prefix(i + 1);
+        return true;
+      }
+      if (c < 0x20 || c > 0x7E)
+        return false;
+      if (c == '\\') {
+        ++i;
+        if (i == input_.size() || (input_[i] != '"' && input_[i] != '\\'))
+          return false;
+        has_escapes = true;
+      }
+    }
+    return false;
+  }
+
+  // https://www.rfc-editor.org/rfc/rfc8941.html#section-4.2.6
+  bool ReadToken(BareItemView* item) {
+    if (input_.empty() ||
+        !(base::IsAsciiAlpha(input_.front()) || input_.front() == '*')) {
+      return false;
+    }
+    size_t length = 1;
+    while (length < input_.size() && IsTokenChar(input_[length]))
+      ++length;
+    item->type_ = Item::kTokenType;
+    item->raw_value_ = input_.substr(0, length);
+    input_.remove_prefix(length);
+    return true;
+  }
+
+  // https://www.rfc-editor.org/rfc/rfc8941.html#section-4.2.7
+  bool ReadByteSequence(BareItemView* item) {
+    size_t end = input_.find(':', 1);
+    if (input_.empty() || input_.front() != ':' ||
+        end == base::StringPiece::npos) {
+      return false;
+    }
+    // Have quiche validate the base64, so both parsers accept the same byte
+    // sequences. This copies the decoded bytes, but byte sequences are rare.
+    if (!quiche::structured_headers::ParseBareItem(
+            base::StringPieceToStringView(input_.substr(0, end + 1)))) {
+      return false;
+    }
+    item->type_ = Item::kByteSequenceType;
+    item->raw_value_ = input_.substr(1, end - 1);
+    input_.remove_prefix(end + 1);
+    return true;
+  }
+
+  // https://www.rfc-editor.org/rfc/rfc8941.html#section-4.2.8
+  bool ReadBoolean(BareItemView* item) {
+    if (!ConsumeChar('?'))
+      return false;
+    item->type_ = Item::kBooleanType;
+    if (ConsumeChar('1')) {
+      item->boolean_ = true;
+      return true;
+    }
+    if (ConsumeChar('0')) {
+      item->boolean_ = false;
+      return true;
+    }
+    return false;
+  }
+
+  void AddItem(const BareItemView& item) {
+    arena_->items_.push_back({item, {}});
+    arena_->item_params_.emplace_back();
+  }
+
+  void AddMember(base::StringPiece key,
+                 size_t first_item,
+                 size_t num_items,
+                 bool member_is_inner_list) {
+    ParameterizedMemberView member;
+    member.key = key;
+    member.member_is_inner_list = member_is_inner_list;
+    arena_->members_.push_back(member);
+    arena_->member_items_.push_back({static_cast<uint32_t>(first_item),
+                                     static_cast<uint32_t>(num_items)});
+    arena_->member_params_.emplace_back();
+  }
+
+  // Adds a dictionary member whose value is |item|, without parameters.
+  void AddMember(base::StringPiece key, const BareItemView& item) {
+    size_t item_index = arena_->items_.size();
+    AddItem(item);
+    AddMember(key, item_index, 1, false /* member_is_inner_list */);
+  }
+
+  void SkipWhitespaces() {
+    while (!input_.empty() && input_.front() == ' ')
+      input_.remove_prefix(1);
+  }
+
+  void SkipOWS() {
+    while (!input_.empty() &&
+           (input_.front() == ' ' || input_.front() == '\t')) {
+      input_.remove_prefix(1);
+    }
+  }
+
+  bool ConsumeChar(char expected) {
+    if (!input_.empty() && input_.front() == expected) {
+      input_.remove_prefix(1);
+      return true;
+    }
+    return false;
+  }
+
+  base::StringPiece input_;
+  const raw_ptr<ViewArena> arena_;
+};
+
+BareItemView::BareItemView() : integer_(0) {}
+
+int64_t BareItemView::GetInteger() const {
+  CHECK(is_integer());
+  return integer_;
+}
+
+double BareItemView::GetDecimal() const {
+  CHECK(is_decimal());
+  return decimal_;
+}
+
+bool BareItemView::GetBoolean() const {
+  CHECK(is_boolean());
+  return boolean_;
+}
+
+base::StringPiece BareItemView::raw_value() const {
+  CHECK(is_string() || is_token() || is_byte_sequence());
+  return raw_value_;
+}
+
+std::string BareItemView::GetString() const {
+  CHECK(is_string() || is_token());
+  return has_escapes_ ? Unescape(raw_value_) : std::string(raw_value_);
+}
+
+std::string BareItemView::GetByteSequence() const {
+  CHECK(is_byte_sequence());
+  std::string field = ":" + std::string(raw_value_) + ":";
+  absl::optional<Item> item = quiche::structured_headers::ParseBareItem(field);
+  // The parser already checked that the byte sequence is valid.
+  DCHECK(item);
+  return item ? item->GetString() : std::string();
+}
+
+Item BareItemView::ToItem() const {
+  switch (type_) {
+    case Item::kNullType:
+      return Item();
+    case Item::kIntegerType:
+      return Item(integer_);
+    case Item::kDecimalType:
+      return Item(decimal_);
+    case Item::kStringType:
+      return Item(GetString(), Item::kStringType);
+    case Item::kTokenType:
+      return Item(GetString(), Item::kTokenType);
+    case Item::kByteSequenceType:
+      return Item(GetByteSequence(), Item::kByteSequenceType);
+    case Item::kBooleanType:
+      return Item(boolean_);
+  }
+}
+
+ViewArena::ViewArena() = default;
+
+ViewArena::~ViewArena() = default;
+
+void ViewArena::Clear() {
+  params_.clear();
+  items_.clear();
+  item_params_.clear();
+  members_.clear();
+  member_items_.clear();
+  member_params_.clear();
+}
+
+void ViewArena::SetSpans() {
+  DCHECK_EQ(items_.size(), item_params_.size());
+  DCHECK_EQ(members_.size(), member_items_.size());
+  DCHECK_EQ(members_.size(), member_params_.size());
+  base::span<const ParameterView> params(params_);
+  base::span<const ParameterizedItemView> items(items_);
+  for (size_t i = 0; i < items_.size(); ++i) {
+    items_[i].params =
+        params.subspan(item_params_[i].begin, item_params_[i].size);
+  }
+  for (size_t i = 0; i < members_.size(); ++i) {
+    members_[i].member =
+        items.subspan(member_items_[i].begin, member_items_[i].size);
+    members_[i].params =
+        params.subspan(member_params_[i].begin, member_params_[i].size);
+  }
+}
+
+absl::optional<ParameterizedItemView> ParseItemView(base::StringPiece str,
+                                                    ViewArena* arena) {
+  ViewParser parser(str, arena);
+  if (!parser.ReadItem(nullptr) || !parser.FinishParsing())
+    return absl::nullopt;
+  return parser.last_item();
+}
+
+absl::optional<base::span<const ParameterizedMemberView>> ParseListView(
+    base::StringPiece str,
+    ViewArena* arena) {
+  ViewParser parser(str, arena);
+  if (!parser.ReadList() || !parser.FinishParsing())
+    return absl::nullopt;
+  return parser.members();
+}
+
+absl::optional<base::span<const ParameterizedMemberView>> ParseDictionaryView(
+    base::StringPiece str,
+    ViewArena* arena) {
+  ViewParser parser(str, arena);
+  if (!parser.ReadDictionary() || !parser.FinishParsing())
+    return absl::nullopt;
+  return parser.members();
+}
+
+absl::optional<ParameterizedItem> ParseItem(base::StringPiece str) {
+  ViewArena arena;
+  absl::optional<ParameterizedItemView> item = ParseItemView(str, &arena);
+  if (!item)
+    return absl::nullopt;
+  return ToParameterizedItem(*item);
+}
+
+absl::optional<Item> ParseBareItem(base::StringPiece str) {
+  ViewArena arena;
+  ViewParser parser(str, &arena);
+  BareItemView item;
+  if (!parser.ReadBareItem(&item) || !parser.FinishParsing())
+    return absl::nullopt;
+  return item.ToItem();
+}
+
+absl::optional<List> ParseList(base::StringPiece str) {
+  ViewArena arena;
+  absl::optional<base::span<const ParameterizedMemberView>> members =
+      ParseListView(str, &arena);
+  if (!members)
+    return absl::nullopt;
+  List list;
+  list.reserve(members->size());
+  for (const ParameterizedMemberView& member : *members)
+    list.push_back(ToParameterizedMember(member));
+  return list;
+}
+
+absl::optional<Dictionary> ParseDictionary(base::StringPiece str) {
+  ViewArena arena;
+  absl::optional<base::span<const ParameterizedMemberView>> members =
+      ParseDictionaryView(str, &arena);
+  if (!members)
+    return absl::nullopt;
+  std::vector<DictionaryMember> dictionary_members;
+  dictionary_members.reserve(members->size());
+  for (const ParameterizedMemberView& member : *members) {
+    dictionary_members.emplace_back(std::string(member.key),
+                                    ToParameterizedMember(member));
+  }
+  return Dictionary(std::move(dictionary_members));
+}
+
+}  // namespace net::structured_headers
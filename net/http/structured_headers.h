@@ -5,10 +5,15 @@
 #ifndef NET_HTTP_STRUCTURED_HEADERS_H_
 #define NET_HTTP_STRUCTURED_HEADERS_H_
 
+#include <stdint.h>
+
 #include <string>
+#include <vector>
 
+#include "base/containers/span.h"
 #include "base/strings/abseil_string_conversions.h"
 #include "base/strings/string_piece.h"
+#include "net/base/net_export.h"
 #include "net/third_party/quiche/src/quiche/common/structured_headers.h"
 #include "third_party/abseil-cpp/absl/types/optional.h"
 
@@ -26,14 +31,125 @@ using ListOfLists = quiche::structured_headers::ListOfLists;
 using List = quiche::structured_headers::List;
 using Parameters = quiche::structured_headers::Parameters;
 
-inline absl::optional<ParameterizedItem> ParseItem(base::StringPiece str) {
-  return quiche::structured_headers::ParseItem(
-      base::StringPieceToStringView(str));
-}
-inline absl::optional<Item> ParseBareItem(base::StringPiece str) {
-  return quiche::structured_headers::ParseBareItem(
-      base::StringPieceToStringView(str));
-}
+// Views of the parts of an RFC 8941 structured field, pointing into the field
+// value and into the ViewArena that it was parsed with. Parsing into views
+// doesn't copy any strings, and reusing a ViewArena for many fields reuses its
+// storage, so parsing many fields doesn't allocate once the arena is large
+// enough. Views are valid as long as the field value is, and until the arena
+// is destroyed or used to parse another field.
+class NET_EXPORT BareItemView {
+ public:
+  BareItemView();
+
+  Item::ItemType type() const { return type_; }
+  bool is_integer() const { return type_ == Item::kIntegerType; }
+  bool is_decimal() const { return type_ == Item::kDecimalType; }
+  bool is_string() const { return type_ == Item::kStringType; }
+  bool is_token() const { return type_ == Item::kTokenType; }
+  bool is_byte_sequence() const { return type_ == Item::kByteSequenceType; }
+  bool is_boolean() const { return type_ == Item::kBooleanType; }
+
+  int64_t GetInteger() const;
+  double GetDecimal() const;
+  bool GetBoolean() const;
+
+  // The text of a string, token or byte sequence, as it appears in the field.
+  // For strings, this is the text between the quotes, with any escapes. For
+  // byte sequences, this is the base64 text between the colons.
+  base::StringPiece raw_value() const;
+
+  // Returns the text of a string, with escapes removed, or of a token.
+  std::string GetString() const;
+  // Returns the decoded contents of a byte sequence.
+  std::string GetByteSequence() const;
+
+  // Returns an owning copy of the item.
+  Item ToItem() const;
+
+ private:
+  friend class ViewParser;
+
+  Item::ItemType type_ = Item::kNullType;
+  union {
+    int64_t integer_;
+    double decimal_;
+    bool boolean_;
+  };
+  base::StringPiece raw_value_;
+  // Set for strings with escapes, which GetString() removes.
+  bool has_escapes_ = false;
+};
+
+struct ParameterView {
+  base::StringPiece key;
+  BareItemView value;
+};
+
+struct ParameterizedItemView {
+  BareItemView item;
+  base::span<const ParameterView> params;
+};
+
+// A member of a list, or the value of a dictionary member. Like
+// ParameterizedMember, |member| holds a single item unless
+// |member_is_inner_list| is true.
+struct ParameterizedMemberView {
+  // Only set for dictionary members.
+  base::StringPiece key;
+  base::span<const ParameterizedItemView> member;
+  bool member_is_inner_list = false;
+  base::span<const ParameterView> params;
+};
+
+// Storage for the views of a parsed field. See BareItemView.
+class NET_EXPORT ViewArena {
+ public:
+  ViewArena();
+  ViewArena(const ViewArena&) = delete;
+  ViewArena& operator=(const ViewArena&) = delete;
+  ~ViewArena();
+
+ private:
+  friend class ViewParser;
+
+  // The start and size of a range of |params_| or |items_|.
+  struct Range {
+    uint32_t begin = 0;
+    uint32_t size = 0;
+  };
+
+  void Clear();
+
+  // Points the spans of the views at their ranges, once no more views will
+  // be added.
+  void SetSpans();
+
+  std::vector<ParameterView> params_;
+  std::vector<ParameterizedItemView> items_;
+  std::vector<Range> item_params_;
+  std::vector<ParameterizedMemberView> members_;
+  std::vector<Range> member_items_;
+  std::vector<Range> member_params_;
+};
+
+// Parse an RFC 8941 item, list or dictionary into views. See BareItemView.
+// Dictionary members have unique keys, in the order in which they first
+// appear.
+NET_EXPORT absl::optional<ParameterizedItemView> ParseItemView(
+    base::StringPiece str,
+    ViewArena* arena);
+NET_EXPORT absl::optional<base::span<const ParameterizedMemberView>>
+ParseListView(base::StringPiece str, ViewArena* arena);
+NET_EXPORT absl::optional<base::span<const ParameterizedMemberView>>
+ParseDictionaryView(base::StringPiece str, ViewArena* arena);
+
+// Owning versions of the above, which copy the views.
+NET_EXPORT absl::optional<ParameterizedItem> ParseItem(base::StringPiece str);
+NET_EXPORT absl::optional<Item> ParseBareItem(base::StringPiece str);
+NET_EXPORT absl::optional<List> ParseList(base::StringPiece str);
+NET_EXPORT absl::optional<Dictionary> ParseDictionary(base::StringPiece str);
+
+// Parsers for draft-ietf-httpbis-header-structure-09 fields.
 inline absl::optional<ParameterisedList> ParseParameterisedList(
     base::StringPiece str) {
   return quiche::structured_headers::ParseParameterisedList(
@@ -43,15 +159,6 @@ inline absl::optional<ListOfLists> ParseListOfLists(base::StringPiece str) {
   return quiche::structured_headers::ParseListOfLists(
       base::StringPieceToStringView(str));
 }
-inline absl::optional<List> ParseList(base::StringPiece str) {
-  return quiche::structured_headers::ParseList(
-      base::StringPieceToStringView(str));
-}
-inline absl::optional<Dictionary> ParseDictionary(
-    const base::StringPiece& str) {
-  return quiche::structured_headers::ParseDictionary(
-      base::StringPieceToStringView(str));
-}
 
 inline absl::optional<std::string> SerializeItem(const Item& value) {
   return quiche::structured_headers::SerializeItem(value);
@@ -4,12 +4,19 @@
 
 #include "net/http/structured_headers.h"
 
+#include "base/check.h"
+
 namespace net {
 namespace structured_headers {
 
 extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
   base::StringPiece input(reinterpret_cast<const char*>(data), size);
-  ParseItem(input);
+  absl::string_view input_view = base::StringPieceToStringView(input);
+  // The view parser behind the RFC 8941 parsers must agree with quiche's.
+  CHECK(ParseItem(input) == quiche::structured_headers::ParseItem(input_view));
+  CHECK(ParseList(input) == quiche::structured_headers::ParseList(input_view));
+  CHECK(ParseDictionary(input) ==
+        quiche::structured_headers::ParseDictionary(input_view));
   ParseListOfLists(input);
   ParseParameterisedList(input);
   return 0;
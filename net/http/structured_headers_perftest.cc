@@ -0,0 +1,93 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/structured_headers.h"
+
+#include <string>
+
+#include "base/strings/abseil_string_conversions.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace net::structured_headers {
+
+namespace {
+
+const int kNumIterations = 100000;
+
+enum class FieldType { kList, kDictionary };
+
+struct Field {
+  const char* name;
+  FieldType type;
+  const char* value;
+};
+
+// Representative Client Hints and priority fields.
+const Field kFields[] = {
+    {"Sec-CH-UA", FieldType::kList,
+     "\"Chromium\";v=\"104\", \" Not A;Brand\";v=\"99\", "
+     "\"Google Chrome\";v=\"104\""},
+    {"Sec-CH-UA-Full-Version-List", FieldType::kList,
+     "\"Chromium\";v=\"104.0.5112.101\", \" Not A;Brand\";v=\"99.0.0.0\", "
+     "\"Google Chrome\";v=\"104.0.5112.101\""},
+    {"Accept-CH", FieldType::kList,
+     "sec-ch-ua, sec-ch-ua-mobile, sec-ch-ua-platform, "
+     "sec-ch-ua-platform-version, sec-ch-ua-model, sec-ch-ua-arch, "
+     "sec-ch-ua-bitness, sec-ch-ua-full-version-list, sec-ch-dpr, "
+     "sec-ch-viewport-width, sec-ch-prefers-color-scheme"},
+    {"Priority", FieldType::kDictionary, "u=1, i"},
+    {"Permissions-Policy", FieldType::kDictionary,
+     "ch-ua=*, ch-ua-model=(self \"https://cdn.example\"), "
+     "ch-ua-platform-version=(), geolocation=(self)"},
+};
+
+template <typename ParseFunction>
+void MeasureParse(const std::string& story, const Field& field,
+                  ParseFunction parse) {
+  size_t total_members = 0;
+  base::ElapsedTimer timer;
+  for (int i = 0; i < kNumIterations; ++i)
+    total_members += parse(field);
+  base::TimeDelta elapsed = timer.Elapsed();
+  EXPECT_LT(0u, total_members);
+
+  perf_test::PerfResultReporter reporter("StructuredHeaders.",
+                                         story + "_" + field.name);
+  reporter.RegisterImportantMetric("parses_per_second", "count/s");
+  reporter.AddResult("parses_per_second",
+                     kNumIterations / elapsed.InSecondsF());
+}
+
+// Compares parsing fields into quiche's owning types, with the owning
+// wrappers of the view parser, and into views with a reused arena.
+TEST(StructuredHeadersPerfTest, Parse) {
+  for (const Field& field : kFields) {
+    MeasureParse("Quiche", field, [](const Field& field) -> size_t {
+      absl::string_view value = base::StringPieceToStringView(field.value);
+      if (field.type == FieldType::kList)
+        return quiche::structured_headers::ParseList(value)->size();
+      return quiche::structured_headers::ParseDictionary(value)->size();
+    });
+
+    MeasureParse("Owning", field, [](const Field& field) -> size_t {
+      if (field.type == FieldType::kList)
+        return ParseList(field.value)->size();
+      return ParseDictionary(field.value)->size();
+    });
+
+    ViewArena arena;
+    MeasureParse("View", field, [&arena](const Field& field) -> size_t {
+      if (field.type == FieldType::kList)
+        return ParseListView(field.value, &arena)->size();
+      return ParseDictionaryView(field.value, &arena)->size();
+    });
+  }
+}
+
+}  // namespace
+
+}  // namespace net::structured_headers
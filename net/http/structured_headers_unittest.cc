@@ -0,0 +1,144 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/structured_headers.h"
+
+#include <string>
+
+#include "base/strings/abseil_string_conversions.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net::structured_headers {
+
+namespace {
+
+// Fields that quiche::structured_headers and the view parser must both accept
+// or both reject, with the same results.
+const char* const kFields[] = {
+    "",
+    "   ",
+    "a",
+    "a, b",
+    "a,\tb",
+    "a, b,",
+    "a,, b",
+    "a=1, b=2;x, a=(3 4);y=?0",
+    "u=1, i",
+    "u=3",
+    "\"Chromium\";v=\"104\", \" Not A;Brand\";v=\"99\", "
+    "\"Google Chrome\";v=\"104\"",
+    "sec-ch-ua-platform, sec-ch-ua-model, sec-ch-ua-full-version-list",
+    "12.345;a=1;b;a=2",
+    "1.",
+    "1.2345",
+    "1.2.3",
+    "-",
+    "-0.5",
+    "123456789012.123",
+    "1234567890123.1",
+    "-999999999999999",
+    "1000000000000000",
+    "\"a\\\"b\\\\c\"",
+    "\"a\\b\"",
+    "\"abc",
+    "\"a\x01\"",
+    ":aGVsbG8=:",
+    ":aGVsbG8:",
+    ":aGVs$bG8=:",
+    ":",
+    "*foo/bar:baz",
+    "Foo",
+    "?1",
+    "?2",
+    "()",
+    "(a b)",
+    "(a b",
+    "(a,b)",
+    "( a  b );c",
+    "A=1",
+    "*a=1",
+    "a=1;B",
+};
+
+TEST(StructuredHeadersTest, MatchesQuiche) {
+  for (const char* field : kFields) {
+    SCOPED_TRACE(field);
+    absl::string_view view = base::StringPieceToStringView(field);
+    EXPECT_EQ(quiche::structured_headers::ParseItem(view), ParseItem(field));
+    EXPECT_EQ(quiche::structured_headers::ParseBareItem(view),
+              ParseBareItem(field));
+    EXPECT_EQ(quiche::structured_headers::ParseList(view), ParseList(field));
+    EXPECT_EQ(quiche::structured_headers::ParseDictionary(view),
+              ParseDictionary(field));
+  }
+}
+
+TEST(StructuredHeadersTest, ParseListView) {
+  ViewArena arena;
+  const std::string field =
+      "\"Chromium\";v=\"104\", \" Not A;Brand\";v=\"99\", (a b);c";
+  absl::optional<base::span<const ParameterizedMemberView>> list =
+      ParseListView(field, &arena);
+  ASSERT_TRUE(list);
+  ASSERT_EQ(3u, list->size());
+
+  const ParameterizedMemberView& brand = (*list)[1];
+  EXPECT_FALSE(brand.member_is_inner_list);
+  ASSERT_EQ(1u, brand.member.size());
+  EXPECT_TRUE(brand.member[0].item.is_string());
+  EXPECT_EQ(" Not A;Brand", brand.member[0].item.GetString());
+  // Views point into the field.
+  EXPECT_EQ(field.data() + field.find(" Not"),
+            brand.member[0].item.raw_value().data());
+  ASSERT_EQ(1u, brand.params.size());
+  EXPECT_EQ("v", brand.params[0].key);
+  EXPECT_EQ("99", brand.params[0].value.GetString());
+
+  const ParameterizedMemberView& inner_list = (*list)[2];
+  EXPECT_TRUE(inner_list.member_is_inner_list);
+  ASSERT_EQ(2u, inner_list.member.size());
+  EXPECT_EQ("b", inner_list.member[1].item.GetString());
+  ASSERT_EQ(1u, inner_list.params.size());
+  EXPECT_TRUE(inner_list.params[0].value.GetBoolean());
+
+  // Reusing the arena replaces the views.
+  list = ParseListView("x", &arena);
+  ASSERT_TRUE(list);
+  ASSERT_EQ(1u, list->size());
+  EXPECT_TRUE((*list)[0].member[0].item.is_token());
+  EXPECT_FALSE(ParseListView("x,", &arena));
+}
+
+TEST(StructuredHeadersTest, ParseDictionaryView) {
+  ViewArena arena;
+  absl::optional<base::span<const ParameterizedMemberView>> dictionary =
+      ParseDictionaryView("u=2, i, u=3;x=1.5", &arena);
+  ASSERT_TRUE(dictionary);
+  // A repeated key replaces the earlier value, in its place.
+  ASSERT_EQ(2u, dictionary->size());
+  EXPECT_EQ("u", (*dictionary)[0].key);
+  EXPECT_EQ(3, (*dictionary)[0].member[0].item.GetInteger());
+  ASSERT_EQ(1u, (*dictionary)[0].params.size());
+  EXPECT_EQ(1.5, (*dictionary)[0].params[0].value.GetDecimal());
+  EXPECT_EQ("i", (*dictionary)[1].key);
+  EXPECT_TRUE((*dictionary)[1].member[0].item.GetBoolean());
+}
+
+TEST(StructuredHeadersTest, ParseItemView) {
+  ViewArena arena;
+  absl::optional<ParameterizedItemView> item =
+      ParseItemView("\"a\\\"b\";p=:aGk=:", &arena);
+  ASSERT_TRUE(item);
+  EXPECT_EQ("a\\\"b", item->item.raw_value());
+  EXPECT_EQ("a\"b", item->item.GetString());
+  ASSERT_EQ(1u, item->params.size());
+  EXPECT_EQ("aGk=", item->params[0].value.raw_value());
+  EXPECT_EQ("hi", item->params[0].value.GetByteSequence());
+  EXPECT_EQ(Item("hi", Item::kByteSequenceType),
+            item->params[0].value.ToItem());
+}
+
+}  // namespace
+
+}  // namespace net::structured_headers
@@ -4,18 +4,23 @@
 
 #include "net/http/transport_security_persister.h"
 
+#include <stdint.h>
+
 #include <memory>
 #include <utility>
 
 #include "base/base64.h"
+#include "base/big_endian.h"
 #include "base/bind.h"
 #include "base/callback.h"
+#include "base/callback_helpers.h"
 #include "base/feature_list.h"
 #include "base/files/file_path.h"
 #include "base/files/file_util.h"
 #include "base/json/json_reader.h"
 #include "base/json/json_writer.h"
 #include "base/location.h"
+#include "base/strings/string_piece.h"
 #include "base/task/sequenced_task_runner.h"
 #include "base/task/task_runner_util.h"
 #include "base/threading/thread_task_runner_handle.h"
@@ -285,6 +290,193 @@ void DeserializeExpectCTData(const base::Value& ct_list,
   }
 }
 
+// Keys of delta log records start with one of these, followed by the hashed
+// host and, for Expect-CT, the serialized NetworkIsolationKey.
+const char kDeltaSTSPrefix = 's';
+const char kDeltaExpectCTPrefix = 'c';
+
+// Values of delta log records. All integers are big endian, and times are
+// microseconds since the Windows epoch.
+//
+//   STS:       uint8 include_subdomains, uint8 upgrade_mode,
+//              uint64 last_observed, uint64 expiry
+//   Expect-CT: uint8 enforce, uint64 last_observed, uint64 expiry,
+//              report_uri
+constexpr size_t kDeltaSTSValueSize = 18;
+constexpr size_t kDeltaExpectCTFixedSize = 17;
+
+uint64_t TimeToDeltaValue(base::Time time) {
+  return static_cast<uint64_t>(
+      time.ToDeltaSinceWindowsEpoch().InMicroseconds());
+}
+
+base::Time DeltaValueToTime(uint64_t value) {
+  return base::Time::FromDeltaSinceWindowsEpoch(
+      base::Microseconds(static_cast<int64_t>(value)));
+}
+
+std::string EncodeSTSState(const TransportSecurityState::STSState& sts_state) {
+  std::string value(kDeltaSTSValueSize, '\0');
+  base::BigEndianWriter writer(&value[0], value.size());
+  writer.WriteU8(sts_state.include_subdomains);
+  writer.WriteU8(sts_state.upgrade_mode);
+  writer.WriteU64(TimeToDeltaValue(sts_state.last_observed));
+  writer.WriteU64(TimeToDeltaValue(sts_state.expiry));
+  return value;
+}
+
+bool DecodeSTSState(base::StringPiece value,
+                    TransportSecurityState::STSState* sts_state) {
+  base::BigEndianReader reader(reinterpret_cast<const uint8_t*>(value.data()),
+                               value.size());
+  uint8_t include_subdomains;
+  uint8_t upgrade_mode;
+  uint64_t last_observed;
+  uint64_t expiry;
+  if (!reader.ReadU8(&include_subdomains) || !reader.ReadU8(&upgrade_mode) ||
+      !reader.ReadU64(&last_observed) || !reader.ReadU64(&expiry) ||
+      reader.remaining() != 0 || include_subdomains > 1 ||
+      (upgrade_mode != TransportSecurityState::STSState::MODE_FORCE_HTTPS &&
+       upgrade_mode != TransportSecurityState::STSState::MODE_DEFAULT)) {
+    return false;
+  }
+  sts_state->include_subdomains = include_subdomains;
+  sts_state->upgrade_mode =
+      static_cast<TransportSecurityState::STSState::UpgradeMode>(upgrade_mode);
+  sts_state->last_observed = DeltaValueToTime(last_observed);
+  sts_state->expiry = DeltaValueToTime(expiry);
+  return true;
+}
+
+std::string EncodeExpectCTState(
+    const TransportSecurityState::ExpectCTState& expect_ct_state) {
+  const std::string& report_uri = expect_ct_state.report_uri.spec();
+  std::string value(kDeltaExpectCTFixedSize + report_uri.size(), '\0');
+  base::BigEndianWriter writer(&value[0], value.size());
+  writer.WriteU8(expect_ct_state.enforce);
+  writer.WriteU64(TimeToDeltaValue(expect_ct_state.last_observed));
+  writer.WriteU64(TimeToDeltaValue(expect_ct_state.expiry));
+  writer.WriteBytes(report_uri.data(), report_uri.size());
+  return value;
+}
+
+std::string GetSTSDeltaKey(const std::string& hashed_host) {
+  return kDeltaSTSPrefix + hashed_host;
+}
+
+// Returns false for entries with transient NetworkIsolationKeys, which are
+// not persisted.
+bool GetExpectCTDeltaKey(const std::string& hashed_host,
+                         const NetworkIsolationKey& network_isolation_key,
+                         std::string* key) {
+  base::Value network_isolation_key_value;
+  if (!network_isolation_key.ToValue(&network_isolation_key_value))
+    return false;
+  std::string serialized_network_isolation_key;
+  base::JSONWriter::Write(network_isolation_key_value,
+                          &serialized_network_isolation_key);
+  *key = kDeltaExpectCTPrefix + hashed_host + serialized_network_isolation_key;
+  return true;
+}
+
+bool DecodeExpectCTState(
+    base::StringPiece value,
+    TransportSecurityState::ExpectCTState* expect_ct_state) {
+  base::BigEndianReader reader(reinterpret_cast<const uint8_t*>(value.data()),
+                               value.size());
+  uint8_t enforce;
+  uint64_t last_observed;
+  uint64_t expiry;
+  base::StringPiece report_uri;
+  if (!reader.ReadU8(&enforce) || !reader.ReadU64(&last_observed) ||
+      !reader.ReadU64(&expiry) ||
+      !reader.ReadPiece(&report_uri, reader.remaining()) || enforce > 1) {
+    return false;
+  }
+  expect_ct_state->enforce = enforce;
+  expect_ct_state->last_observed = DeltaValueToTime(last_observed);
+  expect_ct_state->expiry = DeltaValueToTime(expiry);
+  GURL report_url(report_uri);
+  if (report_url.is_valid())
+    expect_ct_state->report_uri = report_url;
+  return true;
+}
+
+// Adds the entry of a delta log record to |state|. Returns false if the entry
+// is invalid or has expired.
+bool LoadDeltaEntry(const std::string& key,
+                    const std::string& value,
+                    bool partition_by_nik,
+                    base::Time current_time,
+                    TransportSecurityState* state) {
+  if (key.size() < 1 + crypto::kSHA256Length)
+    return false;
+  std::string hashed = key.substr(1, crypto::kSHA256Length);
+
+  if (key[0] == kDeltaSTSPrefix && key.size() == 1 + crypto::kSHA256Length) {
+    TransportSecurityState::STSState sts_state;
+    if (!DecodeSTSState(value, &sts_state) ||
+        sts_state.expiry < current_time || !sts_state.ShouldUpgradeToSSL()) {
+      return false;
+    }
+    state->AddOrUpdateEnabledSTSHosts(hashed, sts_state);
+    return true;
+  }
+
+  if (key[0] != kDeltaExpectCTPrefix)
+    return false;
+
+  TransportSecurityState::ExpectCTState expect_ct_state;
+  if (!DecodeExpectCTState(value, &expect_ct_state) ||
+      expect_ct_state.expiry < current_time ||
+      (!expect_ct_state.enforce && expect_ct_state.report_uri.is_empty())) {
+    return false;
+  }
+
+  absl::optional<base::Value> network_isolation_key_value =
+      base::JSONReader::Read(key.substr(1 + crypto::kSHA256Length));
+  NetworkIsolationKey network_isolation_key;
+  if (!network_isolation_key_value ||
+      !NetworkIsolationKey::FromValue(*network_isolation_key_value,
+                                      &network_isolation_key)) {
+    return false;
+  }
+  // As in DeserializeExpectCTData(), drop partitioned entries when Expect-CT
+  // is not partitioned.
+  if (!partition_by_nik && !network_isolation_key.IsEmpty())
+    return false;
+
+  state->AddOrUpdateEnabledExpectCTHosts(hashed, network_isolation_key,
+                                         expect_ct_state);
+  return true;
+}
+
+// Appends the records in |records| to |delta_log|, and deletes the JSON file
+// they were read from once they have been written.
+void MigrateToDeltaLog(DeltaLogFile* delta_log,
+                       const std::vector<DeltaLogFile::Record>& records,
+                       const base::FilePath& json_path) {
+  if (delta_log->Append(records))
+    base::DeleteFile(json_path);
+}
+
+// Reads the delta log at |log_path|, if there is one.
+absl::optional<DeltaLogFile::Entries> LoadDeltaLog(
+    const base::FilePath& log_path) {
+  if (!base::PathExists(log_path))
+    return absl::nullopt;
+  return DeltaLogFile(log_path).Load();
+}
+
+// Writes |data|, the JSON serialization of the entries of the delta log at
+// |log_path|, to |json_path|, and deletes the log once that succeeded.
+void ReplaceDeltaLogWithJSON(const base::FilePath& log_path,
+                             const base::FilePath& json_path,
+                             const std::string& data) {
+  if (base::ImportantFileWriter::WriteFileAtomically(json_path, data))
+    base::DeleteFile(log_path);
+}
+
 void OnWriteFinishedTask(scoped_refptr<base::SequencedTaskRunner> task_runner,
                          base::OnceClosure callback,
                          bool result) {
@@ -303,18 +495,37 @@ TransportSecurityPersister::TransportSecurityPersister(
       background_runner_(background_runner) {
   transport_security_state_->SetDelegate(this);
 
+  if (base::FeatureList::IsEnabled(features::kTransportSecurityDeltaLog)) {
+    delta_log_ = std::make_unique<DeltaLogFile>(GetDeltaLogPath(data_path));
+    // |delta_log_| is deleted on |background_runner_|, after this task.
+    base::PostTaskAndReplyWithResult(
+        background_runner_.get(), FROM_HERE,
+        base::BindOnce(&DeltaLogFile::Load,
+                       base::Unretained(delta_log_.get())),
+        base::BindOnce(&TransportSecurityPersister::CompleteDeltaLoad,
+                       weak_ptr_factory_.GetWeakPtr()));
+    return;
+  }
+
+  // The delta log mode deletes the JSON file once it has migrated it, so a
+  // log it left behind holds the latest state.
   base::PostTaskAndReplyWithResult(
       background_runner_.get(), FROM_HERE,
-      base::BindOnce(&LoadState, writer_.path()),
-      base::BindOnce(&TransportSecurityPersister::CompleteLoad,
+      base::BindOnce(&LoadDeltaLog, GetDeltaLogPath(data_path)),
+      base::BindOnce(&TransportSecurityPersister::CompleteRollbackLoad,
                      weak_ptr_factory_.GetWeakPtr()));
 }
 
 TransportSecurityPersister::~TransportSecurityPersister() {
   DCHECK(foreground_runner_->RunsTasksInCurrentSequence());
 
-  if (writer_.HasPendingWrite())
+  if (delta_log_) {
+    if (delta_write_timer_.IsRunning())
+      WriteDelta(base::OnceClosure());
+    background_runner_->DeleteSoon(FROM_HERE, std::move(delta_log_));
+  } else if (writer_.HasPendingWrite()) {
     writer_.DoScheduledWrite();
+  }
 
   transport_security_state_->SetDelegate(nullptr);
 }
@@ -323,6 +534,18 @@ void TransportSecurityPersister::StateIsDirty(TransportSecurityState* state) {
   DCHECK(foreground_runner_->RunsTasksInCurrentSequence());
   DCHECK_EQ(transport_security_state_, state);
 
+  if (delta_log_) {
+    // Batch the changes made within the commit interval into a single write,
+    // as ImportantFileWriter does.
+    if (!delta_write_timer_.IsRunning()) {
+      delta_write_timer_.Start(
+          FROM_HERE, writer_.commit_interval(),
+          base::BindOnce(&TransportSecurityPersister::WriteDelta,
+                         base::Unretained(this), base::OnceClosure()));
+    }
+    return;
+  }
+
   writer_.ScheduleWrite(this);
 }
 
@@ -331,6 +554,13 @@ void TransportSecurityPersister::WriteNow(TransportSecurityState* state,
   DCHECK(foreground_runner_->RunsTasksInCurrentSequence());
   DCHECK_EQ(transport_security_state_, state);
 
+  if (delta_log_) {
+    WriteDelta(base::BindOnce(&TransportSecurityPersister::OnWriteFinished,
+                              weak_ptr_factory_.GetWeakPtr(),
+                              std::move(callback)));
+    return;
+  }
+
   writer_.RegisterOnNextWriteCallbacks(
       base::OnceClosure(),
       base::BindOnce(
@@ -342,6 +572,41 @@ void TransportSecurityPersister::WriteNow(TransportSecurityState* state,
   writer_.WriteNow(std::move(data));
 }
 
+void TransportSecurityPersister::OnDynamicSTSStateChanged(
+    const std::string& hashed_host,
+    const TransportSecurityState::STSState* state) {
+  DCHECK(foreground_runner_->RunsTasksInCurrentSequence());
+
+  if (!delta_log_loaded_)
+    return;
+
+  absl::optional<std::string>& record =
+      pending_records_[GetSTSDeltaKey(hashed_host)];
+  if (state)
+    record = EncodeSTSState(*state);
+  else
+    record.reset();
+}
+
+void TransportSecurityPersister::OnDynamicExpectCTStateChanged(
+    const std::string& hashed_host,
+    const NetworkIsolationKey& network_isolation_key,
+    const TransportSecurityState::ExpectCTState* state) {
+  DCHECK(foreground_runner_->RunsTasksInCurrentSequence());
+
+  std::string key;
+  if (!delta_log_loaded_ ||
+      !GetExpectCTDeltaKey(hashed_host, network_isolation_key, &key)) {
+    return;
+  }
+
+  absl::optional<std::string>& record = pending_records_[key];
+  if (state)
+    record = EncodeExpectCTState(*state);
+  else
+    record.reset();
+}
+
 void TransportSecurityPersister::OnWriteFinished(base::OnceClosure callback) {
   DCHECK(foreground_runner_->RunsTasksInCurrentSequence());
   std::move(callback).Run();
@@ -392,10 +657,144 @@ void TransportSecurityPersister::Deserialize(const std::string& serialized,
 void TransportSecurityPersister::CompleteLoad(const std::string& state) {
   DCHECK(foreground_runner_->RunsTasksInCurrentSequence());
 
-  if (state.empty())
+  if (!state.empty())
+    LoadEntries(state);
+
+  if (!delta_log_)
+    return;
+
+  // There was no log yet, so everything is written to it, including entries
+  // added before the load completed. This migrates the JSON file, if any.
+  delta_log_loaded_ = true;
+  pending_records_.clear();
+  background_runner_->PostTask(
+      FROM_HERE,
+      base::BindOnce(&MigrateToDeltaLog, base::Unretained(delta_log_.get()),
+                     EncodeAllEntries(), writer_.path()));
+}
+
+std::vector<DeltaLogFile::Record> TransportSecurityPersister::TakeDelta() {
+  DCHECK(foreground_runner_->RunsTasksInCurrentSequence());
+
+  std::vector<DeltaLogFile::Record> records;
+  records.reserve(pending_records_.size());
+  for (auto& [key, value] : pending_records_)
+    records.emplace_back(key, std::move(value));
+  pending_records_.clear();
+  return records;
+}
+
+std::vector<DeltaLogFile::Record>
+TransportSecurityPersister::EncodeAllEntries() {
+  DCHECK(foreground_runner_->RunsTasksInCurrentSequence());
+
+  std::vector<DeltaLogFile::Record> records;
+  TransportSecurityState::STSStateIterator sts_iterator(
+      *transport_security_state_);
+  for (; sts_iterator.HasNext(); sts_iterator.Advance()) {
+    records.emplace_back(GetSTSDeltaKey(sts_iterator.hostname()),
+                         EncodeSTSState(sts_iterator.domain_state()));
+  }
+
+  if (IsDynamicExpectCTEnabled()) {
+    TransportSecurityState::ExpectCTStateIterator expect_ct_iterator(
+        *transport_security_state_);
+    for (; expect_ct_iterator.HasNext(); expect_ct_iterator.Advance()) {
+      std::string key;
+      if (!GetExpectCTDeltaKey(expect_ct_iterator.hostname(),
+                               expect_ct_iterator.network_isolation_key(),
+                               &key)) {
+        continue;
+      }
+      records.emplace_back(
+          std::move(key),
+          EncodeExpectCTState(expect_ct_iterator.domain_state()));
+    }
+  }
+  return records;
+}
+
+void TransportSecurityPersister::LoadDeltaEntries(
+    const DeltaLogFile::Entries& entries) {
+  DCHECK(foreground_runner_->RunsTasksInCurrentSequence());
+
+  transport_security_state_->ClearDynamicData();
+  pending_records_.clear();
+
+  bool partition_by_nik = base::FeatureList::IsEnabled(
+      features::kPartitionExpectCTStateByNetworkIsolationKey);
+  const base::Time current_time(base::Time::Now());
+
+  for (const auto& [key, value] : entries) {
+    if (!LoadDeltaEntry(key, value, partition_by_nik, current_time,
+                        transport_security_state_) &&
+        delta_log_) {
+      pending_records_[key] = absl::nullopt;
+    }
+  }
+}
+
+// static
+base::FilePath TransportSecurityPersister::GetDeltaLogPath(
+    const base::FilePath& data_path) {
+  return data_path.AddExtensionASCII("log");
+}
+
+void TransportSecurityPersister::CompleteDeltaLoad(
+    absl::optional<DeltaLogFile::Entries> entries) {
+  DCHECK(foreground_runner_->RunsTasksInCurrentSequence());
+
+  if (entries) {
+    LoadDeltaEntries(*entries);
+    delta_log_loaded_ = true;
     return;
+  }
 
-  LoadEntries(state);
+  // There is no log yet, so fall back to the JSON file, which CompleteLoad()
+  // then migrates to the log.
+  base::PostTaskAndReplyWithResult(
+      background_runner_.get(), FROM_HERE,
+      base::BindOnce(&LoadState, writer_.path()),
+      base::BindOnce(&TransportSecurityPersister::CompleteLoad,
+                     weak_ptr_factory_.GetWeakPtr()));
+}
+
+void TransportSecurityPersister::CompleteRollbackLoad(
+    absl::optional<DeltaLogFile::Entries> entries) {
+  DCHECK(foreground_runner_->RunsTasksInCurrentSequence());
+
+  if (!entries) {
+    base::PostTaskAndReplyWithResult(
+        background_runner_.get(), FROM_HERE,
+        base::BindOnce(&LoadState, writer_.path()),
+        base::BindOnce(&TransportSecurityPersister::CompleteLoad,
+                       weak_ptr_factory_.GetWeakPtr()));
+    return;
+  }
+
+  // Convert the log back to JSON. The log is only deleted once the JSON file
+  // has been written, so a failure leaves it to be converted next time.
+  LoadDeltaEntries(*entries);
+  std::string data;
+  SerializeData(&data);
+  background_runner_->PostTask(
+      FROM_HERE,
+      base::BindOnce(&ReplaceDeltaLogWithJSON, GetDeltaLogPath(writer_.path()),
+                     writer_.path(), std::move(data)));
+}
+
+void TransportSecurityPersister::WriteDelta(base::OnceClosure callback) {
+  DCHECK(foreground_runner_->RunsTasksInCurrentSequence());
+  DCHECK(delta_log_);
+
+  delta_write_timer_.Stop();
+  if (!callback)
+    callback = base::DoNothing();
+  background_runner_->PostTaskAndReply(
+      FROM_HERE,
+      base::BindOnce(base::IgnoreResult(&DeltaLogFile::Append),
+                     base::Unretained(delta_log_.get()), TakeDelta()),
+      std::move(callback));
 }
 
 }  // namespace net
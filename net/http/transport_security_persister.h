@@ -29,19 +29,32 @@
 // TransportSecurityPersister::SerializeState
 //   copies the current state of the TransportSecurityState, serializes
 //   and writes to disk.
+//
+// With features::kTransportSecurityDeltaLog enabled, the state is instead kept
+// in a DeltaLogFile next to |data_path|. The TransportSecurityState reports
+// each entry that changes, and each write encodes and appends only those. The
+// log is compacted on the background runner. An existing JSON file is
+// migrated to the log on the first load, and with the feature disabled again,
+// the log is converted back to JSON.
 
 #ifndef NET_HTTP_TRANSPORT_SECURITY_PERSISTER_H_
 #define NET_HTTP_TRANSPORT_SECURITY_PERSISTER_H_
 
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "base/files/file_path.h"
 #include "base/files/important_file_writer.h"
 #include "base/memory/raw_ptr.h"
 #include "base/memory/ref_counted.h"
 #include "base/memory/weak_ptr.h"
+#include "base/timer/timer.h"
+#include "net/base/delta_log_file.h"
 #include "net/base/net_export.h"
 #include "net/http/transport_security_state.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
 
 namespace base {
 class SequencedTaskRunner;
@@ -78,6 +91,14 @@ class NET_EXPORT TransportSecurityPersister
   // |callback| is called after data is persisted.
   void WriteNow(TransportSecurityState* state,
                 base::OnceClosure callback) override;
+  // Record the changed entry for the next delta log write.
+  void OnDynamicSTSStateChanged(
+      const std::string& hashed_host,
+      const TransportSecurityState::STSState* state) override;
+  void OnDynamicExpectCTStateChanged(
+      const std::string& hashed_host,
+      const NetworkIsolationKey& network_isolation_key,
+      const TransportSecurityState::ExpectCTState* state) override;
 
   // ImportantFileWriter::DataSerializer:
   //
@@ -116,14 +137,40 @@ class NET_EXPORT TransportSecurityPersister
   // |transport_security_state_|.
   void LoadEntries(const std::string& serialized);
 
+  // Returns the records for the entries that were added, changed or removed
+  // since the last call, and considers them written. Each STS and Expect-CT
+  // entry is one record, keyed by its hashed host. Always empty unless the
+  // delta log mode is enabled and the log has been loaded.
+  std::vector<DeltaLogFile::Record> TakeDelta();
+
+  // Clears any existing non-static entries, and then re-populates
+  // |transport_security_state_| from the entries of a delta log. In the delta
+  // log mode, entries that are dropped are deleted from the log by the next
+  // write.
+  void LoadDeltaEntries(const DeltaLogFile::Entries& entries);
+
+  // Returns the path of the delta log kept for |data_path|.
+  static base::FilePath GetDeltaLogPath(const base::FilePath& data_path);
+
  private:
   // Populates |state| from the JSON string |serialized|.
   static void Deserialize(const std::string& serialized,
                           TransportSecurityState* state);
 
   void CompleteLoad(const std::string& state);
+  void CompleteDeltaLoad(absl::optional<DeltaLogFile::Entries> entries);
+  // Called, with the delta log mode disabled, with the entries of the log
+  // that mode left behind, if any.
+  void CompleteRollbackLoad(absl::optional<DeltaLogFile::Entries> entries);
   void OnWriteFinished(base::OnceClosure callback);
 
+  // Appends the changes since the last write to |delta_log_|, and invokes
+  // |callback|, if non-null, once they have been written.
+  void WriteDelta(base::OnceClosure callback);
+
+  // Returns a record for every entry of |transport_security_state_|.
+  std::vector<DeltaLogFile::Record> EncodeAllEntries();
+
   raw_ptr<TransportSecurityState> transport_security_state_;
 
   // Helper for safely writing the data.
@@ -132,6 +179,17 @@ class NET_EXPORT TransportSecurityPersister
   scoped_refptr<base::SequencedTaskRunner> foreground_runner_;
   scoped_refptr<base::SequencedTaskRunner> background_runner_;
 
+  // Only used in the delta log mode. |delta_log_| is only accessed, and
+  // destroyed, on |background_runner_|.
+  std::unique_ptr<DeltaLogFile> delta_log_;
+  base::OneShotTimer delta_write_timer_;
+  // Changes are only recorded once the log is loaded, as loading replaces
+  // all dynamic entries.
+  bool delta_log_loaded_ = false;
+  // The encoded value of each entry that changed since the last write, or
+  // nullopt for removed ones, by delta log key.
+  std::map<std::string, absl::optional<std::string>> pending_records_;
+
   base::WeakPtrFactory<TransportSecurityPersister> weak_ptr_factory_{this};
 };
 
@@ -0,0 +1,146 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/transport_security_persister.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/task/thread_pool.h"
+#include "base/test/scoped_feature_list.h"
+#include "base/test/task_environment.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "net/base/delta_log_file.h"
+#include "net/base/features.h"
+#include "net/http/transport_security_state.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace net {
+
+namespace {
+
+const size_t kNumEntries[] = {1000, 10000, 50000};
+
+class TransportSecurityPersisterPerfTest : public testing::Test {
+ public:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    path_ = temp_dir_.GetPath().AppendASCII("TransportSecurity");
+  }
+
+  // Creates a persister for |state|. Its own load finds no entries, so it
+  // does not interfere with the measurements.
+  std::unique_ptr<TransportSecurityPersister> CreatePersister(
+      TransportSecurityState* state) {
+    auto persister = std::make_unique<TransportSecurityPersister>(
+        state,
+        base::ThreadPool::CreateSequencedTaskRunner({base::MayBlock()}),
+        path_);
+    task_environment_.RunUntilIdle();
+    return persister;
+  }
+
+  // Adds |num_entries| dynamic STS entries to |state|.
+  void AddEntries(TransportSecurityState* state, size_t num_entries) {
+    const base::Time expiry = base::Time::Now() + base::Days(365);
+    for (size_t i = 0; i < num_entries; ++i) {
+      state->AddHSTS("host" + base::NumberToString(i) + ".example.test",
+                     expiry, i % 2 == 0 /* include_subdomains */);
+    }
+  }
+
+  perf_test::PerfResultReporter CreateReporter(const std::string& story) {
+    perf_test::PerfResultReporter reporter("TransportSecurityPersister.",
+                                           story);
+    reporter.RegisterImportantMetric("write_time", "ms");
+    reporter.RegisterImportantMetric("load_time", "ms");
+    reporter.RegisterImportantMetric("bytes_written", "bytes");
+    return reporter;
+  }
+
+ protected:
+  base::test::TaskEnvironment task_environment_;
+  base::ScopedTempDir temp_dir_;
+  base::FilePath path_;
+};
+
+// Measures serializing all of the state as JSON, which every write does
+// without the delta log, and loading it back. Unlike the delta log numbers,
+// these leave out the file IO.
+TEST_F(TransportSecurityPersisterPerfTest, JSON) {
+  for (size_t num_entries : kNumEntries) {
+    TransportSecurityState state;
+    std::unique_ptr<TransportSecurityPersister> persister =
+        CreatePersister(&state);
+    AddEntries(&state, num_entries);
+
+    std::string serialized;
+    base::ElapsedTimer write_timer;
+    ASSERT_TRUE(persister->SerializeData(&serialized));
+    base::TimeDelta write_time = write_timer.Elapsed();
+
+    base::ElapsedTimer load_timer;
+    persister->LoadEntries(serialized);
+    base::TimeDelta load_time = load_timer.Elapsed();
+    EXPECT_EQ(num_entries, state.num_sts_entries());
+
+    perf_test::PerfResultReporter reporter =
+        CreateReporter("JSON_" + base::NumberToString(num_entries));
+    reporter.AddResult("write_time", write_time);
+    reporter.AddResult("load_time", load_time);
+    reporter.AddResult("bytes_written", serialized.size());
+  }
+}
+
+// Measures a write with the delta log after one entry changed, and loading
+// the log. The write only encodes the changed entry, so it does not grow with
+// the number of entries.
+TEST_F(TransportSecurityPersisterPerfTest, DeltaLog) {
+  base::test::ScopedFeatureList feature_list(
+      features::kTransportSecurityDeltaLog);
+  for (size_t num_entries : kNumEntries) {
+    TransportSecurityState state;
+    std::unique_ptr<TransportSecurityPersister> persister =
+        CreatePersister(&state);
+    AddEntries(&state, num_entries);
+
+    DeltaLogFile log(temp_dir_.GetPath().AppendASCII(
+        "delta_log_" + base::NumberToString(num_entries)));
+    log.Load();
+    ASSERT_TRUE(log.Append(persister->TakeDelta()));
+    size_t initial_log_size = log.log_size();
+
+    state.AddHSTS("host0.example.test", base::Time::Now() + base::Days(1),
+                  false /* include_subdomains */);
+    base::ElapsedTimer write_timer;
+    std::vector<DeltaLogFile::Record> records = persister->TakeDelta();
+    ASSERT_TRUE(log.Append(records));
+    base::TimeDelta write_time = write_timer.Elapsed();
+    EXPECT_EQ(1u, records.size());
+
+    base::ElapsedTimer load_timer;
+    DeltaLogFile log2(log.path());
+    absl::optional<DeltaLogFile::Entries> entries = log2.Load();
+    ASSERT_TRUE(entries);
+    persister->LoadDeltaEntries(*entries);
+    base::TimeDelta load_time = load_timer.Elapsed();
+    EXPECT_EQ(num_entries, state.num_sts_entries());
+
+    perf_test::PerfResultReporter reporter =
+        CreateReporter("DeltaLog_" + base::NumberToString(num_entries));
+    reporter.AddResult("write_time", write_time);
+    reporter.AddResult("load_time", load_time);
+    reporter.AddResult("bytes_written", log.log_size() - initial_log_size);
+  }
+}
+
+}  // namespace
+
+}  // namespace net
@@ -19,6 +19,7 @@
 #include "base/task/thread_pool.h"
 #include "base/test/scoped_feature_list.h"
 #include "base/threading/thread_task_runner_handle.h"
+#include "net/base/delta_log_file.h"
 #include "net/base/features.h"
 #include "net/base/network_isolation_key.h"
 #include "net/base/schemeful_site.h"
@@ -566,6 +567,155 @@ TEST_P(TransportSecurityPersisterTest,
   EXPECT_FALSE(expect_ct_iter.HasNext());
 }
 
+// Tests that in the delta log mode, writes append the changed entries to the
+// log, and that a new persister loads them back.
+TEST_P(TransportSecurityPersisterTest, DeltaLog) {
+  base::test::ScopedFeatureList feature_list;
+  feature_list.InitWithFeatures(
+      {features::kTransportSecurityDeltaLog,
+       TransportSecurityState::kDynamicExpectCTFeature},
+      {});
+  // Replace the persister, so that the new one uses the delta log.
+  persister_.reset();
+  persister_ = std::make_unique<TransportSecurityPersister>(
+      state_.get(),
+      base::ThreadPool::CreateSequencedTaskRunner(
+          {base::MayBlock(), base::TaskPriority::BEST_EFFORT,
+           base::TaskShutdownBehavior::BLOCK_SHUTDOWN}),
+      transport_security_file_path_);
+  RunUntilIdle();
+
+  const base::Time expiry = base::Time::Now() + base::Seconds(1000);
+  state_->AddHSTS("a.test", expiry, false /* include_subdomains */);
+  state_->AddHSTS("b.test", expiry, false /* include_subdomains */);
+  state_->AddExpectCT("c.test", expiry, true /* enforce */, GURL(),
+                      NetworkIsolationKey());
+  base::RunLoop run_loop;
+  persister_->WriteNow(state_.get(), run_loop.QuitClosure());
+  run_loop.Run();
+
+  const base::FilePath log_path = TransportSecurityPersister::GetDeltaLogPath(
+      transport_security_file_path_);
+  EXPECT_FALSE(base::PathExists(transport_security_file_path_));
+  {
+    DeltaLogFile log(log_path);
+    absl::optional<DeltaLogFile::Entries> entries = log.Load();
+    ASSERT_TRUE(entries);
+    EXPECT_EQ(3u, entries->size());
+  }
+
+  // Only the changes are written.
+  state_->AddHSTS("a.test", expiry, true /* include_subdomains */);
+  ASSERT_TRUE(state_->DeleteDynamicDataForHost("b.test"));
+  base::RunLoop run_loop2;
+  persister_->WriteNow(state_.get(), run_loop2.QuitClosure());
+  run_loop2.Run();
+  EXPECT_TRUE(persister_->TakeDelta().empty());
+  {
+    DeltaLogFile log(log_path);
+    absl::optional<DeltaLogFile::Entries> entries = log.Load();
+    ASSERT_TRUE(entries);
+    EXPECT_EQ(2u, entries->size());
+    EXPECT_GT(log.log_size(), log.compacted_size());
+  }
+
+  TransportSecurityState state2;
+  TransportSecurityPersister persister2(
+      &state2,
+      base::ThreadPool::CreateSequencedTaskRunner(
+          {base::MayBlock(), base::TaskPriority::BEST_EFFORT,
+           base::TaskShutdownBehavior::BLOCK_SHUTDOWN}),
+      transport_security_file_path_);
+  RunUntilIdle();
+
+  TransportSecurityState::STSState sts_state;
+  ASSERT_TRUE(state2.GetDynamicSTSState("a.test", &sts_state));
+  EXPECT_TRUE(sts_state.include_subdomains);
+  EXPECT_EQ(expiry, sts_state.expiry);
+  EXPECT_FALSE(state2.GetDynamicSTSState("b.test", &sts_state));
+  TransportSecurityState::ExpectCTState expect_ct_state;
+  ASSERT_TRUE(state2.GetDynamicExpectCTState("c.test", NetworkIsolationKey(),
+                                             &expect_ct_state));
+  EXPECT_TRUE(expect_ct_state.enforce);
+}
+
+// Tests that the delta log mode migrates the state from an existing JSON file.
+TEST_P(TransportSecurityPersisterTest, DeltaLogMigratesJSON) {
+  const base::Time expiry = base::Time::Now() + base::Seconds(1000);
+  state_->AddHSTS("a.test", expiry, false /* include_subdomains */);
+  base::RunLoop run_loop;
+  persister_->WriteNow(state_.get(), run_loop.QuitClosure());
+  run_loop.Run();
+  ASSERT_TRUE(base::PathExists(transport_security_file_path_));
+
+  base::test::ScopedFeatureList feature_list;
+  feature_list.InitAndEnableFeature(features::kTransportSecurityDeltaLog);
+  for (int i = 0; i < 2; ++i) {
+    TransportSecurityState state;
+    TransportSecurityPersister persister(
+        &state,
+        base::ThreadPool::CreateSequencedTaskRunner(
+            {base::MayBlock(), base::TaskPriority::BEST_EFFORT,
+             base::TaskShutdownBehavior::BLOCK_SHUTDOWN}),
+        transport_security_file_path_);
+    RunUntilIdle();
+
+    // The first persister reads the JSON file and replaces it with the log,
+    // which the second one reads.
+    TransportSecurityState::STSState sts_state;
+    EXPECT_TRUE(state.GetDynamicSTSState("a.test", &sts_state));
+    EXPECT_FALSE(base::PathExists(transport_security_file_path_));
+    EXPECT_TRUE(base::PathExists(TransportSecurityPersister::GetDeltaLogPath(
+        transport_security_file_path_)));
+  }
+}
+
+// Tests that disabling the delta log mode again converts the log back to JSON,
+// rather than dropping the state it holds.
+TEST_P(TransportSecurityPersisterTest, DeltaLogRollback) {
+  const base::Time expiry = base::Time::Now() + base::Seconds(1000);
+  const base::FilePath log_path = TransportSecurityPersister::GetDeltaLogPath(
+      transport_security_file_path_);
+  {
+    base::test::ScopedFeatureList feature_list;
+    feature_list.InitAndEnableFeature(features::kTransportSecurityDeltaLog);
+    TransportSecurityState state;
+    TransportSecurityPersister persister(
+        &state,
+        base::ThreadPool::CreateSequencedTaskRunner(
+            {base::MayBlock(), base::TaskPriority::BEST_EFFORT,
+             base::TaskShutdownBehavior::BLOCK_SHUTDOWN}),
+        transport_security_file_path_);
+    RunUntilIdle();
+
+    state.AddHSTS("a.test", expiry, false /* include_subdomains */);
+    base::RunLoop run_loop;
+    persister.WriteNow(&state, run_loop.QuitClosure());
+    run_loop.Run();
+    ASSERT_TRUE(base::PathExists(log_path));
+    ASSERT_FALSE(base::PathExists(transport_security_file_path_));
+  }
+
+  // The feature is disabled for the rest of the test.
+  for (int i = 0; i < 2; ++i) {
+    TransportSecurityState state;
+    TransportSecurityPersister persister(
+        &state,
+        base::ThreadPool::CreateSequencedTaskRunner(
+            {base::MayBlock(), base::TaskPriority::BEST_EFFORT,
+             base::TaskShutdownBehavior::BLOCK_SHUTDOWN}),
+        transport_security_file_path_);
+    RunUntilIdle();
+
+    // The first persister reads the log and replaces it with the JSON file,
+    // which the second one reads.
+    TransportSecurityState::STSState sts_state;
+    EXPECT_TRUE(state.GetDynamicSTSState("a.test", &sts_state));
+    EXPECT_TRUE(base::PathExists(transport_security_file_path_));
+    EXPECT_FALSE(base::PathExists(log_path));
+  }
+}
+
 }  // namespace
 
 }  // namespace net
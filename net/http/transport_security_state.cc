@@ -40,6 +40,7 @@
 #include "net/dns/dns_util.h"
 #include "net/extras/preload_data/decoder.h"
 #include "net/http/http_security_headers.h"
+#include "net/http/transport_security_state_flat_index.h"
 #include "net/net_buildflags.h"
 #include "net/ssl/ssl_info.h"
 #include "third_party/abseil-cpp/absl/types/optional.h"
@@ -65,6 +66,10 @@ const size_t kMaxReportCacheEntries = 50;
 const int kTimeToRememberReportsMins = 60;
 const size_t kReportCacheKeyLength = 16;
 
+// Parameters for caching the results of GetSTSState() and GetPKPState().
+const size_t kMaxDecisionCacheEntries = 1000;
+constexpr base::TimeDelta kDecisionCacheTTL = base::Minutes(5);
+
 // Override for CheckCTRequirements() for unit tests. Possible values:
 //   false: Use the default implementation (e.g. production)
 //   true: Unless a delegate says otherwise, require CT.
@@ -365,6 +370,27 @@ bool DecodeHSTSPreload(const std::string& search_hostname, PreloadResult* out) {
     return false;
   }
 
+  if (g_hsts_source->flat_index) {
+    absl::optional<TransportSecurityStateFlatIndex> index =
+        TransportSecurityStateFlatIndex::Create(base::make_span(
+            g_hsts_source->flat_index, g_hsts_source->flat_index_size));
+    if (index) {
+      TransportSecurityStateFlatIndex::Entry entry;
+      if (!index->Find(hostname, &entry, &out->hostname_offset))
+        return false;
+      out->pinset_id = entry.pinset_id;
+      out->sts_include_subdomains = entry.sts_include_subdomains;
+      out->pkp_include_subdomains = entry.pkp_include_subdomains;
+      out->force_https = entry.force_https;
+      out->has_pins = entry.has_pins;
+      out->expect_ct = entry.expect_ct;
+      out->expect_ct_report_uri_id = entry.expect_ct_report_uri_id;
+      return true;
+    }
+    DCHECK(false) << "Invalid flat index in the transport security state "
+                     "source";
+  }
+
   HSTSPreloadDecoder decoder(
       g_hsts_source->huffman_tree, g_hsts_source->huffman_tree_size,
       g_hsts_source->preloaded_data, g_hsts_source->preloaded_bits,
@@ -404,7 +430,9 @@ TransportSecurityState::TransportSecurityState()
 
 TransportSecurityState::TransportSecurityState(
     std::vector<std::string> hsts_host_bypass_list)
-    : sent_hpkp_reports_cache_(kMaxReportCacheEntries),
+    : sts_decision_cache_(kMaxDecisionCacheEntries),
+      pkp_decision_cache_(kMaxDecisionCacheEntries),
+      sent_hpkp_reports_cache_(kMaxReportCacheEntries),
       sent_expect_ct_reports_cache_(kMaxReportCacheEntries),
       key_expect_ct_by_nik_(base::FeatureList::IsEnabled(
           features::kPartitionExpectCTStateByNetworkIsolationKey)) {
@@ -651,6 +679,7 @@ void TransportSecurityState::UpdatePinList(
     host_pins_.value()[pin.hostname_] = std::make_pair(
         pinset_names_map[pin.pinset_name_], pin.include_subdomains_);
   }
+  pkp_decision_cache_.Clear();
 }
 
 void TransportSecurityState::AddHSTSInternal(
@@ -673,12 +702,14 @@ void TransportSecurityState::AddHSTSInternal(
 
   // Only store new state when HSTS is explicitly enabled. If it is
   // disabled, remove the state from the enabled hosts.
+  const std::string hashed_host = HashHost(canonicalized_host);
   if (sts_state.ShouldUpgradeToSSL()) {
-    enabled_sts_hosts_[HashHost(canonicalized_host)] = sts_state;
-  } else {
-    const std::string hashed_host = HashHost(canonicalized_host);
-    enabled_sts_hosts_.erase(hashed_host);
+    enabled_sts_hosts_[hashed_host] = sts_state;
+    NotifySTSStateChanged(hashed_host, &sts_state);
+  } else if (enabled_sts_hosts_.erase(hashed_host)) {
+    NotifySTSStateChanged(hashed_host, nullptr);
   }
+  sts_decision_cache_.Clear();
 
   DirtyNotify();
 }
@@ -711,6 +742,7 @@ void TransportSecurityState::AddHPKPInternal(const std::string& host,
     const std::string hashed_host = HashHost(canonicalized_host);
     enabled_pkp_hosts_.erase(hashed_host);
   }
+  pkp_decision_cache_.Clear();
 
   DirtyNotify();
 }
@@ -744,9 +776,10 @@ void TransportSecurityState::AddExpectCTInternal(
       HashHost(canonicalized_host), network_isolation_key);
   if (expect_ct_state.enforce || !expect_ct_state.report_uri.is_empty()) {
     enabled_expect_ct_hosts_[index] = expect_ct_state;
+    NotifyExpectCTStateChanged(index, &expect_ct_state);
     MaybePruneExpectCTState();
-  } else {
-    enabled_expect_ct_hosts_.erase(index);
+  } else if (enabled_expect_ct_hosts_.erase(index)) {
+    NotifyExpectCTStateChanged(index, nullptr);
   }
 
   DirtyNotify();
@@ -874,6 +907,7 @@ bool TransportSecurityState::DeleteDynamicDataForHost(const std::string& host) {
   auto sts_interator = enabled_sts_hosts_.find(hashed_host);
   if (sts_interator != enabled_sts_hosts_.end()) {
     enabled_sts_hosts_.erase(sts_interator);
+    NotifySTSStateChanged(hashed_host, nullptr);
     deleted = true;
   }
 
@@ -883,6 +917,11 @@ bool TransportSecurityState::DeleteDynamicDataForHost(const std::string& host) {
     deleted = true;
   }
 
+  if (deleted) {
+    sts_decision_cache_.Clear();
+    pkp_decision_cache_.Clear();
+  }
+
   // Delete matching entries for all NetworkIsolationKeys. Performance isn't
   // important here, since this is only called when directly initiated by the
   // user, so a linear search is fine.
@@ -892,6 +931,7 @@ bool TransportSecurityState::DeleteDynamicDataForHost(const std::string& host) {
     ++it;
     if (current->first.hashed_host != hashed_host)
       continue;
+    NotifyExpectCTStateChanged(current->first, nullptr);
     enabled_expect_ct_hosts_.erase(current);
     deleted = true;
   }
@@ -906,6 +946,8 @@ void TransportSecurityState::ClearDynamicData() {
   enabled_sts_hosts_.clear();
   enabled_pkp_hosts_.clear();
   enabled_expect_ct_hosts_.clear();
+  sts_decision_cache_.Clear();
+  pkp_decision_cache_.Clear();
 }
 
 void TransportSecurityState::DeleteAllDynamicDataBetween(
@@ -920,6 +962,7 @@ void TransportSecurityState::DeleteAllDynamicDataBetween(
     if (sts_iterator->second.last_observed >= start_time &&
         sts_iterator->second.last_observed < end_time) {
       dirtied = true;
+      NotifySTSStateChanged(sts_iterator->first, nullptr);
       enabled_sts_hosts_.erase(sts_iterator++);
       continue;
     }
@@ -945,6 +988,7 @@ void TransportSecurityState::DeleteAllDynamicDataBetween(
 
         expect_ct_iterator->second.last_observed < end_time) {
       dirtied = true;
+      NotifyExpectCTStateChanged(expect_ct_iterator->first, nullptr);
       enabled_expect_ct_hosts_.erase(expect_ct_iterator++);
       continue;
     }
@@ -952,6 +996,11 @@ void TransportSecurityState::DeleteAllDynamicDataBetween(
     ++expect_ct_iterator;
   }
 
+  if (dirtied) {
+    sts_decision_cache_.Clear();
+    pkp_decision_cache_.Clear();
+  }
+
   if (dirtied && delegate_)
     delegate_->WriteNow(this, std::move(callback));
   else
@@ -969,6 +1018,26 @@ void TransportSecurityState::DirtyNotify() {
     delegate_->StateIsDirty(this);
 }
 
+void TransportSecurityState::NotifySTSStateChanged(
+    const std::string& hashed_host,
+    const STSState* state) {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+
+  if (delegate_)
+    delegate_->OnDynamicSTSStateChanged(hashed_host, state);
+}
+
+void TransportSecurityState::NotifyExpectCTStateChanged(
+    const ExpectCTStateIndex& index,
+    const ExpectCTState* state) {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+
+  if (delegate_) {
+    delegate_->OnDynamicExpectCTStateChanged(
+        index.hashed_host, index.network_isolation_key, state);
+  }
+}
+
 bool TransportSecurityState::AddHSTSHeader(const std::string& host,
                                            const std::string& value) {
   DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
@@ -1243,16 +1312,71 @@ bool TransportSecurityState::GetStaticPKPState(const std::string& host,
 
 bool TransportSecurityState::GetSTSState(const std::string& host,
                                          STSState* result) {
-  return GetDynamicSTSState(host, result) || GetStaticSTSState(host, result);
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  MaybeClearDecisionCaches();
+
+  base::Time now = base::Time::Now();
+  auto it = sts_decision_cache_.Get(host);
+  if (it == sts_decision_cache_.end() || now >= it->second.valid_until) {
+    CachedDecision<STSState> decision;
+    decision.valid_until = now + kDecisionCacheTTL;
+    decision.found =
+        FindDynamicSTSState(host, &decision.state, &decision.valid_until) ||
+        GetStaticSTSState(host, &decision.state);
+    it = sts_decision_cache_.Put(host, std::move(decision));
+  }
+
+  if (it->second.found)
+    *result = it->second.state;
+  return it->second.found;
 }
 
 bool TransportSecurityState::GetPKPState(const std::string& host,
                                          PKPState* result) {
-  return GetDynamicPKPState(host, result) || GetStaticPKPState(host, result);
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  MaybeClearDecisionCaches();
+
+  // Static pins can be turned on and off, or go stale, without any call that
+  // clears the cache.
+  bool static_pins_enabled =
+      enable_static_pins_ && IsStaticPKPListTimely() &&
+      base::FeatureList::IsEnabled(features::kStaticKeyPinningEnforcement);
+  if (decision_cache_static_pins_enabled_ != static_pins_enabled) {
+    pkp_decision_cache_.Clear();
+    decision_cache_static_pins_enabled_ = static_pins_enabled;
+  }
+
+  base::Time now = base::Time::Now();
+  auto it = pkp_decision_cache_.Get(host);
+  if (it == pkp_decision_cache_.end() || now >= it->second.valid_until) {
+    CachedDecision<PKPState> decision;
+    decision.valid_until = now + kDecisionCacheTTL;
+    decision.found =
+        FindDynamicPKPState(host, &decision.state, &decision.valid_until) ||
+        GetStaticPKPState(host, &decision.state);
+    it = pkp_decision_cache_.Put(host, std::move(decision));
+  }
+
+  if (it->second.found)
+    *result = it->second.state;
+  return it->second.found;
 }
 
 bool TransportSecurityState::GetDynamicSTSState(const std::string& host,
                                                 STSState* result) {
+  base::Time valid_until = base::Time::Max();
+  return FindDynamicSTSState(host, result, &valid_until);
+}
+
+bool TransportSecurityState::GetDynamicPKPState(const std::string& host,
+                                                PKPState* result) {
+  base::Time valid_until = base::Time::Max();
+  return FindDynamicPKPState(host, result, &valid_until);
+}
+
+bool TransportSecurityState::FindDynamicSTSState(const std::string& host,
+                                                 STSState* result,
+                                                 base::Time* valid_until) {
   DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
 
   const std::string canonicalized_host = CanonicalizeHost(host);
@@ -1270,10 +1394,12 @@ bool TransportSecurityState::GetDynamicSTSState(const std::string& host,
 
     // If the entry is invalid, drop it.
     if (current_time > j->second.expiry) {
+      NotifySTSStateChanged(j->first, nullptr);
       enabled_sts_hosts_.erase(j);
       DirtyNotify();
       continue;
     }
+    *valid_until = std::min(*valid_until, j->second.expiry);
 
     // An entry matches if it is either an exact match, or if it is a prefix
     // match and the includeSubDomains directive was included.
@@ -1292,8 +1418,9 @@ bool TransportSecurityState::GetDynamicSTSState(const std::string& host,
   return false;
 }
 
-bool TransportSecurityState::GetDynamicPKPState(const std::string& host,
-                                                PKPState* result) {
+bool TransportSecurityState::FindDynamicPKPState(const std::string& host,
+                                                 PKPState* result,
+                                                 base::Time* valid_until) {
   DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
 
   const std::string canonicalized_host = CanonicalizeHost(host);
@@ -1315,6 +1442,7 @@ bool TransportSecurityState::GetDynamicPKPState(const std::string& host,
       DirtyNotify();
       continue;
     }
+    *valid_until = std::min(*valid_until, j->second.expiry);
 
     // If this is the most specific PKP match, add it to the result. Note: a PKP
     // entry at a more specific domain overrides a less specific domain whether
@@ -1357,6 +1485,7 @@ bool TransportSecurityState::GetDynamicExpectCTState(
     return false;
   // If the entry is invalid, drop it.
   if (current_time > j->second.expiry) {
+    NotifyExpectCTStateChanged(j->first, nullptr);
     enabled_expect_ct_hosts_.erase(j);
     DirtyNotify();
     return false;
@@ -1366,12 +1495,21 @@ bool TransportSecurityState::GetDynamicExpectCTState(
   return true;
 }
 
+void TransportSecurityState::MaybeClearDecisionCaches() {
+  if (decision_cache_source_ != g_hsts_source) {
+    sts_decision_cache_.Clear();
+    pkp_decision_cache_.Clear();
+    decision_cache_source_ = g_hsts_source;
+  }
+}
+
 void TransportSecurityState::AddOrUpdateEnabledSTSHosts(
     const std::string& hashed_host,
     const STSState& state) {
   DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
   DCHECK(state.ShouldUpgradeToSSL());
   enabled_sts_hosts_[hashed_host] = state;
+  sts_decision_cache_.Clear();
 }
 
 void TransportSecurityState::AddOrUpdateEnabledExpectCTHosts(
@@ -1525,6 +1663,7 @@ void TransportSecurityState::MaybePruneExpectCTState() {
   for (auto expect_ct_iterator = enabled_expect_ct_hosts_.begin();
        expect_ct_iterator != enabled_expect_ct_hosts_.end();) {
     if (expect_ct_iterator->second.expiry < now) {
+      NotifyExpectCTStateChanged(expect_ct_iterator->first, nullptr);
       enabled_expect_ct_hosts_.erase(expect_ct_iterator++);
       continue;
     }
@@ -1568,6 +1707,7 @@ void TransportSecurityState::MaybePruneExpectCTState() {
   DCHECK_LE(num_entries_to_prune, prunable_expect_ct_entries.size());
 
   for (size_t i = 0; i < num_entries_to_prune; ++i) {
+    NotifyExpectCTStateChanged(prunable_expect_ct_entries[i]->first, nullptr);
     enabled_expect_ct_hosts_.erase(prunable_expect_ct_entries[i]);
   }
 
@@ -1604,6 +1744,7 @@ void TransportSecurityState::MaybePruneExpectCTState() {
                       nik_entries.second.end(), ExpectCTPruningSorter);
     for (auto entry_to_prune = nik_entries.second.begin();
          entry_to_prune != top_frame_origin_prune_end; ++entry_to_prune) {
+      NotifyExpectCTStateChanged((*entry_to_prune)->first, nullptr);
       enabled_expect_ct_hosts_.erase(*entry_to_prune);
     }
   }
@@ -12,6 +12,7 @@
 #include <string>
 
 #include "base/callback.h"
+#include "base/containers/lru_cache.h"
 #include "base/feature_list.h"
 #include "base/gtest_prod_util.h"
 #include "base/memory/raw_ptr.h"
@@ -52,6 +53,9 @@ void NET_EXPORT_PRIVATE SetTransportSecurityStateSourceForTesting(
 // http://tools.ietf.org/html/ietf-websec-strict-transport-sec.
 class NET_EXPORT TransportSecurityState {
  public:
+  class STSState;
+  class ExpectCTState;
+
   class NET_EXPORT Delegate {
    public:
     // This function may not block and may be called with internal locks held.
@@ -62,6 +66,19 @@ class NET_EXPORT TransportSecurityState {
     virtual void WriteNow(TransportSecurityState* state,
                           base::OnceClosure callback) = 0;
 
+    // Called for each dynamic STS entry that is added, updated or removed,
+    // ahead of the StateIsDirty() or WriteNow() call that covers the change,
+    // so that a Delegate can persist only what changed. |hashed_host| is the
+    // key STSStateIterator returns, and |state| is null if the entry was
+    // removed. Must not reenter the TransportSecurityState object either.
+    virtual void OnDynamicSTSStateChanged(const std::string& hashed_host,
+                                          const STSState* state) {}
+    // Same as OnDynamicSTSStateChanged(), for dynamic Expect-CT entries.
+    virtual void OnDynamicExpectCTStateChanged(
+        const std::string& hashed_host,
+        const NetworkIsolationKey& network_isolation_key,
+        const ExpectCTState* state) {}
+
    protected:
     virtual ~Delegate() = default;
   };
@@ -548,6 +565,9 @@ class NET_EXPORT TransportSecurityState {
   // match determines the return value (both is in deviation of RFC6797, cf.
   // https://crbug.com/821811).
   //
+  // Recent results are cached, so that repeated lookups of the same host do
+  // not search the dynamic and static state again.
+  //
   // Note that these methods are not const because they opportunistically remove
   // entries that have expired.
   bool GetSTSState(const std::string& host, STSState* sts_result);
@@ -663,6 +683,21 @@ class NET_EXPORT TransportSecurityState {
   typedef ExpiringCache<std::string, bool, base::TimeTicks, std::less<>>
       ReportCache;
 
+  // A result of GetSTSState() or GetPKPState().
+  template <typename State>
+  struct CachedDecision {
+    bool found = false;
+    State state;
+    // The result must be recomputed from this time on, as a dynamic entry it
+    // depends on may have expired, or the static state may no longer be
+    // timely.
+    base::Time valid_until;
+  };
+  typedef base::HashingLRUCache<std::string, CachedDecision<STSState>>
+      STSDecisionCache;
+  typedef base::HashingLRUCache<std::string, CachedDecision<PKPState>>
+      PKPDecisionCache;
+
   base::Value NetLogUpgradeToSSLParam(const std::string& host);
 
   // IsBuildTimely returns true if the current build is new enough ensure that
@@ -685,6 +720,27 @@ class NET_EXPORT TransportSecurityState {
   // changed.
   void DirtyNotify();
 
+  // If a Delegate is present, notify it that a dynamic entry has changed.
+  // |state| is null if the entry was removed. DirtyNotify() must still be
+  // called afterwards.
+  void NotifySTSStateChanged(const std::string& hashed_host,
+                             const STSState* state);
+  void NotifyExpectCTStateChanged(const ExpectCTStateIndex& index,
+                                  const ExpectCTState* state);
+
+  // Like GetDynamicSTSState() and GetDynamicPKPState(), but also lower
+  // |*valid_until| to the expiry of every dynamic entry the result depends on.
+  bool FindDynamicSTSState(const std::string& host,
+                           STSState* result,
+                           base::Time* valid_until);
+  bool FindDynamicPKPState(const std::string& host,
+                           PKPState* result,
+                           base::Time* valid_until);
+
+  // Clears the decision caches if the static source they were filled from has
+  // been replaced.
+  void MaybeClearDecisionCaches();
+
   // Adds HSTS, HPKP, and Expect-CT state for |host|. The new state supercedes
   // any previous state for the |host|, including static entries.
   //
@@ -788,6 +844,15 @@ class NET_EXPORT TransportSecurityState {
 
   raw_ptr<RequireCTDelegate> require_ct_delegate_ = nullptr;
 
+  // Recent results of GetSTSState() and GetPKPState(), by host. They are
+  // cleared whenever the dynamic state changes.
+  STSDecisionCache sts_decision_cache_;
+  PKPDecisionCache pkp_decision_cache_;
+  // The static source the decision caches were filled from.
+  raw_ptr<const TransportSecurityStateSource> decision_cache_source_ = nullptr;
+  // Whether static pins were used to fill |pkp_decision_cache_|.
+  bool decision_cache_static_pins_enabled_ = false;
+
   // Keeps track of reports that have been sent recently for
   // rate-limiting.
   ReportCache sent_hpkp_reports_cache_;
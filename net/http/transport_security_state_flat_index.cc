@@ -0,0 +1,208 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/transport_security_state_flat_index.h"
+
+#include <string.h>
+
+#include "base/check.h"
+#include "base/check_op.h"
+#include "base/hash/hash.h"
+
+namespace net {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x46535453;  // "STSF"
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderSize = 16;
+constexpr size_t kSlotSize = 12;
+
+// Offsets of the fields of a slot.
+constexpr size_t kSlotHash = 0;
+constexpr size_t kSlotNameOffset = 4;
+constexpr size_t kSlotNameLength = 8;
+constexpr size_t kSlotFlags = 9;
+constexpr size_t kSlotPinsetId = 10;
+constexpr size_t kSlotExpectCTReportURIId = 11;
+
+// Bits of the flags field of a slot.
+constexpr uint8_t kSTSIncludeSubdomains = 1 << 0;
+constexpr uint8_t kPKPIncludeSubdomains = 1 << 1;
+constexpr uint8_t kForceHTTPS = 1 << 2;
+constexpr uint8_t kHasPins = 1 << 3;
+constexpr uint8_t kExpectCT = 1 << 4;
+
+uint32_t ReadUint32(const uint8_t* data) {
+  return static_cast<uint32_t>(data[0]) |
+         static_cast<uint32_t>(data[1]) << 8 |
+         static_cast<uint32_t>(data[2]) << 16 |
+         static_cast<uint32_t>(data[3]) << 24;
+}
+
+void WriteUint32(uint32_t value, uint8_t* data) {
+  data[0] = static_cast<uint8_t>(value);
+  data[1] = static_cast<uint8_t>(value >> 8);
+  data[2] = static_cast<uint8_t>(value >> 16);
+  data[3] = static_cast<uint8_t>(value >> 24);
+}
+
+uint32_t HashName(base::StringPiece name) {
+  return base::PersistentHash(
+      base::as_bytes(base::make_span(name.data(), name.size())));
+}
+
+}  // namespace
+
+bool TransportSecurityStateFlatIndex::Entry::operator==(
+    const Entry& other) const {
+  return sts_include_subdomains == other.sts_include_subdomains &&
+         pkp_include_subdomains == other.pkp_include_subdomains &&
+         force_https == other.force_https && has_pins == other.has_pins &&
+         expect_ct == other.expect_ct && pinset_id == other.pinset_id &&
+         expect_ct_report_uri_id == other.expect_ct_report_uri_id;
+}
+
+// static
+absl::optional<TransportSecurityStateFlatIndex>
+TransportSecurityStateFlatIndex::Create(base::span<const uint8_t> data) {
+  if (data.size() < kHeaderSize || ReadUint32(&data[0]) != kMagic ||
+      ReadUint32(&data[4]) != kVersion) {
+    return absl::nullopt;
+  }
+
+  uint32_t num_slots = ReadUint32(&data[8]);
+  uint32_t names_size = ReadUint32(&data[12]);
+  if (num_slots == 0 || (num_slots & (num_slots - 1)) != 0 ||
+      num_slots > (data.size() - kHeaderSize) / kSlotSize ||
+      data.size() - kHeaderSize - num_slots * kSlotSize != names_size) {
+    return absl::nullopt;
+  }
+
+  return TransportSecurityStateFlatIndex(
+      data.subspan(kHeaderSize, num_slots * kSlotSize),
+      data.subspan(kHeaderSize + num_slots * kSlotSize));
+}
+
+// static
+std::vector<uint8_t> TransportSecurityStateFlatIndex::Build(
+    const std::vector<std::pair<std::string, Entry>>& entries) {
+  // Keep the table at most half full, so that probe sequences stay short.
+  uint32_t num_slots = 1;
+  while (num_slots < 2 * entries.size())
+    num_slots *= 2;
+
+  std::vector<uint8_t> slots(num_slots * kSlotSize);
+  std::string names;
+  for (const auto& [name, entry] : entries) {
+    CHECK(!name.empty());
+    CHECK_LE(name.size(), 255u);
+    CHECK_LT(entry.pinset_id, 256u);
+    CHECK_LT(entry.expect_ct_report_uri_id, 256u);
+
+    uint32_t hash = HashName(name);
+    uint32_t index = hash & (num_slots - 1);
+    while (slots[index * kSlotSize + kSlotNameLength] != 0)
+      index = (index + 1) & (num_slots - 1);
+
+    uint8_t* slot = &slots[index * kSlotSize];
+    WriteUint32(hash, slot + kSlotHash);
+    WriteUint32(names.size(), slot + kSlotNameOffset);
+    slot[kSlotNameLength] = static_cast<uint8_t>(name.size());
+    slot[kSlotFlags] =
+        (entry.sts_include_subdomains ? kSTSIncludeSubdomains : 0) |
+        (entry.pkp_include_subdomains ? kPKPIncludeSubdomains : 0) |
+        (entry.force_https ? kForceHTTPS : 0) |
+        (entry.has_pins ? kHasPins : 0) | (entry.expect_ct ? kExpectCT : 0);
+    slot[kSlotPinsetId] = static_cast<uint8_t>(entry.pinset_id);
+    slot[kSlotExpectCTReportURIId] =
+        static_cast<uint8_t>(entry.expect_ct_report_uri_id);
+    names.append(name);
+  }
+
+  std::vector<uint8_t> data(kHeaderSize);
+  WriteUint32(kMagic, &data[0]);
+  WriteUint32(kVersion, &data[4]);
+  WriteUint32(num_slots, &data[8]);
+  WriteUint32(names.size(), &data[12]);
+  data.insert(data.end(), slots.begin(), slots.end());
+  data.insert(data.end(), names.begin(), names.end());
+  return data;
+}
+
+TransportSecurityStateFlatIndex::TransportSecurityStateFlatIndex(
+    base::span<const uint8_t> slots,
+    base::span<const uint8_t> names)
+    : slots_(slots),
+      names_(names),
+      slot_mask_(slots.size() / kSlotSize - 1) {}
+
+TransportSecurityStateFlatIndex::TransportSecurityStateFlatIndex(
+    const TransportSecurityStateFlatIndex&) = default;
+
+TransportSecurityStateFlatIndex& TransportSecurityStateFlatIndex::operator=(
+    const TransportSecurityStateFlatIndex&) = default;
+
+TransportSecurityStateFlatIndex::~TransportSecurityStateFlatIndex() = default;
+
+bool TransportSecurityStateFlatIndex::Find(base::StringPiece hostname,
+                                           Entry* entry,
+                                           size_t* hostname_offset) const {
+  // Try the most specific suffix first. The first one with an entry decides
+  // the result, even if it does not apply to subdomains.
+  for (size_t offset = 0; offset < hostname.size();) {
+    if (FindExact(hostname.substr(offset), entry)) {
+      if (offset > 0) {
+        if (!entry->sts_include_subdomains && !entry->pkp_include_subdomains)
+          return false;
+        entry->force_https &= entry->sts_include_subdomains;
+      }
+      *hostname_offset = offset;
+      return true;
+    }
+
+    size_t dot = hostname.find('.', offset);
+    if (dot == base::StringPiece::npos)
+      break;
+    offset = dot + 1;
+  }
+  return false;
+}
+
+bool TransportSecurityStateFlatIndex::FindExact(base::StringPiece name,
+                                                Entry* entry) const {
+  uint32_t hash = HashName(name);
+  // The table is never full, so probing ends at an empty slot. Bound the loop
+  // anyway, in case the data is corrupt.
+  for (uint32_t i = 0, index = hash & slot_mask_; i <= slot_mask_;
+       ++i, index = (index + 1) & slot_mask_) {
+    const uint8_t* slot = &slots_[index * kSlotSize];
+    size_t name_length = slot[kSlotNameLength];
+    if (name_length == 0)
+      return false;
+    if (ReadUint32(slot + kSlotHash) != hash || name_length != name.size())
+      continue;
+
+    uint32_t name_offset = ReadUint32(slot + kSlotNameOffset);
+    if (name_offset > names_.size() ||
+        names_.size() - name_offset < name_length) {
+      return false;
+    }
+    if (memcmp(&names_[name_offset], name.data(), name_length) != 0)
+      continue;
+
+    uint8_t flags = slot[kSlotFlags];
+    entry->sts_include_subdomains = flags & kSTSIncludeSubdomains;
+    entry->pkp_include_subdomains = flags & kPKPIncludeSubdomains;
+    entry->force_https = flags & kForceHTTPS;
+    entry->has_pins = flags & kHasPins;
+    entry->expect_ct = flags & kExpectCT;
+    entry->pinset_id = slot[kSlotPinsetId];
+    entry->expect_ct_report_uri_id = slot[kSlotExpectCTReportURIId];
+    return true;
+  }
+  return false;
+}
+
+}  // namespace net
@@ -0,0 +1,100 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_HTTP_TRANSPORT_SECURITY_STATE_FLAT_INDEX_H_
+#define NET_HTTP_TRANSPORT_SECURITY_STATE_FLAT_INDEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/containers/span.h"
+#include "base/strings/string_piece.h"
+#include "net/base/net_export.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
+
+namespace net {
+
+// A read-only view of the static (preloaded) transport security entries,
+// stored as an open-addressed hash table keyed by hostname. Unlike the Huffman
+// coded trie, a lookup hashes each suffix of the hostname that starts at a
+// label boundary and compares bytes in place, without decoding bits.
+//
+// The encoding is position independent and has no pointers, so it can be
+// compiled into the binary or mapped from a file. All integers are little
+// endian:
+//
+//   header:      uint32 magic, uint32 version, uint32 num_slots,
+//                uint32 names_size
+//   slots:       num_slots x {uint32 hash, uint32 name_offset,
+//                             uint8 name_length, uint8 flags,
+//                             uint8 pinset_id, uint8 expect_ct_report_uri_id}
+//   names:       names_size bytes of concatenated hostnames
+//
+// |num_slots| is a power of two, and slots with a |name_length| of zero are
+// empty. Collisions are resolved by linear probing.
+class NET_EXPORT_PRIVATE TransportSecurityStateFlatIndex {
+ public:
+  // The policy of one preloaded hostname. These are the fields of the entries
+  // in the Huffman coded trie.
+  struct NET_EXPORT_PRIVATE Entry {
+    bool operator==(const Entry& other) const;
+
+    bool sts_include_subdomains = false;
+    bool pkp_include_subdomains = false;
+    bool force_https = false;
+    bool has_pins = false;
+    bool expect_ct = false;
+    uint32_t pinset_id = 0;
+    uint32_t expect_ct_report_uri_id = 0;
+  };
+
+  // Returns an index reading |data|, which must outlive it, or nullopt if
+  // |data| does not have a valid header. The slots are checked as they are
+  // read, so creating an index is cheap.
+  static absl::optional<TransportSecurityStateFlatIndex> Create(
+      base::span<const uint8_t> data);
+
+  // Encodes |entries|, which are keyed by lowercase hostnames without a
+  // trailing dot. Hostnames must be unique and at most 255 bytes long, and the
+  // ids must be less than 256.
+  static std::vector<uint8_t> Build(
+      const std::vector<std::pair<std::string, Entry>>& entries);
+
+  TransportSecurityStateFlatIndex(const TransportSecurityStateFlatIndex&);
+  TransportSecurityStateFlatIndex& operator=(
+      const TransportSecurityStateFlatIndex&);
+  ~TransportSecurityStateFlatIndex();
+
+  // Finds the entry for the longest suffix of |hostname| that is either
+  // |hostname| itself or follows a '.'. |hostname| must be lowercase and have
+  // no trailing dot. Returns false if there is no such entry, or if the entry
+  // is for a parent domain and includes neither STS nor PKP subdomains.
+  // Otherwise sets |*entry|, with |force_https| cleared if the entry is for a
+  // parent domain and does not include STS subdomains, and sets
+  // |*hostname_offset| to the offset of the matched suffix in |hostname|.
+  //
+  // This is the result the Huffman coded trie gives for the same entries.
+  bool Find(base::StringPiece hostname,
+            Entry* entry,
+            size_t* hostname_offset) const;
+
+ private:
+  TransportSecurityStateFlatIndex(base::span<const uint8_t> slots,
+                                  base::span<const uint8_t> names);
+
+  // Returns true and sets |*entry| if there is an entry for exactly |name|.
+  bool FindExact(base::StringPiece name, Entry* entry) const;
+
+  base::span<const uint8_t> slots_;
+  base::span<const uint8_t> names_;
+  uint32_t slot_mask_;
+};
+
+}  // namespace net
+
+#endif  // NET_HTTP_TRANSPORT_SECURITY_STATE_FLAT_INDEX_H_
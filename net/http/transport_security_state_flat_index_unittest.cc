@@ -0,0 +1,201 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/transport_security_state_flat_index.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/strings/string_number_conversions.h"
+#include "base/test/scoped_feature_list.h"
+#include "net/base/features.h"
+#include "net/http/transport_security_state.h"
+#include "net/http/transport_security_state_source.h"
+#include "net/http/transport_security_state_test_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace test_default {
+#include "net/http/transport_security_state_static_unittest_default.h"
+}  // namespace test_default
+
+namespace {
+
+using Entry = TransportSecurityStateFlatIndex::Entry;
+
+Entry HSTSEntry(bool include_subdomains) {
+  Entry entry;
+  entry.force_https = true;
+  entry.sts_include_subdomains = include_subdomains;
+  return entry;
+}
+
+Entry PinsEntry(uint32_t pinset_id) {
+  Entry entry;
+  entry.has_pins = true;
+  entry.pinset_id = pinset_id;
+  return entry;
+}
+
+TEST(TransportSecurityStateFlatIndexTest, Find) {
+  Entry pins = PinsEntry(3);
+  pins.force_https = true;
+  pins.pkp_include_subdomains = true;
+  std::vector<uint8_t> data = TransportSecurityStateFlatIndex::Build({
+      {"example.test", HSTSEntry(true)},
+      {"exact.example.test", HSTSEntry(false)},
+      {"pins.test", pins},
+  });
+  absl::optional<TransportSecurityStateFlatIndex> index =
+      TransportSecurityStateFlatIndex::Create(data);
+  ASSERT_TRUE(index);
+
+  Entry entry;
+  size_t offset;
+  ASSERT_TRUE(index->Find("example.test", &entry, &offset));
+  EXPECT_EQ(HSTSEntry(true), entry);
+  EXPECT_EQ(0u, offset);
+
+  ASSERT_TRUE(index->Find("a.b.example.test", &entry, &offset));
+  EXPECT_EQ(HSTSEntry(true), entry);
+  EXPECT_EQ(4u, offset);
+
+  // Only suffixes at label boundaries match.
+  EXPECT_FALSE(index->Find("badexample.test", &entry, &offset));
+  EXPECT_FALSE(index->Find("test", &entry, &offset));
+
+  // The most specific entry decides, even if it does not include subdomains.
+  ASSERT_TRUE(index->Find("exact.example.test", &entry, &offset));
+  EXPECT_EQ(HSTSEntry(false), entry);
+  EXPECT_FALSE(index->Find("www.exact.example.test", &entry, &offset));
+
+  // Subdomains covered for PKP only are not forced to HTTPS.
+  Entry expected = pins;
+  expected.force_https = false;
+  ASSERT_TRUE(index->Find("www.pins.test", &entry, &offset));
+  EXPECT_EQ(expected, entry);
+  EXPECT_EQ(4u, offset);
+}
+
+TEST(TransportSecurityStateFlatIndexTest, ManyEntries) {
+  std::vector<std::pair<std::string, Entry>> entries;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    entries.emplace_back("host" + base::NumberToString(i) + ".test",
+                         PinsEntry(i % 7));
+  }
+  std::vector<uint8_t> data = TransportSecurityStateFlatIndex::Build(entries);
+  absl::optional<TransportSecurityStateFlatIndex> index =
+      TransportSecurityStateFlatIndex::Create(data);
+  ASSERT_TRUE(index);
+
+  for (const auto& [name, expected] : entries) {
+    Entry entry;
+    size_t offset;
+    ASSERT_TRUE(index->Find(name, &entry, &offset)) << name;
+    EXPECT_EQ(expected, entry);
+  }
+  Entry entry;
+  size_t offset;
+  EXPECT_FALSE(index->Find("host1000.test", &entry, &offset));
+}
+
+TEST(TransportSecurityStateFlatIndexTest, Empty) {
+  std::vector<uint8_t> data = TransportSecurityStateFlatIndex::Build({});
+  absl::optional<TransportSecurityStateFlatIndex> index =
+      TransportSecurityStateFlatIndex::Create(data);
+  ASSERT_TRUE(index);
+
+  Entry entry;
+  size_t offset;
+  EXPECT_FALSE(index->Find("example.test", &entry, &offset));
+}
+
+TEST(TransportSecurityStateFlatIndexTest, RejectsInvalidData) {
+  std::vector<uint8_t> data = TransportSecurityStateFlatIndex::Build(
+      {{"example.test", HSTSEntry(true)}});
+  ASSERT_TRUE(TransportSecurityStateFlatIndex::Create(data));
+
+  EXPECT_FALSE(TransportSecurityStateFlatIndex::Create(
+      base::make_span(data).first(data.size() - 1)));
+  EXPECT_FALSE(
+      TransportSecurityStateFlatIndex::Create(base::make_span(data).first(8)));
+
+  std::vector<uint8_t> bad_magic = data;
+  bad_magic[0] ^= 1;
+  EXPECT_FALSE(TransportSecurityStateFlatIndex::Create(bad_magic));
+
+  // The number of slots must be a power of two.
+  std::vector<uint8_t> bad_slots = data;
+  bad_slots[8] = 3;
+  EXPECT_FALSE(TransportSecurityStateFlatIndex::Create(bad_slots));
+}
+
+// Tests that static lookups give the same results with the flat index as with
+// the Huffman coded trie it replaces.
+TEST(TransportSecurityStateFlatIndexTest, MatchesHuffmanTrie) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(
+      features::kStaticKeyPinningEnforcement);
+
+  std::vector<uint8_t> flat_index = TransportSecurityStateFlatIndex::Build(
+      GetDefaultTestSourceFlatIndexEntries());
+  TransportSecurityStateSource flat_source = test_default::kHSTSSource;
+  flat_source.flat_index = flat_index.data();
+  flat_source.flat_index_size = flat_index.size();
+
+  std::vector<std::string> hosts;
+  for (const auto& entry : GetDefaultTestSourceFlatIndexEntries()) {
+    hosts.push_back(entry.first);
+    hosts.push_back("www." + entry.first);
+    hosts.push_back("a.b." + entry.first);
+    hosts.push_back("x" + entry.first);
+    hosts.push_back(entry.first + ".");
+  }
+  for (const char* host :
+       {"", ".", "..", "test", "org", "example.org", "foo.example",
+        "EXAMPLE", "Www.Hsts-Preloaded.Test", "hsts-preloaded.test..",
+        "not-preloaded.test", "bad_host!.test", "a..example"}) {
+    hosts.push_back(host);
+  }
+
+  for (const std::string& host : hosts) {
+    SCOPED_TRACE(host);
+    TransportSecurityState::STSState sts_states[2];
+    TransportSecurityState::PKPState pkp_states[2];
+    bool sts_found[2];
+    bool pkp_found[2];
+    const TransportSecurityStateSource* sources[] = {&test_default::kHSTSSource,
+                                                     &flat_source};
+    for (int i = 0; i < 2; ++i) {
+      SetTransportSecurityStateSourceForTesting(sources[i]);
+      TransportSecurityState state;
+      state.EnableStaticPinsForTesting();
+      state.SetPinningListAlwaysTimelyForTesting(true);
+      sts_found[i] = state.GetStaticSTSState(host, &sts_states[i]);
+      pkp_found[i] = state.GetStaticPKPState(host, &pkp_states[i]);
+    }
+    SetTransportSecurityStateSourceForTesting(nullptr);
+
+    EXPECT_EQ(sts_found[0], sts_found[1]);
+    EXPECT_EQ(sts_states[0].domain, sts_states[1].domain);
+    EXPECT_EQ(sts_states[0].include_subdomains,
+              sts_states[1].include_subdomains);
+    EXPECT_EQ(sts_states[0].ShouldUpgradeToSSL(),
+              sts_states[1].ShouldUpgradeToSSL());
+
+    EXPECT_EQ(pkp_found[0], pkp_found[1]);
+    EXPECT_EQ(pkp_states[0].domain, pkp_states[1].domain);
+    EXPECT_EQ(pkp_states[0].include_subdomains,
+              pkp_states[1].include_subdomains);
+    EXPECT_EQ(pkp_states[0].spki_hashes, pkp_states[1].spki_hashes);
+    EXPECT_EQ(pkp_states[0].bad_spki_hashes, pkp_states[1].bad_spki_hashes);
+    EXPECT_EQ(pkp_states[0].report_uri, pkp_states[1].report_uri);
+  }
+}
+
+}  // namespace
+
+}  // namespace net
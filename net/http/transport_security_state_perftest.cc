@@ -0,0 +1,115 @@
+// Copyright 2022 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/transport_security_state.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/strings/string_number_conversions.h"
+#include "base/timer/elapsed_timer.h"
+#include "net/http/transport_security_state_flat_index.h"
+#include "net/http/transport_security_state_source.h"
+#include "net/http/transport_security_state_test_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace net {
+
+namespace test_default {
+#include "net/http/transport_security_state_static_unittest_default.h"
+}  // namespace test_default
+
+namespace {
+
+constexpr int kIterations = 20000;
+
+// A working set of hosts, most of them not preloaded, as a proxy would see
+// them.
+std::vector<std::string> GetHosts() {
+  std::vector<std::string> hosts = {
+      "hsts-preloaded.test",
+      "www.include-subdomains-hsts-preloaded.test",
+      "a.b.c.include-subdomains-hsts-preloaded.test",
+      "no-rejected-pins-pkp.preloaded.test",
+      "mail.example.org",
+      "foo.example",
+  };
+  for (int i = 0; i < 58; ++i) {
+    hosts.push_back("www.site" + base::NumberToString(i) + ".example.com");
+    hosts.push_back("static.cdn" + base::NumberToString(i) + ".test");
+  }
+  return hosts;
+}
+
+void ReportLookupTime(const std::string& story,
+                      base::TimeDelta elapsed,
+                      size_t num_lookups) {
+  perf_test::PerfResultReporter reporter("TransportSecurityState.", story);
+  reporter.RegisterImportantMetric("lookup_time", "ns");
+  reporter.AddResult("lookup_time",
+                     elapsed.InNanoseconds() / static_cast<double>(num_lookups));
+}
+
+// Runs GetStaticSTSState() over the hosts with |source|.
+void RunStaticLookups(const std::string& story,
+                      const TransportSecurityStateSource* source) {
+  std::vector<std::string> hosts = GetHosts();
+  SetTransportSecurityStateSourceForTesting(source);
+  TransportSecurityState state;
+
+  size_t num_found = 0;
+  base::ElapsedTimer timer;
+  for (int i = 0; i < kIterations; ++i) {
+    for (const std::string& host : hosts) {
+      TransportSecurityState::STSState sts_state;
+      num_found += state.GetStaticSTSState(host, &sts_state);
+    }
+  }
+  ReportLookupTime(story, timer.Elapsed(), kIterations * hosts.size());
+  EXPECT_EQ(4u * kIterations, num_found);
+
+  SetTransportSecurityStateSourceForTesting(nullptr);
+}
+
+TEST(TransportSecurityStatePerfTest, HuffmanTrie) {
+  RunStaticLookups("HuffmanTrie", &test_default::kHSTSSource);
+}
+
+TEST(TransportSecurityStatePerfTest, FlatIndex) {
+  std::vector<uint8_t> flat_index = TransportSecurityStateFlatIndex::Build(
+      GetDefaultTestSourceFlatIndexEntries());
+  TransportSecurityStateSource source = test_default::kHSTSSource;
+  source.flat_index = flat_index.data();
+  source.flat_index_size = flat_index.size();
+  RunStaticLookups("FlatIndex", &source);
+}
+
+// Measures GetSTSState(), which also looks at the dynamic state, once the
+// decision cache holds every host.
+TEST(TransportSecurityStatePerfTest, DecisionCache) {
+  std::vector<std::string> hosts = GetHosts();
+  ScopedTransportSecurityStateSource scoped_source;
+  TransportSecurityState state;
+  state.AddHSTS("dynamic.test", base::Time::Now() + base::Days(1),
+                /*include_subdomains=*/true);
+
+  size_t num_found = 0;
+  base::ElapsedTimer timer;
+  for (int i = 0; i < kIterations; ++i) {
+    for (const std::string& host : hosts) {
+      TransportSecurityState::STSState sts_state;
+      num_found += state.GetSTSState(host, &sts_state);
+    }
+  }
+  ReportLookupTime("DecisionCache", timer.Elapsed(),
+                   kIterations * hosts.size());
+  EXPECT_EQ(4u * kIterations, num_found);
+}
+
+}  // namespace
+
+}  // namespace net
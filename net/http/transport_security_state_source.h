@@ -30,6 +30,10 @@ struct TransportSecurityStateSource {
   const char* const* expect_ct_report_uris;
   const Pinset* pinsets;
   size_t pinsets_count;
+  // If set, a TransportSecurityStateFlatIndex encoding of the same entries as
+  // |preloaded_data|, which is then used for lookups instead of the trie.
+  const uint8_t* flat_index = nullptr;
+  size_t flat_index_size = 0;
 };
 
 }  // namespace net
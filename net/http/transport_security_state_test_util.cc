@@ -71,7 +71,9 @@ ScopedTransportSecurityStateSource::ScopedTransportSecurityStateSource(
       base_source->root_position,
       expect_ct_report_uris_.data(),
       pinsets_.data(),
-      base_source->pinsets_count};
+      base_source->pinsets_count,
+      base_source->flat_index,
+      base_source->flat_index_size};
 
   source_ = std::make_unique<TransportSecurityStateSource>(new_source);
 
@@ -82,4 +84,44 @@ ScopedTransportSecurityStateSource::~ScopedTransportSecurityStateSource() {
   net::SetTransportSecurityStateSourceForTesting(nullptr);
 }
 
+std::vector<std::pair<std::string, TransportSecurityStateFlatIndex::Entry>>
+GetDefaultTestSourceFlatIndexEntries() {
+  using Entry = TransportSecurityStateFlatIndex::Entry;
+  // Pinsets are numbered in the order of the JSON file.
+  const uint32_t kWithoutRejectedPins = 0;
+  const uint32_t kWithReportUri = 2;
+
+  Entry hsts;
+  hsts.force_https = true;
+  Entry hsts_include_subdomains = hsts;
+  hsts_include_subdomains.sts_include_subdomains = true;
+  Entry pins;
+  pins.has_pins = true;
+  pins.pinset_id = kWithoutRejectedPins;
+  Entry pins_with_report_uri = pins;
+  pins_with_report_uri.pinset_id = kWithReportUri;
+  Entry hsts_pins = pins;
+  hsts_pins.force_https = true;
+  Entry expect_ct;
+  expect_ct.expect_ct = true;
+  Entry pins_expect_ct = pins;
+  pins_expect_ct.expect_ct = true;
+
+  return {
+      {"hsts-preloaded.test", hsts},
+      {"include-subdomains-hsts-preloaded.test", hsts_include_subdomains},
+      {"example", hsts_include_subdomains},
+      {"no-rejected-pins-pkp.preloaded.test", pins},
+      {"with-report-uri-pkp.preloaded.test", pins_with_report_uri},
+      {"hsts-hpkp-preloaded.test", hsts_pins},
+      {"expect-ct.preloaded.test", expect_ct},
+      {"pkp-expect-ct.preloaded.test", pins_expect_ct},
+      {"www.example.org", pins},
+      {"test.example.org", pins},
+      {"mail.example.org", pins},
+      {"mail.example.com", pins},
+      {"example.test", pins},
+  };
+}
+
 }  // namespace net
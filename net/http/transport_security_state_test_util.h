@@ -7,8 +7,10 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "net/http/transport_security_state_flat_index.h"
 #include "net/http/transport_security_state_source.h"
 
 namespace net {
@@ -41,6 +43,12 @@ class ScopedTransportSecurityStateSource {
   std::vector<const char*> expect_ct_report_uris_;
 };
 
+// Returns the entries of transport_security_state_static_unittest_default.json
+// as the Huffman coded trie of the default test source encodes them, to build a
+// TransportSecurityStateFlatIndex with the same contents.
+std::vector<std::pair<std::string, TransportSecurityStateFlatIndex::Entry>>
+GetDefaultTestSourceFlatIndexEntries();
+
 }  // namespace net
 
 #endif  // NET_HTTP_TRANSPORT_SECURITY_STATE_TEST_UTIL_H_
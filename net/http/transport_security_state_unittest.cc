@@ -881,6 +881,63 @@ TEST_F(TransportSecurityStateTest, DeleteDynamicDataForHost) {
       "example1.test", network_isolation_key, &expect_ct_state));
 }
 
+// Tests that cached lookup results follow changes to the dynamic state.
+TEST_F(TransportSecurityStateTest, DecisionCacheFollowsDynamicState) {
+  TransportSecurityState state;
+  const base::Time expiry = base::Time::Now() + base::Seconds(1000);
+
+  EXPECT_FALSE(state.ShouldUpgradeToSSL("example1.test"));
+  EXPECT_FALSE(state.ShouldUpgradeToSSL("www.example1.test"));
+  state.AddHSTS("example1.test", expiry, /*include_subdomains=*/true);
+  EXPECT_TRUE(state.ShouldUpgradeToSSL("example1.test"));
+  EXPECT_TRUE(state.ShouldUpgradeToSSL("www.example1.test"));
+
+  EXPECT_FALSE(state.HasPublicKeyPins("www.example1.test"));
+  state.AddHPKP("example1.test", expiry, /*include_subdomains=*/true,
+                GetSampleSPKIHashes(), GURL());
+  EXPECT_TRUE(state.HasPublicKeyPins("www.example1.test"));
+
+  // Cached results expire with the entries they were computed from.
+  FastForwardBy(base::Seconds(1001));
+  EXPECT_FALSE(state.ShouldUpgradeToSSL("www.example1.test"));
+  EXPECT_FALSE(state.HasPublicKeyPins("www.example1.test"));
+
+  state.AddHSTS("example1.test", base::Time::Now() + base::Seconds(1000),
+                /*include_subdomains=*/false);
+  EXPECT_TRUE(state.ShouldUpgradeToSSL("example1.test"));
+  EXPECT_TRUE(state.DeleteDynamicDataForHost("example1.test"));
+  EXPECT_FALSE(state.ShouldUpgradeToSSL("example1.test"));
+
+  state.AddHSTS("example1.test", base::Time::Now() + base::Seconds(1000),
+                /*include_subdomains=*/false);
+  EXPECT_TRUE(state.ShouldUpgradeToSSL("example1.test"));
+  state.ClearDynamicData();
+  EXPECT_FALSE(state.ShouldUpgradeToSSL("example1.test"));
+}
+
+// Tests that cached lookup results follow changes to the static state.
+TEST_F(TransportSecurityStateTest, DecisionCacheFollowsStaticState) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(
+      net::features::kStaticKeyPinningEnforcement);
+  TransportSecurityState state;
+  EnableStaticPins(&state);
+
+  EXPECT_TRUE(state.ShouldUpgradeToSSL("hsts-preloaded.test"));
+  EXPECT_TRUE(state.HasPublicKeyPins("no-rejected-pins-pkp.preloaded.test"));
+
+  DisableStaticPins(&state);
+  EXPECT_FALSE(state.HasPublicKeyPins("no-rejected-pins-pkp.preloaded.test"));
+  EnableStaticPins(&state);
+  EXPECT_TRUE(state.HasPublicKeyPins("no-rejected-pins-pkp.preloaded.test"));
+
+  // Switch to a source that does not preload the host.
+  SetTransportSecurityStateSourceForTesting(&test1::kHSTSSource);
+  EXPECT_FALSE(state.ShouldUpgradeToSSL("hsts-preloaded.test"));
+  SetTransportSecurityStateSourceForTesting(&test_default::kHSTSSource);
+  EXPECT_TRUE(state.ShouldUpgradeToSSL("hsts-preloaded.test"));
+}
+
 TEST_F(TransportSecurityStateTest, LongNames) {
   TransportSecurityState state;
   state.SetPinningListAlwaysTimelyForTesting(true);
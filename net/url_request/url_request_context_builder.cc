@@ -32,6 +32,7 @@
 #include "net/dns/host_resolver_manager.h"
 #include "net/http/http_auth_handler_factory.h"
 #include "net/http/http_cache.h"
+#include "net/http/http_coalescing_layer.h"
 #include "net/http/http_network_layer.h"
 #include "net/http/http_network_session.h"
 #include "net/http/http_server_properties.h"
@@ -587,6 +588,11 @@ std::unique_ptr<URLRequestContext> URLRequestContextBuilder::Build() {
         std::make_unique<HttpNetworkLayer>(storage->http_network_session());
   }
 
+  if (request_coalescing_enabled_) {
+    http_transaction_factory = std::make_unique<HttpCoalescingLayer>(
+        std::move(http_transaction_factory));
+  }
+
   if (http_cache_enabled_) {
     std::unique_ptr<HttpCache::BackendFactory> http_cache_backend;
     if (http_cache_params_.type != HttpCacheParams::IN_MEMORY) {
@@ -620,8 +626,10 @@ std::unique_ptr<URLRequestContext> URLRequestContextBuilder::Build() {
         http_cache_params_.app_status_listener);
 #endif
 
-    http_transaction_factory = std::make_unique<HttpCache>(
+    auto http_cache = std::make_unique<HttpCache>(
         std::move(http_transaction_factory), std::move(http_cache_backend));
+    http_cache->SetHotTierMaxBytes(http_cache_params_.hot_tier_max_bytes);
+    http_transaction_factory = std::move(http_cache);
   }
   storage->set_http_transaction_factory(std::move(http_transaction_factory));
 
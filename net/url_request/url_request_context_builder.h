@@ -14,6 +14,7 @@
 #ifndef NET_URL_REQUEST_URL_REQUEST_CONTEXT_BUILDER_H_
 #define NET_URL_REQUEST_URL_REQUEST_CONTEXT_BUILDER_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include <map>
@@ -118,6 +119,11 @@ class NET_EXPORT URLRequestContextBuilder {
     // Whether or not we need to reset the cache due to an experiment change.
     bool reset_cache = false;
 
+    // The max size in bytes of the in-memory tier that holds small, frequently
+    // used responses in front of the cache backend. Zero, the default,
+    // disables the tier.
+    size_t hot_tier_max_bytes = 0;
+
     // The cache path (when type is DISK).
     base::FilePath path;
 
@@ -281,6 +287,12 @@ class NET_EXPORT URLRequestContextBuilder {
   void set_throttling_enabled(bool throttling_enabled) {
     throttling_enabled_ = throttling_enabled;
   }
+
+  // If enabled, concurrent identical GET requests that miss the cache share a
+  // single network transaction. See HttpCoalescingLayer. Disabled by default.
+  void set_request_coalescing_enabled(bool request_coalescing_enabled) {
+    request_coalescing_enabled_ = request_coalescing_enabled;
+  }
   void set_first_party_sets_enabled(bool enabled) {
     first_party_sets_enabled_ = enabled;
   }
@@ -414,6 +426,7 @@ class NET_EXPORT URLRequestContextBuilder {
 
   bool http_cache_enabled_ = true;
   bool throttling_enabled_ = false;
+  bool request_coalescing_enabled_ = false;
   bool cookie_store_set_by_client_ = false;
   bool suppress_setting_socket_performance_watcher_factory_for_testing_ = false;
   bool first_party_sets_enabled_ = false;
@@ -4,6 +4,7 @@
 
 #include "net/url_request/url_request_throttler_entry.h"
 
+#include <algorithm>
 #include <cmath>
 #include <utility>
 
@@ -11,6 +12,7 @@
 #include "base/check_op.h"
 #include "base/metrics/field_trial.h"
 #include "base/metrics/histogram_macros.h"
+#include "base/numerics/safe_conversions.h"
 #include "base/rand_util.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/values.h"
@@ -49,24 +51,14 @@ const double URLRequestThrottlerEntry::kDefaultMultiplyFactor = 1.4;
 const double URLRequestThrottlerEntry::kDefaultJitterFactor = 0.4;
 const int URLRequestThrottlerEntry::kDefaultMaximumBackoffMs = 15 * 60 * 1000;
 const int URLRequestThrottlerEntry::kDefaultEntryLifetimeMs = 2 * 60 * 1000;
-
-// Returns NetLog parameters when a request is rejected by throttling.
-base::Value NetLogRejectedRequestParams(const std::string* url_id,
-                                        int num_failures,
-                                        const base::TimeDelta& release_after) {
-  base::Value dict(base::Value::Type::DICTIONARY);
-  dict.SetStringKey("url", *url_id);
-  dict.SetIntKey("num_failures", num_failures);
-  dict.SetIntKey("release_after_ms",
-                 static_cast<int>(release_after.InMilliseconds()));
-  return dict;
-}
+const double URLRequestThrottlerEntry::kErrorRateWeight = 0.1;
 
 URLRequestThrottlerEntry::URLRequestThrottlerEntry(
     URLRequestThrottlerManager* manager,
     const std::string& url_id)
     : sliding_window_period_(base::Milliseconds(kDefaultSlidingWindowPeriodMs)),
       max_send_threshold_(kDefaultMaxSendThreshold),
+      adaptive_backoff_bounds_(manager->adaptive_backoff_bounds()),
       backoff_entry_(&backoff_policy_),
       manager_(manager),
       url_id_(url_id),
@@ -75,6 +67,10 @@ URLRequestThrottlerEntry::URLRequestThrottlerEntry(
           NetLogSourceType::EXPONENTIAL_BACKOFF_THROTTLING)) {
   DCHECK(manager_);
   Initialize();
+  // Earlier entries for |url_id| may have been garbage collected, but the
+  // manager keeps their error rate.
+  if (adaptive_backoff_bounds_)
+    SetErrorRate(manager_->GetErrorRate(url_id_));
 }
 
 URLRequestThrottlerEntry::URLRequestThrottlerEntry(
@@ -145,15 +141,44 @@ void URLRequestThrottlerEntry::DetachManager() {
   manager_ = nullptr;
 }
 
+base::Value::Dict URLRequestThrottlerEntry::GetInfoAsValue() const {
+  const base::TimeTicks now = ImplGetTimeNow();
+  const BackoffEntry* backoff_entry = GetBackoffEntry();
+
+  // Requests that were advised to wait, and haven't been sent yet.
+  int queued_requests = 0;
+  for (const base::TimeTicks& send_time : send_log_) {
+    if (send_time > now)
+      ++queued_requests;
+  }
+
+  base::Value::Dict dict;
+  dict.Set("url", url_id_);
+  dict.Set("num_failures", backoff_entry->failure_count());
+  dict.Set("backoff_disabled", is_backoff_disabled_);
+  dict.Set("release_after_ms",
+           static_cast<int>(std::max(GetExponentialBackoffReleaseTime() - now,
+                                     base::TimeDelta())
+                                .InMilliseconds()));
+  dict.Set("queued_requests", queued_requests);
+  dict.Set("sliding_window_release_after_ms",
+           static_cast<int>(std::max(sliding_window_release_time_ - now,
+                                     base::TimeDelta())
+                                .InMilliseconds()));
+  if (adaptive_backoff_bounds_) {
+    dict.Set("error_rate", error_rate_);
+    dict.Set("initial_delay_ms", backoff_policy_.initial_delay_ms);
+    dict.Set("num_errors_to_ignore", backoff_policy_.num_errors_to_ignore);
+  }
+  return dict;
+}
+
 bool URLRequestThrottlerEntry::ShouldRejectRequest(
     const URLRequest& request) const {
   bool reject_request = false;
   if (!is_backoff_disabled_ && GetBackoffEntry()->ShouldRejectRequest()) {
-    net_log_.AddEvent(NetLogEventType::THROTTLING_REJECTED_REQUEST, [&] {
-      return NetLogRejectedRequestParams(
-          &url_id_, GetBackoffEntry()->failure_count(),
-          GetBackoffEntry()->GetTimeUntilRelease());
-    });
+    net_log_.AddEvent(NetLogEventType::THROTTLING_REJECTED_REQUEST,
+                      [&] { return base::Value(GetInfoAsValue()); });
     reject_request = true;
   }
 
@@ -179,7 +204,7 @@ int64_t URLRequestThrottlerEntry::ReserveSendingTimeForNextRequest(
   DCHECK(send_log_.empty() ||
          recommended_sending_time >= send_log_.back());
   // Log the new send event.
-  send_log_.push(recommended_sending_time);
+  send_log_.push_back(recommended_sending_time);
 
   sliding_window_release_time_ = recommended_sending_time;
 
@@ -189,7 +214,7 @@ int64_t URLRequestThrottlerEntry::ReserveSendingTimeForNextRequest(
   while ((send_log_.front() + sliding_window_period_ <=
           sliding_window_release_time_) ||
          send_log_.size() > static_cast<unsigned>(max_send_threshold_)) {
-    send_log_.pop();
+    send_log_.pop_front();
   }
 
   // Check if there are too many send events in recent time.
@@ -213,7 +238,9 @@ base::TimeTicks
 }
 
 void URLRequestThrottlerEntry::UpdateWithResponse(int status_code) {
-  GetBackoffEntry()->InformOfRequest(IsConsideredSuccess(status_code));
+  const bool success = IsConsideredSuccess(status_code);
+  UpdateErrorRate(success);
+  GetBackoffEntry()->InformOfRequest(success);
 }
 
 void URLRequestThrottlerEntry::ReceivedContentWasMalformed(int response_code) {
@@ -267,6 +294,29 @@ bool URLRequestThrottlerEntry::IsConsideredSuccess(int response_code) {
            response_code == 509);
 }
 
+void URLRequestThrottlerEntry::UpdateErrorRate(bool success) {
+  // The manager is detached when it goes away, at which point the back-off
+  // policy is left as it is.
+  if (!adaptive_backoff_bounds_ || !manager_)
+    return;
+  SetErrorRate(manager_->UpdateErrorRate(url_id_, success));
+}
+
+void URLRequestThrottlerEntry::SetErrorRate(double error_rate) {
+  DCHECK(adaptive_backoff_bounds_);
+  error_rate_ = error_rate;
+
+  // Back off sooner and for longer from servers that fail more often, and
+  // tolerate a few errors from those that mostly succeed.
+  const AdaptiveBackoffBounds& bounds = *adaptive_backoff_bounds_;
+  backoff_policy_.initial_delay_ms = base::ClampRound(
+      bounds.min_initial_delay_ms +
+      error_rate_ *
+          (bounds.max_initial_delay_ms - bounds.min_initial_delay_ms));
+  backoff_policy_.num_errors_to_ignore =
+      base::ClampRound(bounds.max_errors_to_ignore * (1.0 - error_rate_));
+}
+
 base::TimeTicks URLRequestThrottlerEntry::ImplGetTimeNow() const {
   return base::TimeTicks::Now();
 }
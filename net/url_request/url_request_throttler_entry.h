@@ -9,13 +9,15 @@
 
 #include <string>
 
-#include "base/containers/queue.h"
+#include "base/containers/circular_deque.h"
 #include "base/memory/raw_ptr.h"
 #include "base/time/time.h"
+#include "base/values.h"
 #include "net/base/backoff_entry.h"
 #include "net/base/net_export.h"
 #include "net/log/net_log_with_source.h"
 #include "net/url_request/url_request_throttler_entry_interface.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
 
 namespace net {
 
@@ -60,6 +62,20 @@ class NET_EXPORT URLRequestThrottlerEntry
   // Time after which the entry is considered outdated.
   static const int kDefaultEntryLifetimeMs;
 
+  // Weight of each response in the moving average of the server error rate
+  // used by adaptive back-off.
+  static const double kErrorRateWeight;
+
+  // Bounds of the back-off policy in adaptive mode, where it is sized from the
+  // rate of server errors. The initial delay grows from |min_initial_delay_ms|
+  // to |max_initial_delay_ms| as the error rate grows from 0 to 1, and the
+  // number of errors to ignore shrinks from |max_errors_to_ignore| to 0.
+  struct AdaptiveBackoffBounds {
+    int min_initial_delay_ms;
+    int max_initial_delay_ms;
+    int max_errors_to_ignore;
+  };
+
   // The manager object's lifetime must enclose the lifetime of this object.
   URLRequestThrottlerEntry(URLRequestThrottlerManager* manager,
                            const std::string& url_id);
@@ -89,6 +105,14 @@ class NET_EXPORT URLRequestThrottlerEntry
   // Causes this entry to NULL its manager pointer.
   void DetachManager();
 
+  // Returns the back-off and sliding window state of the entry: the failure
+  // count, the time until requests are released, the number of requests that
+  // were advised to wait, and in adaptive mode the error rate and the
+  // resulting back-off parameters. These are the parameters of the
+  // THROTTLING_REJECTED_REQUEST event, so that the state that led to
+  // rejecting a request can be inspected in the NetLog.
+  base::Value::Dict GetInfoAsValue() const;
+
   // Implementation of URLRequestThrottlerEntryInterface.
   bool ShouldRejectRequest(const URLRequest& request) const override;
   int64_t ReserveSendingTimeForNextRequest(
@@ -124,10 +148,19 @@ class NET_EXPORT URLRequestThrottlerEntry
     sliding_window_release_time_ = release_time;
   }
 
-  // Valid and immutable after construction time.
+  // Valid after construction time. Immutable unless adaptive back-off is
+  // enabled, in which case UpdateWithResponse() resizes it.
   BackoffEntry::Policy backoff_policy_;
 
  private:
+  // Updates the error rate the manager keeps for |url_id_| with a response,
+  // if adaptive back-off is enabled.
+  void UpdateErrorRate(bool success);
+
+  // Sets |error_rate_| and resizes |backoff_policy_| from it. Only valid if
+  // adaptive back-off is enabled.
+  void SetErrorRate(double error_rate);
+
   // Timestamp calculated by the sliding window algorithm for when we advise
   // clients the next request should be made, at the earliest. Advisory only,
   // not used to deny requests.
@@ -135,7 +168,7 @@ class NET_EXPORT URLRequestThrottlerEntry
 
   // A list of the recent send events. We use them to decide whether there are
   // too many requests sent in sliding window.
-  base::queue<base::TimeTicks> send_log_;
+  base::circular_deque<base::TimeTicks> send_log_;
 
   const base::TimeDelta sliding_window_period_;
   const int max_send_threshold_;
@@ -143,6 +176,13 @@ class NET_EXPORT URLRequestThrottlerEntry
   // True if DisableBackoffThrottling() has been called on this object.
   bool is_backoff_disabled_ = false;
 
+  // Set if the back-off policy is sized from |error_rate_|.
+  const absl::optional<AdaptiveBackoffBounds> adaptive_backoff_bounds_;
+
+  // Last error rate of |url_id_| reported by the manager. The manager owns
+  // the rate so that it outlives garbage-collected entries.
+  double error_rate_ = 0.0;
+
   // Access it through GetBackoffEntry() to allow a unit test seam.
   BackoffEntry backoff_entry_;
 
@@ -5,7 +5,9 @@
 #include "net/url_request/url_request_throttler_manager.h"
 
 #include "base/check_op.h"
+#include "base/feature_list.h"
 #include "base/strings/string_util.h"
+#include "net/base/features.h"
 #include "net/base/url_util.h"
 #include "net/log/net_log.h"
 #include "net/log/net_log_event_type.h"
@@ -16,7 +18,30 @@ namespace net {
 const unsigned int URLRequestThrottlerManager::kMaximumNumberOfEntries = 1500;
 const unsigned int URLRequestThrottlerManager::kRequestsBetweenCollecting = 200;
 
-URLRequestThrottlerManager::URLRequestThrottlerManager() {
+namespace {
+
+absl::optional<URLRequestThrottlerEntry::AdaptiveBackoffBounds>
+GetAdaptiveBackoffBounds() {
+  if (!base::FeatureList::IsEnabled(features::kAdaptiveURLRequestThrottling))
+    return absl::nullopt;
+  URLRequestThrottlerEntry::AdaptiveBackoffBounds bounds = {
+      features::kAdaptiveURLRequestThrottlingMinInitialDelayMs.Get(),
+      features::kAdaptiveURLRequestThrottlingMaxInitialDelayMs.Get(),
+      features::kAdaptiveURLRequestThrottlingMaxErrorsToIgnore.Get()};
+  // Ignore bounds that make no sense.
+  if (bounds.min_initial_delay_ms < 0 ||
+      bounds.max_initial_delay_ms < bounds.min_initial_delay_ms ||
+      bounds.max_errors_to_ignore < 0) {
+    return absl::nullopt;
+  }
+  return bounds;
+}
+
+}  // namespace
+
+URLRequestThrottlerManager::URLRequestThrottlerManager()
+    : adaptive_backoff_bounds_(GetAdaptiveBackoffBounds()),
+      error_rates_(kMaximumNumberOfEntries) {
   url_id_replacements_.ClearPassword();
   url_id_replacements_.ClearUsername();
   url_id_replacements_.ClearQuery();
@@ -118,6 +143,23 @@ NetLog* URLRequestThrottlerManager::net_log() const {
   return net_log_.net_log();
 }
 
+double URLRequestThrottlerManager::GetErrorRate(
+    const std::string& url_id) const {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  auto it = error_rates_.Peek(url_id);
+  return it == error_rates_.end() ? 0.0 : it->second;
+}
+
+double URLRequestThrottlerManager::UpdateErrorRate(const std::string& url_id,
+                                                   bool success) {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  double error_rate = GetErrorRate(url_id);
+  error_rate += URLRequestThrottlerEntry::kErrorRateWeight *
+                ((success ? 0.0 : 1.0) - error_rate);
+  error_rates_.Put(url_id, error_rate);
+  return error_rate;
+}
+
 void URLRequestThrottlerManager::OnIPAddressChanged() {
   OnNetworkChange();
 }
@@ -166,6 +208,7 @@ void URLRequestThrottlerManager::OnNetworkChange() {
   // inconsistent with new entries for the same URLs, but since what we
   // want is a clean slate for the new connection type, this is OK.
   url_entries_.clear();
+  error_rates_.Clear();
   requests_since_last_gc_ = 0;
 }
 
@@ -9,12 +9,14 @@
 #include <set>
 #include <string>
 
+#include "base/containers/lru_cache.h"
 #include "base/memory/ref_counted.h"
 #include "base/threading/platform_thread.h"
 #include "base/threading/thread_checker.h"
 #include "net/base/net_export.h"
 #include "net/base/network_change_notifier.h"
 #include "net/url_request/url_request_throttler_entry.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
 #include "url/gurl.h"
 
 namespace net {
@@ -70,6 +72,25 @@ class NET_EXPORT_PRIVATE URLRequestThrottlerManager
   void set_net_log(NetLog* net_log);
   NetLog* net_log() const;
 
+  // Set if the entries size their back-off from the server error rate, with
+  // the bounds of features::kAdaptiveURLRequestThrottling. Applies to entries
+  // created after construction.
+  const absl::optional<URLRequestThrottlerEntry::AdaptiveBackoffBounds>&
+  adaptive_backoff_bounds() const {
+    return adaptive_backoff_bounds_;
+  }
+
+  // Returns the moving average of the server error rate for |url_id|, or 0 if
+  // none is known. Rates are only tracked with adaptive back-off, and are
+  // kept across garbage collection of the entries, so that a server that
+  // fails intermittently, with gaps longer than the entry lifetime, is still
+  // backed off from according to its history. They are reset on network
+  // changes, like the entries.
+  double GetErrorRate(const std::string& url_id) const;
+
+  // Updates the error rate of |url_id| with a response and returns it.
+  double UpdateErrorRate(const std::string& url_id, bool success);
+
   // IPAddressObserver interface.
   void OnIPAddressChanged() override;
 
@@ -141,6 +162,13 @@ class NET_EXPORT_PRIVATE URLRequestThrottlerManager
   // NetLog to use, if configured.
   NetLogWithSource net_log_;
 
+  const absl::optional<URLRequestThrottlerEntry::AdaptiveBackoffBounds>
+      adaptive_backoff_bounds_;
+
+  // Error rates by URL ID. Bounded like |url_entries_|, dropping the least
+  // recently updated rates first.
+  base::HashingLRUCache<std::string, double> error_rates_;
+
   // Valid once we've registered for network notifications.
   base::PlatformThreadId registered_from_thread_ = base::kInvalidThreadId;
 
@@ -8,7 +8,10 @@
 #include "base/pickle.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/test/metrics/histogram_tester.h"
+#include "base/test/scoped_feature_list.h"
 #include "base/time/time.h"
+#include "base/values.h"
+#include "net/base/features.h"
 #include "net/base/load_flags.h"
 #include "net/base/request_priority.h"
 #include "net/base/test_completion_callback.h"
@@ -310,6 +313,24 @@ TEST_F(URLRequestThrottlerEntryTest, SlidingWindow) {
   EXPECT_EQ(time_4, entry_->sliding_window_release_time());
 }
 
+TEST_F(URLRequestThrottlerEntryTest, GetInfoAsValue) {
+  base::Value::Dict info = entry_->GetInfoAsValue();
+  EXPECT_EQ(0, info.FindInt("num_failures"));
+  EXPECT_EQ(0, info.FindInt("release_after_ms"));
+  EXPECT_EQ(0, info.FindInt("queued_requests"));
+  // Without adaptive back-off, the error rate isn't reported.
+  EXPECT_FALSE(info.Find("error_rate"));
+
+  entry_->UpdateWithResponse(503);
+  const TimeTicks release_time = entry_->GetExponentialBackoffReleaseTime();
+  entry_->ReserveSendingTimeForNextRequest(release_time);
+  info = entry_->GetInfoAsValue();
+  EXPECT_EQ(1, info.FindInt("num_failures"));
+  EXPECT_EQ((release_time - now_).InMilliseconds(),
+            info.FindInt("release_after_ms"));
+  EXPECT_EQ(1, info.FindInt("queued_requests"));
+}
+
 class URLRequestThrottlerManagerTest : public TestWithTaskEnvironment {
  protected:
   URLRequestThrottlerManagerTest()
@@ -409,6 +430,79 @@ TEST_F(URLRequestThrottlerManagerTest, LocalHostOptedOut) {
             localhost_entry->GetExponentialBackoffReleaseTime());
 }
 
+TEST_F(URLRequestThrottlerManagerTest, AdaptiveBackoff) {
+  base::test::ScopedFeatureList feature_list;
+  feature_list.InitAndEnableFeatureWithParameters(
+      features::kAdaptiveURLRequestThrottling,
+      {{"min_initial_delay_ms", "100"},
+       {"max_initial_delay_ms", "1000"},
+       {"max_errors_to_ignore", "4"}});
+  MockURLRequestThrottlerManager manager;
+  ASSERT_TRUE(manager.adaptive_backoff_bounds());
+
+  const std::string url_id =
+      manager.DoGetUrlIdFromUrl(GURL("http://www.example.com/"));
+  auto entry = base::MakeRefCounted<URLRequestThrottlerEntry>(&manager, url_id);
+  base::Value::Dict info = entry->GetInfoAsValue();
+  EXPECT_EQ(0.0, info.FindDouble("error_rate"));
+  EXPECT_EQ(100, info.FindInt("initial_delay_ms"));
+  EXPECT_EQ(4, info.FindInt("num_errors_to_ignore"));
+
+  // A server that keeps failing is backed off from sooner, and for longer.
+  for (int i = 0; i < 10; ++i)
+    entry->UpdateWithResponse(503);
+  info = entry->GetInfoAsValue();
+  EXPECT_GT(info.FindDouble("error_rate").value_or(0.0), 0.5);
+  EXPECT_GT(info.FindInt("initial_delay_ms").value_or(0), 500);
+  EXPECT_LT(info.FindInt("num_errors_to_ignore").value_or(4), 2);
+  EXPECT_TRUE(entry->ShouldRejectRequest(*request_));
+
+  // Once it recovers, the bounds relax again.
+  for (int i = 0; i < 30; ++i)
+    entry->UpdateWithResponse(200);
+  info = entry->GetInfoAsValue();
+  EXPECT_LT(info.FindDouble("error_rate").value_or(1.0), 0.1);
+  EXPECT_LT(info.FindInt("initial_delay_ms").value_or(1000), 200);
+  EXPECT_EQ(4, info.FindInt("num_errors_to_ignore"));
+}
+
+// The error rate of a URL outlives its entry, so that a server that fails
+// with gaps longer than the entry lifetime is still backed off from.
+TEST_F(URLRequestThrottlerManagerTest, AdaptiveBackoffErrorRateOutlivesEntry) {
+  base::test::ScopedFeatureList feature_list;
+  feature_list.InitAndEnableFeatureWithParameters(
+      features::kAdaptiveURLRequestThrottling,
+      {{"min_initial_delay_ms", "100"},
+       {"max_initial_delay_ms", "1000"},
+       {"max_errors_to_ignore", "4"}});
+  MockURLRequestThrottlerManager manager;
+
+  const GURL url("http://www.example.com/");
+  const std::string url_id = manager.DoGetUrlIdFromUrl(url);
+  scoped_refptr<URLRequestThrottlerEntryInterface> entry =
+      manager.RegisterRequestUrl(url);
+  for (int i = 0; i < 10; ++i)
+    entry->UpdateWithResponse(503);
+  const double error_rate = manager.GetErrorRate(url_id);
+  EXPECT_GT(error_rate, 0.5);
+
+  // Once the entry is gone, e.g. because it was garbage collected, a new
+  // entry for the URL picks up the rate.
+  entry = nullptr;
+  manager.EraseEntryForTests(url);
+  EXPECT_EQ(0, manager.GetNumberOfEntries());
+
+  auto new_entry =
+      base::MakeRefCounted<URLRequestThrottlerEntry>(&manager, url_id);
+  base::Value::Dict info = new_entry->GetInfoAsValue();
+  EXPECT_EQ(error_rate, info.FindDouble("error_rate"));
+  EXPECT_GT(info.FindInt("initial_delay_ms").value_or(0), 500);
+
+  // Network changes start from a clean slate.
+  manager.OnIPAddressChanged();
+  EXPECT_EQ(0.0, manager.GetErrorRate(url_id));
+}
+
 TEST_F(URLRequestThrottlerManagerTest, ClearOnNetworkChange) {
   for (int i = 0; i < 3; ++i) {
     MockURLRequestThrottlerManager manager;